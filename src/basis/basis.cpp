@@ -18,26 +18,27 @@ void POLYQUANT_BASIS::load_quantum_particle_basis(const std::string &quantum_par
   }
 }
 void POLYQUANT_BASIS::load_quantum_particle_atom_basis(const std::string &quantum_part_key, const std::string &classical_part_key, const CLASSICAL_PARTICLE_SET &classical_part,
-                                                       libint2::BasisSet &qp_basis) {
-  if (input->input_data["model"]["basis"][quantum_part_key].contains(classical_part_key)) {
+                                                       libint2::BasisSet &qp_basis, const std::string &basis_section) {
+  if (input->input_data["model"][basis_section][quantum_part_key].contains(classical_part_key)) {
     auto center_basis_idx = 0;
-    for (auto center_basis : input->input_data["model"]["basis"][quantum_part_key][classical_part_key]) {
+    for (auto center_basis : input->input_data["model"][basis_section][quantum_part_key][classical_part_key]) {
       if (center_basis.contains("library")) {
-        load_quantum_particle_atom_basis_library(quantum_part_key, classical_part_key, center_basis_idx, qp_basis);
+        load_quantum_particle_atom_basis_library(quantum_part_key, classical_part_key, center_basis_idx, qp_basis, basis_section);
       } else if (center_basis.contains("custom")) {
-        load_quantum_particle_atom_basis_custom(quantum_part_key, classical_part_key, center_basis_idx, classical_part, qp_basis);
+        load_quantum_particle_atom_basis_custom(quantum_part_key, classical_part_key, center_basis_idx, classical_part, qp_basis, basis_section);
       } else {
-        APP_ABORT("'model->basis->" + quantum_part_key + "->" + classical_part_key + "->type' must be library or custom.");
+        APP_ABORT("'model->" + basis_section + "->" + quantum_part_key + "->" + classical_part_key + "->type' must be library or custom.");
       }
       center_basis_idx++;
     }
   } else {
-    Polyquant_cout("'model->basis->" + quantum_part_key + "' didn't contain a basis for: " + classical_part_key);
+    Polyquant_cout("'model->" + basis_section + "->" + quantum_part_key + "' didn't contain a basis for: " + classical_part_key);
   }
 }
 
-void POLYQUANT_BASIS::load_quantum_particle_atom_basis_library(const std::string &quantum_part_key, const std::string &classical_part_key, const int &center_basis_idx, libint2::BasisSet &qp_basis) {
-  auto center_basis = input->input_data["model"]["basis"][quantum_part_key][classical_part_key][center_basis_idx];
+void POLYQUANT_BASIS::load_quantum_particle_atom_basis_library(const std::string &quantum_part_key, const std::string &classical_part_key, const int &center_basis_idx, libint2::BasisSet &qp_basis,
+                                                               const std::string &basis_section) {
+  auto center_basis = input->input_data["model"][basis_section][quantum_part_key][classical_part_key][center_basis_idx];
   try {
     // library basis with atom type specified
     if (center_basis["library"].contains("atom")) {
@@ -99,9 +100,9 @@ void POLYQUANT_BASIS::load_quantum_particle_atom_basis_library(const std::string
   }
 }
 void POLYQUANT_BASIS::load_quantum_particle_atom_basis_custom(const std::string &quantum_part_key, const std::string &classical_part_key, const int &center_basis_idx,
-                                                              const CLASSICAL_PARTICLE_SET &classical_part, libint2::BasisSet &qp_basis) {
+                                                              const CLASSICAL_PARTICLE_SET &classical_part, libint2::BasisSet &qp_basis, const std::string &basis_section) {
   libint2::BasisSet atom_basis = libint2::BasisSet();
-  auto center_basis = input->input_data["model"]["basis"][quantum_part_key][classical_part_key][center_basis_idx];
+  auto center_basis = input->input_data["model"][basis_section][quantum_part_key][classical_part_key][center_basis_idx];
   if (center_basis["custom"].contains("type")) {
     if (center_basis["custom"]["type"] == "even-tempered") {
       // TODO
@@ -130,7 +131,22 @@ void POLYQUANT_BASIS::load_quantum_particle_atom_basis_custom(const std::string
       qp_basis.set_pure(this->pure);
     }
   } else {
-    APP_ABORT("'model->basis->" + quantum_part_key + "->" + classical_part_key + "->custom' needs a type key.");
+    APP_ABORT("'model->" + basis_section + "->" + quantum_part_key + "->" + classical_part_key + "->custom' needs a type key.");
+  }
+}
+
+void POLYQUANT_BASIS::load_aux_basis() {
+  for (auto const &[quantum_part_key, quantum_part] : molecule->quantum_particles) {
+    libint2::BasisSet qp_aux_basis = libint2::BasisSet();
+    if (input->input_data["model"]["aux_basis"].contains(quantum_part_key)) {
+      for (auto const &[classical_part_key, classical_part] : molecule->classical_particles) {
+        load_quantum_particle_atom_basis(quantum_part_key, classical_part_key, classical_part, qp_aux_basis, "aux_basis");
+      }
+      Polyquant_cout("Added density fitting basis for " + quantum_part_key);
+      Polyquant_cout("Number of density fitting basis functions: " + std::to_string(qp_aux_basis.nbf()));
+    }
+    this->num_aux_basis.emplace_back(qp_aux_basis.size() == 0 ? 0 : qp_aux_basis.nbf());
+    this->aux_basis.emplace_back(qp_aux_basis);
   }
 }
 
@@ -629,6 +645,9 @@ void POLYQUANT_BASIS::load_basis(std::shared_ptr<POLYQUANT_INPUT> input_params,
   } else {
     APP_ABORT("Cannot set up basis. Input json missing 'model' section.");
   }
+  if (input->input_data["model"].contains("aux_basis")) {
+    this->load_aux_basis();
+  }
   this->print_basis();
   this->set_ao_labels();
   this->symmetrize_basis();
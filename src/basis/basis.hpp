@@ -36,10 +36,18 @@ public:
   void load_basis(std::shared_ptr<POLYQUANT_INPUT> input_params, std::shared_ptr<POLYQUANT_SYMMETRY> input_symmetry, std::shared_ptr<POLYQUANT_MOLECULE> input_molecule);
 
   void load_quantum_particle_basis(const std::string &quantum_part_key, libint2::BasisSet &qp_basis);
-  void load_quantum_particle_atom_basis(const std::string &quantum_part_key, const std::string &classical_part_key, const CLASSICAL_PARTICLE_SET &classical_part, libint2::BasisSet &qp_basis);
-  void load_quantum_particle_atom_basis_library(const std::string &quantum_part_key, const std::string &classical_part_key, const int &center_basis_idx, libint2::BasisSet &qp_basis);
+  void load_quantum_particle_atom_basis(const std::string &quantum_part_key, const std::string &classical_part_key, const CLASSICAL_PARTICLE_SET &classical_part, libint2::BasisSet &qp_basis,
+                                        const std::string &basis_section = "basis");
+  void load_quantum_particle_atom_basis_library(const std::string &quantum_part_key, const std::string &classical_part_key, const int &center_basis_idx, libint2::BasisSet &qp_basis,
+                                                const std::string &basis_section = "basis");
   void load_quantum_particle_atom_basis_custom(const std::string &quantum_part_key, const std::string &classical_part_key, const int &center_basis_idx, const CLASSICAL_PARTICLE_SET &classical_part,
-                                               libint2::BasisSet &qp_basis);
+                                               libint2::BasisSet &qp_basis, const std::string &basis_section = "basis");
+  /**
+   * @brief Load the density fitting basis of every particle from 'model->aux_basis' (same layout as 'model->basis'). Particles without one get an empty
+   * basis and are not density fitted.
+   *
+   */
+  void load_aux_basis();
   void set_pure_from_input();
   void set_libint_shell_norm();
   void print_basis();
@@ -78,6 +86,14 @@ public:
    *
    */
   std::vector<size_t> num_basis;
+  /**
+   * @brief Density fitting (auxiliary) basis and its size
+   *
+   * indexes: particle
+   *
+   */
+  std::vector<libint2::BasisSet> aux_basis;
+  std::vector<size_t> num_aux_basis;
 
   // indexing particle idx, irrep idx
   std::vector<std::vector<int>> salc_per_irrep;
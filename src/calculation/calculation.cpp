@@ -11,7 +11,11 @@ POLYQUANT_CALCULATION::POLYQUANT_CALCULATION(const std::string &filename) {
 void POLYQUANT_CALCULATION::setup_calculation(const std::string &filename) {
   // parse input file
   Polyquant_section_header("Input Parameters");
-  this->input_params = std::make_shared<POLYQUANT_INPUT>(filename);
+  this->setup_calculation(std::make_shared<POLYQUANT_INPUT>(filename));
+}
+
+void POLYQUANT_CALCULATION::setup_calculation(std::shared_ptr<POLYQUANT_INPUT> input) {
+  this->input_params = input;
   // parse symmetry file
   Polyquant_section_header("Symmetry Handler Setup");
   this->input_symmetry = std::make_shared<POLYQUANT_SYMMETRY>(this->input_params);
@@ -26,6 +30,12 @@ void POLYQUANT_CALCULATION::setup_calculation(const std::string &filename) {
 }
 
 void POLYQUANT_CALCULATION::run() {
+  if (this->input_params->input_data.contains("keywords")) {
+    if (this->input_params->input_data["keywords"].contains("scan")) {
+      this->run_scan();
+      return;
+    }
+  }
   Polyquant_section_header("Calculation Requested");
   std::string mean_field_type = this->parse_mean_field();
   std::string post_mean_field_type = this->parse_post_mean_field();
@@ -40,6 +50,63 @@ void POLYQUANT_CALCULATION::run() {
   }
 }
 
+void POLYQUANT_CALCULATION::run_scan() {
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  auto base_input = this->input_params->input_data;
+  auto scan_points = base_input["keywords"]["scan"];
+  base_input["keywords"].erase("scan");
+  if (scan_points.type() != json::value_t::array || scan_points.size() == 0) {
+    APP_ABORT("keywords->scan must be a non-empty list of input patches.");
+  }
+  this->scan_E_total.clear();
+  this->scan_scf_iterations.clear();
+  this->scan_E_ci.clear();
+  this->previous_scf_calc = nullptr;
+  this->previous_ci_calc = nullptr;
+  this->scanning = true;
+  for (auto point_idx = 0; point_idx < scan_points.size(); point_idx++) {
+    Polyquant_section_header("Scan Point " + std::to_string(point_idx));
+    auto point_input = std::make_shared<POLYQUANT_INPUT>();
+    point_input->input_data = base_input;
+    point_input->input_data.merge_patch(scan_points[point_idx]);
+    Polyquant_dump_json(point_input->input_data);
+    this->scf_calc = nullptr;
+    this->ci_calc = nullptr;
+    this->setup_calculation(point_input);
+    this->run();
+    this->scan_E_total.push_back(this->scf_calc->E_total);
+    this->scan_scf_iterations.push_back(this->scf_calc->iteration_num);
+    if (this->ci_calc != nullptr) {
+      this->scan_E_ci.push_back(this->ci_calc->energies);
+      // otherwise every point keeps the one before it alive
+      this->ci_calc->previous_ci = nullptr;
+    }
+    this->previous_scf_calc = this->scf_calc;
+    this->previous_ci_calc = this->ci_calc;
+  }
+  this->scanning = false;
+  // don't hold on to the last point's objects twice
+  this->previous_scf_calc = nullptr;
+  this->previous_ci_calc = nullptr;
+
+  Polyquant_section_header("Scan Summary");
+  std::stringstream buffer;
+  buffer << std::setw(8) << "point" << std::setw(16) << "SCF iterations" << std::setw(24) << "E_total (SCF)";
+  if (this->scan_E_ci.size() != 0) {
+    buffer << std::setw(24) << "E_0 (CI)";
+  }
+  buffer << std::endl;
+  for (auto point_idx = 0; point_idx < this->scan_E_total.size(); point_idx++) {
+    buffer << std::setw(8) << point_idx << std::setw(16) << this->scan_scf_iterations[point_idx] << std::setw(24) << std::setprecision(12) << std::fixed << this->scan_E_total[point_idx];
+    if (point_idx < this->scan_E_ci.size() && this->scan_E_ci[point_idx].size() != 0) {
+      buffer << std::setw(24) << this->scan_E_ci[point_idx][0];
+    }
+    buffer << std::endl;
+  }
+  Polyquant_cout(buffer.str());
+}
+
 std::string POLYQUANT_CALCULATION::parse_mean_field() {
   Polyquant_cout("Figuring out if we need to run a mean-field calculation for the particles...");
   std::string mean_field_type = "NONE";
@@ -111,6 +178,24 @@ void POLYQUANT_CALCULATION::run_mean_field(std::string &mean_field_type) {
       if (this->input_params->input_data["keywords"]["mf_keywords"].contains("iteration_max")) {
         scf_calc->iteration_max = this->input_params->input_data["keywords"]["mf_keywords"]["iteration_max"];
       }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("checkpoint_filename")) {
+        scf_calc->checkpoint_filename = this->input_params->input_data["keywords"]["mf_keywords"]["checkpoint_filename"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("checkpoint_frequency")) {
+        scf_calc->checkpoint_frequency = this->input_params->input_data["keywords"]["mf_keywords"]["checkpoint_frequency"];
+        if (scf_calc->checkpoint_frequency < 1) {
+          APP_ABORT("checkpoint_frequency must be at least 1.");
+        }
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("restart_from_checkpoint")) {
+        scf_calc->restart_from_checkpoint = this->input_params->input_data["keywords"]["mf_keywords"]["restart_from_checkpoint"];
+        if (scf_calc->restart_from_checkpoint && scf_calc->checkpoint_filename.empty()) {
+          APP_ABORT("restart_from_checkpoint requires a checkpoint_filename.");
+        }
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("telemetry_filename")) {
+        scf_calc->telemetry_filename = this->input_params->input_data["keywords"]["mf_keywords"]["telemetry_filename"];
+      }
       if (this->input_params->input_data["keywords"]["mf_keywords"].contains("diis_extrapolation")) {
         scf_calc->diis_extrapolation = this->input_params->input_data["keywords"]["mf_keywords"]["diis_extrapolation"];
       }
@@ -126,6 +211,20 @@ void POLYQUANT_CALCULATION::run_mean_field(std::string &mean_field_type) {
       if (this->input_params->input_data["keywords"]["mf_keywords"].contains("diis_size")) {
         scf_calc->diis_size = this->input_params->input_data["keywords"]["mf_keywords"]["diis_size"];
       }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("coupled_diis")) {
+        scf_calc->coupled_diis = this->input_params->input_data["keywords"]["mf_keywords"]["coupled_diis"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("diis_energy_mode")) {
+        std::string diis_energy_mode = this->input_params->input_data["keywords"]["mf_keywords"]["diis_energy_mode"];
+        std::transform(diis_energy_mode.begin(), diis_energy_mode.end(), diis_energy_mode.begin(), ::tolower);
+        if (std::find(scf_calc->known_diis_energy_modes.begin(), scf_calc->known_diis_energy_modes.end(), diis_energy_mode) == scf_calc->known_diis_energy_modes.end()) {
+          APP_ABORT("Unknown mf_keywords->diis_energy_mode : " + diis_energy_mode + ". Known modes are none, ediis, and adiis.");
+        }
+        if (diis_energy_mode != "none") {
+          scf_calc->coupled_diis = true;
+        }
+        scf_calc->diis_energy_mode = diis_energy_mode;
+      }
       if (this->input_params->input_data["keywords"]["mf_keywords"].contains("incremental_fock")) {
         scf_calc->incremental_fock = this->input_params->input_data["keywords"]["mf_keywords"]["incremental_fock"];
       }
@@ -135,6 +234,66 @@ void POLYQUANT_CALCULATION::run_mean_field(std::string &mean_field_type) {
       if (this->input_params->input_data["keywords"]["mf_keywords"].contains("incremental_fock_initial_onset_thresh")) {
         scf_calc->incremental_fock_initial_onset_thresh = this->input_params->input_data["keywords"]["mf_keywords"]["incremental_fock_initial_onset_thresh"];
       }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("second_order")) {
+        scf_calc->second_order = this->input_params->input_data["keywords"]["mf_keywords"]["second_order"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("second_order_stall_iterations")) {
+        scf_calc->second_order_stall_iterations = this->input_params->input_data["keywords"]["mf_keywords"]["second_order_stall_iterations"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("second_order_max_micro_iterations")) {
+        scf_calc->second_order_max_micro_iterations = this->input_params->input_data["keywords"]["mf_keywords"]["second_order_max_micro_iterations"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("second_order_hessian")) {
+        std::string second_order_hessian = this->input_params->input_data["keywords"]["mf_keywords"]["second_order_hessian"];
+        if (second_order_hessian != "auto" && second_order_hessian != "diagonal" && second_order_hessian != "finite_difference") {
+          APP_ABORT("mf_keywords->second_order_hessian can only be auto, diagonal or finite_difference");
+        }
+        scf_calc->second_order_hessian = second_order_hessian;
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("second_order_trust_radius")) {
+        scf_calc->second_order_trust_radius_start = this->input_params->input_data["keywords"]["mf_keywords"]["second_order_trust_radius"];
+        scf_calc->second_order_trust_radius = scf_calc->second_order_trust_radius_start;
+        scf_calc->second_order_trust_radius_max = std::max(scf_calc->second_order_trust_radius_max, scf_calc->second_order_trust_radius_start);
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("density_fitting")) {
+        scf_calc->density_fitting = this->input_params->input_data["keywords"]["mf_keywords"]["density_fitting"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("coulomb_engine")) {
+        scf_calc->coulomb_engine = this->input_params->input_data["keywords"]["mf_keywords"]["coulomb_engine"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("coulomb_engine_threshold")) {
+        scf_calc->coulomb_engine_threshold = this->input_params->input_data["keywords"]["mf_keywords"]["coulomb_engine_threshold"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("partial_diag")) {
+        scf_calc->partial_diag = this->input_params->input_data["keywords"]["mf_keywords"]["partial_diag"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("partial_diag_min_size")) {
+        scf_calc->partial_diag_min_size = this->input_params->input_data["keywords"]["mf_keywords"]["partial_diag_min_size"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("partial_diag_extra_virtuals")) {
+        scf_calc->partial_diag_extra_virtuals = this->input_params->input_data["keywords"]["mf_keywords"]["partial_diag_extra_virtuals"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("petite_list")) {
+        scf_calc->petite_list = this->input_params->input_data["keywords"]["mf_keywords"]["petite_list"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("link_exchange")) {
+        scf_calc->link_exchange = this->input_params->input_data["keywords"]["mf_keywords"]["link_exchange"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("link_threshold")) {
+        scf_calc->link_threshold = this->input_params->input_data["keywords"]["mf_keywords"]["link_threshold"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("cfmm")) {
+        scf_calc->cfmm = this->input_params->input_data["keywords"]["mf_keywords"]["cfmm"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("cfmm_well_separated")) {
+        scf_calc->cfmm_well_separated = this->input_params->input_data["keywords"]["mf_keywords"]["cfmm_well_separated"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("cfmm_box_size")) {
+        scf_calc->cfmm_box_size = this->input_params->input_data["keywords"]["mf_keywords"]["cfmm_box_size"];
+      }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("cfmm_extent_threshold")) {
+        scf_calc->cfmm_extent_threshold = this->input_params->input_data["keywords"]["mf_keywords"]["cfmm_extent_threshold"];
+      }
       if (this->input_params->input_data["keywords"]["mf_keywords"].contains("Cauchy_Schwarz_screening")) {
         APP_ABORT("Cauchy Schwarz screening (integrals and density) is not working. e-/e+ are very sensitive. This should be handled carefully.");
         // scf_calc->Cauchy_Schwarz_screening = this->input_params->input_data["keywords"]["mf_keywords"]["Cauchy_Schwarz_screening"];
@@ -146,9 +305,20 @@ void POLYQUANT_CALCULATION::run_mean_field(std::string &mean_field_type) {
       if (this->input_params->input_data["keywords"]["mf_keywords"].contains("force_independent_converged")) {
         scf_calc->independent_converged = this->input_params->input_data["keywords"]["mf_keywords"]["force_independent_converged"];
       }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("guess_mode")) {
+        std::string guess_mode = this->input_params->input_data["keywords"]["mf_keywords"]["guess_mode"];
+        std::transform(guess_mode.begin(), guess_mode.end(), guess_mode.begin(), ::tolower);
+        if (std::find(scf_calc->known_guess_modes.begin(), scf_calc->known_guess_modes.end(), guess_mode) == scf_calc->known_guess_modes.end()) {
+          APP_ABORT("Unknown mf_keywords->guess_mode : " + guess_mode + ". Known guess modes are hcore, sad, and sad_coulomb.");
+        }
+        scf_calc->guess_mode = guess_mode;
+      }
       if (this->input_params->input_data["keywords"]["mf_keywords"].contains("occupation_mode")) {
         scf_calc->occupation_mode = this->input_params->input_data["keywords"]["mf_keywords"]["occupation_mode"];
       }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("concurrent_independent_particles")) {
+        scf_calc->concurrent_independent_particles = this->input_params->input_data["keywords"]["mf_keywords"]["concurrent_independent_particles"];
+      }
       if (this->input_params->input_data["keywords"]["mf_keywords"].contains("stop_after_independent_converged")) {
         scf_calc->stop_after_independent_converged = this->input_params->input_data["keywords"]["mf_keywords"]["stop_after_independent_converged"];
       }
@@ -161,6 +331,9 @@ void POLYQUANT_CALCULATION::run_mean_field(std::string &mean_field_type) {
           }
         }
       }
+      if (this->input_params->input_data["keywords"]["mf_keywords"].contains("cache_frozen_potential")) {
+        scf_calc->cache_frozen_potential = this->input_params->input_data["keywords"]["mf_keywords"]["cache_frozen_potential"];
+      }
       if (this->input_params->input_data["keywords"]["mf_keywords"].contains("npart_per_irrep")) {
         auto npart_per_irrep_inp = this->input_params->input_data["keywords"]["mf_keywords"]["npart_per_irrep"];
         scf_calc->npart_per_irrep.resize(npart_per_irrep_inp.size());
@@ -209,7 +382,13 @@ void POLYQUANT_CALCULATION::run_mean_field(std::string &mean_field_type) {
     }
   }
   if (mean_field_type == "SCF") {
-    scf_calc->setup_standard();
+    if (scf_calc->restart_from_checkpoint) {
+      scf_calc->setup_from_checkpoint();
+    } else if (this->previous_scf_calc != nullptr) {
+      scf_calc->setup_from_previous(this->previous_scf_calc);
+    } else {
+      scf_calc->setup_standard();
+    }
     if (freeze_density_from_input.size() == this->input_molecule->quantum_particles.size()) {
       for (auto i = 0; i < this->input_molecule->quantum_particles.size(); i++) {
         this->scf_calc->freeze_density[i] = freeze_density_from_input[i];
@@ -250,6 +429,10 @@ void POLYQUANT_CALCULATION::run_post_mean_field(std::string &post_mean_field_typ
   Polyquant_cout("Will run a post mean field calculation of type: ");
   Polyquant_cout(post_mean_field_type);
   std::string mean_field_type = "FILE";
+  // a scan solves the SCF at every point rather than reading the orbitals from file
+  if (this->scanning) {
+    mean_field_type = "SCF";
+  }
   std::string fcidump_filename;
 
   if (post_mean_field_type == "FILE") {
@@ -322,6 +505,19 @@ void POLYQUANT_CALCULATION::run_post_mean_field(std::string &post_mean_field_typ
       if (this->input_params->input_data["keywords"]["ci_keywords"].contains("build_matrix")) {
         ci_calc->detset.build_matrix = this->input_params->input_data["keywords"]["ci_keywords"]["build_matrix"];
       }
+      if (this->input_params->input_data["keywords"]["ci_keywords"].contains("string_driven_sigma")) {
+        ci_calc->detset.string_driven_sigma = this->input_params->input_data["keywords"]["ci_keywords"]["string_driven_sigma"];
+      }
+      if (this->input_params->input_data["keywords"]["ci_keywords"].contains("gather_sigma")) {
+        ci_calc->detset.gather_sigma = this->input_params->input_data["keywords"]["ci_keywords"]["gather_sigma"];
+      }
+      if (this->input_params->input_data["keywords"]["ci_keywords"].contains("ham_storage")) {
+        std::string ham_storage = this->input_params->input_data["keywords"]["ci_keywords"]["ham_storage"];
+        if (ham_storage != "csr" && ham_storage != "packed" && ham_storage != "packed_float") {
+          APP_ABORT("keywords->ci_keywords->ham_storage can only be csr, packed or packed_float");
+        }
+        ci_calc->detset.ham_storage = ham_storage;
+      }
       if (this->input_params->input_data["keywords"]["ci_keywords"].contains("exact_diag")) {
         ci_calc->exact_diag = this->input_params->input_data["keywords"]["ci_keywords"]["exact_diag"];
       }
@@ -366,6 +562,12 @@ void POLYQUANT_CALCULATION::run_post_mean_field(std::string &post_mean_field_typ
       if (this->input_params->input_data["keywords"]["ci_keywords"].contains("screening_threshold")) {
         ci_calc->detset.screening_threshold = this->input_params->input_data["keywords"]["ci_keywords"]["screening_threshold"];
       }
+      if (this->input_params->input_data["keywords"]["ci_keywords"].contains("det_address_max_size")) {
+        ci_calc->detset.det_address_max_size = this->input_params->input_data["keywords"]["ci_keywords"]["det_address_max_size"];
+      }
+      if (this->input_params->input_data["keywords"]["ci_keywords"].contains("det_address_min_density")) {
+        ci_calc->detset.det_address_min_density = this->input_params->input_data["keywords"]["ci_keywords"]["det_address_min_density"];
+      }
       if (this->input_params->input_data["keywords"]["ci_keywords"].contains("frozen_core")) {
         auto FC = this->input_params->input_data["keywords"]["ci_keywords"]["frozen_core"];
         if (FC.type() == json::value_t::array) {
@@ -390,6 +592,7 @@ void POLYQUANT_CALCULATION::run_post_mean_field(std::string &post_mean_field_typ
     this->ci_calc->calculate_integrals();
     this->ci_calc->fcidump(fcidump_filename);
   } else if (post_mean_field_type == "CI") {
+    this->ci_calc->previous_ci = this->previous_ci_calc;
     this->ci_calc->run();
     if (dump_for_qmcpack) {
       dump_post_mf_NOs_for_qmcpack(hdf5_filename);
@@ -35,6 +35,12 @@ public:
    * @param filename
    */
   void setup_calculation(const std::string &filename);
+  /**
+   * @brief Set up the calculation from already parsed input
+   *
+   * @param input
+   */
+  void setup_calculation(std::shared_ptr<POLYQUANT_INPUT> input);
   /**
    * @brief Run the calculation
    *
@@ -47,6 +53,12 @@ public:
    */
   void run_mean_field(std::string &mean_field_type);
   void run_post_mean_field(std::string &post_mean_field_type);
+  /**
+   * @brief Run every point of keywords->scan in this process. Each point is a JSON merge patch (RFC 7386) applied to the input, e.g. a new
+   * molecule->geometry or basis. Every point after the first starts from the orbitals, determinants and CI vectors of the point before it.
+   *
+   */
+  void run_scan();
 
   // void
   // run_excess_electron_plus_electronic_mean_field(std::string
@@ -101,6 +113,22 @@ public:
    */
   std::shared_ptr<POLYQUANT_EPCI> ci_calc;
 
+  /**
+   * @brief the calculations of the previous scan point to warm start from
+   *
+   */
+  std::shared_ptr<POLYQUANT_EPSCF> previous_scf_calc;
+  std::shared_ptr<POLYQUANT_EPCI> previous_ci_calc;
+
+  /**
+   * @brief results of each scan point
+   *
+   */
+  std::vector<double> scan_E_total;
+  std::vector<int> scan_scf_iterations;
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, 1>> scan_E_ci;
+  bool scanning = false;
+
   /**
    * @brief Mean-field calculation types that polyquant knows about
    *
@@ -0,0 +1,306 @@
+#ifndef POLYQUANT_DETERMINANT_ARENA_H
+#define POLYQUANT_DETERMINANT_ARENA_H
+#include "io/utils.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace polyquant {
+
+/**
+ * @brief Largest number of words per bitstring for which the Slater-Condon kernels are compiled with a fixed word count. Longer
+ * bitstrings fall back to dynamic extent spans.
+ */
+inline constexpr std::size_t POLYQUANT_MAX_FIXED_DET_WORDS = 4;
+
+/**
+ * @brief Bitstring type used by the fixed word count kernels. For N <= POLYQUANT_MAX_FIXED_DET_WORDS this is a stack resident
+ * std::array copy, for std::dynamic_extent it is a view into the arena.
+ */
+template <typename T, std::size_t N> struct POLYQUANT_FIXED_DET_TYPE {
+  using type = std::array<T, N>;
+};
+template <typename T> struct POLYQUANT_FIXED_DET_TYPE<T, std::dynamic_extent> {
+  using type = std::span<const T>;
+};
+template <typename T, std::size_t N> using POLYQUANT_FIXED_DET = typename POLYQUANT_FIXED_DET_TYPE<T, N>::type;
+
+/**
+ * @brief Contiguous storage for the unique bitstrings of one quantum particle type and spin. Every bitstring has the same number of
+ * words (num_int) so bitstring i lives in words[i * num_int, (i + 1) * num_int) and is handed out as a non-owning span.
+ * The words of a bitstring are stored from highest orbital to lowest orbital.
+ *
+ * @tparam T word type of the bitstrings
+ */
+template <typename T> class POLYQUANT_DET_ARENA {
+public:
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::span<const T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = std::span<const T>;
+
+    const_iterator() = default;
+    const_iterator(const POLYQUANT_DET_ARENA<T> *arena, std::size_t idx) : arena(arena), idx(idx) {}
+    reference operator*() const { return (*arena)[idx]; }
+    const_iterator &operator++() {
+      idx++;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto old = *this;
+      idx++;
+      return old;
+    }
+    bool operator==(const const_iterator &other) const { return arena == other.arena && idx == other.idx; }
+    bool operator!=(const const_iterator &other) const { return !(*this == other); }
+
+  private:
+    const POLYQUANT_DET_ARENA<T> *arena = nullptr;
+    std::size_t idx = 0;
+  };
+
+  /**
+   * @brief Append a bitstring. The first bitstring fixes the number of words for the arena.
+   *
+   * @param det bitstring to append
+   */
+  void push_back(std::span<const T> det) {
+    if (this->count == 0) {
+      this->num_int = det.size();
+    } else if (det.size() != this->num_int) {
+      APP_ABORT("Bitstrings in a determinant arena must all have the same number of words");
+    }
+    this->words.insert(this->words.end(), det.begin(), det.end());
+    this->count++;
+  }
+  /**
+   * @brief Overwrite bitstring i in place.
+   *
+   * @param i index of the bitstring
+   * @param det new bitstring, must have num_int words
+   */
+  void set(std::size_t i, std::span<const T> det) {
+    if (det.size() != this->num_int) {
+      APP_ABORT("Bitstrings in a determinant arena must all have the same number of words");
+    }
+    std::copy(det.begin(), det.end(), this->words.begin() + i * this->num_int);
+  }
+  std::span<const T> operator[](std::size_t i) const { return std::span<const T>(this->words.data() + i * this->num_int, this->num_int); }
+  std::span<const T> back() const { return (*this)[this->count - 1]; }
+  /**
+   * @brief Copy of bitstring i with a compile time word count, or a view of it when N is std::dynamic_extent.
+   *
+   * @tparam N number of words, must equal num_int unless it is std::dynamic_extent
+   * @param i index of the bitstring
+   */
+  template <std::size_t N> POLYQUANT_FIXED_DET<T, N> get_fixed(std::size_t i) const {
+    if constexpr (N == std::dynamic_extent) {
+      return (*this)[i];
+    } else {
+      std::array<T, N> det;
+      std::copy_n(this->words.data() + i * N, N, det.begin());
+      return det;
+    }
+  }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, this->count); }
+  std::size_t size() const { return this->count; }
+  bool empty() const { return this->count == 0; }
+  /**
+   * @brief number of words per bitstring
+   */
+  std::size_t n_int() const { return this->num_int; }
+  void reserve(std::size_t n_dets, std::size_t n_words) { this->words.reserve(n_dets * n_words); }
+  void clear() {
+    this->words.clear();
+    this->count = 0;
+    this->num_int = 0;
+  }
+  bool operator==(const POLYQUANT_DET_ARENA<T> &other) const = default;
+
+private:
+  std::vector<T> words;
+  std::size_t num_int = 0;
+  std::size_t count = 0;
+};
+
+/**
+ * @brief Fixed capacity list of orbital indices used for holes and particles so the Slater-Condon kernels don't allocate.
+ *
+ * @tparam Capacity maximum number of orbitals in the list
+ */
+template <std::size_t Capacity> class POLYQUANT_ORBITAL_LIST {
+public:
+  void push_back(int orb) {
+    if (this->count == Capacity) {
+      APP_ABORT("Orbital list capacity exceeded");
+    }
+    this->orbs[this->count] = orb;
+    this->count++;
+  }
+  int operator[](std::size_t i) const { return this->orbs[i]; }
+  std::size_t size() const { return this->count; }
+  void clear() { this->count = 0; }
+  int *begin() { return this->orbs.data(); }
+  int *end() { return this->orbs.data() + this->count; }
+  const int *begin() const { return this->orbs.data(); }
+  const int *end() const { return this->orbs.data() + this->count; }
+
+private:
+  std::array<int, Capacity> orbs;
+  std::size_t count = 0;
+};
+
+/**
+ * @brief Call f with std::integral_constant<std::size_t, num_int> for 1 <= num_int <= POLYQUANT_MAX_FIXED_DET_WORDS and with
+ * std::integral_constant<std::size_t, std::dynamic_extent> otherwise, so kernels can be instantiated with a compile time word count.
+ *
+ * @param num_int number of words per bitstring
+ * @param f callable templated on the word count
+ */
+template <typename F> decltype(auto) Polyquant_dispatch_det_words(std::size_t num_int, F &&f) {
+  switch (num_int) {
+  case 1:
+    return f(std::integral_constant<std::size_t, 1>{});
+  case 2:
+    return f(std::integral_constant<std::size_t, 2>{});
+  case 3:
+    return f(std::integral_constant<std::size_t, 3>{});
+  case 4:
+    return f(std::integral_constant<std::size_t, 4>{});
+  default:
+    return f(std::integral_constant<std::size_t, std::dynamic_extent>{});
+  }
+}
+
+/**
+ * @brief Compare two bitstrings word by word. Works for spans, std::array and std::vector.
+ */
+template <typename DetA, typename DetB> bool Polyquant_det_equal(const DetA &Di, const DetB &Dj) { return std::equal(Di.begin(), Di.end(), Dj.begin(), Dj.end()); }
+
+/**
+ * @brief Number of orbitals that differ between two bitstrings of the same spin, divided by two.
+ */
+template <typename Det> int Polyquant_det_num_excitation(const Det &Di, const Det &Dj) {
+  int excitation_degree = 0;
+  for (std::size_t i = 0; i < Di.size(); i++) {
+    excitation_degree += std::popcount(Di[i] ^ Dj[i]);
+  }
+  return excitation_degree / 2;
+}
+
+/**
+ * @brief Orbitals occupied in Di but not in Dj (holes), or occupied in Dj but not in Di (particles) when Particles is true, in ascending
+ * order.
+ */
+template <bool Particles, typename Det, typename Orbitals> void Polyquant_det_holes_or_parts(const Det &Di, const Det &Dj, Orbitals &orbs) {
+  using T = std::remove_cvref_t<decltype(Di[0])>;
+  constexpr T bit_kind_size = 8 * sizeof(T);
+  T one = 1;
+  T zero = 0;
+  for (std::size_t i = 0; i < Di.size(); i++) {
+    T H = (Di[i] ^ Dj[i]) & (Particles ? Dj[i] : Di[i]);
+    // words are stored from highest orbital to lowest so walking them in order yields descending orbitals
+    while (H != zero) {
+      auto position = std::countr_zero(H);
+      auto orb_idx = ((Di.size() - i - 1) * bit_kind_size) + position;
+      orbs.push_back(orb_idx);
+      H &= ~(one << position);
+    }
+  }
+  std::sort(orbs.begin(), orbs.end());
+}
+
+/**
+ * @brief Call f(orb) for every occupied orbital of D in ascending order, without building an occupation list.
+ */
+template <typename Det, typename F> void Polyquant_det_for_each_occ(const Det &D, F &&f) {
+  using T = std::remove_cvref_t<decltype(D[0])>;
+  constexpr std::size_t bit_kind_size = 8 * sizeof(T);
+  // the last word holds the lowest orbitals
+  for (std::size_t i = D.size(); i-- > 0;) {
+    for (T bits = D[i]; bits != 0; bits &= bits - 1) {
+      f(static_cast<int>((D.size() - i - 1) * bit_kind_size + std::countr_zero(bits)));
+    }
+  }
+}
+
+/**
+ * @brief Phase of the excitation from Di to Dj given its holes and particles.
+ */
+template <typename Det, typename Orbitals> double Polyquant_det_phase(const Det &Di, const Orbitals &holes, const Orbitals &parts) {
+  using T = std::remove_cvref_t<decltype(Di[0])>;
+  constexpr T bit_kind_size = 8 * sizeof(T);
+  constexpr T bit_kind_shift = std::countr_zero(bit_kind_size);
+  T nperm = 0;
+  T one = 1;
+  T zero = 0;
+  T n_int = Di.size();
+  for (std::size_t l = 0; l < holes.size(); l++) {
+    // notice compared to qp2 we add 1 to low rather than subtracting from high because we store 0 indexed things in parts and holes
+    T high = std::max(parts[l], holes[l]);
+    T low = std::min(parts[l], holes[l]) + one;
+    // since the highest orbital is stored in the first word, enumerate the words from the end of the list
+    T j = n_int - (low >> bit_kind_shift) - one;
+    T k = n_int - (high >> bit_kind_shift) - one;
+    T m = high & (bit_kind_size - one);
+    T n = low & (bit_kind_size - one);
+    if (j == k) {
+      // mask for the space between high and low in the same int
+      nperm += std::popcount(Di[j] & (((one << m) - one) & (~(one << n) + one)));
+    } else {
+      // mask for the space between high and low in different ints
+      nperm += std::popcount(Di[j] & ((~(zero) & (~(one << n) + one))));
+      nperm += std::popcount(Di[k] & (((one << m) - one)));
+      for (T i = k + 1; i < j; i++) {
+        nperm += std::popcount(Di[i]);
+      }
+    }
+  }
+  if (holes.size() == 2) {
+    T a = std::min(holes[0], parts[0]);
+    T b = std::max(holes[0], parts[0]);
+    T c = std::min(holes[1], parts[1]);
+    T d = std::max(holes[1], parts[1]);
+    if ((a < c) && (c < b) && (b < d)) {
+      nperm++;
+    }
+  }
+  return (nperm & 1) ? -1.0 : 1.0;
+}
+
+/**
+ * @brief Excitation between two bitstrings of the same spin. holes, parts and phase are only filled for single and double
+ * excitations, which is all the Slater-Condon rules need.
+ */
+struct POLYQUANT_DET_EXCITATION {
+  int degree = 0;
+  POLYQUANT_ORBITAL_LIST<2> holes;
+  POLYQUANT_ORBITAL_LIST<2> parts;
+  double phase = 1.0;
+};
+
+/**
+ * @brief Excitation degree, holes, particles and phase of the excitation from Di to Dj without touching the heap.
+ */
+template <typename Det> POLYQUANT_DET_EXCITATION Polyquant_det_excitation(const Det &Di, const Det &Dj) {
+  POLYQUANT_DET_EXCITATION excitation;
+  excitation.degree = Polyquant_det_num_excitation(Di, Dj);
+  if (excitation.degree == 1 || excitation.degree == 2) {
+    Polyquant_det_holes_or_parts<false>(Di, Dj, excitation.holes);
+    Polyquant_det_holes_or_parts<true>(Di, Dj, excitation.parts);
+    excitation.phase = Polyquant_det_phase(Di, excitation.holes, excitation.parts);
+  }
+  return excitation;
+}
+
+} // namespace polyquant
+#endif
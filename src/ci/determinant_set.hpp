@@ -1,7 +1,11 @@
 #ifndef POLYQUANT_DETSET_H
 #define POLYQUANT_DETSET_H
 #include "basis/basis.hpp"
+#include "ci/determinant_arena.hpp"
+#include "ci/excitation_map.hpp"
+#include "ci/packed_hamiltonian.hpp"
 #include "integral/integral.hpp"
+#include "io/thread_counter.hpp"
 #include "io/timer.hpp"
 #include "io/utils.hpp"
 #include "molecule/molecule.hpp"
@@ -16,7 +20,9 @@
 #include <inttypes.h>
 #include <iostream>
 #include <iterator>
+#include <numeric>
 #include <set>
+#include <span>
 #include <string>
 #include <tuple>
 #include <unordered_set>
@@ -29,9 +35,11 @@ public:
   POLYQUANT_DETSET() {}
   ~POLYQUANT_DETSET() {
     std::stringstream ss;
-    ss << "SLATER CONDON CALLS : " << Slater_Condon_calls << std::endl;
-    ss << "SLATER CONDON DIAGONAL (i==j) CALLS : " << Slater_Condon_diagonal_calls << std::endl;
-    double percentage_of_all_calls = ((double)Slater_Condon_diagonal_calls) / ((double)Slater_Condon_calls);
+    auto num_calls = Slater_Condon_calls.total();
+    auto num_diagonal_calls = Slater_Condon_diagonal_calls.total();
+    ss << "SLATER CONDON CALLS : " << num_calls << std::endl;
+    ss << "SLATER CONDON DIAGONAL (i==j) CALLS : " << num_diagonal_calls << std::endl;
+    double percentage_of_all_calls = num_calls == 0 ? 0.0 : ((double)num_diagonal_calls) / ((double)num_calls);
     percentage_of_all_calls *= 100.0;
     ss << "percent SLATER CONDON DIAGONAL (i==j) CALLS : " << percentage_of_all_calls << "%" << std::endl;
     Polyquant_cout(ss.str());
@@ -43,7 +51,7 @@ public:
     }
   };
 
-  void get_symm_idx(int idx_part, const std::pair<std::vector<T>, std::vector<T>> &D, int &symm_idx);
+  void get_symm_idx(int idx_part, const std::pair<std::span<const T>, std::span<const T>> &D, int &symm_idx);
   void create_det(int idx_part, std::vector<std::vector<int>> &occ);
   void get_unique_excitation_list(int idx_part, int idx_spin, int idx_det, int excitation_level, std::vector<std::vector<T>> &return_dets) const;
   void get_unique_excitation_set(int idx_part, int idx_spin, int idx_det, int excitation_level, std::set<std::vector<T>> &return_dets) const;
@@ -52,22 +60,45 @@ public:
   void create_excitation(std::vector<std::tuple<int, int, int>> excitation_level, int max_collective_excitation_level);
   void create_unique_excitation_map_singles();
   void create_unique_excitation_map_doubles();
+  /**
+   * @brief Connect every unique string of a particle type and spin to the strings exactly excitation_level (1 or 2) excitations away.
+   * Two strings are connected exactly when removing excitation_level electrons from each leaves the same key, so the keys of all strings
+   * are hashed and sorted into buckets and the connections are read off the buckets. The cost scales with the number of strings and
+   * connections rather than the square of the number of strings.
+   *
+   * @param idx_part index of the quantum particle type
+   * @param idx_spin index of the spin
+   * @param excitation_level 1 for singles, 2 for doubles
+   * @param excitation_map CSR adjacency of the connected strings
+   */
+  void create_unique_excitation_map(int idx_part, int idx_spin, int excitation_level, POLYQUANT_EXCITATION_MAP &excitation_map) const;
+
+  int single_spin_num_excitation(std::span<const T> Di, std::span<const T> Dj) const;
+  int num_excitation(const std::pair<std::span<const T>, std::span<const T>> &Di, const std::pair<std::span<const T>, std::span<const T>> &Dj) const;
+  void get_holes(std::span<const T> Di, std::span<const T> Dj, std::vector<int> &holes) const;
+  void get_parts(std::span<const T> Di, std::span<const T> Dj, std::vector<int> &parts) const;
+  double get_phase(std::span<const T> Di, std::span<const T> Dj, const std::vector<int> &holes, const std::vector<int> &parts) const;
+  void get_occ_virt(int idx_part, std::span<const T> D, std::vector<int> &occ, std::vector<int> &virt) const;
+
+  double same_part_ham_diag(int idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const;
+  double same_part_ham_single(int idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const;
+  double same_part_ham_double(int idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const;
+  double mixed_part_ham_diag(int idx_part, int other_idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const;
+  double mixed_part_ham_single(int idx_part, int other_idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const;
+  double mixed_part_ham_double(int idx_part, int other_idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const;
+  // the kernels above dispatch on the number of words per bitstring to these, N is std::dynamic_extent for long bitstrings
+  template <std::size_t N> double same_part_ham_diag_impl(int idx_part, std::span<const int> i_unfold) const;
+  template <std::size_t N> double same_part_ham_single_impl(int idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const;
+  template <std::size_t N> double same_part_ham_double_impl(int idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const;
+  template <std::size_t N> double mixed_part_ham_diag_impl(int idx_part, int other_idx_part, std::span<const int> i_unfold) const;
+  template <std::size_t N> double mixed_part_ham_single_impl(int idx_part, int other_idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const;
+  template <std::size_t N> double mixed_part_ham_double_impl(int idx_part, int other_idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const;
+  /**
+   * @brief number of words per bitstring, the same for every quantum particle type and spin
+   */
+  std::size_t det_n_int() const { return this->unique_dets[0][0].n_int(); }
 
-  int single_spin_num_excitation(const std::vector<T> &Di, const std::vector<T> &Dj) const;
-  int num_excitation(const std::pair<std::vector<T>, std::vector<T>> &Di, const std::pair<std::vector<T>, std::vector<T>> &Dj) const;
-  void get_holes(std::vector<T> &Di, std::vector<T> &Dj, std::vector<int> &holes) const;
-  void get_parts(std::vector<T> &Di, std::vector<T> &Dj, std::vector<int> &parts) const;
-  double get_phase(std::vector<T> &Di, std::vector<T> &Dj, std::vector<int> &holes, std::vector<int> &parts) const;
-  void get_occ_virt(int idx_part, std::vector<T> &D, std::vector<int> &occ, std::vector<int> &virt) const;
-
-  double same_part_ham_diag(int idx_part, std::vector<int> i_unfold, std::vector<int> j_unfold) const;
-  double same_part_ham_single(int idx_part, std::vector<int> i_unfold, std::vector<int> j_unfold) const;
-  double same_part_ham_double(int idx_part, std::vector<int> i_unfold, std::vector<int> j_unfold) const;
-  double mixed_part_ham_diag(int idx_part, int other_idx_part, std::vector<int> i_unfold, std::vector<int> j_unfold) const;
-  double mixed_part_ham_single(int idx_part, int other_idx_part, std::vector<int> i_unfold, std::vector<int> j_unfold) const;
-  double mixed_part_ham_double(int idx_part, int other_idx_part, std::vector<int> i_unfold, std::vector<int> j_unfold) const;
-
-  std::vector<T> get_det(int idx_part, int idx_spin, int i) const;
+  std::span<const T> get_det(int idx_part, int idx_spin, int i) const;
   std::vector<T> get_det_withfcorbs(int idx_part, int idx_spin, int i) const;
   void print_determinants();
   // /**
@@ -78,17 +109,17 @@ public:
   //  */
   // std::vector<std::unordered_set<std::pair<std::vector<T>, std::vector<T>>, PairVectorHash<T>>> dets;
   /**
-   * @brief unique dets (number of quantum particles, alpha/beta, list of unique dets which are vector of templated type)
+   * @brief unique dets (number of quantum particles, alpha/beta, arena of unique dets). Each arena stores its bitstrings contiguously
+   * with a fixed number of words per bitstring, get_det hands them out as spans into the arena.
    *
    */
-  std::vector<std::vector<std::vector<std::vector<T>>>> unique_dets;
-  int estimate_n_interacting_dets;
+  std::vector<std::vector<POLYQUANT_DET_ARENA<T>>> unique_dets;
 
   // indexes that are single excitations same spin
   // unique_singles[part_type_idx][spin_idx][det_i].size() ->num connected singles
-  std::vector<std::vector<std::vector<std::vector<size_t>>>> unique_singles;
+  std::vector<std::vector<POLYQUANT_EXCITATION_MAP>> unique_singles;
   // indexes that are double excitations same spin
-  std::vector<std::vector<std::vector<std::vector<size_t>>>> unique_doubles;
+  std::vector<std::vector<POLYQUANT_EXCITATION_MAP>> unique_doubles;
   /**
    * @brief map of det index vector - vector of size (num quantum particle types * 2 spins)
    * index 0, 1 correspond to particle 0 spin 0, particle 0 spin 1 etc.
@@ -97,7 +128,136 @@ public:
    * If <0,1> wasn't in the variational space it wouldn't be added to the map
    *
    */
-  std::unordered_map<std::vector<int>, int, VectorHash<int>> dets;
+  std::unordered_map<std::vector<int>, int, VectorHash<int>, VectorEqual<int>> dets;
+  /**
+   * @brief reverse of dets. The det index vector of determinant i is stored contiguously in
+   * dets_unfolded[i * det_idx_stride, (i + 1) * det_idx_stride)
+   *
+   */
+  std::vector<int> dets_unfolded;
+  int det_idx_stride = 0;
+  /**
+   * @brief Add a determinant to the variational space as the next global index, updating dets and dets_unfolded together
+   *
+   * @param det_idx the det index vector of the new determinant
+   */
+  void add_det(const std::vector<int> &det_idx);
+  /**
+   * @brief Rebuild N_dets, dets_unfolded and det_address from dets, for when dets was assigned directly (e.g. determinants reused from a
+   * previous calculation). Aborts if the global indices in dets are not 0 to dets.size() - 1.
+   *
+   */
+  void rebuild_dets_unfolded();
+  /**
+   * @brief Dense address table over the product of the unique string lists. Slot s of a det index vector has stride
+   * det_address_strides[s] so det_address[sum_s det_idx[s] * det_address_strides[s]] is the global index of that determinant,
+   * or -1 when the string combination is not in the variational space. Only built when the product space has at most
+   * det_address_max_size entries and, unless string_driven_sigma is set, at least det_address_min_density of them are determinants.
+   * Otherwise lookups fall back to dets.
+   *
+   */
+  std::vector<int> det_address;
+  std::vector<std::size_t> det_address_strides;
+  bool det_address_dense = false;
+  std::size_t det_address_max_size = 1ul << 25;
+  double det_address_min_density = 1.0 / 64;
+  /**
+   * @brief Build det_address from dets_unfolded, or clear it if the product space is larger than det_address_max_size or too sparse
+   *
+   */
+  void build_det_address();
+  /**
+   * @brief Global index of the determinant with the given det index vector, -1 if it is not in the variational space. Does not allocate.
+   *
+   * @param det_idx the det index vector
+   * @return int the global index
+   */
+  int det_idx_fold(std::span<const int> det_idx) const {
+    if (this->det_address_dense) {
+      std::size_t offset = 0;
+      for (std::size_t slot = 0; slot < det_idx.size(); slot++) {
+        offset += det_idx[slot] * this->det_address_strides[slot];
+      }
+      return this->det_address[offset];
+    }
+    auto det_search = this->dets.find(det_idx);
+    return det_search == this->dets.end() ? -1 : det_search->second;
+  }
+
+  /**
+   * @brief Call f(folded_jdet_idx, integral) for every determinant j != i of the variational space connected to determinant i by
+   * at most a double excitation, where integral() evaluates H_ij and must be called before f returns. The connections come from
+   * the string excitation maps of each det index slot, with pairs of singles in two slots giving the opposite spin and mixed
+   * particle doubles, so every j is visited exactly once. Works for any number of quantum particle types.
+   *
+   * @param idet_unfold det index vector of determinant i
+   * @param jdet_idx scratch det index vector with det_idx_stride entries
+   * @param charges charge of every quantum particle type, in the order of quantum_particles
+   * @param f callable taking the global index of j and a callable returning H_ij
+   */
+  template <typename F> void for_each_connected_det(std::span<const int> idet_unfold, std::vector<int> &jdet_idx, const std::vector<double> &charges, F &&f) const {
+    const auto num_parts = this->unique_dets.size();
+    const auto num_slots = idet_unfold.size();
+    std::copy(idet_unfold.begin(), idet_unfold.end(), jdet_idx.begin());
+    for (std::size_t slot = 0; slot < num_slots; slot++) {
+      int idx_part = slot / 2;
+      int idx_spin = slot % 2;
+      auto idx_I_det = idet_unfold[slot];
+      for (auto idx_J_det : this->unique_singles[idx_part][idx_spin][idx_I_det]) {
+        jdet_idx[slot] = idx_J_det;
+        // single in this slot, with the interaction with every other particle type
+        auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
+        if (folded_jdet_idx >= 0) {
+          f(folded_jdet_idx, [&]() {
+            auto integral = this->same_part_ham_single(idx_part, idet_unfold, jdet_idx);
+            for (std::size_t other_idx_part = 0; other_idx_part < num_parts; other_idx_part++) {
+              if (other_idx_part != static_cast<std::size_t>(idx_part)) {
+                integral += charges[idx_part] * charges[other_idx_part] * this->mixed_part_ham_single(idx_part, other_idx_part, idet_unfold, jdet_idx);
+              }
+            }
+            return integral;
+          });
+        }
+        // doubles made of this single and a single in a later slot
+        for (std::size_t other_slot = slot + 1; other_slot < num_slots; other_slot++) {
+          int other_idx_part = other_slot / 2;
+          int other_idx_spin = other_slot % 2;
+          for (auto idx_other_J_det : this->unique_singles[other_idx_part][other_idx_spin][idet_unfold[other_slot]]) {
+            jdet_idx[other_slot] = idx_other_J_det;
+            auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
+            if (folded_jdet_idx >= 0) {
+              f(folded_jdet_idx, [&]() {
+                if (other_idx_part == idx_part) {
+                  return this->same_part_ham_double(idx_part, idet_unfold, jdet_idx);
+                }
+                return charges[idx_part] * charges[other_idx_part] * this->mixed_part_ham_double(idx_part, other_idx_part, idet_unfold, jdet_idx);
+              });
+            }
+          }
+          jdet_idx[other_slot] = idet_unfold[other_slot];
+        }
+      }
+      // same spin doubles in this slot
+      for (auto idx_J_det : this->unique_doubles[idx_part][idx_spin][idx_I_det]) {
+        jdet_idx[slot] = idx_J_det;
+        auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
+        if (folded_jdet_idx >= 0) {
+          f(folded_jdet_idx, [&]() { return this->same_part_ham_double(idx_part, idet_unfold, jdet_idx); });
+        }
+      }
+      jdet_idx[slot] = idx_I_det;
+    }
+  }
+  /**
+   * @brief charge of every quantum particle type, in the order of quantum_particles
+   */
+  std::vector<double> particle_charges() const {
+    std::vector<double> charges;
+    for (auto const &[quantum_part_key, quantum_part] : this->input_integral->input_molecule->quantum_particles) {
+      charges.push_back(quantum_part.charge);
+    }
+    return charges;
+  }
 
   std::vector<int> max_orb;
   std::vector<double> frozen_core_energy;
@@ -120,8 +280,12 @@ public:
   void precompute_diagonal_Slater_Condon() const;
   double Slater_Condon(int i_det, int j_det) const;
 
-  mutable int Slater_Condon_calls = 0;
-  mutable int Slater_Condon_diagonal_calls = 0;
+  /**
+   * @brief Slater_Condon calls, counted per thread so the counters don't share a cache line between threads
+   *
+   */
+  mutable POLYQUANT_THREAD_COUNTER Slater_Condon_calls;
+  mutable POLYQUANT_THREAD_COUNTER Slater_Condon_diagonal_calls;
   // for diagonalization stuff
   using Scalar = double; // A typedef named "Scalar" is required
   int rows() const {
@@ -148,6 +312,62 @@ public:
   void sigma_one_species_class_singleshot(Eigen::Ref<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> sigma, const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> &C,
                                           int idx_part, int idx_spin, int other_idx_part, int other_idx_spin) const;
   void sigma_one_species(Eigen::Ref<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> sigma, const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> &C) const;
+
+  /**
+   * @brief Olsen / Knowles-Handy style string driven sigma for a single quantum particle type. C is scattered onto the dense
+   * (alpha string, beta string) product space using det_address. The same spin terms are sparse products with the precomputed
+   * string Hamiltonians same_spin_string_ham and the alpha-beta term is gathered through pair intermediates
+   * D(J_a, rs) = sum_{J_b} <I_b|E_rs|J_b> C(J_a, J_b) for each beta string I_b and contracted with the alpha-beta integrals as a
+   * dense matrix product. The diagonal is taken from diagonal_Hii so the result matches sigma_one_species.
+   *
+   * @param sigma sigma vectors, the contribution is added
+   * @param C CI vectors
+   */
+  void sigma_one_species_string_driven(Eigen::Ref<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> sigma,
+                                       const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> &C) const;
+  /**
+   * @brief Build the string replacement lists, same spin string Hamiltonians and alpha-beta diagonal used by
+   * sigma_one_species_string_driven
+   */
+  void precompute_string_sigma_tables() const;
+  /**
+   * @brief Use sigma_one_species_string_driven instead of the determinant driven sigma for single species direct CI
+   */
+  bool string_driven_sigma = false;
+  /**
+   * @brief string_replacements[spin][I] lists the strings J with <I|E_pq + E_qp|J> != 0, including J == I for every occupied p == q
+   */
+  mutable std::vector<POLYQUANT_REPLACEMENT_LIST> string_replacements;
+  /**
+   * @brief same_spin_string_ham[spin](I, J) is the off diagonal part of the one body plus same spin two body Hamiltonian between
+   * the strings I and J of that spin
+   */
+  mutable std::vector<Eigen::SparseMatrix<double, Eigen::RowMajor>> same_spin_string_ham;
+  /**
+   * @brief alpha-beta two body part of the diagonal over the string product space, sum_{a in I_a, b in I_b} (aa|bb)
+   */
+  mutable Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> string_ab_diagonal;
+  /**
+   * @brief Determinant driven sigma where every thread owns disjoint blocks of sigma rows. Row i gathers H_ij C_j over all the
+   * determinants j connected to i, so nothing is scattered into other rows and no per thread copies of sigma are needed. Works
+   * for any number of quantum particle types.
+   *
+   * @param sigma sigma vectors, the contribution is added
+   * @param C CI vectors
+   */
+  void sigma_gather(Eigen::Ref<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> sigma, const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> &C) const;
+  /**
+   * @brief Split the determinants into contiguous blocks of roughly equal estimated cost for sigma_gather and create_ham, estimated
+   * from the number of connected strings of each determinant
+   *
+   * @param row_offsets block b is rows [row_offsets[b], row_offsets[b + 1])
+   */
+  void sigma_row_partition(std::vector<int> &row_offsets) const;
+  /**
+   * @brief Use sigma_gather instead of the scatter kernels with per thread sigma copies. It evaluates every off diagonal element from both
+   * of its rows, so it is opt in, and only the default for more than two quantum particle types, which the scatter kernels don't cover.
+   */
+  bool gather_sigma = false;
   void sigma_two_species_diagonal_contribution(Eigen::Ref<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> sigma,
                                                const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> &C, int idx_part, int idx_spin) const;
   void sigma_two_species_class_one_contribution(Eigen::Ref<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> sigma,
@@ -169,25 +389,48 @@ public:
 
   Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> operator*(const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> &mat_in) const;
 
-  void create_ham_diagonal(int idx_part, int idx_spin);
-
-  void single_species_create_ham();
-  void single_species_create_ham_class_one(int idx_part, int idx_spin);
-  void single_species_create_ham_class_two(int idx_part, int idx_spin, int other_idx_part, int other_idx_spin);
-  void single_species_create_ham_singleshot(int idx_part, int idx_spin, int other_idx_part, int other_idx_spin);
-
-  void two_species_create_ham();
-  void two_species_create_ham_class_one(int idx_part, int idx_spin);
-  void two_species_create_ham_class_two(int idx_part, int idx_spin, int other_idx_part, int other_idx_spin);
-  // void two_species_create_ham_singleshot(int idx_part, int idx_spin, int other_idx_part, int other_idx_spin);
-  void two_species_create_ham_singleshot();
-
+  /**
+   * @brief Build the upper triangle of the Hamiltonian in ham. The nonzeros of every row are counted first, then the rows are
+   * filled in place in the reserved CSR storage, dropping elements with |H_ij| <= screening_threshold as they are computed.
+   *
+   */
   void create_ham();
+  /**
+   * @brief Build the upper triangle of the Hamiltonian in packed, one row block per block of sigma_row_partition. Used by
+   * create_ham for the packed ham_storage options.
+   *
+   * @param packed the packed matrix, overwritten
+   */
+  template <typename Value> void create_packed_ham(POLYQUANT_PACKED_SYM_MATRIX<Value> &packed) const;
+  /**
+   * @brief The screened elements H_ij with j > i of row i_det, sorted by column
+   *
+   * @param i_det the row
+   * @param jdet_idx scratch det index vector of det_idx_stride entries
+   * @param charges particle_charges()
+   * @param row_elems (column, value) pairs of the row, overwritten
+   * @return std::size_t the number of nonzero elements before screening
+   */
+  std::size_t screened_upper_row(int i_det, std::vector<int> &jdet_idx, const std::vector<double> &charges, std::vector<std::pair<int, double>> &row_elems) const;
   void create_S_sq_penalty(std::string type, std::vector<double> expected_S2, std::vector<double> spin_penalty);
   void create_S_sq_minus_expected_S_sq_matrix_singleshot(Eigen::SparseMatrix<double, Eigen::RowMajor> &S2_pen, int idx_part, double expected_S2_for_part);
   std::vector<int> det_idx_unfold(std::size_t det_idx) const;
+  /**
+   * @brief Non-owning view of the det index vector of determinant det_idx inside dets_unfolded, the allocation free det_idx_unfold
+   *
+   * @param det_idx the global index of the determinant
+   * @return std::span<const int> the det index vector
+   */
+  std::span<const int> det_idx_view(std::size_t det_idx) const { return std::span<const int>(this->dets_unfolded.data() + det_idx * this->det_idx_stride, this->det_idx_stride); }
 
   Eigen::SparseMatrix<double, Eigen::RowMajor> ham;
+  /**
+   * @brief Storage of the explicit Hamiltonian. "csr" builds ham, "packed" and "packed_float" build packed_ham and packed_ham_float
+   * with 64 bit row offsets and delta compressed columns for matrices past the 2^31 nonzeros ham can index.
+   */
+  std::string ham_storage = "csr";
+  POLYQUANT_PACKED_SYM_MATRIX<double> packed_ham;
+  POLYQUANT_PACKED_SYM_MATRIX<float> packed_ham_float;
   int N_dets;                // Number of determinants in this symmetry block
   int N_dets_complete_space; // Number of determinants in the full space (not the full ci space, but the full space of the current excitation level). If symmetry is off this is equal to N_dets, if
                              // symmetry is on this should be ~N_irrep * N_dets.
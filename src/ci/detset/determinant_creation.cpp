@@ -35,7 +35,7 @@ template <typename T> void POLYQUANT_DETSET<T>::create_det(int idx_part, std::ve
   unique_dets[idx_part][0].push_back(alpha_det);
   unique_dets[idx_part][1].push_back(beta_det);
 
-  std::pair det_pair(alpha_det, beta_det);
+  auto det_pair = std::make_pair(unique_dets[idx_part][0].back(), unique_dets[idx_part][1].back());
   this->get_symm_idx(idx_part, det_pair, symm_idx);
 
   Polyquant_cout("Creating det " + alpha_bit_string_for_printing + " " + beta_bit_string_for_printing + " for particle " + std::to_string(idx_part) + " of the following irrep " +
@@ -57,7 +57,7 @@ template <typename T> void POLYQUANT_DETSET<T>::get_unique_excitation_list(int i
 
   for (auto &&iocc : iter::combinations(occ, excitation_level)) {
     for (auto &&ivirt : iter::combinations(virt, excitation_level)) {
-      std::vector<T> temp_det(det);
+      std::vector<T> temp_det(det.begin(), det.end());
       // https://stackoverflow.com/a/47990
       for (auto &occbit : iocc) {
         auto int_idx = (temp_det.size() - one) - (occbit >> bit_kind_shift);
@@ -86,7 +86,7 @@ template <typename T> void POLYQUANT_DETSET<T>::get_unique_excitation_set(int id
 
   for (auto &&iocc : iter::combinations(occ, excitation_level)) {
     for (auto &&ivirt : iter::combinations(virt, excitation_level)) {
-      std::vector<T> temp_det(det);
+      std::vector<T> temp_det(det.begin(), det.end());
       // https://stackoverflow.com/a/47990
       for (auto &occbit : iocc) {
         auto int_idx = (temp_det.size() - one) - (occbit >> bit_kind_shift);
@@ -121,7 +121,7 @@ template <typename T> void POLYQUANT_DETSET<T>::get_unique_excitation_list_of_in
   auto curr_idx = 0;
   while (!excited_dets.empty() && curr_idx < this->unique_dets[idx_part][idx_spin].size()) {
     auto curr_det = this->unique_dets[idx_part][idx_spin][curr_idx];
-    auto is_det = [&curr_det](std::vector<T> i) { return i == curr_det; };
+    auto is_det = [&curr_det](const std::vector<T> &i) { return Polyquant_det_equal(i, curr_det); };
     auto det_in_excited_dets_list = std::find_if(excited_dets.begin(), excited_dets.end(), is_det);
     if (det_in_excited_dets_list != excited_dets.end()) {
       return_idx_list.insert(curr_idx);
@@ -152,8 +152,11 @@ template <typename T> void POLYQUANT_DETSET<T>::create_excitation(std::vector<st
   // TODO generalize this and parallellize...
   this->N_dets = 0;
   this->N_dets_complete_space = 0;
-  std::pair<std::vector<T>, std::vector<T>> hf_det_pair_0 = std::make_pair(this->unique_dets[0][0][0], this->unique_dets[0][1][0]);
-  std::pair<std::vector<T>, std::vector<T>> hf_det_pair_1;
+  this->dets.clear();
+  this->dets_unfolded.clear();
+  this->det_idx_stride = 2 * excitation_level.size();
+  std::pair<std::span<const T>, std::span<const T>> hf_det_pair_0 = std::make_pair(this->unique_dets[0][0][0], this->unique_dets[0][1][0]);
+  std::pair<std::span<const T>, std::span<const T>> hf_det_pair_1;
   int symm_idx = -1;
   get_symm_idx(0, hf_det_pair_0, symm_idx);
   if (excitation_level.size() == 2) {
@@ -164,7 +167,7 @@ template <typename T> void POLYQUANT_DETSET<T>::create_excitation(std::vector<st
 
   for (auto i = 0; i < this->unique_dets[0][0].size(); i++) {
     for (auto j = 0; j < this->unique_dets[0][1].size(); j++) {
-      std::pair<std::vector<T>, std::vector<T>> det_pair_0 = std::make_pair(this->unique_dets[0][0][i], this->unique_dets[0][1][j]);
+      std::pair<std::span<const T>, std::span<const T>> det_pair_0 = std::make_pair(this->unique_dets[0][0][i], this->unique_dets[0][1][j]);
       auto excitation_degree_0 = 0;
       excitation_degree_0 = this->num_excitation(hf_det_pair_0, det_pair_0);
       if (excitation_degree_0 <= std::get<2>(excitation_level[0])) {
@@ -172,7 +175,7 @@ template <typename T> void POLYQUANT_DETSET<T>::create_excitation(std::vector<st
           for (auto k = 0; k < this->unique_dets[1][0].size(); k++) {
             for (auto l = 0; l < this->unique_dets[1][1].size(); l++) {
               int excitation_symm_idx = -1;
-              std::pair<std::vector<T>, std::vector<T>> det_pair_1 = std::make_pair(this->unique_dets[1][0][k], this->unique_dets[1][1][l]);
+              std::pair<std::span<const T>, std::span<const T>> det_pair_1 = std::make_pair(this->unique_dets[1][0][k], this->unique_dets[1][1][l]);
               auto excitation_degree_1 = 0;
               excitation_degree_1 = this->num_excitation(hf_det_pair_1, det_pair_1);
               if (excitation_degree_1 <= std::get<2>(excitation_level[1])) {
@@ -182,9 +185,7 @@ template <typename T> void POLYQUANT_DETSET<T>::create_excitation(std::vector<st
                   this->N_dets_complete_space++;
                 }
                 if (excitation_degree_0 + excitation_degree_1 <= max_collective_excitation_level && excitation_symm_idx == this->curr_symm_block) {
-                  std::vector<int> det_idx = {i, j, k, l};
-                  this->dets[det_idx] = this->N_dets;
-                  this->N_dets++;
+                  this->add_det({i, j, k, l});
                 }
               }
             }
@@ -196,158 +197,163 @@ template <typename T> void POLYQUANT_DETSET<T>::create_excitation(std::vector<st
             this->N_dets_complete_space++;
           }
           if (excitation_degree_0 <= max_collective_excitation_level && excitation_symm_idx == this->curr_symm_block) {
-            std::vector<int> det_idx = {i, j};
-            this->dets[det_idx] = this->N_dets;
-            this->N_dets++;
+            this->add_det({i, j});
           }
         }
       }
     }
   }
+  this->build_det_address();
 }
 
 template <typename T> void POLYQUANT_DETSET<T>::create_unique_excitation_map_singles() {
   auto function = __PRETTY_FUNCTION__;
   POLYQUANT_TIMER timer(function);
-  auto nthreads = omp_get_max_threads();
-  std::vector<std::vector<std::vector<double>>> threads_map_contributions;
-  threads_map_contributions.resize(nthreads);
-  for (auto i = 0; i < nthreads; i++) {
-    threads_map_contributions[i].clear();
-  }
-  auto idx_part = 0;
-  unique_singles.resize(this->input_integral->input_molecule->quantum_particles.size());
-  for (auto const &[quantum_part_key, quantum_part] : this->input_integral->input_molecule->quantum_particles) {
+  unique_singles.resize(this->unique_dets.size());
+  for (auto idx_part = 0; idx_part < this->unique_dets.size(); idx_part++) {
     unique_singles[idx_part].resize(2);
     for (auto idx_spin = 0; idx_spin < 2; idx_spin++) {
-      unique_singles[idx_part][idx_spin].resize(this->unique_dets[idx_part][idx_spin].size());
-      for (auto i = 0; i < nthreads; i++) {
-        threads_map_contributions[i].clear();
-        threads_map_contributions[i].resize(this->unique_dets[idx_part][idx_spin].size());
-      }
-#pragma omp parallel
-      {
-        auto thread_id = omp_get_thread_num();
-        for (auto idx_det = 0; idx_det < this->unique_dets[idx_part][idx_spin].size(); idx_det++) {
-          if (idx_det % nthreads != thread_id) {
-            continue;
-          }
-          std::set<std::vector<T>> excited_dets;
-          this->get_unique_excitation_set(idx_part, idx_spin, idx_det, 1, excited_dets);
-
-          auto curr_idx = 0;
-          while (!excited_dets.empty() && curr_idx < this->unique_dets[idx_part][idx_spin].size()) {
-            // for (auto curr_idx = 0; curr_idx < this->unique_dets[idx_part][idx_spin].size(); curr_idx++) {
-            auto curr_det = this->unique_dets[idx_part][idx_spin][curr_idx];
-            auto is_det = [&curr_det](std::vector<T> i) { return i == curr_det; };
-            auto det_in_excited_dets_list = std::find_if(excited_dets.begin(), excited_dets.end(), is_det);
-            if (det_in_excited_dets_list != excited_dets.end()) {
-              threads_map_contributions[thread_id][idx_det].push_back(curr_idx);
-              // unique_singles[idx_part][idx_spin][idx_det].push_back(curr_idx);
-              excited_dets.erase(det_in_excited_dets_list);
-            }
-            curr_idx++;
-          }
-#pragma omp critical
-          unique_singles[idx_part][idx_spin][idx_det].insert(unique_singles[idx_part][idx_spin][idx_det].begin(), threads_map_contributions[thread_id][idx_det].begin(),
-                                                             threads_map_contributions[thread_id][idx_det].end());
-        }
-      }
-
-      // auto curr_idx = 0;
-      // while (!excited_dets.empty() && curr_idx < this->unique_dets[idx_part][idx_spin].size()) {
-      //   auto curr_det = this->unique_dets[idx_part][idx_spin][curr_idx];
-      //   auto is_det = [&curr_det](std::vector<T> i) { return i == curr_det; };
-      //   auto det_in_excited_dets_list = std::find_if(excited_dets.begin(), excited_dets.end(), is_det);
-      //   if (det_in_excited_dets_list != excited_dets.end()) {
-      //     unique_singles[idx_part][idx_spin][idx_det].insert(curr_idx);
-      //     excited_dets.erase(det_in_excited_dets_list);
-      //   }
-      //   // if (*excited_dets.end() == this->unique_dets[idx_part][idx_spin][curr_idx]) {
-      //   //     return_idx_list.push_back(curr_idx);
-      //   //     excited_dets.pop_back();
-      //   // }
-      //   curr_idx++;
-      // }
-      // std::sort(unique_singles[idx_part][idx_spin][idx_det].begin(), unique_singles[idx_part][idx_spin][idx_det].end());
-
-      // merge vectors
-      //
-      // for (auto idx_det = 0; idx_det < this->unique_dets[idx_part][idx_spin].size(); idx_det++) {
-      //   auto thread_id = idx_det % nthreads;
-      //   unique_singles[idx_part][idx_spin][idx_det].insert(unique_singles[idx_part][idx_spin][idx_det].begin(), threads_map_contributions[thread_id][idx_det].begin(),
-      //                                                      threads_map_contributions[thread_id][idx_det].end());
-      // }
-      // std::stringstream filename;
-      // filename << "uniquesingles_map_" << idx_part <<"_"<< idx_spin << ".txt";
-      //   Polyquant_dump_vecofvec_to_file(unique_singles[idx_part][idx_spin], filename.str());
+      this->create_unique_excitation_map(idx_part, idx_spin, 1, unique_singles[idx_part][idx_spin]);
     }
-    idx_part++;
   }
 }
-// so much duplicated code in the function above and here and in get_unique_excitation_list_of_indices. needs a helper fn
+
 template <typename T> void POLYQUANT_DETSET<T>::create_unique_excitation_map_doubles() {
   auto function = __PRETTY_FUNCTION__;
   POLYQUANT_TIMER timer(function);
-  auto nthreads = omp_get_max_threads();
-  std::vector<std::vector<std::vector<double>>> threads_map_contributions;
-  threads_map_contributions.resize(nthreads);
-  for (auto i = 0; i < nthreads; i++) {
-    threads_map_contributions[i].clear();
-  }
-
-  auto idx_part = 0;
-  unique_doubles.resize(this->input_integral->input_molecule->quantum_particles.size());
-  for (auto const &[quantum_part_key, quantum_part] : this->input_integral->input_molecule->quantum_particles) {
+  unique_doubles.resize(this->unique_dets.size());
+  for (auto idx_part = 0; idx_part < this->unique_dets.size(); idx_part++) {
     unique_doubles[idx_part].resize(2);
     for (auto idx_spin = 0; idx_spin < 2; idx_spin++) {
-      unique_doubles[idx_part][idx_spin].resize(this->unique_dets[idx_part][idx_spin].size());
-      // do we have enough particles to do a double excitation?
-      if (this->unique_dets[idx_part][idx_spin][0][0] < 2) {
-        continue;
+      this->create_unique_excitation_map(idx_part, idx_spin, 2, unique_doubles[idx_part][idx_spin]);
+    }
+  }
+}
+
+template <typename T> void POLYQUANT_DETSET<T>::create_unique_excitation_map(int idx_part, int idx_spin, int excitation_level, POLYQUANT_EXCITATION_MAP &excitation_map) const {
+  if (excitation_level != 1 && excitation_level != 2) {
+    APP_ABORT("Excitation maps can only be built for single or double excitations");
+  }
+  const auto &strings = this->unique_dets[idx_part][idx_spin];
+  const std::size_t num_strings = strings.size();
+  const std::size_t num_int = strings.n_int();
+  std::size_t num_occ = 0;
+  if (num_strings != 0) {
+    for (auto word : strings[0]) {
+      num_occ += std::popcount(word);
+    }
+  }
+  // do we have enough particles to do this excitation?
+  if (num_occ < static_cast<std::size_t>(excitation_level)) {
+    excitation_map.assign_empty(num_strings);
+    return;
+  }
+  const std::size_t keys_per_string = excitation_level == 1 ? num_occ : num_occ * (num_occ - 1) / 2;
+  const std::size_t num_keys = num_strings * keys_per_string;
+
+  // key k belongs to string k / keys_per_string and is that string with one or two of its electrons removed
+  std::vector<T> keys(num_keys * num_int);
+  std::vector<std::size_t> key_hashes(num_keys);
+  auto key = [&keys, num_int](std::size_t k) { return std::span<const T>(keys.data() + k * num_int, num_int); };
+#pragma omp parallel
+  {
+    std::vector<std::pair<std::size_t, T>> occ;
+    occ.reserve(num_occ);
+    VectorHash<T> hasher;
+#pragma omp for schedule(static)
+    for (std::size_t idx_det = 0; idx_det < num_strings; idx_det++) {
+      auto det = strings[idx_det];
+      occ.clear();
+      for (std::size_t word = 0; word < num_int; word++) {
+        for (T bits = det[word]; bits != 0; bits &= bits - 1) {
+          occ.push_back({word, bits & (~bits + 1)});
+        }
       }
-      for (auto i = 0; i < nthreads; i++) {
-        threads_map_contributions[i].clear();
-        threads_map_contributions[i].resize(this->unique_dets[idx_part][idx_spin].size());
+      auto k = idx_det * keys_per_string;
+      auto add_key = [&](std::size_t first, std::size_t second) {
+        auto key_begin = keys.begin() + k * num_int;
+        std::copy(det.begin(), det.end(), key_begin);
+        key_begin[occ[first].first] &= ~occ[first].second;
+        key_begin[occ[second].first] &= ~occ[second].second;
+        key_hashes[k] = hasher(key(k));
+        k++;
+      };
+      for (std::size_t first = 0; first < num_occ; first++) {
+        if (excitation_level == 1) {
+          add_key(first, first);
+          continue;
+        }
+        for (std::size_t second = first + 1; second < num_occ; second++) {
+          add_key(first, second);
+        }
       }
+    }
+  }
+
+  // sort the keys so equal keys are adjacent, each run of equal keys is a bucket of mutually connected strings
+  std::vector<std::size_t> sorted_keys(num_keys);
+  std::iota(sorted_keys.begin(), sorted_keys.end(), 0);
+  std::sort(sorted_keys.begin(), sorted_keys.end(), [&](std::size_t a, std::size_t b) {
+    if (key_hashes[a] != key_hashes[b]) {
+      return key_hashes[a] < key_hashes[b];
+    }
+    auto key_a = key(a);
+    auto key_b = key(b);
+    return std::lexicographical_compare(key_a.begin(), key_a.end(), key_b.begin(), key_b.end());
+  });
+  std::vector<std::size_t> bucket_offsets;
+  std::vector<std::size_t> key_bucket(num_keys);
+  for (std::size_t i = 0; i < num_keys; i++) {
+    if (i == 0 || key_hashes[sorted_keys[i]] != key_hashes[sorted_keys[i - 1]] || !Polyquant_det_equal(key(sorted_keys[i]), key(sorted_keys[i - 1]))) {
+      bucket_offsets.push_back(i);
+    }
+    key_bucket[sorted_keys[i]] = bucket_offsets.size() - 1;
+  }
+  bucket_offsets.push_back(num_keys);
+  std::vector<T>().swap(keys);
+
+  // each thread gathers the rows of a contiguous block of strings, then the blocks are stitched into one CSR array
+  std::vector<std::size_t> row_offsets(num_strings + 1, 0);
+  std::vector<std::size_t> connected_strings;
+  auto nthreads = omp_get_max_threads();
+  std::vector<std::vector<std::size_t>> threads_connected_strings(nthreads);
 #pragma omp parallel
-      {
-        auto thread_id = omp_get_thread_num();
-        for (auto idx_det = 0; idx_det < this->unique_dets[idx_part][idx_spin].size(); idx_det++) {
-          if (idx_det % nthreads != thread_id) {
+  {
+    auto thread_id = omp_get_thread_num();
+    auto block_size = (num_strings + nthreads - 1) / nthreads;
+    auto block_begin = std::min(num_strings, thread_id * block_size);
+    auto block_end = std::min(num_strings, block_begin + block_size);
+    auto &thread_connected_strings = threads_connected_strings[thread_id];
+    for (auto idx_det = block_begin; idx_det < block_end; idx_det++) {
+      auto row_begin = thread_connected_strings.size();
+      for (auto k = idx_det * keys_per_string; k < (idx_det + 1) * keys_per_string; k++) {
+        auto bucket = key_bucket[k];
+        for (auto i = bucket_offsets[bucket]; i < bucket_offsets[bucket + 1]; i++) {
+          auto idx_jdet = sorted_keys[i] / keys_per_string;
+          if (idx_jdet == idx_det) {
             continue;
           }
-          std::set<std::vector<T>> excited_dets;
-          this->get_unique_excitation_set(idx_part, idx_spin, idx_det, 2, excited_dets);
-          auto curr_idx = 0;
-          while (!excited_dets.empty() && curr_idx < this->unique_dets[idx_part][idx_spin].size()) {
-            auto curr_det = this->unique_dets[idx_part][idx_spin][curr_idx];
-            auto is_det = [&curr_det](std::vector<T> i) { return i == curr_det; };
-            auto det_in_excited_dets_list = std::find_if(excited_dets.begin(), excited_dets.end(), is_det);
-            if (det_in_excited_dets_list != excited_dets.end()) {
-              threads_map_contributions[thread_id][idx_det].push_back(curr_idx);
-              // unique_doubles[idx_part][idx_spin][idx_det].push_back(curr_idx);
-              excited_dets.erase(det_in_excited_dets_list);
-            }
-            curr_idx++;
+          // strings one excitation apart share num_occ - 1 remove-two keys, keep only the true doubles
+          if (excitation_level == 2 && Polyquant_det_num_excitation(strings[idx_det], strings[idx_jdet]) != 2) {
+            continue;
           }
-#pragma omp critical
-          unique_doubles[idx_part][idx_spin][idx_det].insert(unique_doubles[idx_part][idx_spin][idx_det].begin(), threads_map_contributions[thread_id][idx_det].begin(),
-                                                             threads_map_contributions[thread_id][idx_det].end());
+          thread_connected_strings.push_back(idx_jdet);
         }
       }
-      // merge vectors
-      // for (auto idx_det = 0; idx_det < this->unique_dets[idx_part][idx_spin].size(); idx_det++) {
-      //   auto thread_id = idx_det % nthreads;
-      //   unique_doubles[idx_part][idx_spin][idx_det].insert(unique_doubles[idx_part][idx_spin][idx_det].begin(), threads_map_contributions[thread_id][idx_det].begin(),
-      //                                                      threads_map_contributions[thread_id][idx_det].end());
-      // }
-      // std::stringstream filename;
-      // filename << "uniquedoubles_map_" << idx_part <<"_"<< idx_spin << ".txt";
-      //   Polyquant_dump_vecofvec_to_file(unique_doubles[idx_part][idx_spin], filename.str());
+      std::sort(thread_connected_strings.begin() + row_begin, thread_connected_strings.end());
+      row_offsets[idx_det + 1] = thread_connected_strings.size() - row_begin;
+    }
+#pragma omp barrier
+#pragma omp single
+    {
+      std::partial_sum(row_offsets.begin(), row_offsets.end(), row_offsets.begin());
+      connected_strings.resize(row_offsets.back());
+    }
+    if (block_begin < block_end) {
+      std::copy(thread_connected_strings.begin(), thread_connected_strings.end(), connected_strings.begin() + row_offsets[block_begin]);
     }
-    idx_part++;
   }
+  excitation_map.assign(std::move(row_offsets), std::move(connected_strings));
 }
 
 template <typename T> void POLYQUANT_DETSET<T>::print_determinants() {
@@ -375,19 +381,69 @@ template <typename T> void POLYQUANT_DETSET<T>::print_determinants() {
   }
 }
 
-template <typename T> std::vector<int> POLYQUANT_DETSET<T>::det_idx_unfold(std::size_t det_idx) const {
-  if (det_idx > this->N_dets) {
-    APP_ABORT("det_idx_unfold called with value greater than the number of determinants");
+template <typename T> void POLYQUANT_DETSET<T>::add_det(const std::vector<int> &det_idx) {
+  if (this->det_idx_stride != det_idx.size()) {
+    APP_ABORT("add_det called with a det index vector of the wrong length");
+  }
+  this->dets[det_idx] = this->N_dets;
+  this->dets_unfolded.insert(this->dets_unfolded.end(), det_idx.begin(), det_idx.end());
+  this->N_dets++;
+}
+
+template <typename T> void POLYQUANT_DETSET<T>::rebuild_dets_unfolded() {
+  this->N_dets = this->dets.size();
+  this->dets_unfolded.assign(this->N_dets * this->det_idx_stride, -1);
+  for (auto const &[det_idx, global_idx] : this->dets) {
+    if (global_idx < 0 || global_idx >= this->N_dets || det_idx.size() != this->det_idx_stride) {
+      APP_ABORT("rebuild_dets_unfolded needs the determinants to be numbered contiguously from 0");
+    }
+    std::copy(det_idx.begin(), det_idx.end(), this->dets_unfolded.begin() + global_idx * this->det_idx_stride);
+  }
+  this->build_det_address();
+}
+
+template <typename T> void POLYQUANT_DETSET<T>::build_det_address() {
+  this->det_address.clear();
+  this->det_address_strides.assign(this->det_idx_stride, 0);
+  this->det_address_dense = false;
+  // slot s of the det index vector indexes the unique strings of particle s / 2 and spin s % 2
+  std::size_t address_size = 1;
+  for (auto slot = this->det_idx_stride - 1; slot >= 0; slot--) {
+    this->det_address_strides[slot] = address_size;
+    auto num_strings = this->unique_dets[slot / 2][slot % 2].size();
+    if (num_strings != 0 && address_size > this->det_address_max_size / num_strings) {
+      Polyquant_cout("String product space exceeds det_address_max_size, determinant lookups will use the hash map");
+      return;
+    }
+    address_size *= num_strings;
   }
+  // a 4 byte entry per string combination only beats the hash map when a good fraction of them are determinants, the string driven sigma
+  // walks the whole product space and always needs the table
+  if (!this->string_driven_sigma && this->N_dets < this->det_address_min_density * address_size) {
+    Polyquant_cout("Determinants fill less than det_address_min_density of the string product space, determinant lookups will use the hash map");
+    return;
+  }
+  this->det_address.assign(address_size, -1);
+  for (auto i_det = 0; i_det < this->N_dets; i_det++) {
+    std::size_t offset = 0;
+    for (auto slot = 0; slot < this->det_idx_stride; slot++) {
+      offset += this->dets_unfolded[i_det * this->det_idx_stride + slot] * this->det_address_strides[slot];
+    }
+    this->det_address[offset] = i_det;
+  }
+  this->det_address_dense = true;
+  Polyquant_cout("Dense determinant address table with " + std::to_string(address_size) + " entries for " + std::to_string(this->N_dets) + " determinants");
+}
 
-  auto it = std::find_if(std::begin(dets), std::end(dets), [&det_idx](auto &&pair) { return pair.second == det_idx; });
-  if (it == std::end(dets)) {
-    APP_ABORT("det_idx_unfold could not find determinant which should exist (idx < N_dets).");
+template <typename T> std::vector<int> POLYQUANT_DETSET<T>::det_idx_unfold(std::size_t det_idx) const {
+  if (det_idx >= this->N_dets) {
+    APP_ABORT("det_idx_unfold called with value greater than the number of determinants");
   }
-  return it->first;
+  auto begin = this->dets_unfolded.begin() + det_idx * this->det_idx_stride;
+  return std::vector<int>(begin, begin + this->det_idx_stride);
 }
 
-template <typename T> std::vector<T> POLYQUANT_DETSET<T>::get_det(int idx_part, int idx_spin, int i) const { return unique_dets[idx_part][idx_spin][i]; }
+template <typename T> std::span<const T> POLYQUANT_DETSET<T>::get_det(int idx_part, int idx_spin, int i) const { return unique_dets[idx_part][idx_spin][i]; }
 template <typename T> std::vector<T> POLYQUANT_DETSET<T>::get_det_withfcorbs(int idx_part, int idx_spin, int i) const {
   T one = 1;
   T zero = 0;
@@ -405,7 +461,7 @@ template <typename T> std::vector<T> POLYQUANT_DETSET<T>::get_det_withfcorbs(int
 
   if (nfc == 0) {
     if (num_int == det.size()) {
-      return det;
+      return std::vector<T>(det.begin(), det.end());
     } else {
       std::vector<T> new_det;
       new_det.push_back(zero);
@@ -2,7 +2,7 @@
 #include "ci/determinant_set.hpp"
 
 namespace polyquant {
-template <typename T> void POLYQUANT_DETSET<T>::get_symm_idx(int idx_part, const std::pair<std::vector<T>, std::vector<T>> &D, int &symm_idx) {
+template <typename T> void POLYQUANT_DETSET<T>::get_symm_idx(int idx_part, const std::pair<std::span<const T>, std::span<const T>> &D, int &symm_idx) {
   // int symm_idx = -1;
   std::vector<int> occ, virt;
   occ.clear();
@@ -22,7 +22,11 @@ template <typename T>
 void POLYQUANT_DETSET<T>::create_sigma(Eigen::Ref<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> sigma,
                                        const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> &C) const {
   auto num_parts = this->input_integral->input_molecule->quantum_particles.size();
-  if (num_parts == 1) {
+  if (num_parts == 1 && this->string_driven_sigma) {
+    sigma_one_species_string_driven(sigma, C);
+  } else if (this->gather_sigma || num_parts > 2) {
+    sigma_gather(sigma, C);
+  } else if (num_parts == 1) {
     sigma_one_species(sigma, C);
   } else if (num_parts == 2) {
     sigma_two_species(sigma, C);
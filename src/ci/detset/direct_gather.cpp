@@ -0,0 +1,72 @@
+#include "ci/determinant_set.hpp"
+
+namespace polyquant {
+
+template <typename T> void POLYQUANT_DETSET<T>::sigma_row_partition(std::vector<int> &row_offsets) const {
+  auto num_slots = static_cast<std::size_t>(this->det_idx_stride);
+  // estimated number of connected determinants of each row, from the string excitation maps
+  std::vector<double> row_cost(this->N_dets + 1, 0.0);
+#pragma omp parallel for schedule(static)
+  for (auto i_det = 0; i_det < this->N_dets; i_det++) {
+    auto idet_unfold = this->det_idx_view(i_det);
+    double cost = 1.0;
+    for (std::size_t slot = 0; slot < num_slots; slot++) {
+      auto num_singles = static_cast<double>(this->unique_singles[slot / 2][slot % 2][idet_unfold[slot]].size());
+      cost += num_singles + this->unique_doubles[slot / 2][slot % 2][idet_unfold[slot]].size();
+      for (std::size_t other_slot = slot + 1; other_slot < num_slots; other_slot++) {
+        cost += num_singles * this->unique_singles[other_slot / 2][other_slot % 2][idet_unfold[other_slot]].size();
+      }
+    }
+    row_cost[i_det + 1] = cost;
+  }
+  std::partial_sum(row_cost.begin(), row_cost.end(), row_cost.begin());
+
+  // many more blocks than threads so the dynamic schedule can even out the cost estimate
+  auto num_blocks = std::max(1, std::min(this->N_dets, 16 * omp_get_max_threads()));
+  auto block_cost = row_cost.back() / num_blocks;
+  row_offsets.assign(1, 0);
+  for (auto i_det = 1; i_det < this->N_dets; i_det++) {
+    if (row_cost[i_det] >= block_cost * row_offsets.size()) {
+      row_offsets.push_back(i_det);
+    }
+  }
+  row_offsets.push_back(this->N_dets);
+}
+
+template <typename T>
+void POLYQUANT_DETSET<T>::sigma_gather(Eigen::Ref<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> sigma,
+                                       const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> &C) const {
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  const auto num_slots = static_cast<std::size_t>(this->det_idx_stride);
+  const auto num_states = C.cols();
+  const auto charges = this->particle_charges();
+
+  std::vector<int> row_offsets;
+  this->sigma_row_partition(row_offsets);
+  const auto num_blocks = static_cast<int>(row_offsets.size()) - 1;
+
+#pragma omp parallel
+  {
+    std::vector<int> jdet_idx(num_slots);
+    Eigen::Matrix<double, 1, Eigen::Dynamic> sigma_row(num_states);
+#pragma omp for schedule(dynamic, 1)
+    for (auto idx_block = 0; idx_block < num_blocks; idx_block++) {
+      for (auto i_det = row_offsets[idx_block]; i_det < row_offsets[idx_block + 1]; i_det++) {
+        sigma_row.noalias() = this->diagonal_Hii[i_det] * C.row(i_det);
+        // sigma_i += H_ij C_j for every determinant j connected to i
+        this->for_each_connected_det(this->det_idx_view(i_det), jdet_idx, charges, [&](int folded_jdet_idx, auto &&integral) {
+          auto elem = integral();
+          if (elem != 0.0) {
+            sigma_row.noalias() += elem * C.row(folded_jdet_idx);
+          }
+        });
+        // only this thread writes row i_det
+        sigma.row(i_det) += sigma_row;
+      }
+    }
+  }
+}
+
+template class POLYQUANT_DETSET<uint64_t>;
+}; // namespace polyquant
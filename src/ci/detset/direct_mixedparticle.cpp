@@ -36,13 +36,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_diagonal_contribution(Eigen::Ref<Eig
 
             if ((idx_I_A_det + idx_I_B_det + idx_I_C_det + idx_I_D_det) % nthreads != thread_id)
               continue;
-            std::vector<int> det_idx(4);
+            std::array<int, 4> det_idx;
             det_idx[2 * idx_part + first_spin_idx] = idx_I_A_det;
             det_idx[2 * idx_part + second_spin_idx] = idx_I_B_det;
             det_idx[2 * other_idx_part + first_spin_idx] = idx_I_C_det;
             det_idx[2 * other_idx_part + second_spin_idx] = idx_I_D_det;
-            if (this->dets.find(det_idx) != this->dets.end()) {
-              auto folded_idet_idx = this->dets.find(det_idx)->second;
+            if (this->det_idx_fold(det_idx) >= 0) {
+              auto folded_idet_idx = this->det_idx_fold(det_idx);
               // auto integral = Slater_Condon(folded_idet_idx, folded_idet_idx);
               auto integral = diagonal_Hii[folded_idet_idx];
               for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
@@ -88,14 +88,14 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_one_contribution(Eigen::Ref<Ei
           for (auto idx_I_D_det = 0; idx_I_D_det < this->unique_dets[other_idx_part][second_spin_idx].size(); idx_I_D_det++) {
             if ((idx_I_A_det + idx_I_B_det + idx_I_C_det + idx_I_D_det) % nthreads != thread_id)
               continue;
-            std::vector<int> det_idx(4);
+            std::array<int, 4> det_idx;
             det_idx[2 * idx_part + first_spin_idx] = idx_I_A_det;
             det_idx[2 * idx_part + second_spin_idx] = idx_I_B_det;
             det_idx[2 * other_idx_part + first_spin_idx] = idx_I_C_det;
             det_idx[2 * other_idx_part + second_spin_idx] = idx_I_D_det;
 
-            if (this->dets.find(det_idx) != this->dets.end()) {
-              auto folded_idet_idx = this->dets.find(det_idx)->second;
+            if (this->det_idx_fold(det_idx) >= 0) {
+              auto folded_idet_idx = this->det_idx_fold(det_idx);
               std::vector<int> excitation_list;
               // this->get_unique_excitation_list_of_indices(idx_part, first_spin_idx, idx_I_A_det, 1, excitation_list);
               // if (this->unique_dets[idx_part][first_spin_idx][0][0] > 1)
@@ -113,13 +113,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_one_contribution(Eigen::Ref<Ei
                 if (idx_J_A_det <= idx_I_A_det) {
                   continue;
                 }
-                std::vector<int> jdet_idx(4);
+                std::array<int, 4> jdet_idx;
                 jdet_idx[2 * idx_part + first_spin_idx] = idx_J_A_det;
                 jdet_idx[2 * idx_part + second_spin_idx] = idx_I_B_det;
                 jdet_idx[2 * other_idx_part + first_spin_idx] = idx_I_C_det;
                 jdet_idx[2 * other_idx_part + second_spin_idx] = idx_I_D_det;
-                if (this->dets.find(jdet_idx) != this->dets.end()) {
-                  auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+                if (this->det_idx_fold(jdet_idx) >= 0) {
+                  auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
                   // auto num_exec = single_spin_num_excitation(this->unique_dets[idx_part][first_spin_idx][idx_I_A_det], this->unique_dets[idx_part][first_spin_idx][idx_J_A_det]);
                   auto integral = Slater_Condon(folded_idet_idx, folded_jdet_idx);
                   // auto integral = 0.0;
@@ -197,12 +197,12 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_two_contribution(Eigen::Ref<Ei
           for (auto idx_I_D_det = 0; idx_I_D_det < this->unique_dets[idx_D_part_spin.first][idx_D_part_spin.second].size(); idx_I_D_det++) {
             if ((idx_I_A_det + idx_I_B_det + idx_I_C_det + idx_I_D_det) % nthreads != thread_id)
               continue;
-            std::vector<int> det_idx(4);
+            std::array<int, 4> det_idx;
             det_idx[2 * idx_A_part_spin.first + idx_A_part_spin.second] = idx_I_A_det;
             det_idx[2 * idx_B_part_spin.first + idx_B_part_spin.second] = idx_I_B_det;
             det_idx[2 * idx_C_part_spin.first + idx_C_part_spin.second] = idx_I_C_det;
             det_idx[2 * idx_D_part_spin.first + idx_D_part_spin.second] = idx_I_D_det;
-            if (this->dets.find(det_idx) != this->dets.end()) {
+            if (this->det_idx_fold(det_idx) >= 0) {
               // std::set<int> a_excitation_list;
               // this->get_unique_excitation_list_of_indices(idx_A_part_spin.first, idx_A_part_spin.second, idx_I_A_det, 1, a_excitation_list);
               // std::sort(a_excitation_list.begin(), a_excitation_list.end());
@@ -236,14 +236,14 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_two_contribution(Eigen::Ref<Ei
                   //   continue;
                   // }
 
-                  auto folded_det_idx = this->dets.find(det_idx)->second;
-                  std::vector<int> jdet_idx(4);
+                  auto folded_det_idx = this->det_idx_fold(det_idx);
+                  std::array<int, 4> jdet_idx;
                   jdet_idx[2 * idx_A_part_spin.first + idx_A_part_spin.second] = idx_J_A_det;
                   jdet_idx[2 * idx_B_part_spin.first + idx_B_part_spin.second] = idx_J_B_det;
                   jdet_idx[2 * idx_C_part_spin.first + idx_C_part_spin.second] = idx_I_C_det;
                   jdet_idx[2 * idx_D_part_spin.first + idx_D_part_spin.second] = idx_I_D_det;
-                  if (this->dets.find(jdet_idx) != this->dets.end()) {
-                    auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+                  if (this->det_idx_fold(jdet_idx) >= 0) {
+                    auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
                     auto integral = Slater_Condon(folded_det_idx, folded_jdet_idx);
                     for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
                       threads_sigma_contributions[thread_id](folded_det_idx, state_idx) += integral * C(folded_jdet_idx, state_idx);
@@ -306,13 +306,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         if (idx_J_A_det < idx_I_A_det) {
           continue;
         }
-        std::vector<int> jdet_idx(4);
+        std::array<int, 4> jdet_idx;
         jdet_idx[2 * 0 + 0] = idx_J_A_det;
         jdet_idx[2 * 0 + 1] = idx_I_B_det;
         jdet_idx[2 * 1 + 0] = idx_I_C_det;
         jdet_idx[2 * 1 + 1] = idx_I_D_det;
-        if (this->dets.find(jdet_idx) != this->dets.end()) {
-          auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+        if (this->det_idx_fold(jdet_idx) >= 0) {
+          auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
           auto integral = 0.0;
           integral += same_part_ham_single(0, idet_unfold, jdet_idx);
           integral += charge_factor * mixed_part_ham_single(0, 1, idet_unfold, jdet_idx);
@@ -325,13 +325,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         }
         // (part 0 spin 0 single, part 0 spin 1 single) doubles
         for (auto idx_J_B_det : unique_singles[0][1][idx_I_B_det]) {
-          std::vector<int> jdet_idx(4);
+          std::array<int, 4> jdet_idx;
           jdet_idx[2 * 0 + 0] = idx_J_A_det;
           jdet_idx[2 * 0 + 1] = idx_J_B_det;
           jdet_idx[2 * 1 + 0] = idx_I_C_det;
           jdet_idx[2 * 1 + 1] = idx_I_D_det;
-          if (this->dets.find(jdet_idx) != this->dets.end()) {
-            auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+          if (this->det_idx_fold(jdet_idx) >= 0) {
+            auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
             auto integral = 0.0;
             integral += same_part_ham_double(0, idet_unfold, jdet_idx);
             integral += charge_factor * mixed_part_ham_double(0, 1, idet_unfold, jdet_idx);
@@ -345,13 +345,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         }
         // (part 0 spin 0 single, part 1 spin 0 single) doubles
         for (auto idx_J_C_det : unique_singles[1][0][idx_I_C_det]) {
-          std::vector<int> jdet_idx(4);
+          std::array<int, 4> jdet_idx;
           jdet_idx[2 * 0 + 0] = idx_J_A_det;
           jdet_idx[2 * 0 + 1] = idx_I_B_det;
           jdet_idx[2 * 1 + 0] = idx_J_C_det;
           jdet_idx[2 * 1 + 1] = idx_I_D_det;
-          if (this->dets.find(jdet_idx) != this->dets.end()) {
-            auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+          if (this->det_idx_fold(jdet_idx) >= 0) {
+            auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
             auto integral = 0.0;
             integral += charge_factor * mixed_part_ham_double(0, 1, idet_unfold, jdet_idx);
             for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
@@ -364,13 +364,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         }
         // (part 0 spin 0 single, part 1 spin 1 single) doubles
         for (auto idx_J_D_det : unique_singles[1][1][idx_I_D_det]) {
-          std::vector<int> jdet_idx(4);
+          std::array<int, 4> jdet_idx;
           jdet_idx[2 * 0 + 0] = idx_J_A_det;
           jdet_idx[2 * 0 + 1] = idx_I_B_det;
           jdet_idx[2 * 1 + 0] = idx_I_C_det;
           jdet_idx[2 * 1 + 1] = idx_J_D_det;
-          if (this->dets.find(jdet_idx) != this->dets.end()) {
-            auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+          if (this->det_idx_fold(jdet_idx) >= 0) {
+            auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
             auto integral = 0.0;
             integral += charge_factor * mixed_part_ham_double(0, 1, idet_unfold, jdet_idx);
             for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
@@ -387,13 +387,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         if (idx_J_B_det < idx_I_B_det) {
           continue;
         }
-        std::vector<int> jdet_idx(4);
+        std::array<int, 4> jdet_idx;
         jdet_idx[2 * 0 + 0] = idx_I_A_det;
         jdet_idx[2 * 0 + 1] = idx_J_B_det;
         jdet_idx[2 * 1 + 0] = idx_I_C_det;
         jdet_idx[2 * 1 + 1] = idx_I_D_det;
-        if (this->dets.find(jdet_idx) != this->dets.end()) {
-          auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+        if (this->det_idx_fold(jdet_idx) >= 0) {
+          auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
           // auto integral = Slater_Condon(i_det, folded_jdet_idx);
           auto integral = 0.0;
           integral += same_part_ham_single(0, idet_unfold, jdet_idx);
@@ -407,13 +407,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         }
         // (part 0 spin 1 single, part 1 spin 0 single) doubles
         for (auto idx_J_C_det : unique_singles[1][0][idx_I_C_det]) {
-          std::vector<int> jdet_idx(4);
+          std::array<int, 4> jdet_idx;
           jdet_idx[2 * 0 + 0] = idx_I_A_det;
           jdet_idx[2 * 0 + 1] = idx_J_B_det;
           jdet_idx[2 * 1 + 0] = idx_J_C_det;
           jdet_idx[2 * 1 + 1] = idx_I_D_det;
-          if (this->dets.find(jdet_idx) != this->dets.end()) {
-            auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+          if (this->det_idx_fold(jdet_idx) >= 0) {
+            auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
             // auto integral = Slater_Condon(i_det, folded_jdet_idx);
             auto integral = 0.0;
             integral += charge_factor * mixed_part_ham_double(0, 1, idet_unfold, jdet_idx);
@@ -427,13 +427,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         }
         // (part 0 spin 1 single, part 1 spin 1 single) doubles
         for (auto idx_J_D_det : unique_singles[1][1][idx_I_D_det]) {
-          std::vector<int> jdet_idx(4);
+          std::array<int, 4> jdet_idx;
           jdet_idx[2 * 0 + 0] = idx_I_A_det;
           jdet_idx[2 * 0 + 1] = idx_J_B_det;
           jdet_idx[2 * 1 + 0] = idx_I_C_det;
           jdet_idx[2 * 1 + 1] = idx_J_D_det;
-          if (this->dets.find(jdet_idx) != this->dets.end()) {
-            auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+          if (this->det_idx_fold(jdet_idx) >= 0) {
+            auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
             // auto integral = Slater_Condon(i_det, folded_jdet_idx);
             auto integral = 0.0;
             integral += charge_factor * mixed_part_ham_double(0, 1, idet_unfold, jdet_idx);
@@ -451,13 +451,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         if (idx_J_C_det < idx_I_C_det) {
           continue;
         }
-        std::vector<int> jdet_idx(4);
+        std::array<int, 4> jdet_idx;
         jdet_idx[2 * 0 + 0] = idx_I_A_det;
         jdet_idx[2 * 0 + 1] = idx_I_B_det;
         jdet_idx[2 * 1 + 0] = idx_J_C_det;
         jdet_idx[2 * 1 + 1] = idx_I_D_det;
-        if (this->dets.find(jdet_idx) != this->dets.end()) {
-          auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+        if (this->det_idx_fold(jdet_idx) >= 0) {
+          auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
           // auto integral = Slater_Condon(i_det, folded_jdet_idx);
           auto integral = 0.0;
           integral += same_part_ham_single(1, idet_unfold, jdet_idx);
@@ -471,13 +471,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         }
         // (part 1 spin 0 single, part 1 spin 1 single) doubles
         for (auto idx_J_D_det : unique_singles[1][1][idx_I_D_det]) {
-          std::vector<int> jdet_idx(4);
+          std::array<int, 4> jdet_idx;
           jdet_idx[2 * 0 + 0] = idx_I_A_det;
           jdet_idx[2 * 0 + 1] = idx_I_B_det;
           jdet_idx[2 * 1 + 0] = idx_J_C_det;
           jdet_idx[2 * 1 + 1] = idx_J_D_det;
-          if (this->dets.find(jdet_idx) != this->dets.end()) {
-            auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+          if (this->det_idx_fold(jdet_idx) >= 0) {
+            auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
             // auto integral = Slater_Condon(i_det, folded_jdet_idx);
             auto integral = 0.0;
             integral += same_part_ham_double(1, idet_unfold, jdet_idx);
@@ -496,13 +496,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         if (idx_J_D_det < idx_I_D_det) {
           continue;
         }
-        std::vector<int> jdet_idx(4);
+        std::array<int, 4> jdet_idx;
         jdet_idx[2 * 0 + 0] = idx_I_A_det;
         jdet_idx[2 * 0 + 1] = idx_I_B_det;
         jdet_idx[2 * 1 + 0] = idx_I_C_det;
         jdet_idx[2 * 1 + 1] = idx_J_D_det;
-        if (this->dets.find(jdet_idx) != this->dets.end()) {
-          auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+        if (this->det_idx_fold(jdet_idx) >= 0) {
+          auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
           // auto integral = Slater_Condon(i_det, folded_jdet_idx);
           auto integral = 0.0;
           integral += same_part_ham_single(1, idet_unfold, jdet_idx);
@@ -520,13 +520,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         if (idx_J_A_det < idx_I_A_det) {
           continue;
         }
-        std::vector<int> jdet_idx(4);
+        std::array<int, 4> jdet_idx;
         jdet_idx[2 * 0 + 0] = idx_J_A_det;
         jdet_idx[2 * 0 + 1] = idx_I_B_det;
         jdet_idx[2 * 1 + 0] = idx_I_C_det;
         jdet_idx[2 * 1 + 1] = idx_I_D_det;
-        if (this->dets.find(jdet_idx) != this->dets.end()) {
-          auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+        if (this->det_idx_fold(jdet_idx) >= 0) {
+          auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
           auto integral = 0.0;
           integral += same_part_ham_double(0, idet_unfold, jdet_idx);
           for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
@@ -542,13 +542,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         if (idx_J_B_det < idx_I_B_det) {
           continue;
         }
-        std::vector<int> jdet_idx(4);
+        std::array<int, 4> jdet_idx;
         jdet_idx[2 * 0 + 0] = idx_I_A_det;
         jdet_idx[2 * 0 + 1] = idx_J_B_det;
         jdet_idx[2 * 1 + 0] = idx_I_C_det;
         jdet_idx[2 * 1 + 1] = idx_I_D_det;
-        if (this->dets.find(jdet_idx) != this->dets.end()) {
-          auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+        if (this->det_idx_fold(jdet_idx) >= 0) {
+          auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
           auto integral = 0.0;
           integral += same_part_ham_double(0, idet_unfold, jdet_idx);
           for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
@@ -564,13 +564,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         if (idx_J_C_det < idx_I_C_det) {
           continue;
         }
-        std::vector<int> jdet_idx(4);
+        std::array<int, 4> jdet_idx;
         jdet_idx[2 * 0 + 0] = idx_I_A_det;
         jdet_idx[2 * 0 + 1] = idx_I_B_det;
         jdet_idx[2 * 1 + 0] = idx_J_C_det;
         jdet_idx[2 * 1 + 1] = idx_I_D_det;
-        if (this->dets.find(jdet_idx) != this->dets.end()) {
-          auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+        if (this->det_idx_fold(jdet_idx) >= 0) {
+          auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
           auto integral = 0.0;
           integral += same_part_ham_double(1, idet_unfold, jdet_idx);
           for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
@@ -586,13 +586,13 @@ void POLYQUANT_DETSET<T>::sigma_two_species_class_singleshot(Eigen::Ref<Eigen::M
         if (idx_J_D_det < idx_I_D_det) {
           continue;
         }
-        std::vector<int> jdet_idx(4);
+        std::array<int, 4> jdet_idx;
         jdet_idx[2 * 0 + 0] = idx_I_A_det;
         jdet_idx[2 * 0 + 1] = idx_I_B_det;
         jdet_idx[2 * 1 + 0] = idx_I_C_det;
         jdet_idx[2 * 1 + 1] = idx_J_D_det;
-        if (this->dets.find(jdet_idx) != this->dets.end()) {
-          auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+        if (this->det_idx_fold(jdet_idx) >= 0) {
+          auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
           auto integral = 0.0;
           integral += same_part_ham_double(1, idet_unfold, jdet_idx);
           for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
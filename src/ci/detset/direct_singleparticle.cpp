@@ -26,13 +26,13 @@ void POLYQUANT_DETSET<T>::sigma_one_species_diagonal_contribution(Eigen::Ref<Eig
       for (auto idx_I_B_det = 0; idx_I_B_det < this->unique_dets[idx_part][second_spin_idx].size(); idx_I_B_det++) {
         if ((idx_I_A_det + idx_I_B_det) % nthreads != thread_id)
           continue;
-        std::vector<int> det_idx(2);
+        std::array<int, 2> det_idx;
         det_idx[first_spin_idx] = idx_I_A_det;
         det_idx[second_spin_idx] = idx_I_B_det;
-        if (this->dets.find(det_idx) != this->dets.end()) {
+        if (this->det_idx_fold(det_idx) >= 0) {
           // TODO pick one of these and stick to that form
           // auto folded_idet_idx = this->dets.find(det_idx)->second;
-          auto folded_idet_idx = this->dets.at(det_idx);
+          auto folded_idet_idx = this->det_idx_fold(det_idx);
           // auto integral = Slater_Condon(folded_idet_idx, folded_idet_idx);
           auto integral = diagonal_Hii[folded_idet_idx];
           for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
@@ -74,11 +74,11 @@ void POLYQUANT_DETSET<T>::sigma_one_species_class_one_contribution(Eigen::Ref<Ei
       for (auto idx_I_B_det = 0; idx_I_B_det < this->unique_dets[idx_part][second_spin_idx].size(); idx_I_B_det++) {
         if ((idx_I_A_det + idx_I_B_det) % nthreads != thread_id)
           continue;
-        std::vector<int> det_idx(2);
+        std::array<int, 2> det_idx;
         det_idx[first_spin_idx] = idx_I_A_det;
         det_idx[second_spin_idx] = idx_I_B_det;
-        if (this->dets.find(det_idx) != this->dets.end()) {
-          auto folded_idet_idx = this->dets.find(det_idx)->second;
+        if (this->det_idx_fold(det_idx) >= 0) {
+          auto folded_idet_idx = this->det_idx_fold(det_idx);
           // replace this with for (idx_J_A_det in single_excitation(idx_I_A_det) + double_excitation(idx_I_A_det))
           std::vector<int> excitation_list;
           std::set_union(unique_singles[idx_part][first_spin_idx][idx_I_A_det].begin(), unique_singles[idx_part][first_spin_idx][idx_I_A_det].end(),
@@ -99,10 +99,10 @@ void POLYQUANT_DETSET<T>::sigma_one_species_class_one_contribution(Eigen::Ref<Ei
             if (idx_J_A_det <= idx_I_A_det) {
               continue;
             }
-            std::vector<int> jdet_idx(2);
+            std::array<int, 2> jdet_idx;
             jdet_idx[first_spin_idx] = idx_J_A_det;
             jdet_idx[second_spin_idx] = idx_I_B_det;
-            if (this->dets.find(jdet_idx) != this->dets.end()) {
+            if (this->det_idx_fold(jdet_idx) >= 0) {
 
               auto num_exec = single_spin_num_excitation(this->unique_dets[idx_part][first_spin_idx][idx_I_A_det], this->unique_dets[idx_part][first_spin_idx][idx_J_A_det]);
               auto integral = 0.0;
@@ -112,7 +112,7 @@ void POLYQUANT_DETSET<T>::sigma_one_species_class_one_contribution(Eigen::Ref<Ei
                 integral = same_part_ham_double(idx_part, det_idx, jdet_idx);
               }
               if (integral != 0.0) {
-                auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+                auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
                 for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
                   // auto integral = Slater_Condon(folded_idet_idx, folded_jdet_idx);
                   threads_sigma_contributions[thread_id](folded_idet_idx, state_idx) += integral * C(folded_jdet_idx, state_idx);
@@ -169,10 +169,10 @@ void POLYQUANT_DETSET<T>::sigma_one_species_class_two_contribution(Eigen::Ref<Ei
       for (auto idx_I_B_det = 0; idx_I_B_det < this->unique_dets[idx_part][second_spin_idx].size(); idx_I_B_det++) {
         if ((idx_I_A_det + idx_I_B_det) % nthreads != thread_id)
           continue;
-        std::vector<int> det_idx(2);
+        std::array<int, 2> det_idx;
         det_idx[first_spin_idx] = idx_I_A_det;
         det_idx[second_spin_idx] = idx_I_B_det;
-        if (this->dets.find(det_idx) != this->dets.end()) {
+        if (this->det_idx_fold(det_idx) >= 0) {
           // std::set<int> a_excitation_list;
           // this->get_unique_excitation_list_of_indices(idx_part, first_spin_idx, idx_I_A_det, 1, a_excitation_list);
           // std::sort(a_excitation_list.begin(), a_excitation_list.end());
@@ -189,7 +189,7 @@ void POLYQUANT_DETSET<T>::sigma_one_species_class_two_contribution(Eigen::Ref<Ei
             //  if (num_exec != 1) {
             //    continue;
             //  }
-            auto folded_det_idx = this->dets.find(det_idx)->second;
+            auto folded_det_idx = this->det_idx_fold(det_idx);
             // replace this with for (idx_J_B_det in single_excitation(idx_I_B_det))
             // for (auto idx_J_B_det = idx_I_B_det; idx_J_B_det < this->unique_dets[idx_part][second_spin_idx].size(); idx_J_B_det++) {
             // for (auto idx_J_B_det = 0; idx_J_B_det < this->unique_dets[idx_part][second_spin_idx].size(); idx_J_B_det++) {
@@ -206,11 +206,11 @@ void POLYQUANT_DETSET<T>::sigma_one_species_class_two_contribution(Eigen::Ref<Ei
               //   continue;
               // }
 
-              std::vector<int> jdet_idx(2);
+              std::array<int, 2> jdet_idx;
               jdet_idx[first_spin_idx] = idx_J_A_det;
               jdet_idx[second_spin_idx] = idx_J_B_det;
-              if (this->dets.find(jdet_idx) != this->dets.end()) {
-                auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+              if (this->det_idx_fold(jdet_idx) >= 0) {
+                auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
                 // auto integral = Slater_Condon(folded_det_idx, folded_jdet_idx);
                 auto integral = same_part_ham_double(idx_part, det_idx, jdet_idx);
                 if (integral != 0.0) {
@@ -275,11 +275,11 @@ void POLYQUANT_DETSET<T>::sigma_one_species_class_singleshot(Eigen::Ref<Eigen::M
           continue;
         }
         //  alpha single
-        std::vector<int> jdet_idx(2);
+        std::array<int, 2> jdet_idx;
         jdet_idx[first_spin_idx] = idx_J_A_det;
         jdet_idx[second_spin_idx] = idx_I_B_det;
-        if (this->dets.find(jdet_idx) != this->dets.end()) {
-          auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+        if (this->det_idx_fold(jdet_idx) >= 0) {
+          auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
           auto integral = same_part_ham_single(idx_part, idet_unfold, jdet_idx);
           for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
             if (integral != 0.0) {
@@ -290,11 +290,11 @@ void POLYQUANT_DETSET<T>::sigma_one_species_class_singleshot(Eigen::Ref<Eigen::M
         }
         // loop over connected beta excitations for a connected double excitation
         for (auto idx_J_B_det : unique_singles[idx_part][second_spin_idx][idx_I_B_det]) {
-          std::vector<int> jdet_idx(2);
+          std::array<int, 2> jdet_idx;
           jdet_idx[first_spin_idx] = idx_J_A_det;
           jdet_idx[second_spin_idx] = idx_J_B_det;
-          if (this->dets.find(jdet_idx) != this->dets.end()) {
-            auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+          if (this->det_idx_fold(jdet_idx) >= 0) {
+            auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
             auto integral = same_part_ham_double(idx_part, idet_unfold, jdet_idx);
             for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
               if (integral != 0.0) {
@@ -311,11 +311,11 @@ void POLYQUANT_DETSET<T>::sigma_one_species_class_singleshot(Eigen::Ref<Eigen::M
           continue;
         }
         //  alpha single
-        std::vector<int> jdet_idx(2);
+        std::array<int, 2> jdet_idx;
         jdet_idx[first_spin_idx] = idx_I_A_det;
         jdet_idx[second_spin_idx] = idx_J_B_det;
-        if (this->dets.find(jdet_idx) != this->dets.end()) {
-          auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+        if (this->det_idx_fold(jdet_idx) >= 0) {
+          auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
           auto integral = same_part_ham_single(idx_part, idet_unfold, jdet_idx);
           for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
             if (integral != 0.0) {
@@ -331,11 +331,11 @@ void POLYQUANT_DETSET<T>::sigma_one_species_class_singleshot(Eigen::Ref<Eigen::M
           continue;
         }
         //  alpha double
-        std::vector<int> jdet_idx(2);
+        std::array<int, 2> jdet_idx;
         jdet_idx[first_spin_idx] = idx_J_A_det;
         jdet_idx[second_spin_idx] = idx_I_B_det;
-        if (this->dets.find(jdet_idx) != this->dets.end()) {
-          auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+        if (this->det_idx_fold(jdet_idx) >= 0) {
+          auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
           auto integral = same_part_ham_double(idx_part, idet_unfold, jdet_idx);
           for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
             if (integral != 0.0) {
@@ -351,11 +351,11 @@ void POLYQUANT_DETSET<T>::sigma_one_species_class_singleshot(Eigen::Ref<Eigen::M
           continue;
         }
         //  alpha single
-        std::vector<int> jdet_idx(2);
+        std::array<int, 2> jdet_idx;
         jdet_idx[first_spin_idx] = idx_I_A_det;
         jdet_idx[second_spin_idx] = idx_J_B_det;
-        if (this->dets.find(jdet_idx) != this->dets.end()) {
-          auto folded_jdet_idx = this->dets.find(jdet_idx)->second;
+        if (this->det_idx_fold(jdet_idx) >= 0) {
+          auto folded_jdet_idx = this->det_idx_fold(jdet_idx);
           auto integral = same_part_ham_double(idx_part, idet_unfold, jdet_idx);
           for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
             if (integral != 0.0) {
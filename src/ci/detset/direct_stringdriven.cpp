@@ -0,0 +1,174 @@
+#include "ci/determinant_set.hpp"
+
+namespace polyquant {
+
+template <typename T> void POLYQUANT_DETSET<T>::precompute_string_sigma_tables() const {
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  auto idx_part = 0;
+  auto num_spin_ints = this->input_integral->mo_one_body_ints[idx_part].size();
+  string_replacements.resize(2);
+  same_spin_string_ham.resize(2);
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> occupations(2);
+  for (auto idx_spin = 0; idx_spin < 2; idx_spin++) {
+    auto spin_ints = idx_spin % num_spin_ints;
+    const auto &one_body = this->input_integral->mo_one_body_ints[idx_part][spin_ints];
+    const auto &two_body = this->input_integral->mo_two_body_ints[idx_part][spin_ints][idx_part][spin_ints];
+    const auto &strings = this->unique_dets[idx_part][idx_spin];
+    const auto &singles = this->unique_singles[idx_part][idx_spin];
+    const auto &doubles = this->unique_doubles[idx_part][idx_spin];
+    const std::size_t num_strings = strings.size();
+    occupations[idx_spin].setZero(num_strings, one_body.rows());
+
+    // every string has one diagonal entry per occupied orbital and one entry per connected single
+    std::vector<std::size_t> row_offsets(num_strings + 1, 0);
+    for (std::size_t idx_det = 0; idx_det < num_strings; idx_det++) {
+      std::size_t num_occ = 0;
+      for (auto word : strings[idx_det]) {
+        num_occ += std::popcount(word);
+      }
+      row_offsets[idx_det + 1] = row_offsets[idx_det] + num_occ + singles[idx_det].size();
+    }
+    std::vector<POLYQUANT_STRING_REPLACEMENT> replacements(row_offsets.back());
+
+    auto nthreads = omp_get_max_threads();
+    std::vector<std::vector<Eigen::Triplet<double>>> threads_triplets(nthreads);
+#pragma omp parallel
+    {
+      auto thread_id = omp_get_thread_num();
+      std::vector<int> occ, virt;
+#pragma omp for schedule(dynamic)
+      for (std::size_t idx_det = 0; idx_det < num_strings; idx_det++) {
+        auto det_i = strings[idx_det];
+        occ.clear();
+        virt.clear();
+        this->get_occ_virt(idx_part, det_i, occ, virt);
+        auto entry = row_offsets[idx_det];
+        for (auto orb_i : occ) {
+          occupations[idx_spin](idx_det, orb_i) = 1.0;
+          replacements[entry] = {idx_det, static_cast<std::size_t>(this->input_integral->idx2(orb_i, orb_i)), 1.0};
+          entry++;
+        }
+        for (auto idx_jdet : singles[idx_det]) {
+          auto det_j = strings[idx_jdet];
+          POLYQUANT_ORBITAL_LIST<1> holes, parts;
+          Polyquant_det_holes_or_parts<false>(det_i, det_j, holes);
+          Polyquant_det_holes_or_parts<true>(det_i, det_j, parts);
+          auto phase = Polyquant_det_phase(det_i, holes, parts);
+          replacements[entry] = {idx_jdet, static_cast<std::size_t>(this->input_integral->idx2(holes[0], parts[0])), phase};
+          entry++;
+          auto elem = one_body(holes[0], parts[0]);
+          for (auto orb_i : occ) {
+            elem += two_body(this->input_integral->idx2(holes[0], parts[0]), this->input_integral->idx2(orb_i, orb_i));
+            elem -= two_body(this->input_integral->idx2(holes[0], orb_i), this->input_integral->idx2(orb_i, parts[0]));
+          }
+          if (elem != 0.0) {
+            threads_triplets[thread_id].emplace_back(idx_det, idx_jdet, phase * elem);
+          }
+        }
+        for (auto idx_jdet : doubles[idx_det]) {
+          auto det_j = strings[idx_jdet];
+          POLYQUANT_ORBITAL_LIST<2> holes, parts;
+          Polyquant_det_holes_or_parts<false>(det_i, det_j, holes);
+          Polyquant_det_holes_or_parts<true>(det_i, det_j, parts);
+          auto phase = Polyquant_det_phase(det_i, holes, parts);
+          auto elem = two_body(this->input_integral->idx2(holes[0], parts[0]), this->input_integral->idx2(holes[1], parts[1]));
+          elem -= two_body(this->input_integral->idx2(holes[0], parts[1]), this->input_integral->idx2(holes[1], parts[0]));
+          if (elem != 0.0) {
+            threads_triplets[thread_id].emplace_back(idx_det, idx_jdet, phase * elem);
+          }
+        }
+      }
+    }
+    string_replacements[idx_spin].assign(std::move(row_offsets), std::move(replacements));
+    std::vector<Eigen::Triplet<double>> triplets;
+    for (auto &thread_triplets : threads_triplets) {
+      triplets.insert(triplets.end(), thread_triplets.begin(), thread_triplets.end());
+    }
+    same_spin_string_ham[idx_spin].resize(num_strings, num_strings);
+    same_spin_string_ham[idx_spin].setFromTriplets(triplets.begin(), triplets.end());
+  }
+
+  // (aa|bb) for every pair of occupied alpha and beta orbitals, as occ_a * V * occ_b^T
+  const auto &two_body_ab = this->input_integral->mo_two_body_ints[idx_part][0][idx_part][1 % num_spin_ints];
+  auto num_orb_a = occupations[0].cols();
+  auto num_orb_b = occupations[1].cols();
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> coulomb_ab(num_orb_a, num_orb_b);
+  for (auto orb_a = 0; orb_a < num_orb_a; orb_a++) {
+    for (auto orb_b = 0; orb_b < num_orb_b; orb_b++) {
+      coulomb_ab(orb_a, orb_b) = two_body_ab(this->input_integral->idx2(orb_a, orb_a), this->input_integral->idx2(orb_b, orb_b));
+    }
+  }
+  string_ab_diagonal.noalias() = occupations[0] * coulomb_ab * occupations[1].transpose();
+}
+
+template <typename T>
+void POLYQUANT_DETSET<T>::sigma_one_species_string_driven(Eigen::Ref<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> sigma,
+                                                          const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> &C) const {
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  if (!this->det_address_dense) {
+    APP_ABORT("The string driven sigma needs the dense determinant address table. Increase det_address_max_size or use the determinant driven sigma.");
+  }
+  if (this->string_replacements.empty()) {
+    this->precompute_string_sigma_tables();
+  }
+  auto idx_part = 0;
+  auto num_spin_ints = this->input_integral->mo_one_body_ints[idx_part].size();
+  const auto &two_body_ab = this->input_integral->mo_two_body_ints[idx_part][0][idx_part][1 % num_spin_ints];
+  const auto num_strings_a = this->unique_dets[idx_part][0].size();
+  const auto num_strings_b = this->unique_dets[idx_part][1].size();
+  const auto num_pairs = two_body_ab.cols();
+  const auto &replacements_a = this->string_replacements[0];
+  const auto &replacements_b = this->string_replacements[1];
+
+  // C and sigma on the (alpha string, beta string) product space, combinations outside the variational space stay zero
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> C_strings(num_strings_a, num_strings_b);
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> sigma_strings(num_strings_a, num_strings_b);
+  for (auto state_idx = 0; state_idx < C.cols(); state_idx++) {
+    C_strings.setZero();
+#pragma omp parallel for
+    for (auto i_det = 0; i_det < this->N_dets; i_det++) {
+      C_strings(this->dets_unfolded[i_det * 2 + 0], this->dets_unfolded[i_det * 2 + 1]) = C(i_det, state_idx);
+    }
+
+    // alpha-alpha and beta-beta, the same spin string Hamiltonians are symmetric
+    sigma_strings.noalias() = this->same_spin_string_ham[0] * C_strings;
+    sigma_strings.noalias() += (this->same_spin_string_ham[1] * C_strings.transpose()).transpose();
+
+    // alpha-beta, each beta string writes its own column of sigma_strings
+#pragma omp parallel
+    {
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> D(num_strings_a, num_pairs);
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> G(num_strings_a, num_pairs);
+#pragma omp for schedule(dynamic)
+      for (std::size_t idx_I_B_det = 0; idx_I_B_det < num_strings_b; idx_I_B_det++) {
+        // D(J_a, rs) = sum_{J_b} <I_b|E_rs|J_b> C(J_a, J_b)
+        D.setZero();
+        for (const auto &replacement : replacements_b[idx_I_B_det]) {
+          D.col(replacement.pair) += replacement.phase * C_strings.col(replacement.string);
+        }
+        // G(J_a, pq) = sum_rs (pq|rs) D(J_a, rs)
+        G.noalias() = D * two_body_ab.transpose();
+        // sigma(I_a, I_b) += sum_{J_a, pq} <I_a|E_pq|J_a> G(J_a, pq)
+        for (std::size_t idx_I_A_det = 0; idx_I_A_det < num_strings_a; idx_I_A_det++) {
+          auto elem = 0.0;
+          for (const auto &replacement : replacements_a[idx_I_A_det]) {
+            elem += replacement.phase * G(replacement.string, replacement.pair);
+          }
+          sigma_strings(idx_I_A_det, idx_I_B_det) += elem;
+        }
+      }
+    }
+    // the alpha-beta term above includes its share of the diagonal, which is replaced by diagonal_Hii below
+    sigma_strings.array() -= this->string_ab_diagonal.array() * C_strings.array();
+
+#pragma omp parallel for
+    for (auto i_det = 0; i_det < this->N_dets; i_det++) {
+      sigma(i_det, state_idx) += sigma_strings(this->dets_unfolded[i_det * 2 + 0], this->dets_unfolded[i_det * 2 + 1]) + this->diagonal_Hii[i_det] * C(i_det, state_idx);
+    }
+  }
+}
+
+template class POLYQUANT_DETSET<uint64_t>;
+}; // namespace polyquant
@@ -1,87 +1,138 @@
-
 #include "ci/determinant_set.hpp"
 
 namespace polyquant {
-template <typename T> void POLYQUANT_DETSET<T>::create_ham_diagonal(int idx_part, int idx_spin) {
-  auto function = __PRETTY_FUNCTION__;
-  POLYQUANT_TIMER timer(function);
-  auto nthreads = omp_get_max_threads();
-  std::vector<std::vector<Eigen::Triplet<double>>> triplet_list_threads;
-  std::vector<Eigen::SparseMatrix<double, Eigen::RowMajor>> ham_threads;
-  triplet_list_threads.resize(nthreads);
-  ham_threads.resize(nthreads);
-#pragma omp parallel
-  {
-    auto thread_id = omp_get_thread_num();
-    for (auto i_det = 0; i_det < this->N_dets; i_det++) {
-      if (i_det % nthreads != thread_id) {
-        continue;
-      }
-      triplet_list_threads[thread_id].push_back(Eigen::Triplet<double>(i_det, i_det, diagonal_Hii[i_det]));
+template <typename T>
+std::size_t POLYQUANT_DETSET<T>::screened_upper_row(int i_det, std::vector<int> &jdet_idx, const std::vector<double> &charges, std::vector<std::pair<int, double>> &row_elems) const {
+  row_elems.clear();
+  std::size_t num_nonzero = 0;
+  this->for_each_connected_det(this->det_idx_view(i_det), jdet_idx, charges, [&](int folded_jdet_idx, auto &&integral) {
+    if (folded_jdet_idx <= i_det) {
+      return;
     }
-    ham_threads[thread_id].resize(this->N_dets, this->N_dets);
-    ham_threads[thread_id].reserve(triplet_list_threads[thread_id].size());
-    ham_threads[thread_id].setFromTriplets(triplet_list_threads[thread_id].begin(), triplet_list_threads[thread_id].end());
-
-#pragma omp critical
-    ham += ham_threads[thread_id];
-  }
-  //   Polyquant_dump_mat_to_file(ham, "ci_ham.txt");
-  // }
-  // for (auto thread_id = 0; thread_id < nthreads; thread_id++) {
-  //   ham += ham_threads[thread_id];
-  //   // for (auto trip_elem : triplet_list_threads[thread_id]) {
-  //   //   ham.coeffRef(trip_elem.row(), trip_elem.col()) += trip_elem.value();
-  //   // }
-  // }
-  // #pragma omp parallel
-  //   {
-  //     auto thread_id = omp_get_thread_num();
-  //     for (auto t_idx = 0; t_idx < nthreads; t_idx++) {
-  //       for (auto trip_elem : triplet_list_threads[t_idx]) {
-  //         auto row_idx = trip_elem.row();
-  //         if (row_idx % nthreads == thread_id) {
-  //         ham.coeffRef(trip_elem.row(), trip_elem.col()) += trip_elem.value();
-  //         }
-  //       }
-  //     }
-  //   }
+    auto elem = integral();
+    if (elem == 0.0) {
+      return;
+    }
+    num_nonzero++;
+    if (this->screening_threshold == 0.0 || std::abs(elem) > this->screening_threshold) {
+      row_elems.emplace_back(folded_jdet_idx, elem);
+    }
+  });
+  std::sort(row_elems.begin(), row_elems.end());
+  return num_nonzero;
 }
 
 template <typename T> void POLYQUANT_DETSET<T>::create_ham() {
 
   auto function = __PRETTY_FUNCTION__;
   POLYQUANT_TIMER timer(function);
+  if (this->ham_storage == "packed") {
+    this->create_packed_ham(this->packed_ham);
+    return;
+  } else if (this->ham_storage == "packed_float") {
+    this->create_packed_ham(this->packed_ham_float);
+    return;
+  } else if (this->ham_storage != "csr") {
+    APP_ABORT("ham_storage can only be csr, packed or packed_float");
+  }
+  const auto num_slots = static_cast<std::size_t>(this->det_idx_stride);
+  const auto charges = this->particle_charges();
+  std::vector<int> row_offsets;
+  this->sigma_row_partition(row_offsets);
+  const auto num_blocks = static_cast<int>(row_offsets.size()) - 1;
+
+  // first pass, the diagonal plus every connected determinant above it bounds the nonzeros of each row of the upper triangle
+  Eigen::VectorXi row_sizes(this->N_dets);
+#pragma omp parallel
+  {
+    std::vector<int> jdet_idx(num_slots);
+#pragma omp for schedule(dynamic, 1)
+    for (auto idx_block = 0; idx_block < num_blocks; idx_block++) {
+      for (auto i_det = row_offsets[idx_block]; i_det < row_offsets[idx_block + 1]; i_det++) {
+        auto row_size = 1;
+        this->for_each_connected_det(this->det_idx_view(i_det), jdet_idx, charges, [&](int folded_jdet_idx, auto &&) {
+          if (folded_jdet_idx > i_det) {
+            row_size++;
+          }
+        });
+        row_sizes[i_det] = row_size;
+      }
+    }
+  }
   this->ham.resize(this->N_dets, this->N_dets);
-  std::vector<int> sizes;
-  // sizes.resize(this->N_dets, this->N_dets);
-  // estimate
-  int estimate = std::sqrt(this->N_dets) * 10;
-  this->estimate_n_interacting_dets = (estimate < this->N_dets) ? estimate : this->N_dets;
-  sizes.resize(this->N_dets, estimate_n_interacting_dets);
-  this->ham.reserve(sizes);
-  // this->ham.reserve(this->N_dets * this->N_dets);
-  auto num_parts = this->input_integral->input_molecule->quantum_particles.size();
-  if (num_parts == 1) {
-    single_species_create_ham();
-  } else if (num_parts == 2) {
-    two_species_create_ham();
-  } else {
-    std::stringstream ss;
-    ss << "Hamiltonian building not supported for " << num_parts << " unique quantum particles." << std::endl;
-    APP_ABORT(ss.str());
+  this->ham.reserve(row_sizes);
+
+  // second pass, every thread fills its own rows of the reserved storage and screens the elements as it goes
+  auto inner_idx = this->ham.innerIndexPtr();
+  auto values = this->ham.valuePtr();
+  auto outer_idx = this->ham.outerIndexPtr();
+  auto inner_nonzeros = this->ham.innerNonZeroPtr();
+  std::size_t num_nonzero = 0;
+#pragma omp parallel reduction(+ : num_nonzero)
+  {
+    std::vector<int> jdet_idx(num_slots);
+    std::vector<std::pair<int, double>> row_elems;
+#pragma omp for schedule(dynamic, 1)
+    for (auto idx_block = 0; idx_block < num_blocks; idx_block++) {
+      for (auto i_det = row_offsets[idx_block]; i_det < row_offsets[idx_block + 1]; i_det++) {
+        num_nonzero += 1 + this->screened_upper_row(i_det, jdet_idx, charges, row_elems);
+        auto row_start = outer_idx[i_det];
+        if (this->screening_threshold == 0.0 || std::abs(this->diagonal_Hii[i_det]) > this->screening_threshold) {
+          inner_idx[row_start] = i_det;
+          values[row_start] = this->diagonal_Hii[i_det];
+          row_start++;
+        }
+        for (const auto &[folded_jdet_idx, elem] : row_elems) {
+          inner_idx[row_start] = folded_jdet_idx;
+          values[row_start] = elem;
+          row_start++;
+        }
+        inner_nonzeros[i_det] = row_start - outer_idx[i_det];
+      }
+    }
   }
   this->ham.makeCompressed();
   std::stringstream ss;
   ss << "Created hamiltonian matrix." << std::endl;
-  ss << "  number of nonzero matrix elem before pruning: " << this->ham.nonZeros() << std::endl;
-  if (this->screening_threshold != 0.0) {
-    this->ham.prune(this->screening_threshold, 1.0);
-  }
+  ss << "  number of nonzero matrix elem before pruning: " << num_nonzero << std::endl;
   ss << "  number of nonzero matrix elem after  pruning: " << this->ham.nonZeros() << std::endl;
   Polyquant_cout(ss.str());
   // Polyquant_dump_sparse_mat_to_file(ham, "ci_ham.txt");
 }
 
+template <typename T> template <typename Value> void POLYQUANT_DETSET<T>::create_packed_ham(POLYQUANT_PACKED_SYM_MATRIX<Value> &packed) const {
+  const auto num_slots = static_cast<std::size_t>(this->det_idx_stride);
+  const auto charges = this->particle_charges();
+  std::vector<int> row_offsets;
+  this->sigma_row_partition(row_offsets);
+  const auto num_blocks = static_cast<int>(row_offsets.size()) - 1;
+
+  // the diagonal stays in double precision, every thread appends the screened rows of its blocks
+  packed.reset(this->diagonal_Hii, row_offsets);
+  std::size_t num_nonzero = 0;
+#pragma omp parallel reduction(+ : num_nonzero)
+  {
+    std::vector<int> jdet_idx(num_slots);
+    std::vector<std::pair<int, double>> row_elems;
+#pragma omp for schedule(dynamic, 1)
+    for (auto idx_block = 0; idx_block < num_blocks; idx_block++) {
+      auto &row_block = packed.block(idx_block);
+      for (auto i_det = row_offsets[idx_block]; i_det < row_offsets[idx_block + 1]; i_det++) {
+        num_nonzero += 1 + this->screened_upper_row(i_det, jdet_idx, charges, row_elems);
+        row_block.push_row(i_det, row_elems);
+      }
+      row_block.shrink_to_fit();
+    }
+  }
+  std::stringstream ss;
+  ss << "Created packed hamiltonian matrix with " << sizeof(Value) << " byte elements." << std::endl;
+  ss << "  number of nonzero matrix elem before pruning: " << num_nonzero << std::endl;
+  ss << "  number of nonzero matrix elem after  pruning: " << packed.nonZeros() << std::endl;
+  ss << "  storage (GB): " << static_cast<double>(packed.memory_bytes()) / (1024.0 * 1024.0 * 1024.0) << std::endl;
+  Polyquant_cout(ss.str());
+}
+
 template class POLYQUANT_DETSET<uint64_t>;
+template void POLYQUANT_DETSET<uint64_t>::create_packed_ham(POLYQUANT_PACKED_SYM_MATRIX<double> &packed) const;
+template void POLYQUANT_DETSET<uint64_t>::create_packed_ham(POLYQUANT_PACKED_SYM_MATRIX<float> &packed) const;
 }; // namespace polyquant
@@ -40,9 +40,8 @@ void POLYQUANT_DETSET<T>::create_1rdm(const int state_idx, const int quantum_par
       for (auto idx_jdet : unique_singles[quantum_part_idx][quantum_part_spin_idx][idx_idet]) {
         std::vector<int> j_unfold = i_unfold;
         j_unfold[2 * quantum_part_idx + quantum_part_spin_idx] = idx_jdet;
-        auto det_j_search = this->dets.find(j_unfold);
-        if (det_j_search != this->dets.end()) {
-          auto j_det = det_j_search->second;
+        auto j_det = this->det_idx_fold(j_unfold);
+        if (j_det >= 0) {
           auto Dj = this->get_det(quantum_part_idx, quantum_part_spin_idx, idx_jdet);
           if (i_det < j_det) {
             continue;
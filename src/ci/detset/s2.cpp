@@ -89,9 +89,8 @@ void POLYQUANT_DETSET<T>::evaluate_s2(Eigen::Matrix<double, Eigen::Dynamic, Eige
               j_unfold[2 * quantum_part_idx + spin_0] = idx_jdet_a;
               j_unfold[2 * quantum_part_idx + spin_1] = idx_jdet_b;
 
-              auto det_j_search = this->dets.find(j_unfold);
-              if (det_j_search != this->dets.end()) {
-                auto j_det = det_j_search->second;
+              auto j_det = this->det_idx_fold(j_unfold);
+              if (j_det >= 0) {
 
                 auto C_J = C(j_det, state_idx);
                 if (C_J == 0.0) {
@@ -225,9 +224,8 @@ void POLYQUANT_DETSET<T>::create_S_sq_minus_expected_S_sq_matrix_singleshot(Eige
           j_unfold[2 * quantum_part_idx + spin_0] = idx_jdet_a;
           j_unfold[2 * quantum_part_idx + spin_1] = idx_jdet_b;
 
-          auto det_j_search = this->dets.find(j_unfold);
-          if (det_j_search != this->dets.end()) {
-            auto j_det = det_j_search->second;
+          auto j_det = this->det_idx_fold(j_unfold);
+          if (j_det >= 0) {
 
             auto Dj_a = this->get_det(quantum_part_idx, spin_0, idx_jdet_a);
             auto Dj_b = this->get_det(quantum_part_idx, spin_1, idx_jdet_b);
@@ -2,33 +2,30 @@
 
 namespace polyquant {
 template <typename T> double POLYQUANT_DETSET<T>::Slater_Condon(int i_det, int j_det) const {
+  Slater_Condon_calls.increment();
   if (i_det == j_det) {
+    Slater_Condon_diagonal_calls.increment();
     return diagonal_Hii[i_det];
   }
-  Slater_Condon_calls++;
-  // std::pair<int, int> mat_idx;
-  // if (j_det < i_det) {
-  //   mat_idx = std::make_pair(j_det, i_det);
-  // } else {
-  //   mat_idx = std::make_pair(i_det, j_det);
-  // }
-  // auto cached_matrix_elem = this->cache.get(mat_idx);
-  // if (cached_matrix_elem.has_value()) {
-  //   return cached_matrix_elem.value();
-  // } else {
   double matrix_elem = 0.0;
-  auto i_unfold = det_idx_unfold(i_det);
-  auto j_unfold = det_idx_unfold(j_det);
-  std::vector<bool> iequalj;
-  //   // todo condense this
-  for (auto idx_part = 0; idx_part < unique_dets.size(); idx_part++) {
-    iequalj.push_back(i_unfold[idx_part * 2 + 0] == j_unfold[idx_part * 2 + 0] && i_unfold[idx_part * 2 + 1] == j_unfold[idx_part * 2 + 1]);
-  }
+  auto i_unfold = det_idx_view(i_det);
+  auto j_unfold = det_idx_view(j_det);
+  const std::size_t num_parts = unique_dets.size();
+  // true if i and j have the same strings for every particle except skip_part and other_skip_part
+  auto iequalj_otherparts = [&](std::size_t skip_part, std::size_t other_skip_part) {
+    for (std::size_t idx_part = 0; idx_part < num_parts; idx_part++) {
+      if (idx_part == skip_part || idx_part == other_skip_part) {
+        continue;
+      }
+      if (i_unfold[idx_part * 2 + 0] != j_unfold[idx_part * 2 + 0] || i_unfold[idx_part * 2 + 1] != j_unfold[idx_part * 2 + 1]) {
+        return false;
+      }
+    }
+    return true;
+  };
   auto idx_part = 0ul;
   for (auto const &[quantum_part_key, quantum_part] : this->input_integral->input_molecule->quantum_particles) {
-    std::vector<bool> iequalj_otherparts(iequalj.begin(), iequalj.end());
-    iequalj_otherparts.erase(iequalj_otherparts.begin() + idx_part);
-    if (std::find(iequalj_otherparts.begin(), iequalj_otherparts.end(), false) == iequalj_otherparts.end()) {
+    if (iequalj_otherparts(idx_part, idx_part)) {
       auto excitation_level = 0;
       auto det_i_a = this->get_det(idx_part, 0, i_unfold[idx_part * 2 + 0]);
       auto det_i_b = this->get_det(idx_part, 1, i_unfold[idx_part * 2 + 1]);
@@ -57,10 +54,7 @@ template <typename T> double POLYQUANT_DETSET<T>::Slater_Condon(int i_det, int j
       // loop over other particles
       // if all other particle dets j,k,l etc are equal then add the particle
       // i j interaction
-      std::vector<bool> iequalj_otherparts(iequalj.begin(), iequalj.end());
-      iequalj_otherparts.erase(iequalj_otherparts.begin() + idx_part);
-      iequalj_otherparts.erase(iequalj_otherparts.begin() + other_idx_part);
-      if (std::find(iequalj_otherparts.begin(), iequalj_otherparts.end(), false) == iequalj_otherparts.end()) {
+      if (iequalj_otherparts(idx_part, other_idx_part)) {
         auto excitation_level = 0;
         auto excitation_level_part_i = 0;
         auto excitation_level_part_j = 0;
@@ -95,7 +89,6 @@ template <typename T> double POLYQUANT_DETSET<T>::Slater_Condon(int i_det, int j
     }
     idx_part++;
   }
-  //   this->cache.set(mat_idx, matrix_elem);
   return matrix_elem;
 }
 
@@ -117,7 +110,7 @@ template <typename T> void POLYQUANT_DETSET<T>::precompute_diagonal_Slater_Condo
       if (i % nthreads != thread_id) {
         continue;
       }
-      auto i_unfold = det_idx_unfold(i);
+      auto i_unfold = det_idx_view(i);
       double matrix_elem = 0.0;
       auto idx_part = 0ul;
       for (auto const &[quantum_part_key, quantum_part] : this->input_integral->input_molecule->quantum_particles) {
@@ -1,232 +1,167 @@
 #include "ci/determinant_set.hpp"
 
 namespace polyquant {
-template <typename T> double POLYQUANT_DETSET<T>::mixed_part_ham_diag(int idx_part, int other_idx_part, std::vector<int> i_unfold, std::vector<int> j_unfold) const {
+template <typename T> template <std::size_t N> double POLYQUANT_DETSET<T>::mixed_part_ham_diag_impl(int idx_part, int other_idx_part, std::span<const int> i_unfold) const {
   auto elem = 0.0;
   if (other_idx_part < idx_part) {
     std::swap(idx_part, other_idx_part);
   }
-  auto idx_part_det_i_a = this->get_det(idx_part, 0, i_unfold[idx_part * 2 + 0]);
-  auto idx_part_det_i_b = this->get_det(idx_part, 1, i_unfold[idx_part * 2 + 1]);
-  auto idx_part_det_j_a = this->get_det(idx_part, 0, j_unfold[idx_part * 2 + 0]);
-  auto idx_part_det_j_b = this->get_det(idx_part, 1, j_unfold[idx_part * 2 + 1]);
-  auto other_idx_part_det_i_a = this->get_det(other_idx_part, 0, i_unfold[other_idx_part * 2 + 0]);
-  auto other_idx_part_det_i_b = this->get_det(other_idx_part, 1, i_unfold[other_idx_part * 2 + 1]);
-  auto other_idx_part_det_j_a = this->get_det(other_idx_part, 0, j_unfold[other_idx_part * 2 + 0]);
-  auto other_idx_part_det_j_b = this->get_det(other_idx_part, 1, j_unfold[other_idx_part * 2 + 1]);
+  auto idx_part_det_i_a = this->unique_dets[idx_part][0].template get_fixed<N>(i_unfold[idx_part * 2 + 0]);
+  auto idx_part_det_i_b = this->unique_dets[idx_part][1].template get_fixed<N>(i_unfold[idx_part * 2 + 1]);
+  auto other_idx_part_det_i_a = this->unique_dets[other_idx_part][0].template get_fixed<N>(i_unfold[other_idx_part * 2 + 0]);
+  auto other_idx_part_det_i_b = this->unique_dets[other_idx_part][1].template get_fixed<N>(i_unfold[other_idx_part * 2 + 1]);
   auto idx_part_alpha_spin_idx = 0;
   auto idx_part_beta_spin_idx = 1 % this->input_integral->mo_one_body_ints[idx_part].size();
   auto other_idx_part_alpha_spin_idx = 0;
   auto other_idx_part_beta_spin_idx = 1 % this->input_integral->mo_one_body_ints[other_idx_part].size();
 
-  std::vector<int> other_idx_part_aocc, other_idx_part_avirt;
-  std::vector<int> other_idx_part_bocc, other_idx_part_bvirt;
-  std::vector<int> idx_part_aocc, idx_part_avirt;
-  std::vector<int> idx_part_bocc, idx_part_bvirt;
-  this->get_occ_virt(other_idx_part, other_idx_part_det_i_a, other_idx_part_aocc, other_idx_part_avirt);
-  this->get_occ_virt(other_idx_part, other_idx_part_det_i_b, other_idx_part_bocc, other_idx_part_bvirt);
-  this->get_occ_virt(idx_part, idx_part_det_i_a, idx_part_aocc, idx_part_avirt);
-  this->get_occ_virt(idx_part, idx_part_det_i_b, idx_part_bocc, idx_part_bvirt);
+  const auto &two_body_aa = this->input_integral->mo_two_body_ints[idx_part][idx_part_alpha_spin_idx][other_idx_part][other_idx_part_alpha_spin_idx];
+  const auto &two_body_ab = this->input_integral->mo_two_body_ints[idx_part][idx_part_alpha_spin_idx][other_idx_part][other_idx_part_beta_spin_idx];
+  const auto &two_body_ba = this->input_integral->mo_two_body_ints[idx_part][idx_part_beta_spin_idx][other_idx_part][other_idx_part_alpha_spin_idx];
+  const auto &two_body_bb = this->input_integral->mo_two_body_ints[idx_part][idx_part_beta_spin_idx][other_idx_part][other_idx_part_beta_spin_idx];
 
-  for (auto orb_a_i : idx_part_aocc) {
-    for (auto orb_a_j : other_idx_part_aocc) {
-      elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_alpha_spin_idx][other_idx_part][other_idx_part_alpha_spin_idx](this->input_integral->idx2(orb_a_i, orb_a_i),
-                                                                                                                                       this->input_integral->idx2(orb_a_j, orb_a_j));
-    }
-    for (auto orb_b_j : other_idx_part_bocc) {
-      elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_alpha_spin_idx][other_idx_part][other_idx_part_beta_spin_idx](this->input_integral->idx2(orb_a_i, orb_a_i),
-                                                                                                                                      this->input_integral->idx2(orb_b_j, orb_b_j));
-    }
-  }
-  for (auto orb_b_i : idx_part_bocc) {
-    for (auto orb_a_j : other_idx_part_aocc) {
-      elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_beta_spin_idx][other_idx_part][other_idx_part_alpha_spin_idx](this->input_integral->idx2(orb_b_i, orb_b_i),
-                                                                                                                                      this->input_integral->idx2(orb_a_j, orb_a_j));
-    }
-    for (auto orb_b_j : other_idx_part_bocc) {
-      elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_beta_spin_idx][other_idx_part][other_idx_part_beta_spin_idx](this->input_integral->idx2(orb_b_i, orb_b_i),
-                                                                                                                                     this->input_integral->idx2(orb_b_j, orb_b_j));
-    }
-  }
+  Polyquant_det_for_each_occ(idx_part_det_i_a, [&](int orb_a_i) {
+    Polyquant_det_for_each_occ(other_idx_part_det_i_a, [&](int orb_a_j) { elem += two_body_aa(this->input_integral->idx2(orb_a_i, orb_a_i), this->input_integral->idx2(orb_a_j, orb_a_j)); });
+    Polyquant_det_for_each_occ(other_idx_part_det_i_b, [&](int orb_b_j) { elem += two_body_ab(this->input_integral->idx2(orb_a_i, orb_a_i), this->input_integral->idx2(orb_b_j, orb_b_j)); });
+  });
+  Polyquant_det_for_each_occ(idx_part_det_i_b, [&](int orb_b_i) {
+    Polyquant_det_for_each_occ(other_idx_part_det_i_a, [&](int orb_a_j) { elem += two_body_ba(this->input_integral->idx2(orb_b_i, orb_b_i), this->input_integral->idx2(orb_a_j, orb_a_j)); });
+    Polyquant_det_for_each_occ(other_idx_part_det_i_b, [&](int orb_b_j) { elem += two_body_bb(this->input_integral->idx2(orb_b_i, orb_b_i), this->input_integral->idx2(orb_b_j, orb_b_j)); });
+  });
   return elem;
 }
 
-template <typename T> double POLYQUANT_DETSET<T>::mixed_part_ham_single(int idx_part, int other_idx_part, std::vector<int> i_unfold, std::vector<int> j_unfold) const {
+template <typename T>
+template <std::size_t N>
+double POLYQUANT_DETSET<T>::mixed_part_ham_single_impl(int idx_part, int other_idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const {
   auto elem = 0.0;
   if (other_idx_part < idx_part) {
     std::swap(idx_part, other_idx_part);
   }
-  auto idx_part_det_i_a = this->get_det(idx_part, 0, i_unfold[idx_part * 2 + 0]);
-  auto idx_part_det_i_b = this->get_det(idx_part, 1, i_unfold[idx_part * 2 + 1]);
-  auto idx_part_det_j_a = this->get_det(idx_part, 0, j_unfold[idx_part * 2 + 0]);
-  auto idx_part_det_j_b = this->get_det(idx_part, 1, j_unfold[idx_part * 2 + 1]);
-  auto other_idx_part_det_i_a = this->get_det(other_idx_part, 0, i_unfold[other_idx_part * 2 + 0]);
-  auto other_idx_part_det_i_b = this->get_det(other_idx_part, 1, i_unfold[other_idx_part * 2 + 1]);
-  auto other_idx_part_det_j_a = this->get_det(other_idx_part, 0, j_unfold[other_idx_part * 2 + 0]);
-  auto other_idx_part_det_j_b = this->get_det(other_idx_part, 1, j_unfold[other_idx_part * 2 + 1]);
+  auto idx_part_det_i_a = this->unique_dets[idx_part][0].template get_fixed<N>(i_unfold[idx_part * 2 + 0]);
+  auto idx_part_det_i_b = this->unique_dets[idx_part][1].template get_fixed<N>(i_unfold[idx_part * 2 + 1]);
+  auto idx_part_det_j_a = this->unique_dets[idx_part][0].template get_fixed<N>(j_unfold[idx_part * 2 + 0]);
+  auto idx_part_det_j_b = this->unique_dets[idx_part][1].template get_fixed<N>(j_unfold[idx_part * 2 + 1]);
+  auto other_idx_part_det_i_a = this->unique_dets[other_idx_part][0].template get_fixed<N>(i_unfold[other_idx_part * 2 + 0]);
+  auto other_idx_part_det_i_b = this->unique_dets[other_idx_part][1].template get_fixed<N>(i_unfold[other_idx_part * 2 + 1]);
+  auto other_idx_part_det_j_a = this->unique_dets[other_idx_part][0].template get_fixed<N>(j_unfold[other_idx_part * 2 + 0]);
+  auto other_idx_part_det_j_b = this->unique_dets[other_idx_part][1].template get_fixed<N>(j_unfold[other_idx_part * 2 + 1]);
   auto idx_part_alpha_spin_idx = 0;
   auto idx_part_beta_spin_idx = 1 % this->input_integral->mo_one_body_ints[idx_part].size();
   auto other_idx_part_alpha_spin_idx = 0;
   auto other_idx_part_beta_spin_idx = 1 % this->input_integral->mo_one_body_ints[other_idx_part].size();
   // excitation in idx_part
-  if (other_idx_part_det_i_a == other_idx_part_det_j_a && other_idx_part_det_i_b == other_idx_part_det_j_b) {
-    std::vector<int> aocc, avirt;
-    std::vector<int> bocc, bvirt;
-    this->get_occ_virt(other_idx_part, other_idx_part_det_i_a, aocc, avirt);
-    this->get_occ_virt(other_idx_part, other_idx_part_det_i_b, bocc, bvirt);
-    std::vector<int> idx_part_holes, idx_part_parts;
-    double phase = 1.0;
-    if (idx_part_det_i_a == idx_part_det_j_a) {
-      // beta excitation in idx_part
-      get_holes(idx_part_det_i_b, idx_part_det_j_b, idx_part_holes);
-      get_parts(idx_part_det_i_b, idx_part_det_j_b, idx_part_parts);
-      phase *= get_phase(idx_part_det_i_b, idx_part_det_j_b, idx_part_holes, idx_part_parts);
-      for (auto orb_a_i : aocc) {
-        elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_beta_spin_idx][other_idx_part][other_idx_part_alpha_spin_idx](
-            this->input_integral->idx2(idx_part_holes[0], idx_part_parts[0]), this->input_integral->idx2(orb_a_i, orb_a_i));
-      }
-      for (auto orb_b_i : bocc) {
-        elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_beta_spin_idx][other_idx_part][other_idx_part_beta_spin_idx](this->input_integral->idx2(idx_part_holes[0], idx_part_parts[0]),
-                                                                                                                                       this->input_integral->idx2(orb_b_i, orb_b_i));
-      }
-    } else {
-      // alpha excitation in idx_part
-      get_holes(idx_part_det_i_a, idx_part_det_j_a, idx_part_holes);
-      get_parts(idx_part_det_i_a, idx_part_det_j_a, idx_part_parts);
-      phase *= get_phase(idx_part_det_i_a, idx_part_det_j_a, idx_part_holes, idx_part_parts);
-      for (auto orb_a_i : aocc) {
-        elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_alpha_spin_idx][other_idx_part][other_idx_part_alpha_spin_idx](
-            this->input_integral->idx2(idx_part_holes[0], idx_part_parts[0]), this->input_integral->idx2(orb_a_i, orb_a_i));
-      }
-      for (auto orb_b_i : bocc) {
-        elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_alpha_spin_idx][other_idx_part][other_idx_part_beta_spin_idx](
-            this->input_integral->idx2(idx_part_holes[0], idx_part_parts[0]), this->input_integral->idx2(orb_b_i, orb_b_i));
-      }
-    }
-    elem *= phase;
+  if (Polyquant_det_equal(other_idx_part_det_i_a, other_idx_part_det_j_a) && Polyquant_det_equal(other_idx_part_det_i_b, other_idx_part_det_j_b)) {
+    // alpha or beta excitation in idx_part
+    auto beta_exc = Polyquant_det_equal(idx_part_det_i_a, idx_part_det_j_a);
+    auto exc_spin_idx = beta_exc ? idx_part_beta_spin_idx : idx_part_alpha_spin_idx;
+    auto excitation = beta_exc ? Polyquant_det_excitation(idx_part_det_i_b, idx_part_det_j_b) : Polyquant_det_excitation(idx_part_det_i_a, idx_part_det_j_a);
+    auto hole_part = this->input_integral->idx2(excitation.holes[0], excitation.parts[0]);
+    const auto &two_body_a = this->input_integral->mo_two_body_ints[idx_part][exc_spin_idx][other_idx_part][other_idx_part_alpha_spin_idx];
+    const auto &two_body_b = this->input_integral->mo_two_body_ints[idx_part][exc_spin_idx][other_idx_part][other_idx_part_beta_spin_idx];
+    Polyquant_det_for_each_occ(other_idx_part_det_i_a, [&](int orb_a_i) { elem += two_body_a(hole_part, this->input_integral->idx2(orb_a_i, orb_a_i)); });
+    Polyquant_det_for_each_occ(other_idx_part_det_i_b, [&](int orb_b_i) { elem += two_body_b(hole_part, this->input_integral->idx2(orb_b_i, orb_b_i)); });
+    elem *= excitation.phase;
   } else {
-    // excitation in other_idx_part
-    std::vector<int> aocc, avirt;
-    std::vector<int> bocc, bvirt;
-    this->get_occ_virt(idx_part, idx_part_det_i_a, aocc, avirt);
-    this->get_occ_virt(idx_part, idx_part_det_i_b, bocc, bvirt);
-    std::vector<int> other_idx_part_holes, other_idx_part_parts;
-    double phase = 1.0;
-    if (other_idx_part_det_i_b == other_idx_part_det_j_b) {
-      // alpha excitation in other_idx_part
-      get_holes(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_holes);
-      get_parts(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_parts);
-      phase *= get_phase(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_holes, other_idx_part_parts);
-      for (auto orb_a_i : aocc) {
-        elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_alpha_spin_idx][other_idx_part][other_idx_part_alpha_spin_idx](
-            this->input_integral->idx2(orb_a_i, orb_a_i), this->input_integral->idx2(other_idx_part_holes[0], other_idx_part_parts[0]));
-      }
-      for (auto orb_b_i : bocc) {
-        elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_beta_spin_idx][other_idx_part][other_idx_part_alpha_spin_idx](
-            this->input_integral->idx2(orb_b_i, orb_b_i), this->input_integral->idx2(other_idx_part_holes[0], other_idx_part_parts[0]));
-      }
-    } else {
-      // beta excitation in other_idx_part
-      get_holes(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_holes);
-      get_parts(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_parts);
-      phase *= get_phase(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_holes, other_idx_part_parts);
-      for (auto orb_a_i : aocc) {
-        elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_alpha_spin_idx][other_idx_part][other_idx_part_beta_spin_idx](
-            this->input_integral->idx2(orb_a_i, orb_a_i), this->input_integral->idx2(other_idx_part_holes[0], other_idx_part_parts[0]));
-      }
-      for (auto orb_b_i : bocc) {
-        elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_beta_spin_idx][other_idx_part][other_idx_part_beta_spin_idx](
-            this->input_integral->idx2(orb_b_i, orb_b_i), this->input_integral->idx2(other_idx_part_holes[0], other_idx_part_parts[0]));
-      }
-    }
-    elem *= phase;
+    // alpha or beta excitation in other_idx_part
+    auto alpha_exc = Polyquant_det_equal(other_idx_part_det_i_b, other_idx_part_det_j_b);
+    auto exc_spin_idx = alpha_exc ? other_idx_part_alpha_spin_idx : other_idx_part_beta_spin_idx;
+    auto excitation = alpha_exc ? Polyquant_det_excitation(other_idx_part_det_i_a, other_idx_part_det_j_a) : Polyquant_det_excitation(other_idx_part_det_i_b, other_idx_part_det_j_b);
+    auto hole_part = this->input_integral->idx2(excitation.holes[0], excitation.parts[0]);
+    const auto &two_body_a = this->input_integral->mo_two_body_ints[idx_part][idx_part_alpha_spin_idx][other_idx_part][exc_spin_idx];
+    const auto &two_body_b = this->input_integral->mo_two_body_ints[idx_part][idx_part_beta_spin_idx][other_idx_part][exc_spin_idx];
+    Polyquant_det_for_each_occ(idx_part_det_i_a, [&](int orb_a_i) { elem += two_body_a(this->input_integral->idx2(orb_a_i, orb_a_i), hole_part); });
+    Polyquant_det_for_each_occ(idx_part_det_i_b, [&](int orb_b_i) { elem += two_body_b(this->input_integral->idx2(orb_b_i, orb_b_i), hole_part); });
+    elem *= excitation.phase;
   }
   return elem;
 }
 
-template <typename T> double POLYQUANT_DETSET<T>::mixed_part_ham_double(int idx_part, int other_idx_part, std::vector<int> i_unfold, std::vector<int> j_unfold) const {
+template <typename T>
+template <std::size_t N>
+double POLYQUANT_DETSET<T>::mixed_part_ham_double_impl(int idx_part, int other_idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const {
   auto elem = 0.0;
   if (other_idx_part < idx_part) {
     std::swap(idx_part, other_idx_part);
   }
-  auto idx_part_det_i_a = this->get_det(idx_part, 0, i_unfold[idx_part * 2 + 0]);
-  auto idx_part_det_i_b = this->get_det(idx_part, 1, i_unfold[idx_part * 2 + 1]);
-  auto idx_part_det_j_a = this->get_det(idx_part, 0, j_unfold[idx_part * 2 + 0]);
-  auto idx_part_det_j_b = this->get_det(idx_part, 1, j_unfold[idx_part * 2 + 1]);
-  auto other_idx_part_det_i_a = this->get_det(other_idx_part, 0, i_unfold[other_idx_part * 2 + 0]);
-  auto other_idx_part_det_i_b = this->get_det(other_idx_part, 1, i_unfold[other_idx_part * 2 + 1]);
-  auto other_idx_part_det_j_a = this->get_det(other_idx_part, 0, j_unfold[other_idx_part * 2 + 0]);
-  auto other_idx_part_det_j_b = this->get_det(other_idx_part, 1, j_unfold[other_idx_part * 2 + 1]);
+  auto idx_part_det_i_a = this->unique_dets[idx_part][0].template get_fixed<N>(i_unfold[idx_part * 2 + 0]);
+  auto idx_part_det_i_b = this->unique_dets[idx_part][1].template get_fixed<N>(i_unfold[idx_part * 2 + 1]);
+  auto idx_part_det_j_a = this->unique_dets[idx_part][0].template get_fixed<N>(j_unfold[idx_part * 2 + 0]);
+  auto idx_part_det_j_b = this->unique_dets[idx_part][1].template get_fixed<N>(j_unfold[idx_part * 2 + 1]);
+  auto other_idx_part_det_i_a = this->unique_dets[other_idx_part][0].template get_fixed<N>(i_unfold[other_idx_part * 2 + 0]);
+  auto other_idx_part_det_i_b = this->unique_dets[other_idx_part][1].template get_fixed<N>(i_unfold[other_idx_part * 2 + 1]);
+  auto other_idx_part_det_j_a = this->unique_dets[other_idx_part][0].template get_fixed<N>(j_unfold[other_idx_part * 2 + 0]);
+  auto other_idx_part_det_j_b = this->unique_dets[other_idx_part][1].template get_fixed<N>(j_unfold[other_idx_part * 2 + 1]);
   auto idx_part_alpha_spin_idx = 0;
   auto idx_part_beta_spin_idx = 1 % this->input_integral->mo_one_body_ints[idx_part].size();
   auto other_idx_part_alpha_spin_idx = 0;
   auto other_idx_part_beta_spin_idx = 1 % this->input_integral->mo_one_body_ints[other_idx_part].size();
 
   // spin = -1 mixed, spin = 0 alpha excitation, spin = 1 beta excitation
-  if (idx_part_det_i_a == idx_part_det_j_a && other_idx_part_det_i_a == other_idx_part_det_j_a) {
+  if (Polyquant_det_equal(idx_part_det_i_a, idx_part_det_j_a) && Polyquant_det_equal(other_idx_part_det_i_a, other_idx_part_det_j_a)) {
     // beta idx_part exc, beta other_idx_part exc
-    std::vector<int> idx_part_holes, idx_part_parts;
-    std::vector<int> other_idx_part_holes, other_idx_part_parts;
+    POLYQUANT_ORBITAL_LIST<2> idx_part_holes, idx_part_parts;
+    POLYQUANT_ORBITAL_LIST<2> other_idx_part_holes, other_idx_part_parts;
     double phase = 1.0;
     double idx_part_phase = 1.0;
     double other_idx_part_phase = 1.0;
-    get_holes(idx_part_det_i_b, idx_part_det_j_b, idx_part_holes);
-    get_parts(idx_part_det_i_b, idx_part_det_j_b, idx_part_parts);
-    get_holes(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_holes);
-    get_parts(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_parts);
-    idx_part_phase = get_phase(idx_part_det_i_b, idx_part_det_j_b, idx_part_holes, idx_part_parts);
-    other_idx_part_phase = get_phase(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_holes, other_idx_part_parts);
+    Polyquant_det_holes_or_parts<false>(idx_part_det_i_b, idx_part_det_j_b, idx_part_holes);
+    Polyquant_det_holes_or_parts<true>(idx_part_det_i_b, idx_part_det_j_b, idx_part_parts);
+    Polyquant_det_holes_or_parts<false>(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_holes);
+    Polyquant_det_holes_or_parts<true>(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_parts);
+    idx_part_phase = Polyquant_det_phase(idx_part_det_i_b, idx_part_holes, idx_part_parts);
+    other_idx_part_phase = Polyquant_det_phase(other_idx_part_det_i_b, other_idx_part_holes, other_idx_part_parts);
     phase = idx_part_phase * other_idx_part_phase;
     elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_beta_spin_idx][other_idx_part][other_idx_part_beta_spin_idx](
         this->input_integral->idx2(idx_part_holes[0], idx_part_parts[0]), this->input_integral->idx2(other_idx_part_holes[0], other_idx_part_parts[0]));
     elem *= phase;
-  } else if (idx_part_det_i_b == idx_part_det_j_b && other_idx_part_det_i_b == other_idx_part_det_j_b) {
+  } else if (Polyquant_det_equal(idx_part_det_i_b, idx_part_det_j_b) && Polyquant_det_equal(other_idx_part_det_i_b, other_idx_part_det_j_b)) {
     // alpha idx_part exc, alpha other_idx_part exc
-    std::vector<int> idx_part_holes, idx_part_parts;
-    std::vector<int> other_idx_part_holes, other_idx_part_parts;
+    POLYQUANT_ORBITAL_LIST<2> idx_part_holes, idx_part_parts;
+    POLYQUANT_ORBITAL_LIST<2> other_idx_part_holes, other_idx_part_parts;
     double phase = 1.0;
     double idx_part_phase = 1.0;
     double other_idx_part_phase = 1.0;
-    get_holes(idx_part_det_i_a, idx_part_det_j_a, idx_part_holes);
-    get_parts(idx_part_det_i_a, idx_part_det_j_a, idx_part_parts);
-    get_holes(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_holes);
-    get_parts(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_parts);
-    idx_part_phase = get_phase(idx_part_det_i_a, idx_part_det_j_a, idx_part_holes, idx_part_parts);
-    other_idx_part_phase = get_phase(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_holes, other_idx_part_parts);
+    Polyquant_det_holes_or_parts<false>(idx_part_det_i_a, idx_part_det_j_a, idx_part_holes);
+    Polyquant_det_holes_or_parts<true>(idx_part_det_i_a, idx_part_det_j_a, idx_part_parts);
+    Polyquant_det_holes_or_parts<false>(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_holes);
+    Polyquant_det_holes_or_parts<true>(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_parts);
+    idx_part_phase = Polyquant_det_phase(idx_part_det_i_a, idx_part_holes, idx_part_parts);
+    other_idx_part_phase = Polyquant_det_phase(other_idx_part_det_i_a, other_idx_part_holes, other_idx_part_parts);
     phase = idx_part_phase * other_idx_part_phase;
     elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_alpha_spin_idx][other_idx_part][other_idx_part_alpha_spin_idx](
         this->input_integral->idx2(idx_part_holes[0], idx_part_parts[0]), this->input_integral->idx2(other_idx_part_holes[0], other_idx_part_parts[0]));
     elem *= phase;
-  } else if (idx_part_det_i_a == idx_part_det_j_a && other_idx_part_det_i_b == other_idx_part_det_j_b) {
+  } else if (Polyquant_det_equal(idx_part_det_i_a, idx_part_det_j_a) && Polyquant_det_equal(other_idx_part_det_i_b, other_idx_part_det_j_b)) {
     // beta idx_part exc, alpha other_idx_part exc
-    std::vector<int> idx_part_holes, idx_part_parts;
-    std::vector<int> other_idx_part_holes, other_idx_part_parts;
+    POLYQUANT_ORBITAL_LIST<2> idx_part_holes, idx_part_parts;
+    POLYQUANT_ORBITAL_LIST<2> other_idx_part_holes, other_idx_part_parts;
     double phase = 1.0;
     double idx_part_phase = 1.0;
     double other_idx_part_phase = 1.0;
-    get_holes(idx_part_det_i_b, idx_part_det_j_b, idx_part_holes);
-    get_parts(idx_part_det_i_b, idx_part_det_j_b, idx_part_parts);
-    get_holes(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_holes);
-    get_parts(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_parts);
-    idx_part_phase = get_phase(idx_part_det_i_b, idx_part_det_j_b, idx_part_holes, idx_part_parts);
-    other_idx_part_phase = get_phase(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_holes, other_idx_part_parts);
+    Polyquant_det_holes_or_parts<false>(idx_part_det_i_b, idx_part_det_j_b, idx_part_holes);
+    Polyquant_det_holes_or_parts<true>(idx_part_det_i_b, idx_part_det_j_b, idx_part_parts);
+    Polyquant_det_holes_or_parts<false>(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_holes);
+    Polyquant_det_holes_or_parts<true>(other_idx_part_det_i_a, other_idx_part_det_j_a, other_idx_part_parts);
+    idx_part_phase = Polyquant_det_phase(idx_part_det_i_b, idx_part_holes, idx_part_parts);
+    other_idx_part_phase = Polyquant_det_phase(other_idx_part_det_i_a, other_idx_part_holes, other_idx_part_parts);
     phase = idx_part_phase * other_idx_part_phase;
     elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_beta_spin_idx][other_idx_part][other_idx_part_alpha_spin_idx](
         this->input_integral->idx2(idx_part_holes[0], idx_part_parts[0]), this->input_integral->idx2(other_idx_part_holes[0], other_idx_part_parts[0]));
     elem *= phase;
-  } else if (idx_part_det_i_b == idx_part_det_j_b && other_idx_part_det_i_a == other_idx_part_det_j_a) {
+  } else if (Polyquant_det_equal(idx_part_det_i_b, idx_part_det_j_b) && Polyquant_det_equal(other_idx_part_det_i_a, other_idx_part_det_j_a)) {
     // alpha idx_part exc, beta other_idx_part exc
-    std::vector<int> idx_part_holes, idx_part_parts;
-    std::vector<int> other_idx_part_holes, other_idx_part_parts;
+    POLYQUANT_ORBITAL_LIST<2> idx_part_holes, idx_part_parts;
+    POLYQUANT_ORBITAL_LIST<2> other_idx_part_holes, other_idx_part_parts;
     double phase = 1.0;
     double idx_part_phase = 1.0;
     double other_idx_part_phase = 1.0;
-    get_holes(idx_part_det_i_a, idx_part_det_j_a, idx_part_holes);
-    get_parts(idx_part_det_i_a, idx_part_det_j_a, idx_part_parts);
-    get_holes(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_holes);
-    get_parts(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_parts);
-    idx_part_phase = get_phase(idx_part_det_i_a, idx_part_det_j_a, idx_part_holes, idx_part_parts);
-    other_idx_part_phase = get_phase(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_holes, other_idx_part_parts);
+    Polyquant_det_holes_or_parts<false>(idx_part_det_i_a, idx_part_det_j_a, idx_part_holes);
+    Polyquant_det_holes_or_parts<true>(idx_part_det_i_a, idx_part_det_j_a, idx_part_parts);
+    Polyquant_det_holes_or_parts<false>(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_holes);
+    Polyquant_det_holes_or_parts<true>(other_idx_part_det_i_b, other_idx_part_det_j_b, other_idx_part_parts);
+    idx_part_phase = Polyquant_det_phase(idx_part_det_i_a, idx_part_holes, idx_part_parts);
+    other_idx_part_phase = Polyquant_det_phase(other_idx_part_det_i_b, other_idx_part_holes, other_idx_part_parts);
     phase = idx_part_phase * other_idx_part_phase;
     elem += this->input_integral->mo_two_body_ints[idx_part][idx_part_alpha_spin_idx][other_idx_part][other_idx_part_beta_spin_idx](
         this->input_integral->idx2(idx_part_holes[0], idx_part_parts[0]), this->input_integral->idx2(other_idx_part_holes[0], other_idx_part_parts[0]));
@@ -235,5 +170,17 @@ template <typename T> double POLYQUANT_DETSET<T>::mixed_part_ham_double(int idx_
   return elem;
 }
 
+template <typename T> double POLYQUANT_DETSET<T>::mixed_part_ham_diag(int idx_part, int other_idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const {
+  return Polyquant_dispatch_det_words(this->det_n_int(), [&](auto n_int) { return this->template mixed_part_ham_diag_impl<decltype(n_int)::value>(idx_part, other_idx_part, i_unfold); });
+}
+
+template <typename T> double POLYQUANT_DETSET<T>::mixed_part_ham_single(int idx_part, int other_idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const {
+  return Polyquant_dispatch_det_words(this->det_n_int(), [&](auto n_int) { return this->template mixed_part_ham_single_impl<decltype(n_int)::value>(idx_part, other_idx_part, i_unfold, j_unfold); });
+}
+
+template <typename T> double POLYQUANT_DETSET<T>::mixed_part_ham_double(int idx_part, int other_idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const {
+  return Polyquant_dispatch_det_words(this->det_n_int(), [&](auto n_int) { return this->template mixed_part_ham_double_impl<decltype(n_int)::value>(idx_part, other_idx_part, i_unfold, j_unfold); });
+}
+
 template class POLYQUANT_DETSET<uint64_t>;
 }; // namespace polyquant
@@ -1,178 +1,114 @@
 #include "ci/determinant_set.hpp"
 
 namespace polyquant {
-template <typename T> double POLYQUANT_DETSET<T>::same_part_ham_diag(int idx_part, std::vector<int> i_unfold, std::vector<int> j_unfold) const {
-  auto det_i_a = this->get_det(idx_part, 0, i_unfold[idx_part * 2 + 0]);
-  auto det_i_b = this->get_det(idx_part, 1, i_unfold[idx_part * 2 + 1]);
-  auto det_j_a = this->get_det(idx_part, 0, j_unfold[idx_part * 2 + 0]);
-  auto det_j_b = this->get_det(idx_part, 1, j_unfold[idx_part * 2 + 1]);
+template <typename T> template <std::size_t N> double POLYQUANT_DETSET<T>::same_part_ham_diag_impl(int idx_part, std::span<const int> i_unfold) const {
+  auto det_i_a = this->unique_dets[idx_part][0].template get_fixed<N>(i_unfold[idx_part * 2 + 0]);
+  auto det_i_b = this->unique_dets[idx_part][1].template get_fixed<N>(i_unfold[idx_part * 2 + 1]);
 
   auto alpha_spin_idx = 0;
   auto beta_spin_idx = 1 % this->input_integral->mo_one_body_ints[idx_part].size();
-
-  std::vector<int> aocc, avirt;
-  this->get_occ_virt(idx_part, det_i_a, aocc, avirt);
-
-  std::vector<int> bocc, bvirt;
-  this->get_occ_virt(idx_part, det_i_b, bocc, bvirt);
+  const auto &one_body_a = this->input_integral->mo_one_body_ints[idx_part][alpha_spin_idx];
+  const auto &one_body_b = this->input_integral->mo_one_body_ints[idx_part][beta_spin_idx];
+  const auto &two_body_aa = this->input_integral->mo_two_body_ints[idx_part][alpha_spin_idx][idx_part][alpha_spin_idx];
+  const auto &two_body_ab = this->input_integral->mo_two_body_ints[idx_part][alpha_spin_idx][idx_part][beta_spin_idx];
+  const auto &two_body_ba = this->input_integral->mo_two_body_ints[idx_part][beta_spin_idx][idx_part][alpha_spin_idx];
+  const auto &two_body_bb = this->input_integral->mo_two_body_ints[idx_part][beta_spin_idx][idx_part][beta_spin_idx];
 
   double elem = 0.0;
-  for (auto orb_a_i : aocc) {
-    elem += this->input_integral->mo_one_body_ints[idx_part][alpha_spin_idx](orb_a_i, orb_a_i);
-  }
-  for (auto orb_b_i : bocc) {
-    elem += this->input_integral->mo_one_body_ints[idx_part][beta_spin_idx](orb_b_i, orb_b_i);
-  }
-  for (auto orb_a_i : aocc) {
-    for (auto orb_a_j : aocc) {
-      elem += 0.5 *
-              (this->input_integral->mo_two_body_ints[idx_part][alpha_spin_idx][idx_part][alpha_spin_idx](this->input_integral->idx2(orb_a_i, orb_a_i), this->input_integral->idx2(orb_a_j, orb_a_j)));
-      elem -= 0.5 *
-              (this->input_integral->mo_two_body_ints[idx_part][alpha_spin_idx][idx_part][alpha_spin_idx](this->input_integral->idx2(orb_a_i, orb_a_j), this->input_integral->idx2(orb_a_j, orb_a_i)));
-    }
-    for (auto orb_b_j : bocc) {
-      elem +=
-          0.5 * this->input_integral->mo_two_body_ints[idx_part][alpha_spin_idx][idx_part][beta_spin_idx](this->input_integral->idx2(orb_a_i, orb_a_i), this->input_integral->idx2(orb_b_j, orb_b_j));
-    }
-  }
-  for (auto orb_b_i : bocc) {
-    for (auto orb_b_j : bocc) {
-      elem +=
-          0.5 * (this->input_integral->mo_two_body_ints[idx_part][beta_spin_idx][idx_part][beta_spin_idx](this->input_integral->idx2(orb_b_i, orb_b_i), this->input_integral->idx2(orb_b_j, orb_b_j)));
-      elem -=
-          0.5 * (this->input_integral->mo_two_body_ints[idx_part][beta_spin_idx][idx_part][beta_spin_idx](this->input_integral->idx2(orb_b_i, orb_b_j), this->input_integral->idx2(orb_b_j, orb_b_i)));
-    }
-    for (auto orb_a_j : aocc) {
-      elem +=
-          0.5 * this->input_integral->mo_two_body_ints[idx_part][beta_spin_idx][idx_part][alpha_spin_idx](this->input_integral->idx2(orb_b_i, orb_b_i), this->input_integral->idx2(orb_a_j, orb_a_j));
-    }
-  }
+  Polyquant_det_for_each_occ(det_i_a, [&](int orb_a_i) { elem += one_body_a(orb_a_i, orb_a_i); });
+  Polyquant_det_for_each_occ(det_i_b, [&](int orb_b_i) { elem += one_body_b(orb_b_i, orb_b_i); });
+  Polyquant_det_for_each_occ(det_i_a, [&](int orb_a_i) {
+    Polyquant_det_for_each_occ(det_i_a, [&](int orb_a_j) {
+      elem += 0.5 * (two_body_aa(this->input_integral->idx2(orb_a_i, orb_a_i), this->input_integral->idx2(orb_a_j, orb_a_j)));
+      elem -= 0.5 * (two_body_aa(this->input_integral->idx2(orb_a_i, orb_a_j), this->input_integral->idx2(orb_a_j, orb_a_i)));
+    });
+    Polyquant_det_for_each_occ(det_i_b, [&](int orb_b_j) { elem += 0.5 * two_body_ab(this->input_integral->idx2(orb_a_i, orb_a_i), this->input_integral->idx2(orb_b_j, orb_b_j)); });
+  });
+  Polyquant_det_for_each_occ(det_i_b, [&](int orb_b_i) {
+    Polyquant_det_for_each_occ(det_i_b, [&](int orb_b_j) {
+      elem += 0.5 * (two_body_bb(this->input_integral->idx2(orb_b_i, orb_b_i), this->input_integral->idx2(orb_b_j, orb_b_j)));
+      elem -= 0.5 * (two_body_bb(this->input_integral->idx2(orb_b_i, orb_b_j), this->input_integral->idx2(orb_b_j, orb_b_i)));
+    });
+    Polyquant_det_for_each_occ(det_i_a, [&](int orb_a_j) { elem += 0.5 * two_body_ba(this->input_integral->idx2(orb_b_i, orb_b_i), this->input_integral->idx2(orb_a_j, orb_a_j)); });
+  });
   return elem;
 }
 
-template <typename T> double POLYQUANT_DETSET<T>::same_part_ham_single(int idx_part, std::vector<int> i_unfold, std::vector<int> j_unfold) const {
+template <typename T> template <std::size_t N> double POLYQUANT_DETSET<T>::same_part_ham_single_impl(int idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const {
   auto elem = 0.0;
-  auto det_i_a = this->get_det(idx_part, 0, i_unfold[idx_part * 2 + 0]);
-  auto det_i_b = this->get_det(idx_part, 1, i_unfold[idx_part * 2 + 1]);
-  auto det_j_a = this->get_det(idx_part, 0, j_unfold[idx_part * 2 + 0]);
-  auto det_j_b = this->get_det(idx_part, 1, j_unfold[idx_part * 2 + 1]);
+  auto det_i_a = this->unique_dets[idx_part][0].template get_fixed<N>(i_unfold[idx_part * 2 + 0]);
+  auto det_i_b = this->unique_dets[idx_part][1].template get_fixed<N>(i_unfold[idx_part * 2 + 1]);
+  auto det_j_a = this->unique_dets[idx_part][0].template get_fixed<N>(j_unfold[idx_part * 2 + 0]);
+  auto det_j_b = this->unique_dets[idx_part][1].template get_fixed<N>(j_unfold[idx_part * 2 + 1]);
   auto alpha_spin_idx = 0;
   auto beta_spin_idx = 1 % this->input_integral->mo_one_body_ints[idx_part].size();
 
   // spin = 0 alpha excitation, spin = 1 beta excitation
   auto spin = 0;
-  if (det_i_a == det_j_a) {
+  if (Polyquant_det_equal(det_i_a, det_j_a)) {
     spin = 1;
   }
+  // the excited spin and the spectator spin
+  auto exc_spin_idx = spin == 0 ? alpha_spin_idx : beta_spin_idx;
+  auto other_spin_idx = spin == 0 ? beta_spin_idx : alpha_spin_idx;
+  const auto &det_i_exc = spin == 0 ? det_i_a : det_i_b;
+  const auto &det_i_other = spin == 0 ? det_i_b : det_i_a;
+  auto excitation = spin == 0 ? Polyquant_det_excitation(det_i_a, det_j_a) : Polyquant_det_excitation(det_i_b, det_j_b);
+  auto hole = excitation.holes[0];
+  auto part = excitation.parts[0];
+  const auto &two_body_same = this->input_integral->mo_two_body_ints[idx_part][exc_spin_idx][idx_part][exc_spin_idx];
+  const auto &two_body_other = this->input_integral->mo_two_body_ints[idx_part][exc_spin_idx][idx_part][other_spin_idx];
 
-  std::vector<int> aocc, avirt;
-  std::vector<int> bocc, bvirt;
-  this->get_occ_virt(idx_part, det_i_a, aocc, avirt);
-  this->get_occ_virt(idx_part, det_i_b, bocc, bvirt);
-
-  // get hole
-  // get part
-  std::vector<int> holes, parts;
-  double phase = 1.0;
-  if (spin == 0) {
-    get_holes(det_i_a, det_j_a, holes);
-    get_parts(det_i_a, det_j_a, parts);
-    phase = get_phase(det_i_a, det_j_a, holes, parts);
-    elem += this->input_integral->mo_one_body_ints[idx_part][alpha_spin_idx](holes[0], parts[0]);
-    for (auto orb_a_i : aocc) {
-      elem += this->input_integral->mo_two_body_ints[idx_part][alpha_spin_idx][idx_part][alpha_spin_idx](this->input_integral->idx2(holes[0], parts[0]), this->input_integral->idx2(orb_a_i, orb_a_i));
-      elem -= this->input_integral->mo_two_body_ints[idx_part][alpha_spin_idx][idx_part][alpha_spin_idx](this->input_integral->idx2(holes[0], orb_a_i), this->input_integral->idx2(orb_a_i, parts[0]));
-    }
-    for (auto orb_b_i : bocc) {
-      elem += this->input_integral->mo_two_body_ints[idx_part][alpha_spin_idx][idx_part][beta_spin_idx](this->input_integral->idx2(holes[0], parts[0]), this->input_integral->idx2(orb_b_i, orb_b_i));
-    }
-    elem *= phase;
-  } else {
-    get_holes(det_i_b, det_j_b, holes);
-    get_parts(det_i_b, det_j_b, parts);
-    phase = get_phase(det_i_b, det_j_b, holes, parts);
-    elem += this->input_integral->mo_one_body_ints[idx_part][beta_spin_idx](holes[0], parts[0]);
-    for (auto orb_b_i : bocc) {
-      elem += this->input_integral->mo_two_body_ints[idx_part][beta_spin_idx][idx_part][beta_spin_idx](this->input_integral->idx2(holes[0], parts[0]), this->input_integral->idx2(orb_b_i, orb_b_i));
-      elem -= this->input_integral->mo_two_body_ints[idx_part][beta_spin_idx][idx_part][beta_spin_idx](this->input_integral->idx2(holes[0], orb_b_i), this->input_integral->idx2(orb_b_i, parts[0]));
-    }
-    for (auto orb_a_i : aocc) {
-      elem += this->input_integral->mo_two_body_ints[idx_part][beta_spin_idx][idx_part][alpha_spin_idx](this->input_integral->idx2(holes[0], parts[0]), this->input_integral->idx2(orb_a_i, orb_a_i));
-    }
-    elem *= phase;
-  }
+  elem += this->input_integral->mo_one_body_ints[idx_part][exc_spin_idx](hole, part);
+  Polyquant_det_for_each_occ(det_i_exc, [&](int orb_i) {
+    elem += two_body_same(this->input_integral->idx2(hole, part), this->input_integral->idx2(orb_i, orb_i));
+    elem -= two_body_same(this->input_integral->idx2(hole, orb_i), this->input_integral->idx2(orb_i, part));
+  });
+  Polyquant_det_for_each_occ(det_i_other, [&](int orb_i) { elem += two_body_other(this->input_integral->idx2(hole, part), this->input_integral->idx2(orb_i, orb_i)); });
+  elem *= excitation.phase;
   return elem;
 }
 
-template <typename T> double POLYQUANT_DETSET<T>::same_part_ham_double(int idx_part, std::vector<int> i_unfold, std::vector<int> j_unfold) const {
+template <typename T> template <std::size_t N> double POLYQUANT_DETSET<T>::same_part_ham_double_impl(int idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const {
   auto elem = 0.0;
-  auto det_i_a = this->get_det(idx_part, 0, i_unfold[idx_part * 2 + 0]);
-  auto det_i_b = this->get_det(idx_part, 1, i_unfold[idx_part * 2 + 1]);
-  auto det_j_a = this->get_det(idx_part, 0, j_unfold[idx_part * 2 + 0]);
-  auto det_j_b = this->get_det(idx_part, 1, j_unfold[idx_part * 2 + 1]);
+  auto det_i_a = this->unique_dets[idx_part][0].template get_fixed<N>(i_unfold[idx_part * 2 + 0]);
+  auto det_i_b = this->unique_dets[idx_part][1].template get_fixed<N>(i_unfold[idx_part * 2 + 1]);
+  auto det_j_a = this->unique_dets[idx_part][0].template get_fixed<N>(j_unfold[idx_part * 2 + 0]);
+  auto det_j_b = this->unique_dets[idx_part][1].template get_fixed<N>(j_unfold[idx_part * 2 + 1]);
   auto alpha_spin_idx = 0;
   auto beta_spin_idx = 1 % this->input_integral->mo_one_body_ints[idx_part].size();
 
   // spin = -1 mixed, spin = 0 alpha excitation, spin = 1 beta excitation
-  if (det_i_a == det_j_a) {
-    std::vector<int> holes, parts;
-    double phase = 1.0;
-    get_holes(det_i_b, det_j_b, holes);
-    get_parts(det_i_b, det_j_b, parts);
-    phase = get_phase(det_i_b, det_j_b, holes, parts);
-    elem += this->input_integral->mo_two_body_ints[idx_part][beta_spin_idx][idx_part][beta_spin_idx](this->input_integral->idx2(holes[0], parts[0]), this->input_integral->idx2(holes[1], parts[1]));
-    elem -= this->input_integral->mo_two_body_ints[idx_part][beta_spin_idx][idx_part][beta_spin_idx](this->input_integral->idx2(holes[0], parts[1]), this->input_integral->idx2(holes[1], parts[0]));
-    elem *= phase;
-  } else if (det_i_b == det_j_b) {
-    std::vector<int> holes, parts;
-    double phase = 1.0;
-    get_holes(det_i_a, det_j_a, holes);
-    get_parts(det_i_a, det_j_a, parts);
-    phase = get_phase(det_i_a, det_j_a, holes, parts);
-    elem += this->input_integral->mo_two_body_ints[idx_part][alpha_spin_idx][idx_part][alpha_spin_idx](this->input_integral->idx2(holes[0], parts[0]), this->input_integral->idx2(holes[1], parts[1]));
-    elem -= this->input_integral->mo_two_body_ints[idx_part][alpha_spin_idx][idx_part][alpha_spin_idx](this->input_integral->idx2(holes[0], parts[1]), this->input_integral->idx2(holes[1], parts[0]));
-    elem *= phase;
+  if (Polyquant_det_equal(det_i_a, det_j_a) || Polyquant_det_equal(det_i_b, det_j_b)) {
+    auto spin_idx = Polyquant_det_equal(det_i_a, det_j_a) ? beta_spin_idx : alpha_spin_idx;
+    auto excitation = Polyquant_det_equal(det_i_a, det_j_a) ? Polyquant_det_excitation(det_i_b, det_j_b) : Polyquant_det_excitation(det_i_a, det_j_a);
+    const auto &holes = excitation.holes;
+    const auto &parts = excitation.parts;
+    const auto &two_body = this->input_integral->mo_two_body_ints[idx_part][spin_idx][idx_part][spin_idx];
+    elem += two_body(this->input_integral->idx2(holes[0], parts[0]), this->input_integral->idx2(holes[1], parts[1]));
+    elem -= two_body(this->input_integral->idx2(holes[0], parts[1]), this->input_integral->idx2(holes[1], parts[0]));
+    elem *= excitation.phase;
   } else {
-    std::vector<int> aholes, aparts;
-    std::vector<int> bholes, bparts;
-    double phase = 1.0;
-    get_holes(det_i_a, det_j_a, aholes);
-    get_parts(det_i_a, det_j_a, aparts);
-    get_holes(det_i_b, det_j_b, bholes);
-    get_parts(det_i_b, det_j_b, bparts);
-    auto aphase = get_phase(det_i_a, det_j_a, aholes, aparts);
-    auto bphase = get_phase(det_i_b, det_j_b, bholes, bparts);
-    phase *= aphase * bphase;
-    // std::cout << "det_i(" << i_unfold[idx_part * 2 + 0] << ", " << i_unfold[idx_part * 2 + 1] << ") = ";
-    // std::cout << "{";
-    // for ( auto i : det_i_a){
-    //     std::cout << i << ", ";
-    // }
-    // std::cout << "}, {";
-    // for ( auto i : det_i_b){
-    //     std::cout << i << ", ";
-    // }
-    // std::cout << "}" << std::endl;
-
-    // std::cout << "det_j(" << j_unfold[idx_part * 2 + 0] << ", " << j_unfold[idx_part * 2 + 1] << ") = ";
-    // std::cout << "{";
-    // for ( auto i : det_j_a){
-    //     std::cout << i << ", ";
-    // }
-    // std::cout << "}, {";
-    // for ( auto i : det_j_b){
-    //     std::cout << i << ", ";
-    // }
-    // std::cout << "}" << std::endl;
-
-    // std::cout << "ah ap bh bp :" << aholes[0] << " " <<aparts[0] << " " <<bholes[0] << " " <<bparts[0] << std::endl;
-    // std::cout << "aphase bphase : " << aphase << " " << bphase << std::endl;
-    elem +=
-        this->input_integral->mo_two_body_ints[idx_part][alpha_spin_idx][idx_part][beta_spin_idx](this->input_integral->idx2(aholes[0], aparts[0]), this->input_integral->idx2(bholes[0], bparts[0]));
-    elem *= phase;
+    auto aexcitation = Polyquant_det_excitation(det_i_a, det_j_a);
+    auto bexcitation = Polyquant_det_excitation(det_i_b, det_j_b);
+    elem += this->input_integral->mo_two_body_ints[idx_part][alpha_spin_idx][idx_part][beta_spin_idx](this->input_integral->idx2(aexcitation.holes[0], aexcitation.parts[0]),
+                                                                                                      this->input_integral->idx2(bexcitation.holes[0], bexcitation.parts[0]));
+    elem *= aexcitation.phase * bexcitation.phase;
   }
   return elem;
 }
 
+template <typename T> double POLYQUANT_DETSET<T>::same_part_ham_diag(int idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const {
+  return Polyquant_dispatch_det_words(this->det_n_int(), [&](auto n_int) { return this->template same_part_ham_diag_impl<decltype(n_int)::value>(idx_part, i_unfold); });
+}
+
+template <typename T> double POLYQUANT_DETSET<T>::same_part_ham_single(int idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const {
+  return Polyquant_dispatch_det_words(this->det_n_int(), [&](auto n_int) { return this->template same_part_ham_single_impl<decltype(n_int)::value>(idx_part, i_unfold, j_unfold); });
+}
+
+template <typename T> double POLYQUANT_DETSET<T>::same_part_ham_double(int idx_part, std::span<const int> i_unfold, std::span<const int> j_unfold) const {
+  return Polyquant_dispatch_det_words(this->det_n_int(), [&](auto n_int) { return this->template same_part_ham_double_impl<decltype(n_int)::value>(idx_part, i_unfold, j_unfold); });
+}
+
 template class POLYQUANT_DETSET<uint64_t>;
 }; // namespace polyquant
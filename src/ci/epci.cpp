@@ -376,6 +376,57 @@ void POLYQUANT_EPCI::setup_determinants() {
   this->detset.create_unique_excitation_map_doubles();
 }
 
+bool POLYQUANT_EPCI::reuse_determinants() {
+  if (this->previous_ci == nullptr) {
+    return false;
+  }
+  // with symmetry the determinants kept depend on the irreps of the orbitals, which can reorder between calculations
+  if (this->input_symmetry->do_symmetry) {
+    return false;
+  }
+  const auto &previous_detset = this->previous_ci->detset;
+  if (previous_detset.max_orb != this->detset.max_orb || previous_detset.frozen_core != this->detset.frozen_core || previous_detset.deleted_virtual != this->detset.deleted_virtual ||
+      this->previous_ci->excitation_level != this->excitation_level || this->previous_ci->max_collective_excitation_level != this->max_collective_excitation_level) {
+    return false;
+  }
+  this->detset.unique_dets = previous_detset.unique_dets;
+  this->detset.unique_singles = previous_detset.unique_singles;
+  this->detset.unique_doubles = previous_detset.unique_doubles;
+  this->detset.dets = previous_detset.dets;
+  this->detset.det_idx_stride = previous_detset.det_idx_stride;
+  this->detset.N_dets_complete_space = previous_detset.N_dets_complete_space;
+  // the address table follows this calculation's det_address settings and string_driven_sigma, not the previous one's
+  this->detset.rebuild_dets_unfolded();
+  this->detset.curr_symm_block = previous_detset.curr_symm_block;
+  this->reused_determinants = true;
+  Polyquant_cout("Reusing the " + std::to_string(this->detset.N_dets) + " determinants of the previous calculation");
+  return true;
+}
+
+bool POLYQUANT_EPCI::form_initial_subspace(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &initial_space, Eigen::Index num_vec) {
+  if (!this->reused_determinants || this->previous_ci->C_ci.rows() != this->detset.N_dets) {
+    return false;
+  }
+  const auto &C_previous = this->previous_ci->C_ci;
+  num_vec = std::min<Eigen::Index>(num_vec, this->detset.N_dets);
+  auto num_previous = std::min<Eigen::Index>(C_previous.cols(), num_vec);
+  initial_space.setZero(this->detset.N_dets, num_vec);
+  initial_space.leftCols(num_previous) = C_previous.leftCols(num_previous);
+  std::vector<int> lowest_dets(this->detset.N_dets);
+  std::iota(lowest_dets.begin(), lowest_dets.end(), 0);
+  std::partial_sort(lowest_dets.begin(), lowest_dets.begin() + (num_vec - num_previous), lowest_dets.end(),
+                    [&](int a, int b) { return this->detset.diagonal_Hii[a] < this->detset.diagonal_Hii[b]; });
+  for (auto i = num_previous; i < num_vec; i++) {
+    initial_space(lowest_dets[i - num_previous], i) = 1.0;
+  }
+  // the leading columns of Q span the previous CI vectors
+  Eigen::HouseholderQR<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> qr(initial_space);
+  initial_space = qr.householderQ() * Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Identity(this->detset.N_dets, num_vec);
+  this->warm_started = true;
+  Polyquant_cout("Starting Davidson from the " + std::to_string(num_previous) + " CI vectors of the previous calculation");
+  return true;
+}
+
 void POLYQUANT_EPCI::print_start() {
   Polyquant_section_header("Multispecies CI Calculation");
   std::stringstream buffer;
@@ -388,6 +439,13 @@ void POLYQUANT_EPCI::print_start() {
   buffer << "    second_order_spin_penalty = " << std::boolalpha << this->second_order_spin_penalty << std::endl;
   buffer << "    screening_threshold = " << this->detset.screening_threshold << std::endl;
   buffer << "    Direct( matrix-free) = " << std::boolalpha << !this->detset.build_matrix << std::endl;
+  if (this->detset.build_matrix) {
+    buffer << "    Hamiltonian storage = " << this->detset.ham_storage << std::endl;
+  }
+  if (!this->detset.build_matrix) {
+    buffer << "    String driven sigma = " << std::boolalpha << this->detset.string_driven_sigma << std::endl;
+    buffer << "    Row gather sigma = " << std::boolalpha << this->detset.gather_sigma << std::endl;
+  }
 
   if (this->first_order_spin_penalty || this->second_order_spin_penalty) {
     buffer << "    Expected S^2   " << std::endl;
@@ -571,7 +629,9 @@ void POLYQUANT_EPCI::run() {
     }
   }
   this->calculate_integrals();
-  this->setup_determinants();
+  if (!this->reuse_determinants()) {
+    this->setup_determinants();
+  }
   this->detset.precompute_diagonal_Slater_Condon();
   this->print_start_iterations();
 
@@ -590,11 +650,17 @@ void POLYQUANT_EPCI::run() {
   this->constant_shift += this->hf_det_energy;
   this->detset.diagonal_Hii.array() -= this->hf_det_energy;
   DavidsonDerivedLogger<Scalar, Vector_of_Scalar> *logger = new DavidsonDerivedLogger<Scalar, Vector_of_Scalar>(constant_shift);
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> initial_space;
 
   if (this->detset.build_matrix == false) {
     Spectra::DavidsonSymEigsSolver<POLYQUANT_DETSET<uint64_t>> solver(this->detset, this->num_states, initialsubspacevec, maxsubspacevec, logger);
     Eigen::Index maxit = this->iteration_max;
-    int nconv = solver.compute(Spectra::SortRule::SmallestAlge, maxit, this->convergence_E);
+    int nconv;
+    if (this->form_initial_subspace(initial_space, initialsubspacevec)) {
+      nconv = solver.compute_with_guess(initial_space, Spectra::SortRule::SmallestAlge, maxit, this->convergence_E);
+    } else {
+      nconv = solver.compute(Spectra::SortRule::SmallestAlge, maxit, this->convergence_E);
+    }
     if (solver.info() == Spectra::CompInfo::Successful) {
       this->energies = solver.eigenvalues();
       this->C_ci = solver.eigenvectors();
@@ -609,6 +675,9 @@ void POLYQUANT_EPCI::run() {
       APP_ABORT("CI Calculation did not converge!");
     }
   } else {
+    if (this->detset.ham_storage != "csr" && (this->first_order_spin_penalty || this->second_order_spin_penalty)) {
+      APP_ABORT("Spin penalties are only implemented for ham_storage csr");
+    }
     this->detset.create_ham();
 
     if (this->first_order_spin_penalty) {
@@ -620,13 +689,20 @@ void POLYQUANT_EPCI::run() {
     }
 
     if (this->exact_diag) {
-      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> h(this->detset.ham);
-      for (auto i = 0; i < h.rows(); i++) {
-        for (auto j = i; j < h.rows(); j++) {
-          if (i == j) {
-            continue;
-          } else {
-            h(j, i) = h(i, j);
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> h;
+      if (this->detset.ham_storage == "packed") {
+        h = this->detset.packed_ham * Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Identity(this->detset.N_dets, this->detset.N_dets);
+      } else if (this->detset.ham_storage == "packed_float") {
+        h = this->detset.packed_ham_float * Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Identity(this->detset.N_dets, this->detset.N_dets);
+      } else {
+        h = this->detset.ham;
+        for (auto i = 0; i < h.rows(); i++) {
+          for (auto j = i; j < h.rows(); j++) {
+            if (i == j) {
+              continue;
+            } else {
+              h(j, i) = h(i, j);
+            }
           }
         }
       }
@@ -650,23 +726,36 @@ void POLYQUANT_EPCI::run() {
       this->print_success();
       this->dump_molden();
     } else {
-      // row major so Upper has more continguous memory
-      Spectra::SparseSymMatProd<double, Eigen::Upper, Eigen::RowMajor, int> op_sparse(this->detset.ham);
-      Spectra::DavidsonSymEigsSolver<Spectra::SparseSymMatProd<double, Eigen::Upper, Eigen::RowMajor, int>> solver(op_sparse, this->num_states, initialsubspacevec, maxsubspacevec, logger);
-      Eigen::Index maxit = this->iteration_max;
-      int nconv = solver.compute(Spectra::SortRule::SmallestAlge, maxit, this->convergence_E);
-      if (solver.info() == Spectra::CompInfo::Successful) {
-        this->energies = solver.eigenvalues();
-        this->C_ci = solver.eigenvectors();
-        for (auto e = 0; e < this->energies.size(); e++) {
-          this->energies[e] += constant_shift;
+      auto davidson = [&](auto &op) {
+        Spectra::DavidsonSymEigsSolver<std::remove_cvref_t<decltype(op)>> solver(op, this->num_states, initialsubspacevec, maxsubspacevec, logger);
+        Eigen::Index maxit = this->iteration_max;
+        int nconv;
+        if (this->form_initial_subspace(initial_space, initialsubspacevec)) {
+          nconv = solver.compute_with_guess(initial_space, Spectra::SortRule::SmallestAlge, maxit, this->convergence_E);
+        } else {
+          nconv = solver.compute(Spectra::SortRule::SmallestAlge, maxit, this->convergence_E);
+        }
+        if (solver.info() == Spectra::CompInfo::Successful) {
+          this->energies = solver.eigenvalues();
+          this->C_ci = solver.eigenvectors();
+          for (auto e = 0; e < this->energies.size(); e++) {
+            this->energies[e] += constant_shift;
+          }
+          this->calculate_NOs();
+          this->calculate_S_squared();
+          this->print_success();
+          this->dump_molden();
+        } else {
+          APP_ABORT("CI Calculation did not converge!");
         }
-        this->calculate_NOs();
-        this->calculate_S_squared();
-        this->print_success();
-        this->dump_molden();
+      };
+      if (this->detset.ham_storage == "packed") {
+        davidson(this->detset.packed_ham);
+      } else if (this->detset.ham_storage == "packed_float") {
+        davidson(this->detset.packed_ham_float);
       } else {
-        APP_ABORT("CI Calculation did not converge!");
+        POLYQUANT_SPARSE_SYM_MAT_PROD op_sparse(this->detset.ham);
+        davidson(op_sparse);
       }
     }
   }
@@ -2,6 +2,7 @@
 #define POLYQUANT_EPCI_H
 #include "basis/basis.hpp"
 #include "ci/determinant_set.hpp"
+#include "ci/symmetric_spmm.hpp"
 #include "integral/integral.hpp"
 #include "io/davidson_logging.hpp"
 #include "io/fcidump_utilities.hpp"
@@ -13,10 +14,10 @@
 #include <Eigen/Core>
 #include <Spectra/DavidsonSymEigsSolver.h>
 #include <Spectra/LoggerBase.h>
-#include <Spectra/MatOp/SparseSymMatProd.h>
 #include <Spectra/SymEigsSolver.h>
 #include <combinations.hpp>
 #include <inttypes.h>
+#include <numeric>
 #include <string>
 
 namespace polyquant {
@@ -34,6 +35,20 @@ public:
   void calculate_NOs();
   void calculate_S_squared();
   void setup_determinants();
+  /**
+   * @brief Take the determinant set and excitation maps from previous_ci if they describe the same space
+   *
+   * @return whether the determinants were reused
+   */
+  bool reuse_determinants();
+  /**
+   * @brief Davidson starting vectors from the CI vectors of previous_ci, padded with the lowest diagonal determinants
+   *
+   * @param initial_space the orthonormal starting vectors
+   * @param num_vec the number of starting vectors
+   * @return whether a warm start is possible
+   */
+  bool form_initial_subspace(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &initial_space, Eigen::Index num_vec);
   void run();
   void print_start();
   void print_start_iterations();
@@ -82,6 +97,13 @@ public:
    *
    */
   std::shared_ptr<POLYQUANT_EPSCF> input_epscf;
+  /**
+   * @brief a converged CI (e.g. the previous point of a scan) to warm start from
+   *
+   */
+  std::shared_ptr<POLYQUANT_EPCI> previous_ci;
+  bool reused_determinants = false;
+  bool warm_started = false;
   POLYQUANT_DETSET<uint64_t> detset;
   Eigen::Matrix<double, Eigen::Dynamic, 1> energies;
   Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> C_ci;
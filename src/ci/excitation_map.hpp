@@ -0,0 +1,74 @@
+#ifndef POLYQUANT_EXCITATION_MAP_H
+#define POLYQUANT_EXCITATION_MAP_H
+#include "io/utils.hpp"
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace polyquant {
+
+/**
+ * @brief Compressed sparse row list over the unique strings of one quantum particle type and spin. The entries of string i are
+ * targets[offsets[i], offsets[i + 1]), handed out as a non-owning span.
+ *
+ * @tparam Entry type of the entries
+ */
+template <typename Entry> class POLYQUANT_CSR_LIST {
+public:
+  /**
+   * @brief Take ownership of prebuilt CSR arrays.
+   *
+   * @param row_offsets offsets into entries, one more than the number of strings
+   * @param entries entries of all strings, stored row after row
+   */
+  void assign(std::vector<std::size_t> &&row_offsets, std::vector<Entry> &&entries) {
+    if (row_offsets.empty() || row_offsets.back() != entries.size()) {
+      APP_ABORT("CSR list offsets don't match the number of entries");
+    }
+    this->offsets = std::move(row_offsets);
+    this->targets = std::move(entries);
+  }
+  /**
+   * @brief A list of num_strings strings without any entries.
+   */
+  void assign_empty(std::size_t num_strings) {
+    this->offsets.assign(num_strings + 1, 0);
+    this->targets.clear();
+  }
+  std::span<const Entry> operator[](std::size_t i) const { return std::span<const Entry>(this->targets.data() + this->offsets[i], this->offsets[i + 1] - this->offsets[i]); }
+  /**
+   * @brief number of strings (rows)
+   */
+  std::size_t size() const { return this->offsets.empty() ? 0 : this->offsets.size() - 1; }
+  bool empty() const { return this->size() == 0; }
+  /**
+   * @brief total number of stored entries
+   */
+  std::size_t num_connections() const { return this->targets.size(); }
+  bool operator==(const POLYQUANT_CSR_LIST<Entry> &other) const = default;
+
+private:
+  std::vector<std::size_t> offsets;
+  std::vector<Entry> targets;
+};
+
+/**
+ * @brief The strings connected to each string by a single or double excitation, in ascending order.
+ */
+using POLYQUANT_EXCITATION_MAP = POLYQUANT_CSR_LIST<std::size_t>;
+
+/**
+ * @brief One entry of a string replacement list, <I| E_pq + E_qp |J> = phase for the target string I the list belongs to. For p == q
+ * the operator is E_pp alone. pair is the triangular index of (p, q) used by the two body integrals.
+ */
+struct POLYQUANT_STRING_REPLACEMENT {
+  std::size_t string;
+  std::size_t pair;
+  double phase;
+  bool operator==(const POLYQUANT_STRING_REPLACEMENT &other) const = default;
+};
+using POLYQUANT_REPLACEMENT_LIST = POLYQUANT_CSR_LIST<POLYQUANT_STRING_REPLACEMENT>;
+
+} // namespace polyquant
+#endif
@@ -0,0 +1,254 @@
+#ifndef POLYQUANT_PACKED_HAMILTONIAN_H
+#define POLYQUANT_PACKED_HAMILTONIAN_H
+#include "ci/symmetric_spmm.hpp"
+#include "io/utils.hpp"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace polyquant {
+
+/**
+ * @brief Position inside a row of a POLYQUANT_PACKED_ROW_BLOCK: the next column delta and value, the end of the row's values and the
+ * last column read.
+ */
+template <typename Value> struct POLYQUANT_PACKED_ROW_CURSOR {
+  const std::uint8_t *delta_ptr = nullptr;
+  const Value *value_ptr = nullptr;
+  const Value *value_end = nullptr;
+  int col = 0;
+};
+
+/**
+ * @brief Contiguous rows of the strictly upper triangle of a symmetric matrix. Row first_row + r owns
+ * values[row_offsets[r], row_offsets[r + 1]) and col_deltas[byte_offsets[r], byte_offsets[r + 1]), the offsets are 64 bit so a block
+ * is not limited to 2^31 nonzeros. The column indices are stored as LEB128 varint deltas, the first relative to the row itself and
+ * the rest relative to the previous column, so columns close to the diagonal take a single byte.
+ *
+ * @tparam Value stored type of the matrix elements
+ */
+template <typename Value> class POLYQUANT_PACKED_ROW_BLOCK {
+public:
+  explicit POLYQUANT_PACKED_ROW_BLOCK(int first_row = 0) : first_row(first_row), row_offsets(1, 0), byte_offsets(1, 0) {}
+  /**
+   * @brief Append the next row of the block.
+   *
+   * @param row index of the row, must be first_row + num_rows()
+   * @param elems (column, value) pairs of the row with strictly increasing columns above row
+   */
+  void push_row(int row, std::span<const std::pair<int, double>> elems) {
+    if (row != this->first_row + this->num_rows()) {
+      APP_ABORT("Packed matrix rows must be appended in order");
+    }
+    auto prev_col = row;
+    for (const auto &[col, value] : elems) {
+      if (col <= prev_col) {
+        APP_ABORT("Packed matrix columns must be strictly increasing and above the diagonal");
+      }
+      auto delta = static_cast<std::uint32_t>(col - prev_col);
+      while (delta >= 0x80) {
+        this->col_deltas.push_back(static_cast<std::uint8_t>(delta | 0x80));
+        delta >>= 7;
+      }
+      this->col_deltas.push_back(static_cast<std::uint8_t>(delta));
+      this->values.push_back(static_cast<Value>(value));
+      prev_col = col;
+    }
+    this->row_offsets.push_back(static_cast<std::int64_t>(this->values.size()));
+    this->byte_offsets.push_back(static_cast<std::int64_t>(this->col_deltas.size()));
+  }
+  /**
+   * @brief Cursor at the first element of row first_row + r
+   */
+  POLYQUANT_PACKED_ROW_CURSOR<Value> row_cursor(int r) const {
+    POLYQUANT_PACKED_ROW_CURSOR<Value> cursor;
+    cursor.delta_ptr = this->col_deltas.data() + this->byte_offsets[r];
+    cursor.value_ptr = this->values.data() + this->row_offsets[r];
+    cursor.value_end = this->values.data() + this->row_offsets[r + 1];
+    cursor.col = this->first_row + r;
+    return cursor;
+  }
+  /**
+   * @brief Call f(col, value) for the next elements of the cursor's row with col < col_end and move the cursor past them.
+   */
+  template <typename F> static void advance(POLYQUANT_PACKED_ROW_CURSOR<Value> &cursor, int col_end, F &&f) {
+    while (cursor.value_ptr != cursor.value_end) {
+      auto delta_ptr = cursor.delta_ptr;
+      std::uint32_t delta = 0;
+      for (auto shift = 0;; shift += 7) {
+        auto byte = *delta_ptr++;
+        delta |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+          break;
+        }
+      }
+      auto col = cursor.col + static_cast<int>(delta);
+      if (col >= col_end) {
+        return;
+      }
+      f(col, *cursor.value_ptr);
+      cursor.value_ptr++;
+      cursor.delta_ptr = delta_ptr;
+      cursor.col = col;
+    }
+  }
+  /**
+   * @brief Call f(row, col, value) for every stored element of the block, row by row with increasing columns.
+   */
+  template <typename F> void for_each_nonzero(F &&f) const {
+    for (auto r = 0; r < this->num_rows(); r++) {
+      auto cursor = this->row_cursor(r);
+      advance(cursor, std::numeric_limits<int>::max(), [&](int col, Value value) { f(this->first_row + r, col, value); });
+    }
+  }
+  int begin_row() const { return this->first_row; }
+  int num_rows() const { return static_cast<int>(this->row_offsets.size()) - 1; }
+  std::int64_t nonZeros() const { return this->row_offsets.back(); }
+  std::int64_t row_nonzeros(int r) const { return this->row_offsets[r + 1] - this->row_offsets[r]; }
+  std::size_t memory_bytes() const {
+    return (this->row_offsets.size() + this->byte_offsets.size()) * sizeof(std::int64_t) + this->col_deltas.size() + this->values.size() * sizeof(Value);
+  }
+  void shrink_to_fit() {
+    this->row_offsets.shrink_to_fit();
+    this->byte_offsets.shrink_to_fit();
+    this->col_deltas.shrink_to_fit();
+    this->values.shrink_to_fit();
+  }
+
+private:
+  int first_row;
+  std::vector<std::int64_t> row_offsets;
+  std::vector<std::int64_t> byte_offsets;
+  std::vector<std::uint8_t> col_deltas;
+  std::vector<Value> values;
+};
+
+/**
+ * @brief Symmetric matrix stored as its diagonal, in double precision, and the strictly upper triangle split into
+ * POLYQUANT_PACKED_ROW_BLOCKs. Meant for explicit CI Hamiltonians with more nonzeros than Eigen::SparseMatrix<double, RowMajor, int>
+ * can index, with Value = float to halve the storage of the off diagonal elements. Provides the rows(), cols(), operator()(i, j)
+ * and operator* interface Spectra's Davidson solver expects of a matrix operator.
+ *
+ * @tparam Value stored type of the off diagonal elements
+ */
+template <typename Value> class POLYQUANT_PACKED_SYM_MATRIX {
+public:
+  using Scalar = double; // A typedef named "Scalar" is required
+  using Matrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>;
+  using cursor_type = POLYQUANT_PACKED_ROW_CURSOR<Value>;
+
+  /**
+   * @brief Empty matrix with one row block per [row_offsets[b], row_offsets[b + 1]).
+   *
+   * @param diag the diagonal, which also sets the dimension
+   * @param row_offsets first row of every block followed by the dimension
+   */
+  void reset(const Eigen::Matrix<double, Eigen::Dynamic, 1> &diag, const std::vector<int> &row_offsets) {
+    if (row_offsets.empty() || row_offsets.front() != 0 || row_offsets.back() != diag.size()) {
+      APP_ABORT("Packed matrix row blocks don't cover the diagonal");
+    }
+    this->diagonal = diag;
+    this->blocks.clear();
+    this->spmm = POLYQUANT_SYMMETRIC_SPMM<cursor_type>();
+    for (std::size_t idx_block = 0; idx_block + 1 < row_offsets.size(); idx_block++) {
+      this->blocks.emplace_back(row_offsets[idx_block]);
+    }
+  }
+  POLYQUANT_PACKED_ROW_BLOCK<Value> &block(std::size_t idx_block) { return this->blocks[idx_block]; }
+  const POLYQUANT_PACKED_ROW_BLOCK<Value> &block(std::size_t idx_block) const { return this->blocks[idx_block]; }
+  std::size_t num_blocks() const { return this->blocks.size(); }
+
+  int rows() const { return static_cast<int>(this->diagonal.size()); }
+  int cols() const { return static_cast<int>(this->diagonal.size()); }
+  /**
+   * @brief number of stored elements of the upper triangle, including the diagonal
+   */
+  std::int64_t nonZeros() const {
+    std::int64_t num_nonzero = this->diagonal.size();
+    for (const auto &row_block : this->blocks) {
+      num_nonzero += row_block.nonZeros();
+    }
+    return num_nonzero;
+  }
+  std::size_t memory_bytes() const {
+    std::size_t num_bytes = this->diagonal.size() * sizeof(double);
+    for (const auto &row_block : this->blocks) {
+      num_bytes += row_block.memory_bytes();
+    }
+    return num_bytes;
+  }
+  /**
+   * @brief Element (i, j). Off diagonal elements are found by decoding row min(i, j) up to the column, so this is only meant for the
+   * diagonal the Davidson preconditioner asks for and for tests.
+   */
+  double operator()(int i, int j) const {
+    if (i == j) {
+      return this->diagonal[i];
+    }
+    auto row = std::min(i, j);
+    auto col = std::max(i, j);
+    auto cursor = this->row_cursor(row);
+    double elem = 0.0;
+    POLYQUANT_PACKED_ROW_BLOCK<Value>::advance(cursor, col + 1, [&](int c, Value value) {
+      if (c == col) {
+        elem = value;
+      }
+    });
+    return elem;
+  }
+  /**
+   * @brief Row cursors for POLYQUANT_SYMMETRIC_SPMM
+   */
+  cursor_type row_cursor(int row) const {
+    const auto &row_block = this->block_of_row(row);
+    return row_block.row_cursor(row - row_block.begin_row());
+  }
+  template <typename F> void advance(int, cursor_type &cursor, int col_end, F &&f) const { POLYQUANT_PACKED_ROW_BLOCK<Value>::advance(cursor, col_end, f); }
+  /**
+   * @brief Y = A X using both the stored upper triangle and its transpose, threaded with POLYQUANT_SYMMETRIC_SPMM. Its blocks and
+   * buffers are set up by the first product after the matrix is filled and reused after that.
+   */
+  void multiply(const Eigen::Ref<const Matrix> &X, Eigen::Ref<Matrix> Y) const {
+    if (this->spmm.empty()) {
+      std::vector<std::int64_t> row_offsets(1, 0);
+      row_offsets.reserve(this->rows() + 1);
+      for (const auto &row_block : this->blocks) {
+        for (auto r = 0; r < row_block.num_rows(); r++) {
+          row_offsets.push_back(row_offsets.back() + row_block.row_nonzeros(r));
+        }
+      }
+      this->spmm.setup(row_offsets);
+    }
+    this->spmm.multiply(*this, this->diagonal, X, Y);
+  }
+  Matrix operator*(const Eigen::Ref<const Matrix> &mat_in) const {
+    Matrix mat_out(this->rows(), mat_in.cols());
+    this->multiply(mat_in, mat_out);
+    return mat_out;
+  }
+  // y_out = M * x_in
+  void perform_op(const double *x_in, double *y_out) const {
+    Eigen::Map<const Matrix> x(x_in, this->rows(), 1);
+    Eigen::Map<Matrix> y(y_out, this->rows(), 1);
+    this->multiply(x, y);
+  }
+
+  Eigen::Matrix<double, Eigen::Dynamic, 1> diagonal;
+
+private:
+  const POLYQUANT_PACKED_ROW_BLOCK<Value> &block_of_row(int row) const {
+    auto it = std::upper_bound(this->blocks.begin(), this->blocks.end(), row, [](int r, const auto &row_block) { return r < row_block.begin_row(); });
+    return *std::prev(it);
+  }
+  std::vector<POLYQUANT_PACKED_ROW_BLOCK<Value>> blocks;
+  mutable POLYQUANT_SYMMETRIC_SPMM<cursor_type> spmm;
+};
+
+} // namespace polyquant
+#endif
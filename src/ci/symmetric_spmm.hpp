@@ -0,0 +1,167 @@
+#ifndef POLYQUANT_SYMMETRIC_SPMM_H
+#define POLYQUANT_SYMMETRIC_SPMM_H
+#include "io/utils.hpp"
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <omp.h>
+#include <vector>
+
+namespace polyquant {
+
+/**
+ * @brief Split rows into num_parts contiguous ranges holding roughly the same number of stored elements.
+ *
+ * @param row_offsets number of stored elements before every row followed by the total
+ * @param num_parts number of ranges
+ * @return std::vector<int> range p is rows [part_rows[p], part_rows[p + 1]), trailing ranges may be empty
+ */
+inline std::vector<int> Polyquant_balanced_row_split(const std::vector<std::int64_t> &row_offsets, std::size_t num_parts) {
+  const auto dim = static_cast<int>(row_offsets.size()) - 1;
+  std::vector<int> part_rows(1, 0);
+  auto part_cost = static_cast<double>(row_offsets.back()) / num_parts;
+  for (auto row = 1; row < dim && part_rows.size() < num_parts; row++) {
+    if (row_offsets[row] >= part_cost * part_rows.size()) {
+      part_rows.push_back(row);
+    }
+  }
+  part_rows.resize(num_parts + 1, dim);
+  return part_rows;
+}
+
+/**
+ * @brief Threaded Y = A X for a symmetric A given as its diagonal and strict upper triangle, without any per thread copies of Y.
+ * The rows and columns are cut at the same block boundaries and tile (p, q >= p) holds the elements of the rows of block p with
+ * columns in block q. Tile (p, q) only writes to the rows of blocks p and q, so the tiles of one anti-diagonal p + q = r never touch
+ * the same rows and run concurrently, one anti-diagonal after the other. Every row keeps a cursor into its elements, which the
+ * tiles of increasing q advance in turn. The cursors and the row major copies of X and Y are kept between products.
+ *
+ * The matrix provides row_cursor(row) pointing at the first element of row right of the diagonal and advance(row, cursor, col_end, f)
+ * calling f(col, value) for the next elements of row before col_end.
+ *
+ * @tparam Cursor position inside a row of the matrix
+ */
+template <typename Cursor> class POLYQUANT_SYMMETRIC_SPMM {
+public:
+  /**
+   * @brief Choose the blocks, several per thread so every anti-diagonal has enough tiles to spread.
+   *
+   * @param row_offsets number of stored elements before every row followed by the total
+   */
+  void setup(const std::vector<std::int64_t> &row_offsets) {
+    const auto dim = static_cast<std::size_t>(row_offsets.size() - 1);
+    const auto num_blocks = std::max<std::size_t>(1, std::min<std::size_t>(dim, 8 * omp_get_max_threads()));
+    this->block_rows = Polyquant_balanced_row_split(row_offsets, num_blocks);
+    this->cursors.resize(dim);
+  }
+  bool empty() const { return this->block_rows.empty(); }
+
+  template <typename Matrix>
+  void multiply(const Matrix &A, const Eigen::Matrix<double, Eigen::Dynamic, 1> &diagonal, const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> &X,
+                Eigen::Ref<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> Y) const {
+    const auto dim = static_cast<int>(diagonal.size());
+    const auto num_blocks = static_cast<int>(this->block_rows.size()) - 1;
+    const auto num_vecs = X.cols();
+    // row major so every element touches two contiguous rows of vectors
+    this->X_rows = X;
+    this->Y_rows.resize(dim, num_vecs);
+#pragma omp parallel
+    {
+#pragma omp for schedule(static)
+      for (auto row = 0; row < dim; row++) {
+        this->Y_rows.row(row) = diagonal[row] * this->X_rows.row(row);
+        this->cursors[row] = A.row_cursor(row);
+      }
+      for (auto diag_idx = 0; diag_idx < 2 * num_blocks - 1; diag_idx++) {
+#pragma omp for schedule(dynamic, 1)
+        for (auto p = std::max(0, diag_idx - num_blocks + 1); p <= diag_idx / 2; p++) {
+          const auto col_end = this->block_rows[diag_idx - p + 1];
+          for (auto row = this->block_rows[p]; row < this->block_rows[p + 1]; row++) {
+            auto *y_row = this->Y_rows.data() + row * num_vecs;
+            const auto *x_row = this->X_rows.data() + row * num_vecs;
+            A.advance(row, this->cursors[row], col_end, [&](int col, auto value) {
+              const auto elem = static_cast<double>(value);
+              auto *y_col = this->Y_rows.data() + col * num_vecs;
+              const auto *x_col = this->X_rows.data() + col * num_vecs;
+              for (Eigen::Index vec_idx = 0; vec_idx < num_vecs; vec_idx++) {
+                y_row[vec_idx] += elem * x_col[vec_idx];
+                y_col[vec_idx] += elem * x_row[vec_idx];
+              }
+            });
+          }
+        }
+      }
+    }
+    Y = this->Y_rows;
+  }
+
+private:
+  std::vector<int> block_rows;
+  mutable std::vector<Cursor> cursors;
+  mutable Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> X_rows;
+  mutable Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> Y_rows;
+};
+
+/**
+ * @brief Matrix operator for Spectra's Davidson solver over the upper triangle of a row major Eigen::SparseMatrix, multiplying the
+ * whole block of vectors with POLYQUANT_SYMMETRIC_SPMM instead of Spectra::SparseSymMatProd's serial product.
+ */
+class POLYQUANT_SPARSE_SYM_MAT_PROD {
+public:
+  using Scalar = double; // A typedef named "Scalar" is required
+  using Matrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>;
+  using cursor_type = int;
+
+  /**
+   * @param upper matrix whose upper triangle, including the diagonal, is used. Must outlive the operator.
+   */
+  explicit POLYQUANT_SPARSE_SYM_MAT_PROD(const Eigen::SparseMatrix<double, Eigen::RowMajor> &upper) : mat(upper) {
+    if (!this->mat.isCompressed()) {
+      APP_ABORT("Symmetric sparse product needs a compressed matrix");
+    }
+    this->diagonal = this->mat.diagonal();
+    std::vector<std::int64_t> row_offsets(this->mat.outerIndexPtr(), this->mat.outerIndexPtr() + this->mat.rows() + 1);
+    this->spmm.setup(row_offsets);
+  }
+  int rows() const { return static_cast<int>(this->mat.rows()); }
+  int cols() const { return static_cast<int>(this->mat.cols()); }
+  double operator()(int i, int j) const { return this->mat.coeff(std::min(i, j), std::max(i, j)); }
+  /**
+   * @brief Row cursors for POLYQUANT_SYMMETRIC_SPMM, the index of the first element of row right of the diagonal
+   */
+  cursor_type row_cursor(int row) const {
+    auto elem_idx = this->mat.outerIndexPtr()[row];
+    while (elem_idx < this->mat.outerIndexPtr()[row + 1] && this->mat.innerIndexPtr()[elem_idx] <= row) {
+      elem_idx++;
+    }
+    return elem_idx;
+  }
+  template <typename F> void advance(int row, cursor_type &elem_idx, int col_end, F &&f) const {
+    while (elem_idx < this->mat.outerIndexPtr()[row + 1] && this->mat.innerIndexPtr()[elem_idx] < col_end) {
+      f(this->mat.innerIndexPtr()[elem_idx], this->mat.valuePtr()[elem_idx]);
+      elem_idx++;
+    }
+  }
+  void multiply(const Eigen::Ref<const Matrix> &X, Eigen::Ref<Matrix> Y) const { this->spmm.multiply(*this, this->diagonal, X, Y); }
+  Matrix operator*(const Eigen::Ref<const Matrix> &mat_in) const {
+    Matrix mat_out(this->rows(), mat_in.cols());
+    this->multiply(mat_in, mat_out);
+    return mat_out;
+  }
+  // y_out = M * x_in
+  void perform_op(const double *x_in, double *y_out) const {
+    Eigen::Map<const Matrix> x(x_in, this->rows(), 1);
+    Eigen::Map<Matrix> y(y_out, this->rows(), 1);
+    this->multiply(x, y);
+  }
+
+private:
+  const Eigen::SparseMatrix<double, Eigen::RowMajor> &mat;
+  Eigen::Matrix<double, Eigen::Dynamic, 1> diagonal;
+  POLYQUANT_SYMMETRIC_SPMM<cursor_type> spmm;
+};
+
+} // namespace polyquant
+#endif
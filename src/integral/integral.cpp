@@ -94,6 +94,135 @@ void POLYQUANT_INTEGRAL::calculate_frozen_core_ints(std::vector<std::vector<Eige
   libint2::finalize();
 }
 
+void POLYQUANT_INTEGRAL::calculate_density_fitting() {
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  libint2::initialize();
+  Polyquant_cout("Calculating density fitting three center integrals...");
+  auto num_parts = this->input_molecule->quantum_particles.size();
+  this->ri_B.resize(num_parts);
+  for (auto quantum_part_b_idx = 0ul; quantum_part_b_idx < num_parts; quantum_part_b_idx++) {
+    if (this->ri_B[quantum_part_b_idx].size() != 0 || this->input_basis->aux_basis.size() <= quantum_part_b_idx || this->input_basis->num_aux_basis[quantum_part_b_idx] == 0) {
+      continue;
+    }
+    auto &aux_shells = this->input_basis->aux_basis[quantum_part_b_idx];
+    auto num_aux = this->input_basis->num_aux_basis[quantum_part_b_idx];
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> metric(num_aux, num_aux);
+    this->compute_density_fitting_metric(metric, aux_shells);
+    // (P|Q)^-1/2 without the (near) linearly dependent combinations of the auxiliary functions
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> eigensolver(metric);
+    auto &evals = eigensolver.eigenvalues();
+    std::vector<int> kept;
+    for (auto i = 0; i < evals.size(); i++) {
+      if (evals(i) > this->density_fitting_metric_threshold * evals.maxCoeff()) {
+        kept.push_back(i);
+      }
+    }
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> metric_inv_sqrt = eigensolver.eigenvectors()(Eigen::all, kept);
+    for (auto i = 0; i < kept.size(); i++) {
+      metric_inv_sqrt.col(i) /= std::sqrt(evals(kept[i]));
+    }
+    std::stringstream buffer;
+    buffer << "Particle " << quantum_part_b_idx << " : " << kept.size() << " of " << num_aux << " density fitting functions kept";
+    Polyquant_cout(buffer.str());
+    this->ri_B[quantum_part_b_idx].resize(num_parts);
+    for (auto quantum_part_a_idx = 0ul; quantum_part_a_idx < num_parts; quantum_part_a_idx++) {
+      auto num_basis_a = this->input_basis->num_basis[quantum_part_a_idx];
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> three_center(num_basis_a * num_basis_a, num_aux);
+      this->compute_density_fitting_three_center(three_center, aux_shells, this->input_basis->basis[quantum_part_a_idx]);
+      this->ri_B[quantum_part_b_idx][quantum_part_a_idx].noalias() = three_center * metric_inv_sqrt;
+    }
+  }
+  libint2::finalize();
+}
+
+void POLYQUANT_INTEGRAL::compute_density_fitting_metric(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &output_matrix, const libint2::BasisSet &aux_shells) {
+  auto nthreads = omp_get_max_threads();
+  std::vector<libint2::Engine> engines(nthreads);
+  engines[0] = libint2::Engine(libint2::Operator::coulomb, aux_shells.max_nprim(), aux_shells.max_l(), 0);
+  engines[0].set(libint2::BraKet::xs_xs);
+  engines[0].set_precision(0.0);
+  for (auto i = 1; i < nthreads; i++) {
+    engines[i] = engines[0];
+  }
+  auto shell2bf = aux_shells.shell2bf();
+  auto unit_shell = libint2::Shell::unit();
+  output_matrix.setZero();
+#pragma omp parallel
+  {
+    int nthreads = omp_get_num_threads();
+    auto thread_id = omp_get_thread_num();
+    const auto &buf = engines[thread_id].results();
+    for (auto s1 = 0l, s12 = 0l; s1 != aux_shells.size(); ++s1) {
+      for (auto s2 = 0l; s2 <= s1; ++s2, ++s12) {
+        if (s12 % nthreads != thread_id) {
+          continue;
+        }
+        engines[thread_id].compute2<libint2::Operator::coulomb, libint2::BraKet::xs_xs, 0>(aux_shells[s1], unit_shell, aux_shells[s2], unit_shell);
+        if (buf[0] == nullptr) {
+          continue;
+        }
+        auto n1 = aux_shells[s1].size();
+        auto n2 = aux_shells[s2].size();
+        Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> buf_mat(buf[0], n1, n2);
+        output_matrix.block(shell2bf[s1], shell2bf[s2], n1, n2) = buf_mat;
+        if (s1 != s2) {
+          output_matrix.block(shell2bf[s2], shell2bf[s1], n2, n1) = buf_mat.transpose();
+        }
+      }
+    }
+  }
+}
+
+void POLYQUANT_INTEGRAL::compute_density_fitting_three_center(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &output_matrix, const libint2::BasisSet &aux_shells,
+                                                              const libint2::BasisSet &shells) {
+  auto nthreads = omp_get_max_threads();
+  std::vector<libint2::Engine> engines(nthreads);
+  engines[0] = libint2::Engine(libint2::Operator::coulomb, std::max(aux_shells.max_nprim(), shells.max_nprim()), std::max(aux_shells.max_l(), shells.max_l()), 0);
+  engines[0].set(libint2::BraKet::xs_xx);
+  engines[0].set_precision(0.0);
+  for (auto i = 1; i < nthreads; i++) {
+    engines[i] = engines[0];
+  }
+  auto aux_shell2bf = aux_shells.shell2bf();
+  auto shell2bf = shells.shell2bf();
+  auto num_basis = shells.nbf();
+  auto unit_shell = libint2::Shell::unit();
+  output_matrix.setZero();
+#pragma omp parallel
+  {
+    int nthreads = omp_get_num_threads();
+    auto thread_id = omp_get_thread_num();
+    const auto &buf = engines[thread_id].results();
+    for (auto sP = 0l; sP != aux_shells.size(); ++sP) {
+      if (sP % nthreads != thread_id) {
+        continue;
+      }
+      auto nP = aux_shells[sP].size();
+      for (auto s1 = 0l; s1 != shells.size(); ++s1) {
+        auto n1 = shells[s1].size();
+        for (auto s2 = 0l; s2 <= s1; ++s2) {
+          auto n2 = shells[s2].size();
+          engines[thread_id].compute2<libint2::Operator::coulomb, libint2::BraKet::xs_xx, 0>(aux_shells[sP], unit_shell, shells[s1], shells[s2]);
+          if (buf[0] == nullptr) {
+            continue;
+          }
+          for (auto P = 0ul, P12 = 0ul; P < nP; P++) {
+            for (auto f1 = 0ul; f1 < n1; f1++) {
+              for (auto f2 = 0ul; f2 < n2; f2++, P12++) {
+                auto bf1 = shell2bf[s1] + f1;
+                auto bf2 = shell2bf[s2] + f2;
+                output_matrix(bf1 * num_basis + bf2, aux_shell2bf[sP] + P) = buf[0][P12];
+                output_matrix(bf2 * num_basis + bf1, aux_shell2bf[sP] + P) = buf[0][P12];
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
 void POLYQUANT_INTEGRAL::calculate_unique_shell_pairs(double threshold) {
   if (threshold == -1) {
     threshold = this->tolerance_2e;
@@ -245,19 +374,36 @@ Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> POLYQUANT_INTEGRAL::transf
   std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> eri_threads;
   temp_threads.resize(nthreads);
   eri_threads.resize(nthreads);
+  // each rank owns a contiguous block of the first MO index i, so it only stores the (i, q, r, s), (i, j, r, s) and (i, j, k, s)
+  // intermediates and the (ij|kl) rows of its own block. The stages never need another rank's block. Only the final matrix is
+  // summed over ranks (the blocks don't overlap) since every rank's CI needs random access to all of it
+  const bool mpi_distribute = !omp_in_parallel() && Polyquant_mpi_size() > 1;
+  const int mpi_rank = mpi_distribute ? Polyquant_mpi_rank() : 0;
+  const int mpi_size = mpi_distribute ? Polyquant_mpi_size() : 1;
+  const int mo_a_start = (num_mo_a * mpi_rank) / mpi_size;
+  const int mo_a_end = (num_mo_a * (mpi_rank + 1)) / mpi_size;
+  const int num_mo_a_local = mo_a_end - mo_a_start;
   for (int i = 0; i < nthreads; i++) {
     engines[i] = engines[0];
-    temp_threads[i].resize(num_mo_a * num_ao_a * num_ao_b * num_ao_b);
+    temp_threads[i].resize(num_mo_a_local * num_ao_a * num_ao_b * num_ao_b);
     temp_threads[i].setZero();
   }
 #pragma omp parallel
   {
     auto thread_id = omp_get_thread_num();
+    auto worker_id = thread_id;
+    auto num_workers = nthreads;
     auto shell_counter = 0;
 
     for (size_t i = 0; i < num_shell_a; i++) {
       auto shell_i_bf_start = shell2bf_a[i];
       auto shell_i_bf_size = this->input_basis->basis[quantum_part_a_idx][i].size();
+      // MOs of this shell's index range that are in this rank's block
+      auto shell_i_mo_start = std::max<int>(shell_i_bf_start, mo_a_start + frozen_core[quantum_part_a_idx]);
+      auto shell_i_mo_end = std::min<int>(shell_i_bf_start + shell_i_bf_size, mo_a_end + frozen_core[quantum_part_a_idx]);
+      if (shell_i_mo_start >= shell_i_mo_end) {
+        continue;
+      }
       for (size_t q = 0; q < num_shell_a; q++) {
         auto shell_q_bf_start = shell2bf_a[q];
         auto shell_q_bf_size = this->input_basis->basis[quantum_part_a_idx][q].size();
@@ -268,7 +414,7 @@ Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> POLYQUANT_INTEGRAL::transf
             auto shell_s_bf_start = shell2bf_b[s];
             auto shell_s_bf_size = this->input_basis->basis[quantum_part_b_idx][s].size();
             shell_counter++;
-            if (shell_counter % nthreads != thread_id) {
+            if (shell_counter % num_workers != worker_id) {
               continue;
             }
             for (size_t p = 0; p < num_shell_a; p++) {
@@ -285,14 +431,14 @@ Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> POLYQUANT_INTEGRAL::transf
                       auto eri_pqrs = buf_1234[shell_pqrs_bf];
                       shell_pqrs_bf++;
                       if (eri_pqrs != 0.0) {
-                        for (auto shell_i_bf = shell_i_bf_start; shell_i_bf < shell_i_bf_start + shell_i_bf_size; ++shell_i_bf) {
+                        for (auto shell_i_bf = shell_i_mo_start; shell_i_bf < shell_i_mo_end; ++shell_i_bf) {
                           if (shell_i_bf >= frozen_core[quantum_part_a_idx] && shell_i_bf < (mo_coeffs_a.cols() - deleted_virtual[quantum_part_a_idx])) {
                             auto C_pi = mo_coeffs_a(shell_p_bf, shell_i_bf);
                             if (C_pi != 0.0) {
                               auto val = C_pi * eri_pqrs;
                               // temp1(shell_i_bf - frozen_core[quantum_part_a_idx], shell_q_bf, shell_r_bf, shell_s_bf) += mo_coeffs_a(shell_p_bf, shell_i_bf) * eri_pqrs;
-                              // num_mo_a * num_shell_a * num_shell_b * num_shell_b
-                              auto idx1 = (shell_i_bf - frozen_core[quantum_part_a_idx]) * num_ao_a * num_ao_b * num_ao_b;
+                              // num_mo_a_local * num_shell_a * num_shell_b * num_shell_b
+                              auto idx1 = (shell_i_bf - frozen_core[quantum_part_a_idx] - mo_a_start) * num_ao_a * num_ao_b * num_ao_b;
                               idx1 += shell_q_bf * num_ao_b * num_ao_b;
                               idx1 += shell_r_bf * num_ao_b;
                               idx1 += shell_s_bf;
@@ -311,11 +457,11 @@ Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> POLYQUANT_INTEGRAL::transf
       }
     }
   }
-  temp.resize(num_mo_a * num_ao_a * num_ao_b * num_ao_b);
+  temp.resize(num_mo_a_local * num_ao_a * num_ao_b * num_ao_b);
   temp.setZero();
   for (int thread_id = 0; thread_id < nthreads; thread_id++) {
     temp += temp_threads[thread_id];
-    temp_threads[thread_id].resize(num_mo_a * num_mo_a * num_ao_b * num_ao_b);
+    temp_threads[thread_id].resize(num_mo_a_local * num_mo_a * num_ao_b * num_ao_b);
     temp_threads[thread_id].setZero();
   }
 // temp2.resize(num_mo_a * num_mo_a * num_ao_b * num_ao_b);
@@ -327,13 +473,15 @@ Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> POLYQUANT_INTEGRAL::transf
     auto fn_counter = 0;
     int nthreads = omp_get_num_threads();
     auto thread_id = omp_get_thread_num();
-    for (auto i = 0; i < num_mo_a; i++) {
+    auto worker_id = thread_id;
+    auto num_workers = nthreads;
+    for (auto i = 0; i < num_mo_a_local; i++) {
       for (auto j = 0; j < num_mo_a; j++) {
         for (auto r = 0; r < num_ao_b; r++) {
           for (auto s = 0; s < num_ao_b; s++) {
             double elem = 0.0;
             fn_counter++;
-            if (fn_counter % nthreads != thread_id)
+            if (fn_counter % num_workers != worker_id)
               continue;
             // for (auto q = 0; q < num_ao_a; q++) {
             //   auto idx1 = i * num_ao_a * num_ao_b * num_ao_b;
@@ -363,11 +511,11 @@ Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> POLYQUANT_INTEGRAL::transf
       }
     }
   }
-  temp.resize(num_mo_a * num_mo_a * num_ao_b * num_ao_b);
+  temp.resize(num_mo_a_local * num_mo_a * num_ao_b * num_ao_b);
   temp.setZero();
   for (int thread_id = 0; thread_id < nthreads; thread_id++) {
     temp += temp_threads[thread_id];
-    temp_threads[thread_id].resize(num_mo_a * num_mo_a * num_mo_b * num_ao_b);
+    temp_threads[thread_id].resize(num_mo_a_local * num_mo_a * num_mo_b * num_ao_b);
     temp_threads[thread_id].setZero();
   }
 // temp1.resize(0);
@@ -382,13 +530,15 @@ Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> POLYQUANT_INTEGRAL::transf
     auto fn_counter = 0;
     int nthreads = omp_get_num_threads();
     auto thread_id = omp_get_thread_num();
-    for (auto i = 0; i < num_mo_a; i++) {
+    auto worker_id = thread_id;
+    auto num_workers = nthreads;
+    for (auto i = 0; i < num_mo_a_local; i++) {
       for (auto j = 0; j < num_mo_a; j++) {
         for (auto k = 0; k < num_mo_b; k++) {
           for (auto s = 0; s < num_ao_b; s++) {
             double elem = 0.0;
             fn_counter++;
-            if (fn_counter % nthreads != thread_id)
+            if (fn_counter % num_workers != worker_id)
               continue;
             // for (auto r = 0; r < num_ao_b; r++) {
             //   auto idx2 = i * num_mo_a * num_ao_b * num_ao_b;
@@ -419,7 +569,7 @@ Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> POLYQUANT_INTEGRAL::transf
       }
     }
   }
-  temp.resize(num_mo_a * num_mo_a * num_mo_b * num_ao_b);
+  temp.resize(num_mo_a_local * num_mo_a * num_mo_b * num_ao_b);
   temp.setZero();
   for (int thread_id = 0; thread_id < nthreads; thread_id++) {
     temp += temp_threads[thread_id];
@@ -437,13 +587,15 @@ Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> POLYQUANT_INTEGRAL::transf
     auto fn_counter = 0;
     int nthreads = omp_get_num_threads();
     auto thread_id = omp_get_thread_num();
-    for (auto i = 0; i < num_mo_a; i++) {
-      for (auto j = i; j < num_mo_a; j++) {
+    auto worker_id = thread_id;
+    auto num_workers = nthreads;
+    for (auto i = 0; i < num_mo_a_local; i++) {
+      for (auto j = i + mo_a_start; j < num_mo_a; j++) {
         for (auto k = 0; k < num_mo_b; k++) {
           for (auto l = k; l < num_mo_b; l++) {
             double elem = 0.0;
             fn_counter++;
-            if (fn_counter % nthreads != thread_id)
+            if (fn_counter % num_workers != worker_id)
               continue;
             // for (auto s = 0; s < num_ao_b; s++) {
             //   auto idx3 = i * num_mo_a * num_mo_b * num_ao_b;
@@ -460,7 +612,8 @@ Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> POLYQUANT_INTEGRAL::transf
             offset += k * num_ao_b;
             auto stride = 1;
             // eri(this->idx2(i, j), this->idx2(k, l)) = mo_coeffs_b(Eigen::seqN(0, num_ao_b), l + frozen_core[quantum_part_b_idx]).dot(temp3(Eigen::seqN(offset, num_ao_b, stride)));
-            eri_threads[thread_id](this->idx2(i, j), this->idx2(k, l)) = mo_coeffs_b(Eigen::seqN(0, num_ao_b), l + frozen_core[quantum_part_b_idx]).dot(temp(Eigen::seqN(offset, num_ao_b, stride)));
+            eri_threads[thread_id](this->idx2(i + mo_a_start, j), this->idx2(k, l)) =
+                mo_coeffs_b(Eigen::seqN(0, num_ao_b), l + frozen_core[quantum_part_b_idx]).dot(temp(Eigen::seqN(offset, num_ao_b, stride)));
           }
         }
       }
@@ -472,6 +625,10 @@ Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> POLYQUANT_INTEGRAL::transf
     eri += eri_threads[thread_id];
     eri_threads[thread_id].resize(0, 0);
   }
+  // gather the rank blocks, each (ij|kl) row is only nonzero on the rank that owns i
+  if (mpi_distribute) {
+    Polyquant_mpi_allreduce_sum(eri);
+  }
   libint2::finalize();
   return eri;
 }
@@ -887,6 +1044,43 @@ void POLYQUANT_INTEGRAL::compute_1body_ints(Eigen::Matrix<double, Eigen::Dynamic
     }
   }
 }
+void POLYQUANT_INTEGRAL::compute_1body_ints_mixed_basis(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &output_matrix, const libint2::BasisSet &shells_a,
+                                                        const libint2::BasisSet &shells_b, libint2::Operator obtype) {
+  output_matrix.setZero(shells_a.nbf(), shells_b.nbf());
+#pragma omp parallel
+  {
+    int nthreads = omp_get_num_threads();
+    auto thread_id = omp_get_thread_num();
+    // the engine has to be able to handle the shells of both basis sets
+    libint2::Engine engine(obtype, std::max(shells_a.max_nprim(), shells_b.max_nprim()), std::max(shells_a.max_l(), shells_b.max_l()), 0);
+    auto shell2bf_a = shells_a.shell2bf();
+    auto shell2bf_b = shells_b.shell2bf();
+    const auto &buf = engine.results();
+    // no permutational symmetry between two different basis sets
+    for (auto s1 = 0l; s1 < shells_a.size(); ++s1) {
+      if (s1 % nthreads != thread_id) {
+        continue;
+      }
+      auto bf1 = shell2bf_a[s1];
+      auto n1 = shells_a[s1].size();
+      for (auto s2 = 0l; s2 < shells_b.size(); ++s2) {
+        auto bf2 = shell2bf_b[s2];
+        auto n2 = shells_b[s2].size();
+        engine.compute(shells_a[s1], shells_b[s2]);
+        const auto *buf_12 = buf[0];
+        if (buf_12 == nullptr) {
+          continue;
+        }
+        for (size_t f1 = 0, f12 = 0; f1 != n1; ++f1) {
+          for (size_t f2 = 0; f2 != n2; ++f2, ++f12) {
+            output_matrix(bf1 + f1, bf2 + f2) = buf_12[f12];
+          }
+        }
+      }
+    }
+  }
+}
+
 /**
  * @details This follows the HF test in the Libint2 repo. It constructs the
  * integral engines and splits up the calculation of integrals on each OpenMP
@@ -45,6 +45,19 @@ public:
   void calculate_kinetic();
   void calculate_nuclear();
   void calculate_polarization_potential();
+  /**
+   * @brief Calculate the density fitting factors ri_B for every particle with an auxiliary basis
+   *
+   */
+  void calculate_density_fitting();
+  /**
+   * @brief Two center coulomb metric (P|Q) of an auxiliary basis
+   */
+  void compute_density_fitting_metric(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &output_matrix, const libint2::BasisSet &aux_shells);
+  /**
+   * @brief Three center coulomb integrals (P|ij) stored as output_matrix(i * nbf + j, P)
+   */
+  void compute_density_fitting_three_center(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &output_matrix, const libint2::BasisSet &aux_shells, const libint2::BasisSet &shells);
   //  void calculate_two_electron();
   std::pair<std::vector<size_t>, std::vector<size_t>> make_sorted_ijkl_idx(const size_t &quantum_part_a_idx, const size_t &quantum_part_b_idx, const size_t &i, const size_t &j, const size_t &k,
                                                                            const size_t &l);
@@ -99,6 +112,17 @@ public:
   void compute_1body_ints(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &output_matrix, const libint2::BasisSet &shells, libint2::Operator obtype,
                           const std::vector<std::pair<double, std::array<double, 3>>> &atoms = std::vector<std::pair<double, std::array<double, 3>>>());
 
+  /**
+   * @brief Calculate one body integrals between two different basis sets
+   *
+   * @param output_matrix the matrix to hold the one body ints (rows in shells_a, columns in shells_b)
+   * @param shells_a the bra basis set
+   * @param shells_b the ket basis set
+   * @param obtype the operator to calculate the integrals for
+   */
+  void compute_1body_ints_mixed_basis(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &output_matrix, const libint2::BasisSet &shells_a, const libint2::BasisSet &shells_b,
+                                      libint2::Operator obtype);
+
   /**
    * @brief Calculate Schwarz integrals (diagonal 2 body ints)
    *
@@ -174,6 +198,18 @@ public:
    *
    */
   std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> Schwarz;
+  /**
+   * @brief Density fitting factors (ij_a|P_b) (P|Q)^-1/2 in the auxiliary basis of particle b, stored as (i * nbf_a + j, Q)
+   *
+   * indexes: aux particle b, orbital particle a
+   *
+   */
+  std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> ri_B;
+  /**
+   * @brief Eigenvalues of the coulomb metric below this (relative to the largest) are dropped
+   *
+   */
+  double density_fitting_metric_threshold = 1e-10;
   /**
    * @brief Frozen core effective one body integrals
    *
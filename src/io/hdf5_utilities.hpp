@@ -61,6 +61,7 @@ public:
   std::string filename;
 
   template <typename T> void load_data(T &output, std::string path) { output = H5Easy::load<T>(*hdf5_file, path); }
+  template <typename T> void dump_data(const T &input, std::string path) { H5Easy::dump(*hdf5_file, path, input, H5Easy::DumpMode::Overwrite); }
 
   bool exist(std::string path) { return hdf5_file->exist(path); }
   void write_str(std::string path, std::string val);
@@ -0,0 +1,191 @@
+#ifndef POLYQUANT_MPI_UTILITIES_H
+#define POLYQUANT_MPI_UTILITIES_H
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#ifdef POLYQUANT_WITH_MPI
+#include <mpi.h>
+#endif
+
+namespace polyquant {
+
+/**
+ * @brief RAII owner of the MPI environment. Constructed once in main, it initializes MPI on construction and finalizes it on destruction.
+ * Without POLYQUANT_WITH_MPI it does nothing.
+ */
+class POLYQUANT_MPI_ENVIRONMENT {
+public:
+  POLYQUANT_MPI_ENVIRONMENT(int &argc, char **&argv) {
+#ifdef POLYQUANT_WITH_MPI
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+#endif
+  };
+  ~POLYQUANT_MPI_ENVIRONMENT() {
+#ifdef POLYQUANT_WITH_MPI
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (!finalized) {
+      MPI_Finalize();
+    }
+#endif
+  };
+  POLYQUANT_MPI_ENVIRONMENT(const POLYQUANT_MPI_ENVIRONMENT &) = delete;
+  POLYQUANT_MPI_ENVIRONMENT &operator=(const POLYQUANT_MPI_ENVIRONMENT &) = delete;
+};
+
+/**
+ * @brief Whether MPI has been initialized and not yet finalized. When false every helper below behaves as a single rank run.
+ */
+inline bool Polyquant_mpi_active() {
+#ifdef POLYQUANT_WITH_MPI
+  int initialized, finalized;
+  MPI_Initialized(&initialized);
+  MPI_Finalized(&finalized);
+  return initialized && !finalized;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Rank of this process in MPI_COMM_WORLD, 0 when running without MPI.
+ */
+inline int Polyquant_mpi_rank() {
+  int rank = 0;
+#ifdef POLYQUANT_WITH_MPI
+  if (Polyquant_mpi_active()) {
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  }
+#endif
+  return rank;
+}
+
+/**
+ * @brief Number of ranks in MPI_COMM_WORLD, 1 when running without MPI.
+ */
+inline int Polyquant_mpi_size() {
+  int size = 1;
+#ifdef POLYQUANT_WITH_MPI
+  if (Polyquant_mpi_active()) {
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+  }
+#endif
+  return size;
+}
+
+/**
+ * @brief In place sum of a dense double buffer over all ranks. Must be called by every rank with buffers of the same size, and only
+ * from outside of OpenMP parallel regions.
+ *
+ * @param data the buffer to reduce
+ * @param count the number of doubles in the buffer
+ */
+inline void Polyquant_mpi_allreduce_sum(double *data, size_t count) {
+#ifdef POLYQUANT_WITH_MPI
+  if (Polyquant_mpi_size() > 1) {
+    // MPI counts are ints so large buffers are reduced in chunks
+    const size_t max_chunk = static_cast<size_t>(std::numeric_limits<int>::max());
+    for (size_t offset = 0; offset < count; offset += max_chunk) {
+      auto chunk = std::min(max_chunk, count - offset);
+      MPI_Allreduce(MPI_IN_PLACE, data + offset, static_cast<int>(chunk), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    }
+  }
+#endif
+}
+
+/**
+ * @brief In place sum of a dense Eigen matrix or vector over all ranks.
+ *
+ * @param mat the matrix to reduce
+ */
+template <typename Derived> void Polyquant_mpi_allreduce_sum(Eigen::PlainObjectBase<Derived> &mat) { Polyquant_mpi_allreduce_sum(mat.data(), static_cast<size_t>(mat.size())); }
+
+/**
+ * @brief Copy a raw buffer from rank 0 to every other rank. Must be called by every rank with buffers of the same size, and only from
+ * outside of OpenMP parallel regions.
+ *
+ * @param data the buffer, read on rank 0 and overwritten on the others
+ * @param num_bytes the size of the buffer in bytes
+ */
+inline void Polyquant_mpi_broadcast(void *data, size_t num_bytes) {
+#ifdef POLYQUANT_WITH_MPI
+  if (Polyquant_mpi_size() > 1) {
+    // MPI counts are ints so large buffers are sent in chunks
+    const size_t max_chunk = static_cast<size_t>(std::numeric_limits<int>::max());
+    auto bytes = static_cast<char *>(data);
+    for (size_t offset = 0; offset < num_bytes; offset += max_chunk) {
+      auto chunk = std::min(max_chunk, num_bytes - offset);
+      MPI_Bcast(bytes + offset, static_cast<int>(chunk), MPI_BYTE, 0, MPI_COMM_WORLD);
+    }
+  }
+#endif
+}
+
+// declared up front so the container overloads find each other for nested types
+template <typename T>
+  requires std::is_arithmetic_v<T>
+void Polyquant_mpi_broadcast(T &value);
+template <typename Derived> void Polyquant_mpi_broadcast(Eigen::PlainObjectBase<Derived> &mat);
+template <typename T1, typename T2> void Polyquant_mpi_broadcast(std::pair<T1, T2> &value);
+template <typename T> void Polyquant_mpi_broadcast(std::vector<T> &values);
+template <typename T> void Polyquant_mpi_broadcast(std::deque<T> &values);
+
+/**
+ * @brief Copy a number from rank 0 to every other rank.
+ */
+template <typename T>
+  requires std::is_arithmetic_v<T>
+void Polyquant_mpi_broadcast(T &value) {
+  Polyquant_mpi_broadcast(static_cast<void *>(&value), sizeof(T));
+}
+
+/**
+ * @brief Copy a dense Eigen matrix or vector from rank 0 to every other rank, resizing it to rank 0's shape.
+ */
+template <typename Derived> void Polyquant_mpi_broadcast(Eigen::PlainObjectBase<Derived> &mat) {
+  std::int64_t rows = mat.rows();
+  std::int64_t cols = mat.cols();
+  Polyquant_mpi_broadcast(rows);
+  Polyquant_mpi_broadcast(cols);
+  mat.resize(rows, cols);
+  Polyquant_mpi_broadcast(static_cast<void *>(mat.data()), static_cast<size_t>(mat.size()) * sizeof(typename Derived::Scalar));
+}
+
+template <typename T1, typename T2> void Polyquant_mpi_broadcast(std::pair<T1, T2> &value) {
+  Polyquant_mpi_broadcast(value.first);
+  Polyquant_mpi_broadcast(value.second);
+}
+
+/**
+ * @brief Copy a vector, possibly nested, from rank 0 to every other rank, resizing it to rank 0's size.
+ */
+template <typename T> void Polyquant_mpi_broadcast(std::vector<T> &values) {
+  std::int64_t num_values = values.size();
+  Polyquant_mpi_broadcast(num_values);
+  values.resize(num_values);
+  if constexpr (std::is_arithmetic_v<T>) {
+    Polyquant_mpi_broadcast(static_cast<void *>(values.data()), values.size() * sizeof(T));
+  } else {
+    for (auto &value : values) {
+      Polyquant_mpi_broadcast(value);
+    }
+  }
+}
+
+template <typename T> void Polyquant_mpi_broadcast(std::deque<T> &values) {
+  std::int64_t num_values = values.size();
+  Polyquant_mpi_broadcast(num_values);
+  values.resize(num_values);
+  for (auto &value : values) {
+    Polyquant_mpi_broadcast(value);
+  }
+}
+
+} // namespace polyquant
+#endif
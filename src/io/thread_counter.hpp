@@ -0,0 +1,42 @@
+#ifndef POLYQUANT_THREAD_COUNTER_H
+#define POLYQUANT_THREAD_COUNTER_H
+#include <atomic>
+#include <cstddef>
+#include <omp.h>
+#include <vector>
+
+namespace polyquant {
+
+/**
+ * @brief Event counter that OpenMP threads can bump without contention or false sharing. Every thread increments its own cache line
+ * sized slot with a relaxed atomic add and total() sums the slots, so it is only exact once the parallel region that counted has
+ * finished. Threads beyond the slots sized at construction (a larger team or nested regions) share slots, which the atomic add
+ * keeps correct.
+ */
+class POLYQUANT_THREAD_COUNTER {
+public:
+  POLYQUANT_THREAD_COUNTER() : slots(omp_get_max_threads()) {}
+
+  void increment() { std::atomic_ref<std::size_t>(this->slots[omp_get_thread_num() % this->slots.size()].value).fetch_add(1, std::memory_order_relaxed); }
+  std::size_t total() const {
+    std::size_t sum = 0;
+    for (auto &slot : this->slots) {
+      sum += std::atomic_ref<std::size_t>(slot.value).load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+  void reset() {
+    for (auto &slot : this->slots) {
+      std::atomic_ref<std::size_t>(slot.value).store(0, std::memory_order_relaxed);
+    }
+  }
+
+private:
+  struct alignas(64) POLYQUANT_COUNTER_SLOT {
+    alignas(std::atomic_ref<std::size_t>::required_alignment) std::size_t value = 0;
+  };
+  mutable std::vector<POLYQUANT_COUNTER_SLOT> slots;
+};
+
+} // namespace polyquant
+#endif
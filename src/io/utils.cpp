@@ -8,9 +8,15 @@ namespace polyquant {
 void APP_ABORT(const std::string &reason) {
   std::vector<std::string> ERROR_MESSAGE = {"THIS IS A POLYQUANT ERROR. PLEASE REPORT TO POLYQUANT MAINTAINERS.", "    ABORT REASON:"};
   ERROR_MESSAGE.push_back(reason);
+  // print from every rank, the failing rank may not be rank 0
   for (auto line : ERROR_MESSAGE) {
-    Polyquant_cout(line);
+    std::cout << line << std::endl;
+  }
+#ifdef POLYQUANT_WITH_MPI
+  if (Polyquant_mpi_size() > 1) {
+    MPI_Abort(MPI_COMM_WORLD, 1);
   }
+#endif
   exit(1);
 }
 
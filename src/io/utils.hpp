@@ -1,5 +1,6 @@
 #ifndef POLYQUANT_INPUTUTILS_H
 #define POLYQUANT_INPUTUTILS_H
+#include "io/mpi_utilities.hpp"
 #include <Eigen/Dense>
 #include <Eigen/Eigen>
 #include <algorithm>
@@ -11,6 +12,7 @@
 #include <iostream>
 #include <libint2.hpp>       // IWYU pragma: keep
 #include <nlohmann/json.hpp> // IWYU pragma: keep
+#include <span>
 #include <string>
 #include <vector>
 // TODO switch to #include <format> once it is supported
@@ -36,7 +38,11 @@ void APP_WARN(const std::string &reason);
  * @tparam T the type of the thing to print out
  * @param message
  */
-template <typename T> void Polyquant_cout(const T &message) { std::cout << std::setprecision(20) << message << std::endl; }
+template <typename T> void Polyquant_cout(const T &message) {
+  if (Polyquant_mpi_rank() == 0) {
+    std::cout << std::setprecision(20) << message << std::endl;
+  }
+}
 
 template <typename T> void Polyquant_section_header(const T &message) {
   fmt::print("\n{0:^{2}}┌{0:─^{3}}┐\n"
@@ -322,7 +328,9 @@ template <typename T> struct PairVectorHash {
   }
 };
 template <typename T> struct VectorHash {
-  size_t operator()(const std::vector<T> &v) const {
+  // transparent so unordered containers keyed on vectors can be searched with a span without building a key vector
+  using is_transparent = void;
+  size_t operator()(std::span<const T> v) const {
     std::hash<T> hasher;
     size_t seed = 0;
     for (T i : v) {
@@ -330,6 +338,11 @@ template <typename T> struct VectorHash {
     }
     return seed;
   }
+  size_t operator()(const std::vector<T> &v) const { return (*this)(std::span<const T>(v)); }
+};
+template <typename T> struct VectorEqual {
+  using is_transparent = void;
+  bool operator()(std::span<const T> a, std::span<const T> b) const { return std::equal(a.begin(), a.end(), b.begin(), b.end()); }
 };
 template <typename T> struct PairHash {
   size_t operator()(const std::pair<T, T> &v) const {
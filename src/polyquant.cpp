@@ -15,12 +15,14 @@
 #include <Eigen/Core>
 #include <calculation/calculation.hpp>
 #include <cxxopts.hpp>
+#include <io/mpi_utilities.hpp>
 #include <io/utils.hpp>
 #include <string>
 
 using namespace polyquant;
 
 int main(int argc, char **argv) {
+  POLYQUANT_MPI_ENVIRONMENT mpi_environment(argc, argv);
   Eigen::initParallel();
   cxxopts::Options options("polyquant", "polyquant -- A software package for nonrelativistically treating multiple interacting quantum species.");
   options.add_options()("i,input", "input filename", cxxopts::value<std::string>())("h,help", "Print usage");
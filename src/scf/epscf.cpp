@@ -1,4 +1,13 @@
 #include "scf/epscf.hpp"
+// same LAPACKE complex types as polyquant.cpp
+#include <complex>
+#ifndef lapack_complex_float
+#define lapack_complex_float std::complex<float>
+#endif
+#ifndef lapack_complex_double
+#define lapack_complex_double std::complex<double>
+#endif
+#include <lapacke.h>
 
 using namespace polyquant;
 
@@ -118,7 +127,7 @@ void POLYQUANT_EPSCF::form_fock_helper_single_fock_matrix(Eigen::Matrix<double,
                                                           const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm,
                                                           const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm_last, const QUANTUM_PARTICLE_SET &quantum_part_a,
                                                           const int quantum_part_a_idx, const int quantum_part_a_spin_idx, const QUANTUM_PARTICLE_SET &quantum_part_b, const int quantum_part_b_idx,
-                                                          const int quantum_part_b_spin_idx) {
+                                                          const int quantum_part_b_spin_idx, const int num_threads, const bool do_coulomb, const bool rank_local) {
   auto shells_a = this->input_basis->basis[quantum_part_a_idx];
   auto num_shell_a = this->input_basis->basis[quantum_part_a_idx].size();
   auto shell2bf_a = this->input_basis->basis[quantum_part_a_idx].shell2bf();
@@ -127,7 +136,7 @@ void POLYQUANT_EPSCF::form_fock_helper_single_fock_matrix(Eigen::Matrix<double,
   auto shell2bf_b = this->input_basis->basis[quantum_part_b_idx].shell2bf();
 
   // loop over shells
-  auto nthreads = omp_get_max_threads();
+  auto nthreads = (num_threads > 0) ? num_threads : omp_get_max_threads();
   std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> FA;
   auto max_nprim = shells_a.max_nprim() > shells_b.max_nprim() ? shells_a.max_nprim() : shells_b.max_nprim();
   auto max_l = shells_a.max_l() > shells_b.max_l() ? shells_a.max_l() : shells_b.max_l();
@@ -146,10 +155,22 @@ void POLYQUANT_EPSCF::form_fock_helper_single_fock_matrix(Eigen::Matrix<double,
     FA[i].resizeLike(fock);
     FA[i].setZero();
   }
-#pragma omp parallel
+  // quartets are split over ranks x threads. rank_local builds (the initial guess, and the independent fock builds whose tasks are
+  // already dealt out over the ranks) and calls from inside a parallel region are not distributed, so that no rank waits on a
+  // collective another rank never reaches
+  const bool mpi_distribute = !rank_local && !omp_in_parallel() && Polyquant_mpi_size() > 1;
+  const int mpi_rank = mpi_distribute ? Polyquant_mpi_rank() : 0;
+  const int mpi_size = mpi_distribute ? Polyquant_mpi_size() : 1;
+#pragma omp parallel num_threads(nthreads)
   {
     int shellcounter = 0;
     auto thread_id = omp_get_thread_num();
+    // the team can be smaller than requested (e.g. nested regions)
+    auto team_size = omp_get_num_threads();
+    auto worker_id = mpi_rank * team_size + thread_id;
+    auto num_workers = mpi_size * team_size;
+    size_t quartets_computed = 0;
+    size_t quartets_screened = 0;
     for (size_t shell_i = 0; shell_i < num_shell_a; shell_i++) {
       auto shell_i_bf_start = shell2bf_a[shell_i];
       auto shell_i_bf_size = shells_a[shell_i].size();
@@ -179,9 +200,17 @@ void POLYQUANT_EPSCF::form_fock_helper_single_fock_matrix(Eigen::Matrix<double,
             shellcounter++;
             // const auto *shellpairdata_kl = shellpairdata_kl_iter->get();
             // shellpairdata_kl_iter++;
-            if (shellcounter % nthreads != thread_id) {
+            if (shellcounter % num_workers != worker_id) {
               continue;
             }
+            auto shell_ijkl_petite_deg = 1.0;
+            if (this->petite_list_active) {
+              shell_ijkl_petite_deg = this->petite_list_quartet_degeneracy(quantum_part_a_idx, shell_i, shell_j, quantum_part_b_idx, shell_k, shell_l);
+              if (shell_ijkl_petite_deg == 0.0) {
+                quartets_screened++;
+                continue;
+              }
+            }
             auto shell_l_bf_start = shell2bf_b[shell_l];
             auto shell_l_bf_size = shells_b[shell_l].size();
             // auto D_shell_kl_norm = directscf_get_shell_density_norm_coulomb(dm, dm_last, quantum_part_a, quantum_part_a_idx, quantum_part_a_spin_idx, quantum_part_b, quantum_part_b_idx,
@@ -212,7 +241,7 @@ void POLYQUANT_EPSCF::form_fock_helper_single_fock_matrix(Eigen::Matrix<double,
             // instead of 8
             const auto shell_ij_perdeg = (shell_i == shell_j) ? 1.0 : 2.0;
             const auto shell_kl_perdeg = (shell_k == shell_l) ? 1.0 : 2.0;
-            auto shell_ijkl_perdeg = shell_ij_perdeg * shell_kl_perdeg;
+            auto shell_ijkl_perdeg = shell_ij_perdeg * shell_kl_perdeg * shell_ijkl_petite_deg;
             const auto &buf = engines[thread_id].results();
             // if (this->Cauchy_Schwarz_screening) { //&& this->Cauchy_Schwarz_threshold[quantum_part_a_idx] > 1e-10) {
             //   engines[thread_id].set_precision(D_norm != 0.0 ? this->Cauchy_Schwarz_threshold[quantum_part_a_idx] / D_norm : this->Cauchy_Schwarz_threshold[quantum_part_a_idx]);
@@ -221,6 +250,7 @@ void POLYQUANT_EPSCF::form_fock_helper_single_fock_matrix(Eigen::Matrix<double,
             // } else {
             // engines[thread_id].set_precision(0.0); // D_norm != 0.0 ? this->Cauchy_Schwarz_threshold[quantum_part_a_idx] / D_norm : this->Cauchy_Schwarz_threshold[quantum_part_a_idx]);
             engines[thread_id].compute(shells_a[shell_i], shells_a[shell_j], shells_b[shell_k], shells_b[shell_l]);
+            quartets_computed++;
             //}
             // engines[thread_id].compute(shells_a[shell_i], shells_a[shell_j], shells_b[shell_k], shells_b[shell_l]);
             const auto *buf_1234 = buf[0];
@@ -232,12 +262,14 @@ void POLYQUANT_EPSCF::form_fock_helper_single_fock_matrix(Eigen::Matrix<double,
                     for (auto shell_l_bf = shell_l_bf_start; shell_l_bf < shell_l_bf_start + shell_l_bf_size; ++shell_l_bf) {
                       auto eri_ijkl = buf_1234[shell_ijkl_bf];
                       shell_ijkl_bf++;
-                      auto D_kl = this->directscf_get_density_coulomb(dm, dm_last, quantum_part_a, quantum_part_a_idx, quantum_part_a_spin_idx, quantum_part_b, quantum_part_b_idx,
-                                                                      quantum_part_b_spin_idx, shell_k_bf, shell_l_bf);
-                      const auto spinscale = (quantum_part_a_idx == quantum_part_b_idx && quantum_part_b.restricted == false && quantum_part_b.num_parts > 1) ? 0.5 : 1.0;
-                      const auto scaleall = (quantum_part_a_idx == quantum_part_b_idx) ? 0.5 * spinscale : 0.5 * quantum_part_a.charge * quantum_part_b.charge * spinscale;
-                      FA[thread_id](shell_i_bf, shell_j_bf) += scaleall * shell_ijkl_perdeg * D_kl * eri_ijkl;
-                      FA[thread_id](shell_j_bf, shell_i_bf) += scaleall * shell_ijkl_perdeg * D_kl * eri_ijkl;
+                      if (do_coulomb) {
+                        auto D_kl = this->directscf_get_density_coulomb(dm, dm_last, quantum_part_a, quantum_part_a_idx, quantum_part_a_spin_idx, quantum_part_b, quantum_part_b_idx,
+                                                                        quantum_part_b_spin_idx, shell_k_bf, shell_l_bf);
+                        const auto spinscale = (quantum_part_a_idx == quantum_part_b_idx && quantum_part_b.restricted == false && quantum_part_b.num_parts > 1) ? 0.5 : 1.0;
+                        const auto scaleall = (quantum_part_a_idx == quantum_part_b_idx) ? 0.5 * spinscale : 0.5 * quantum_part_a.charge * quantum_part_b.charge * spinscale;
+                        FA[thread_id](shell_i_bf, shell_j_bf) += scaleall * shell_ijkl_perdeg * D_kl * eri_ijkl;
+                        FA[thread_id](shell_j_bf, shell_i_bf) += scaleall * shell_ijkl_perdeg * D_kl * eri_ijkl;
+                      }
                       // FB[thread_id](shell_k_bf, shell_l_bf) += scaleall * shell_ijkl_perdeg * D_ij * eri_ijkl;
                       // FB[thread_id](shell_l_bf, shell_k_bf) += scaleall * shell_ijkl_perdeg * D_ij * eri_ijkl;
                       // exchange terms
@@ -265,18 +297,898 @@ void POLYQUANT_EPSCF::form_fock_helper_single_fock_matrix(Eigen::Matrix<double,
         }
       }
     }
+#pragma omp atomic
+    this->telemetry_quartets_computed += quartets_computed;
+#pragma omp atomic
+    this->telemetry_quartets_screened += quartets_screened;
+  }
+
+  if (this->petite_list_active || mpi_distribute) {
+    for (auto ti = 1; ti < nthreads; ti++) {
+      FA[0] += FA[ti];
+    }
+    if (mpi_distribute) {
+      Polyquant_mpi_allreduce_sum(FA[0]);
+    }
+    if (this->petite_list_active) {
+      this->petite_list_symmetrize(FA[0], quantum_part_a_idx);
+    }
+    fock += FA[0];
+  } else {
+    for (auto ti = 0; ti < nthreads; ti++) {
+      fock += FA[ti];
+    }
+  }
+}
+
+void POLYQUANT_EPSCF::form_petite_list() {
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  this->petite_list_active = false;
+  this->petite_shell_map.clear();
+  this->petite_bf_map.clear();
+  this->petite_bf_sign.clear();
+  if (!this->input_symmetry->do_symmetry || this->input_symmetry->point_group == "C1" || this->input_symmetry->point_group == "SO(3)" || this->input_symmetry->ctx.size() == 0) {
+    APP_WARN("petite_list needs a point group. Computing every shell quartet.");
+    return;
+  }
+  int msopsl = 0;
+  const msym_symmetry_operation_t *msops = NULL;
+  if (MSYM_SUCCESS != msymGetSymmetryOperations(this->input_symmetry->ctx[0], &msopsl, &msops)) {
+    APP_ABORT("Error getting symmetry operations");
+  }
+  // diagonal of the cartesian matrix of each operation
+  std::vector<Eigen::Vector3d> op_diagonals;
+  for (int op_idx = 0; op_idx < msopsl; op_idx++) {
+    const msym_symmetry_operation_t *sop = &msops[op_idx];
+    Eigen::Vector3d v(sop->v[0], sop->v[1], sop->v[2]);
+    if (v.norm() > 0.0) {
+      v.normalize();
+    }
+    Eigen::Matrix3d reflection = Eigen::Matrix3d::Identity() - 2.0 * v * v.transpose();
+    Eigen::Matrix3d op = Eigen::Matrix3d::Identity();
+    double angle = (sop->order != 0) ? 2.0 * M_PI * sop->power / sop->order : 0.0;
+    switch (sop->type) {
+    case _msym_symmetry_operation::MSYM_SYMMETRY_OPERATION_TYPE_INVERSION:
+      op = -Eigen::Matrix3d::Identity();
+      break;
+    case _msym_symmetry_operation::MSYM_SYMMETRY_OPERATION_TYPE_PROPER_ROTATION:
+      op = Eigen::AngleAxisd(angle, v).toRotationMatrix();
+      break;
+    case _msym_symmetry_operation::MSYM_SYMMETRY_OPERATION_TYPE_IMPROPER_ROTATION:
+      op = reflection * Eigen::AngleAxisd(angle, v).toRotationMatrix();
+      break;
+    case _msym_symmetry_operation::MSYM_SYMMETRY_OPERATION_TYPE_REFLECTION:
+      op = reflection;
+      break;
+    default:
+      break;
+    }
+    Eigen::Matrix3d off_diagonal = op;
+    off_diagonal.diagonal().setZero();
+    if (off_diagonal.cwiseAbs().maxCoeff() > 1e-8 || (op.diagonal().cwiseAbs().array() - 1.0).abs().maxCoeff() > 1e-8) {
+      APP_WARN("petite_list only supports point groups whose operations map each basis function onto +- another (D2h and its subgroups). Computing every shell quartet.");
+      return;
+    }
+    op_diagonals.push_back(op.diagonal().array().round().matrix());
+  }
+
+  // which of x, y, z a basis function is odd in. Real solid harmonics ordered m = -l..l, cartesians as libint (xx, xy, xz, yy, yz, zz)
+  auto function_parities = [](const int l, const bool pure) {
+    std::vector<std::array<int, 3>> parities;
+    if (pure) {
+      for (int m = -l; m <= l; m++) {
+        auto abs_m = std::abs(m);
+        if (m > 0) {
+          parities.push_back({m % 2, 0, (l - abs_m) % 2});
+        } else if (m < 0) {
+          parities.push_back({(abs_m - 1) % 2, 1, (l - abs_m) % 2});
+        } else {
+          parities.push_back({0, 0, l % 2});
+        }
+      }
+    } else {
+      for (int i = l; i >= 0; i--) {
+        for (int j = l - i; j >= 0; j--) {
+          parities.push_back({i % 2, j % 2, (l - i - j) % 2});
+        }
+      }
+    }
+    return parities;
+  };
+
+  static constexpr double thresh = 1e-6;
+  auto num_parts = this->input_molecule->quantum_particles.size();
+  auto num_ops = op_diagonals.size();
+  this->petite_shell_map.resize(num_parts);
+  this->petite_bf_map.resize(num_parts);
+  this->petite_bf_sign.resize(num_parts);
+  for (auto quantum_part_idx = 0; quantum_part_idx < num_parts; quantum_part_idx++) {
+    const auto &shells = this->input_basis->basis[quantum_part_idx];
+    auto shell2bf = shells.shell2bf();
+    auto num_basis = this->input_basis->num_basis[quantum_part_idx];
+    // position of each shell among the shells on the same center
+    std::vector<size_t> shell_rank(shells.size(), 0);
+    for (auto shell_i = 0; shell_i < shells.size(); shell_i++) {
+      for (auto shell_j = 0; shell_j < shell_i; shell_j++) {
+        Eigen::Vector3d diff(shells[shell_i].O[0] - shells[shell_j].O[0], shells[shell_i].O[1] - shells[shell_j].O[1], shells[shell_i].O[2] - shells[shell_j].O[2]);
+        if (diff.norm() < thresh) {
+          shell_rank[shell_i]++;
+        }
+      }
+    }
+    this->petite_shell_map[quantum_part_idx].resize(num_ops);
+    this->petite_bf_map[quantum_part_idx].resize(num_ops);
+    this->petite_bf_sign[quantum_part_idx].resize(num_ops);
+    for (auto op_idx = 0; op_idx < num_ops; op_idx++) {
+      const auto &op_diagonal = op_diagonals[op_idx];
+      auto &shell_map = this->petite_shell_map[quantum_part_idx][op_idx];
+      auto &bf_map = this->petite_bf_map[quantum_part_idx][op_idx];
+      auto &bf_sign = this->petite_bf_sign[quantum_part_idx][op_idx];
+      shell_map.resize(shells.size());
+      bf_map.resize(num_basis);
+      bf_sign.resize(num_basis);
+      for (auto shell_i = 0; shell_i < shells.size(); shell_i++) {
+        Eigen::Vector3d image_center(op_diagonal[0] * shells[shell_i].O[0], op_diagonal[1] * shells[shell_i].O[1], op_diagonal[2] * shells[shell_i].O[2]);
+        bool found = false;
+        for (auto shell_j = 0; shell_j < shells.size() && !found; shell_j++) {
+          Eigen::Vector3d diff(shells[shell_j].O[0] - image_center[0], shells[shell_j].O[1] - image_center[1], shells[shell_j].O[2] - image_center[2]);
+          if (diff.norm() < thresh && shell_rank[shell_j] == shell_rank[shell_i]) {
+            found = (shells[shell_j].alpha == shells[shell_i].alpha && shells[shell_j].contr.size() == shells[shell_i].contr.size());
+            for (auto contr_idx = 0; found && contr_idx < shells[shell_i].contr.size(); contr_idx++) {
+              found = shells[shell_j].contr[contr_idx].l == shells[shell_i].contr[contr_idx].l && shells[shell_j].contr[contr_idx].pure == shells[shell_i].contr[contr_idx].pure;
+            }
+            if (!found) {
+              break;
+            }
+            shell_map[shell_i] = shell_j;
+            auto bf_offset = 0;
+            for (const auto &contr : shells[shell_i].contr) {
+              for (const auto &parity : function_parities(contr.l, contr.pure)) {
+                bf_map[shell2bf[shell_i] + bf_offset] = shell2bf[shell_j] + bf_offset;
+                bf_sign[shell2bf[shell_i] + bf_offset] = std::pow(op_diagonal[0], parity[0]) * std::pow(op_diagonal[1], parity[1]) * std::pow(op_diagonal[2], parity[2]);
+                bf_offset++;
+              }
+            }
+          }
+        }
+        if (!found) {
+          APP_WARN("The basis of particle " + std::to_string(quantum_part_idx) + " isn't symmetric under the point group. Computing every shell quartet.");
+          this->petite_shell_map.clear();
+          this->petite_bf_map.clear();
+          this->petite_bf_sign.clear();
+          return;
+        }
+      }
+    }
+  }
+  this->petite_list_active = true;
+  Polyquant_cout("Petite list built for the " + std::to_string(num_ops) + " operations of " + this->input_symmetry->point_group);
+}
+
+double POLYQUANT_EPSCF::petite_list_quartet_degeneracy(const int quantum_part_a_idx, const size_t shell_i, const size_t shell_j, const int quantum_part_b_idx, const size_t shell_k,
+                                                       const size_t shell_l) const {
+  // pairs are stored with the larger shell first, like unique_shell_pairs
+  const std::array<size_t, 4> quartet = {shell_i, shell_j, shell_k, shell_l};
+  // at most 8 operations in D2h
+  std::array<std::array<size_t, 4>, 8> images;
+  auto num_images = 0;
+  for (auto op_idx = 0; op_idx < this->petite_shell_map[quantum_part_a_idx].size(); op_idx++) {
+    const auto &shell_map_a = this->petite_shell_map[quantum_part_a_idx][op_idx];
+    const auto &shell_map_b = this->petite_shell_map[quantum_part_b_idx][op_idx];
+    auto image_i = shell_map_a[shell_i];
+    auto image_j = shell_map_a[shell_j];
+    auto image_k = shell_map_b[shell_k];
+    auto image_l = shell_map_b[shell_l];
+    const std::array<size_t, 4> image = {std::max(image_i, image_j), std::min(image_i, image_j), std::max(image_k, image_l), std::min(image_k, image_l)};
+    if (image < quartet) {
+      return 0.0;
+    }
+    if (std::find(images.begin(), images.begin() + num_images, image) == images.begin() + num_images) {
+      images[num_images] = image;
+      num_images++;
+    }
+  }
+  return static_cast<double>(num_images);
+}
+
+void POLYQUANT_EPSCF::petite_list_symmetrize(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &skeleton, const int quantum_part_idx) const {
+  // F = 1/h sum_g R_g F_skeleton R_g^T, valid because every density here is totally symmetric
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> symmetrized = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(skeleton.rows(), skeleton.cols());
+  auto num_ops = this->petite_bf_map[quantum_part_idx].size();
+  for (auto op_idx = 0; op_idx < num_ops; op_idx++) {
+    const auto &bf_map = this->petite_bf_map[quantum_part_idx][op_idx];
+    const auto &bf_sign = this->petite_bf_sign[quantum_part_idx][op_idx];
+    for (auto nu = 0; nu < skeleton.cols(); nu++) {
+      for (auto mu = 0; mu < skeleton.rows(); mu++) {
+        symmetrized(mu, nu) += bf_sign[mu] * bf_sign[nu] * skeleton(bf_map[mu], bf_map[nu]);
+      }
+    }
+  }
+  skeleton = symmetrized / static_cast<double>(num_ops);
+}
+
+void POLYQUANT_EPSCF::form_fock_helper_coulomb_matrix(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &fock,
+                                                      const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm,
+                                                      const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm_last, const QUANTUM_PARTICLE_SET &quantum_part_a,
+                                                      const int quantum_part_a_idx, const int quantum_part_a_spin_idx, const QUANTUM_PARTICLE_SET &quantum_part_b, const int quantum_part_b_idx,
+                                                      const int num_threads, const bool rank_local) {
+  const auto &shells_a = this->input_basis->basis[quantum_part_a_idx];
+  const auto &shells_b = this->input_basis->basis[quantum_part_b_idx];
+  auto shell2bf_a = shells_a.shell2bf();
+  auto shell2bf_b = shells_b.shell2bf();
+  auto num_basis_b = this->input_basis->num_basis[quantum_part_b_idx];
+  const auto &Schwarz_a = this->input_integral->Schwarz[quantum_part_a_idx];
+  const auto &Schwarz_b = this->input_integral->Schwarz[quantum_part_b_idx];
+
+  // density of b (all spins, or its change for incremental builds) that multiplies each ket
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> D_ket = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(num_basis_b, num_basis_b);
+  auto quantum_part_b_spin_lim = (quantum_part_b.restricted || quantum_part_b.num_parts == 1) ? 1 : 2;
+  for (auto quantum_part_b_spin_idx = 0; quantum_part_b_spin_idx < quantum_part_b_spin_lim; quantum_part_b_spin_idx++) {
+    for (auto k = 0; k < num_basis_b; k++) {
+      for (auto l = 0; l < num_basis_b; l++) {
+        D_ket(k, l) += this->directscf_get_density_coulomb(dm, dm_last, quantum_part_a, quantum_part_a_idx, quantum_part_a_spin_idx, quantum_part_b, quantum_part_b_idx,
+                                                           quantum_part_b_spin_idx, k, l);
+      }
+    }
+  }
+  // contract the density into the ket shell pairs first, sorted by their largest possible contribution
+  struct ket_pair {
+    size_t shell_k;
+    size_t shell_l;
+    size_t pair_idx;
+    double bound;
+    Eigen::Matrix<double, Eigen::Dynamic, 1> D_kl;
+    Eigen::Matrix<double, 10, 1> moments;
+  };
+  std::vector<ket_pair> ket_pairs;
+  size_t ket_pair_idx = 0;
+  for (size_t shell_k = 0; shell_k < shells_b.size(); shell_k++) {
+    auto shell_k_bf_start = shell2bf_b[shell_k];
+    auto shell_k_bf_size = shells_b[shell_k].size();
+    for (auto &shell_l : std::get<0>(this->input_integral->unique_shell_pairs[quantum_part_b_idx])[shell_k]) {
+      auto shell_l_bf_start = shell2bf_b[shell_l];
+      auto shell_l_bf_size = shells_b[shell_l].size();
+      const auto shell_kl_perdeg = (shell_k == shell_l) ? 1.0 : 2.0;
+      ket_pair ket{shell_k, shell_l, ket_pair_idx, 0.0, Eigen::Matrix<double, Eigen::Dynamic, 1>(shell_k_bf_size * shell_l_bf_size), Eigen::Matrix<double, 10, 1>::Zero()};
+      ket_pair_idx++;
+      // same ordering as the libint buffer (k major, l minor)
+      for (auto k = 0; k < shell_k_bf_size; k++) {
+        for (auto l = 0; l < shell_l_bf_size; l++) {
+          ket.D_kl(k * shell_l_bf_size + l) = shell_kl_perdeg * D_ket(shell_k_bf_start + k, shell_l_bf_start + l);
+        }
+      }
+      ket.bound = ket.D_kl.lpNorm<Eigen::Infinity>() * Schwarz_b(shell_k, shell_l);
+      if (this->cfmm) {
+        ket.moments = this->cfmm_pair_moments[quantum_part_b_idx][ket.pair_idx].transpose() * ket.D_kl;
+      }
+      if (ket.bound > 0.0) {
+        ket_pairs.push_back(std::move(ket));
+      }
+    }
+  }
+  std::sort(ket_pairs.begin(), ket_pairs.end(), [](const ket_pair &x, const ket_pair &y) { return x.bound > y.bound; });
+
+  // CFMM: group the kets into boxes, each with the moments of all of its kets about the box center. Kets keep their sorted order within a box.
+  struct ket_box {
+    Eigen::Vector3d center;
+    double radius;
+    Eigen::Matrix<double, 10, 1> moments;
+    std::vector<size_t> kets;
+  };
+  std::vector<ket_box> ket_boxes;
+  if (this->cfmm) {
+    std::map<std::array<long, 3>, size_t> box_index;
+    for (size_t ket_idx = 0; ket_idx < ket_pairs.size(); ket_idx++) {
+      const auto &P_kl = this->cfmm_pair_centers[quantum_part_b_idx][ket_pairs[ket_idx].pair_idx];
+      std::array<long, 3> box_key;
+      for (auto x = 0; x < 3; x++) {
+        box_key[x] = static_cast<long>(std::floor(P_kl[x] / this->cfmm_box_size));
+      }
+      auto [box_it, inserted] = box_index.try_emplace(box_key, ket_boxes.size());
+      if (inserted) {
+        ket_boxes.push_back(ket_box{Eigen::Vector3d::Zero(), 0.0, Eigen::Matrix<double, 10, 1>::Zero(), {}});
+      }
+      ket_boxes[box_it->second].kets.push_back(ket_idx);
+    }
+    for (auto &box : ket_boxes) {
+      for (auto ket_idx : box.kets) {
+        const auto &P_kl = this->cfmm_pair_centers[quantum_part_b_idx][ket_pairs[ket_idx].pair_idx];
+        box.center += Eigen::Vector3d(P_kl[0], P_kl[1], P_kl[2]);
+      }
+      box.center /= static_cast<double>(box.kets.size());
+      for (auto ket_idx : box.kets) {
+        const auto &P_kl = this->cfmm_pair_centers[quantum_part_b_idx][ket_pairs[ket_idx].pair_idx];
+        Eigen::Vector3d s = Eigen::Vector3d(P_kl[0], P_kl[1], P_kl[2]) - box.center;
+        box.radius = std::max(box.radius, s.norm() + P_kl[3]);
+        box.moments += this->cfmm_translate_moments(ket_pairs[ket_idx].moments, s);
+      }
+    }
+  }
+
+  std::vector<std::pair<size_t, size_t>> bra_pairs;
+  for (size_t shell_i = 0; shell_i < shells_a.size(); shell_i++) {
+    for (auto &shell_j : std::get<0>(this->input_integral->unique_shell_pairs[quantum_part_a_idx])[shell_i]) {
+      bra_pairs.emplace_back(shell_i, shell_j);
+    }
+  }
+
+  auto nthreads = (num_threads > 0) ? num_threads : omp_get_max_threads();
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> FA(nthreads);
+  std::vector<libint2::Engine> engines(nthreads);
+  engines[0] = libint2::Engine(libint2::Operator::coulomb, std::max(shells_a.max_nprim(), shells_b.max_nprim()), std::max(shells_a.max_l(), shells_b.max_l()), 0);
+  engines[0].set_precision(0.0);
+  for (int i = 0; i < nthreads; i++) {
+    engines[i] = engines[0];
+    FA[i].setZero(fock.rows(), fock.cols());
+  }
+  const auto spinscale = (quantum_part_a_idx == quantum_part_b_idx && quantum_part_b.restricted == false && quantum_part_b.num_parts > 1) ? 0.5 : 1.0;
+  const auto scaleall = (quantum_part_a_idx == quantum_part_b_idx) ? 0.5 * spinscale : 0.5 * quantum_part_a.charge * quantum_part_b.charge;
+  // bra pairs are split over ranks x threads like the quartets of the direct build, with the same exceptions
+  const bool mpi_distribute = !rank_local && !omp_in_parallel() && Polyquant_mpi_size() > 1;
+  const int mpi_rank = mpi_distribute ? Polyquant_mpi_rank() : 0;
+  const int mpi_size = mpi_distribute ? Polyquant_mpi_size() : 1;
+#pragma omp parallel num_threads(nthreads)
+  {
+    auto thread_id = omp_get_thread_num();
+    auto team_size = omp_get_num_threads();
+    auto worker_id = mpi_rank * team_size + thread_id;
+    auto num_workers = mpi_size * team_size;
+    const auto &buf = engines[thread_id].results();
+    Eigen::Matrix<double, Eigen::Dynamic, 1> J_ij;
+    size_t quartets_computed = 0;
+    size_t quartets_screened = 0;
+    size_t quartets_far_field = 0;
+    for (auto bra_idx = 0; bra_idx < bra_pairs.size(); bra_idx++) {
+      if (bra_idx % num_workers != worker_id) {
+        continue;
+      }
+      auto [shell_i, shell_j] = bra_pairs[bra_idx];
+      auto shell_i_bf_start = shell2bf_a[shell_i];
+      auto shell_i_bf_size = shells_a[shell_i].size();
+      auto shell_j_bf_start = shell2bf_a[shell_j];
+      auto shell_j_bf_size = shells_a[shell_j].size();
+      J_ij.setZero(shell_i_bf_size * shell_j_bf_size);
+      auto exact_ket = [&](const ket_pair &ket) {
+        engines[thread_id].compute(shells_a[shell_i], shells_a[shell_j], shells_b[ket.shell_k], shells_b[ket.shell_l]);
+        quartets_computed++;
+        if (buf[0] == nullptr) {
+          return;
+        }
+        Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> eri(buf[0], J_ij.size(), ket.D_kl.size());
+        J_ij.noalias() += eri * ket.D_kl;
+      };
+      if (this->cfmm) {
+        // the bra pairs are enumerated in the same order as the unique shell pairs
+        const auto &P_ij = this->cfmm_pair_centers[quantum_part_a_idx][bra_idx];
+        const auto &moments_ij = this->cfmm_pair_moments[quantum_part_a_idx][bra_idx];
+        const Eigen::Vector3d center_ij(P_ij[0], P_ij[1], P_ij[2]);
+        for (const auto &box : ket_boxes) {
+          Eigen::Vector3d R = box.center - center_ij;
+          if (R.norm() > this->cfmm_well_separated * (P_ij[3] + box.radius)) {
+            J_ij.noalias() += moments_ij * this->cfmm_interaction_tensor(box.moments, R);
+            quartets_screened += box.kets.size();
+            quartets_far_field += box.kets.size();
+            continue;
+          }
+          for (auto box_ket_idx = 0; box_ket_idx < box.kets.size(); box_ket_idx++) {
+            const auto &ket = ket_pairs[box.kets[box_ket_idx]];
+            if (Schwarz_a(shell_i, shell_j) * ket.bound < this->coulomb_engine_threshold) {
+              quartets_screened += box.kets.size() - box_ket_idx;
+              break;
+            }
+            const auto &P_kl = this->cfmm_pair_centers[quantum_part_b_idx][ket.pair_idx];
+            Eigen::Vector3d R_kl = Eigen::Vector3d(P_kl[0], P_kl[1], P_kl[2]) - center_ij;
+            if (R_kl.norm() > this->cfmm_well_separated * (P_ij[3] + P_kl[3])) {
+              J_ij.noalias() += moments_ij * this->cfmm_interaction_tensor(ket.moments, R_kl);
+              quartets_screened++;
+              quartets_far_field++;
+            } else {
+              exact_ket(ket);
+            }
+          }
+        }
+      } else {
+        for (auto ket_idx = 0; ket_idx < ket_pairs.size(); ket_idx++) {
+          // the kets are sorted so nothing after this can contribute either
+          if (Schwarz_a(shell_i, shell_j) * ket_pairs[ket_idx].bound < this->coulomb_engine_threshold) {
+            quartets_screened += ket_pairs.size() - ket_idx;
+            break;
+          }
+          exact_ket(ket_pairs[ket_idx]);
+        }
+      }
+      const auto shell_ij_perdeg = (shell_i == shell_j) ? 1.0 : 2.0;
+      for (auto i = 0; i < shell_i_bf_size; i++) {
+        for (auto j = 0; j < shell_j_bf_size; j++) {
+          auto val = scaleall * shell_ij_perdeg * J_ij(i * shell_j_bf_size + j);
+          FA[thread_id](shell_i_bf_start + i, shell_j_bf_start + j) += val;
+          FA[thread_id](shell_j_bf_start + j, shell_i_bf_start + i) += val;
+        }
+      }
+    }
+#pragma omp atomic
+    this->telemetry_quartets_computed += quartets_computed;
+#pragma omp atomic
+    this->telemetry_quartets_screened += quartets_screened;
+#pragma omp atomic
+    this->telemetry_quartets_far_field += quartets_far_field;
+  }
+  for (auto ti = 1; ti < nthreads; ti++) {
+    FA[0] += FA[ti];
+  }
+  if (mpi_distribute) {
+    Polyquant_mpi_allreduce_sum(FA[0]);
+  }
+  fock += FA[0];
+}
+
+void POLYQUANT_EPSCF::form_fock_helper_exchange_matrix(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &fock,
+                                                       const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm,
+                                                       const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm_last, const QUANTUM_PARTICLE_SET &quantum_part,
+                                                       const int quantum_part_idx, const int quantum_part_spin_idx, const int num_threads, const bool rank_local) {
+  const auto &shells = this->input_basis->basis[quantum_part_idx];
+  auto shell2bf = shells.shell2bf();
+  auto num_shell = shells.size();
+  auto num_basis = this->input_basis->num_basis[quantum_part_idx];
+  const auto &Schwarz = this->input_integral->Schwarz[quantum_part_idx];
+
+  // exchange density (or its change for incremental builds) and its largest element in each shell block
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> D_x(num_basis, num_basis);
+  for (auto k = 0; k < num_basis; k++) {
+    for (auto l = 0; l < num_basis; l++) {
+      D_x(k, l) = this->directscf_get_density_exchange(dm, dm_last, quantum_part, quantum_part_idx, quantum_part_spin_idx, k, l);
+    }
+  }
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> D_shell(num_shell, num_shell);
+  for (size_t shell_k = 0; shell_k < num_shell; shell_k++) {
+    for (size_t shell_l = 0; shell_l < num_shell; shell_l++) {
+      D_shell(shell_k, shell_l) = D_x.block(shell2bf[shell_k], shell2bf[shell_l], shells[shell_k].size(), shells[shell_l].size()).lpNorm<Eigen::Infinity>();
+    }
+  }
+
+  // the significant partners of each shell sorted by their Schwarz bound (sigma lists), and the shells each shell has density with sorted by that
+  // density times the largest Schwarz bound of the partner (lambda lists)
+  std::vector<std::vector<size_t>> sigma_lists(num_shell);
+  std::vector<std::vector<size_t>> lambda_lists(num_shell);
+  Eigen::Matrix<double, Eigen::Dynamic, 1> Schwarz_max = Eigen::Matrix<double, Eigen::Dynamic, 1>::Zero(num_shell);
+  for (size_t shell_m = 0; shell_m < num_shell; shell_m++) {
+    for (size_t shell_l = 0; shell_l < num_shell; shell_l++) {
+      if (Schwarz(shell_m, shell_l) > 0.0) {
+        sigma_lists[shell_m].push_back(shell_l);
+      }
+    }
+    std::sort(sigma_lists[shell_m].begin(), sigma_lists[shell_m].end(), [&](size_t x, size_t y) { return Schwarz(shell_m, x) > Schwarz(shell_m, y); });
+    if (!sigma_lists[shell_m].empty()) {
+      Schwarz_max(shell_m) = Schwarz(shell_m, sigma_lists[shell_m].front());
+    }
+  }
+  for (size_t shell_m = 0; shell_m < num_shell; shell_m++) {
+    for (size_t shell_l = 0; shell_l < num_shell; shell_l++) {
+      if (D_shell(shell_m, shell_l) > 0.0 && Schwarz_max(shell_l) > 0.0) {
+        lambda_lists[shell_m].push_back(shell_l);
+      }
+    }
+    std::sort(lambda_lists[shell_m].begin(), lambda_lists[shell_m].end(),
+              [&](size_t x, size_t y) { return D_shell(shell_m, x) * Schwarz_max(x) > D_shell(shell_m, y) * Schwarz_max(y); });
+  }
+
+  // canonical shell pairs (mu >= nu) in canonical order, so (mu nu|lambda sigma) is canonical when the ket pair comes no later than the bra pair
+  std::vector<std::pair<size_t, size_t>> bra_pairs;
+  for (size_t shell_m = 0; shell_m < num_shell; shell_m++) {
+    for (size_t shell_n = 0; shell_n <= shell_m; shell_n++) {
+      if (Schwarz(shell_m, shell_n) > 0.0) {
+        bra_pairs.emplace_back(shell_m, shell_n);
+      }
+    }
   }
+  auto pair_order = [](size_t shell_x, size_t shell_y) { return shell_x * (shell_x + 1) / 2 + shell_y; };
 
+  auto nthreads = (num_threads > 0) ? num_threads : omp_get_max_threads();
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> FA(nthreads);
+  std::vector<libint2::Engine> engines(nthreads);
+  engines[0] = libint2::Engine(libint2::Operator::coulomb, shells.max_nprim(), shells.max_l(), 0);
+  engines[0].set_precision(0.0);
+  for (int i = 0; i < nthreads; i++) {
+    engines[i] = engines[0];
+    FA[i].setZero(fock.rows(), fock.cols());
+  }
+  // bra pairs are split over ranks x threads, except for rank local calls and calls from inside a parallel region
+  const bool mpi_distribute = !rank_local && !omp_in_parallel() && Polyquant_mpi_size() > 1;
+  const int mpi_rank = mpi_distribute ? Polyquant_mpi_rank() : 0;
+  const int mpi_size = mpi_distribute ? Polyquant_mpi_size() : 1;
+#pragma omp parallel num_threads(nthreads)
+  {
+    auto thread_id = omp_get_thread_num();
+    auto team_size = omp_get_num_threads();
+    auto worker_id = mpi_rank * team_size + thread_id;
+    auto num_workers = mpi_size * team_size;
+    const auto &buf = engines[thread_id].results();
+    std::vector<size_t> ML;
+    std::vector<char> in_ML(num_shell, 0);
+    size_t quartets_computed = 0;
+    size_t quartets_screened = 0;
+    for (auto bra_idx = 0; bra_idx < bra_pairs.size(); bra_idx++) {
+      if (bra_idx % num_workers != worker_id) {
+        continue;
+      }
+      auto [shell_m, shell_n] = bra_pairs[bra_idx];
+      const auto bra_order = pair_order(shell_m, shell_n);
+      const auto Schwarz_mn = Schwarz(shell_m, shell_n);
+      auto shell_m_bf_start = shell2bf[shell_m];
+      auto shell_m_bf_size = shells[shell_m].size();
+      auto shell_n_bf_start = shell2bf[shell_n];
+      auto shell_n_bf_size = shells[shell_n].size();
+      // the ket shells with significant density to mu or nu, the lambda lists are sorted so each walk stops at the first insignificant one
+      ML.clear();
+      for (auto shell_x : {shell_m, shell_n}) {
+        for (auto shell_l : lambda_lists[shell_x]) {
+          if (Schwarz_mn * D_shell(shell_x, shell_l) * Schwarz_max(shell_l) < this->link_threshold) {
+            break;
+          }
+          if (!in_ML[shell_l]) {
+            in_ML[shell_l] = 1;
+            ML.push_back(shell_l);
+          }
+        }
+      }
+      // the exchange density of (mu nu|lambda sigma) is in the (mu, lambda), (mu, sigma), (nu, lambda) and (nu, sigma) blocks, so a significant quartet
+      // has lambda or sigma in ML. It is computed from the one whose own density blocks make it significant, the larger one if both do.
+      auto D_bra = [&](size_t shell_l) { return std::max(D_shell(shell_m, shell_l), D_shell(shell_n, shell_l)); };
+      size_t bra_quartets_computed = 0;
+      for (auto shell_l : ML) {
+        in_ML[shell_l] = 0;
+        const auto D_l = D_bra(shell_l);
+        for (auto shell_s : sigma_lists[shell_l]) {
+          // the sigmas are sorted so nothing after this can contribute through lambda either
+          if (Schwarz_mn * Schwarz(shell_l, shell_s) * D_l < this->link_threshold) {
+            break;
+          }
+          auto shell_r = std::max(shell_l, shell_s);
+          auto shell_t = std::min(shell_l, shell_s);
+          const auto ket_order = pair_order(shell_r, shell_t);
+          if (ket_order > bra_order) {
+            continue;
+          }
+          if (shell_l < shell_s && Schwarz_mn * Schwarz(shell_l, shell_s) * D_bra(shell_s) >= this->link_threshold) {
+            continue;
+          }
+          engines[thread_id].compute(shells[shell_m], shells[shell_n], shells[shell_r], shells[shell_t]);
+          bra_quartets_computed++;
+          const auto *buf_1234 = buf[0];
+          if (buf_1234 == nullptr) {
+            continue;
+          }
+          const auto shell_mnrt_perdeg = ((shell_m == shell_n) ? 1.0 : 2.0) * ((shell_r == shell_t) ? 1.0 : 2.0) * ((bra_order == ket_order) ? 1.0 : 2.0);
+          auto shell_r_bf_start = shell2bf[shell_r];
+          auto shell_r_bf_size = shells[shell_r].size();
+          auto shell_t_bf_start = shell2bf[shell_t];
+          auto shell_t_bf_size = shells[shell_t].size();
+          auto shell_mnrt_bf = 0;
+          for (auto m = shell_m_bf_start; m < shell_m_bf_start + shell_m_bf_size; m++) {
+            for (auto n = shell_n_bf_start; n < shell_n_bf_start + shell_n_bf_size; n++) {
+              for (auto r = shell_r_bf_start; r < shell_r_bf_start + shell_r_bf_size; r++) {
+                for (auto t = shell_t_bf_start; t < shell_t_bf_start + shell_t_bf_size; t++) {
+                  auto eri_mnrt = shell_mnrt_perdeg * buf_1234[shell_mnrt_bf];
+                  shell_mnrt_bf++;
+                  FA[thread_id](m, r) += eri_mnrt * D_x(n, t);
+                  FA[thread_id](m, t) += eri_mnrt * D_x(n, r);
+                  FA[thread_id](n, r) += eri_mnrt * D_x(m, t);
+                  FA[thread_id](n, t) += eri_mnrt * D_x(m, r);
+                }
+              }
+            }
+          }
+        }
+      }
+      // every significant ket pair up to this bra pair makes a canonical quartet, so the screened count is the canonical quartets of this bra pair
+      // that were not computed (skipped by the density bounds), not a count of rejections
+      quartets_computed += bra_quartets_computed;
+      quartets_screened += bra_idx + 1 - bra_quartets_computed;
+    }
+#pragma omp atomic
+    this->telemetry_quartets_computed += quartets_computed;
+#pragma omp atomic
+    this->telemetry_quartets_screened += quartets_screened;
+  }
+  // each canonical quartet stands for its 8 permutations, half of which land in the transpose
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> K = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(fock.rows(), fock.cols());
   for (auto ti = 0; ti < nthreads; ti++) {
-    fock += FA[ti];
+    K += FA[ti];
+  }
+  if (mpi_distribute) {
+    Polyquant_mpi_allreduce_sum(K);
+  }
+  fock -= 0.125 * (K + K.transpose());
+}
+
+void POLYQUANT_EPSCF::form_cfmm_shell_pairs() {
+  auto num_parts = this->input_molecule->quantum_particles.size();
+  this->cfmm_pair_centers.resize(num_parts);
+  this->cfmm_pair_moments.resize(num_parts);
+  const auto log_threshold = std::log(this->cfmm_extent_threshold);
+  for (auto quantum_part_idx = 0; quantum_part_idx < num_parts; quantum_part_idx++) {
+    const auto &shells = this->input_basis->basis[quantum_part_idx];
+    this->cfmm_pair_centers[quantum_part_idx].clear();
+    this->cfmm_pair_moments[quantum_part_idx].clear();
+    libint2::Engine engine(libint2::Operator::emultipole2, shells.max_nprim(), shells.max_l(), 0);
+    engine.set_precision(0.0);
+    const auto &buf = engine.results();
+    for (size_t shell_i = 0; shell_i < shells.size(); shell_i++) {
+      for (auto &shell_j : std::get<0>(this->input_integral->unique_shell_pairs[quantum_part_idx])[shell_i]) {
+        const auto &A = shells[shell_i].O;
+        const auto &B = shells[shell_j].O;
+        const auto AB2 = (A[0] - B[0]) * (A[0] - B[0]) + (A[1] - B[1]) * (A[1] - B[1]) + (A[2] - B[2]) * (A[2] - B[2]);
+        // the pair is centered on its most diffuse significant primitive product, and extends as far as any of its primitive products
+        std::array<double, 4> center{0.5 * (A[0] + B[0]), 0.5 * (A[1] + B[1]), 0.5 * (A[2] + B[2]), 0.0};
+        std::vector<std::array<double, 5>> prim_pairs; // P, zeta, log of the gaussian prefactor
+        auto zeta_min = std::numeric_limits<double>::max();
+        for (auto alpha : shells[shell_i].alpha) {
+          for (auto beta : shells[shell_j].alpha) {
+            auto zeta = alpha + beta;
+            auto log_K = -alpha * beta / zeta * AB2;
+            if (log_K < log_threshold) {
+              continue;
+            }
+            std::array<double, 5> prim;
+            for (auto x = 0; x < 3; x++) {
+              prim[x] = (alpha * A[x] + beta * B[x]) / zeta;
+            }
+            prim[3] = zeta;
+            prim[4] = log_K;
+            prim_pairs.push_back(prim);
+            if (zeta < zeta_min) {
+              zeta_min = zeta;
+              center[0] = prim[0];
+              center[1] = prim[1];
+              center[2] = prim[2];
+            }
+          }
+        }
+        for (auto &prim : prim_pairs) {
+          auto offset = std::sqrt((prim[0] - center[0]) * (prim[0] - center[0]) + (prim[1] - center[1]) * (prim[1] - center[1]) + (prim[2] - center[2]) * (prim[2] - center[2]));
+          center[3] = std::max(center[3], offset + std::sqrt((prim[4] - log_threshold) / prim[3]));
+        }
+        Eigen::Matrix<double, Eigen::Dynamic, 10> moments = Eigen::Matrix<double, Eigen::Dynamic, 10>::Zero(shells[shell_i].size() * shells[shell_j].size(), 10);
+        engine.set_params(std::array<double, 3>{center[0], center[1], center[2]});
+        engine.compute(shells[shell_i], shells[shell_j]);
+        if (buf[0] != nullptr) {
+          for (auto moment = 0; moment < 10; moment++) {
+            moments.col(moment) = Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 1>>(buf[moment], moments.rows());
+          }
+        }
+        this->cfmm_pair_centers[quantum_part_idx].push_back(center);
+        this->cfmm_pair_moments[quantum_part_idx].push_back(moments);
+      }
+    }
+  }
+}
+
+Eigen::Matrix<double, 10, 1> POLYQUANT_EPSCF::cfmm_interaction_tensor(const Eigen::Matrix<double, 10, 1> &moments_b, const Eigen::Vector3d &R) {
+  // taylor expansion of 1/|R + r_b - r_a| to second order
+  const int quadrupole_idx[3][3] = {{4, 5, 6}, {5, 7, 8}, {6, 8, 9}};
+  const auto r2 = R.squaredNorm();
+  const auto inv_r = 1.0 / std::sqrt(r2);
+  const auto inv_r3 = inv_r * inv_r * inv_r;
+  const auto inv_r5 = inv_r3 * inv_r * inv_r;
+  Eigen::Vector3d d1 = -R * inv_r3;
+  Eigen::Matrix3d d2 = 3.0 * inv_r5 * R * R.transpose() - inv_r3 * Eigen::Matrix3d::Identity();
+  Eigen::Matrix3d M2_b;
+  for (auto x = 0; x < 3; x++) {
+    for (auto y = 0; y < 3; y++) {
+      M2_b(x, y) = moments_b(quadrupole_idx[x][y]);
+    }
+  }
+  const auto q_b = moments_b(0);
+  Eigen::Matrix<double, 10, 1> T;
+  T(0) = q_b * inv_r + d1.dot(moments_b.segment<3>(1)) + 0.5 * (d2.cwiseProduct(M2_b)).sum();
+  T.segment<3>(1) = -q_b * d1 - d2 * moments_b.segment<3>(1);
+  for (auto x = 0; x < 3; x++) {
+    for (auto y = x; y < 3; y++) {
+      // off diagonal moments are stored once but appear twice
+      T(quadrupole_idx[x][y]) = (x == y) ? 0.5 * q_b * d2(x, y) : q_b * d2(x, y);
+    }
+  }
+  return T;
+}
+
+Eigen::Matrix<double, 10, 1> POLYQUANT_EPSCF::cfmm_translate_moments(const Eigen::Matrix<double, 10, 1> &moments, const Eigen::Vector3d &s) {
+  const int quadrupole_idx[3][3] = {{4, 5, 6}, {5, 7, 8}, {6, 8, 9}};
+  Eigen::Matrix<double, 10, 1> translated = moments;
+  translated.segment<3>(1) += moments(0) * s;
+  for (auto x = 0; x < 3; x++) {
+    for (auto y = x; y < 3; y++) {
+      translated(quadrupole_idx[x][y]) += s(x) * moments(1 + y) + s(y) * moments(1 + x) + s(x) * s(y) * moments(0);
+    }
+  }
+  return translated;
+}
+
+bool POLYQUANT_EPSCF::use_density_fitting(const int quantum_part_b_idx) {
+  return this->density_fitting && quantum_part_b_idx < static_cast<int>(this->input_integral->ri_B.size()) && this->input_integral->ri_B[quantum_part_b_idx].size() != 0;
+}
+
+void POLYQUANT_EPSCF::form_fock_helper_density_fitting(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &fock,
+                                                       const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm,
+                                                       const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm_last, const QUANTUM_PARTICLE_SET &quantum_part_a,
+                                                       const int quantum_part_a_idx, const int quantum_part_a_spin_idx, const QUANTUM_PARTICLE_SET &quantum_part_b, const int quantum_part_b_idx,
+                                                       const int num_threads, const bool rank_local) {
+  auto num_basis_a = this->input_basis->num_basis[quantum_part_a_idx];
+  auto num_basis_b = this->input_basis->num_basis[quantum_part_b_idx];
+  const auto &B_a = this->input_integral->ri_B[quantum_part_b_idx][quantum_part_a_idx];
+  const auto &B_b = this->input_integral->ri_B[quantum_part_b_idx][quantum_part_b_idx];
+
+  // same density (and scaling) the direct build contracts with, summed over the spins of b
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> D_coulomb = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(num_basis_b, num_basis_b);
+  auto quantum_part_b_spin_lim = (quantum_part_b.restricted || quantum_part_b.num_parts == 1) ? 1 : 2;
+  for (auto quantum_part_b_spin_idx = 0; quantum_part_b_spin_idx < quantum_part_b_spin_lim; quantum_part_b_spin_idx++) {
+    for (auto k = 0; k < num_basis_b; k++) {
+      for (auto l = 0; l < num_basis_b; l++) {
+        D_coulomb(k, l) += this->directscf_get_density_coulomb(dm, dm_last, quantum_part_a, quantum_part_a_idx, quantum_part_a_spin_idx, quantum_part_b, quantum_part_b_idx,
+                                                               quantum_part_b_spin_idx, k, l);
+      }
+    }
+  }
+  // J_ij = sum_Q B_ij,Q (sum_kl B_kl,Q D_kl), two matrix vector products that every rank does itself
+  Eigen::Matrix<double, Eigen::Dynamic, 1> gamma = B_b.transpose() * Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 1>>(D_coulomb.data(), D_coulomb.size());
+  Eigen::Matrix<double, Eigen::Dynamic, 1> J = B_a * gamma;
+  const auto spinscale = (quantum_part_a_idx == quantum_part_b_idx && quantum_part_b.restricted == false && quantum_part_b.num_parts > 1) ? 0.5 : 1.0;
+  const auto scaleall = (quantum_part_a_idx == quantum_part_b_idx) ? spinscale : quantum_part_a.charge * quantum_part_b.charge * spinscale;
+  fock += scaleall * Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>(J.data(), num_basis_a, num_basis_a);
+
+  // exchange only within the same particle and spin, K = sum_Q B_Q D B_Q
+  if (quantum_part_a_idx == quantum_part_b_idx) {
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> D_exchange = dm[quantum_part_a_idx][quantum_part_a_spin_idx];
+    if (this->incremental_fock && incremental_fock_doing_incremental[quantum_part_a_idx][quantum_part_a_spin_idx]) {
+      D_exchange -= dm_last[quantum_part_a_idx][quantum_part_a_spin_idx];
+    }
+    auto nthreads = (num_threads > 0) ? num_threads : omp_get_max_threads();
+    // each rank takes a contiguous block of the auxiliary functions, except for rank local calls and calls from inside a parallel region
+    const bool mpi_distribute = !rank_local && !omp_in_parallel() && Polyquant_mpi_size() > 1;
+    const int mpi_rank = mpi_distribute ? Polyquant_mpi_rank() : 0;
+    const int mpi_size = mpi_distribute ? Polyquant_mpi_size() : 1;
+    const int num_aux = B_a.cols();
+    const int Q_start = (num_aux * mpi_rank) / mpi_size;
+    const int Q_end = (num_aux * (mpi_rank + 1)) / mpi_size;
+    std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> K(nthreads);
+#pragma omp parallel num_threads(nthreads)
+    {
+      auto thread_id = omp_get_thread_num();
+      K[thread_id].setZero(num_basis_a, num_basis_a);
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> BD(num_basis_a, num_basis_a);
+#pragma omp for schedule(static)
+      for (auto Q = Q_start; Q < Q_end; Q++) {
+        Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> B_Q(B_a.col(Q).data(), num_basis_a, num_basis_a);
+        BD.noalias() = B_Q * D_exchange;
+        K[thread_id].noalias() += BD * B_Q;
+      }
+    }
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> K_sum = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(num_basis_a, num_basis_a);
+    for (auto &K_thread : K) {
+      if (K_thread.size() != 0) {
+        K_sum += K_thread;
+      }
+    }
+    if (mpi_distribute) {
+      Polyquant_mpi_allreduce_sum(K_sum);
+    }
+    fock -= K_sum;
+  }
+}
+
+bool POLYQUANT_EPSCF::skip_particle(const int quantum_part_idx) {
+  if ((this->iteration_num > 1) && this->freeze_density[quantum_part_idx] == true) {
+    return true;
+  }
+  // without interactions a converged particle's density can't change anymore
+  return !this->independent_converged && quantum_part_idx < static_cast<int>(this->independent_particle_converged.size()) && this->independent_particle_converged[quantum_part_idx] == true;
+}
+
+void POLYQUANT_EPSCF::form_fock_helper_independent() {
+  // every (particle, spin) fock matrix only depends on its own particle's density, so they are built at the same time. With MPI the tasks are
+  // dealt out over the ranks and built rank local, each fock matrix is then summed from the change its owner made to it
+  const bool mpi_distribute = Polyquant_mpi_size() > 1;
+  const int mpi_rank = mpi_distribute ? Polyquant_mpi_rank() : 0;
+  const int mpi_size = mpi_distribute ? Polyquant_mpi_size() : 1;
+  std::vector<std::pair<int, int>> all_tasks;
+  std::vector<std::pair<int, int>> tasks;
+  std::vector<double> task_cost;
+  auto quantum_part_a_idx = 0;
+  for (auto const &[quantum_part_a_key, quantum_part_a] : this->input_molecule->quantum_particles) {
+    if (this->skip_particle(quantum_part_a_idx)) {
+      quantum_part_a_idx++;
+      continue;
+    }
+    auto quantum_part_a_spin_lim = (quantum_part_a.restricted || quantum_part_a.num_parts == 1) ? 1 : 2;
+    for (auto quantum_part_a_spin_idx = 0; quantum_part_a_spin_idx < quantum_part_a_spin_lim; quantum_part_a_spin_idx++) {
+      this->Cauchy_Schwarz_threshold[quantum_part_a_idx] = std::max(this->iteration_rms_error[quantum_part_a_idx][quantum_part_a_spin_idx] / 1e4, std::numeric_limits<double>::epsilon());
+      double num_basis = this->input_basis->num_basis[quantum_part_a_idx];
+      if (static_cast<int>(all_tasks.size()) % mpi_size == mpi_rank) {
+        tasks.emplace_back(quantum_part_a_idx, quantum_part_a_spin_idx);
+        task_cost.push_back(quantum_part_a_spin_lim * num_basis * num_basis * num_basis * num_basis);
+      }
+      all_tasks.emplace_back(quantum_part_a_idx, quantum_part_a_spin_idx);
+    }
+    quantum_part_a_idx++;
+  }
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> F_before(all_tasks.size());
+  if (mpi_distribute) {
+    for (auto all_task_idx = 0; all_task_idx < all_tasks.size(); all_task_idx++) {
+      F_before[all_task_idx] = this->F[all_tasks[all_task_idx].first][all_tasks[all_task_idx].second];
+    }
+  }
+  // give every task of this rank a thread team roughly proportional to its number of integrals
+  int nthreads = omp_get_max_threads();
+  int num_tasks = tasks.size();
+  std::vector<int> team_sizes(num_tasks, 1);
+  for (auto extra_thread = num_tasks; num_tasks > 0 && extra_thread < nthreads; extra_thread++) {
+    auto largest = std::max_element(task_cost.begin(), task_cost.end());
+    auto task_idx = std::distance(task_cost.begin(), largest);
+    task_cost[task_idx] *= static_cast<double>(team_sizes[task_idx]) / (team_sizes[task_idx] + 1);
+    team_sizes[task_idx]++;
+  }
+  auto max_active_levels = omp_get_max_active_levels();
+  omp_set_max_active_levels(std::max(max_active_levels, 2));
+#pragma omp parallel for schedule(dynamic, 1) num_threads(std::max(std::min(num_tasks, nthreads), 1))
+  for (auto task_idx = 0; task_idx < num_tasks; task_idx++) {
+    auto [quantum_part_idx, quantum_part_spin_idx] = tasks[task_idx];
+    auto quantum_part_it = this->input_molecule->quantum_particles.begin();
+    std::advance(quantum_part_it, quantum_part_idx);
+    auto &quantum_part = quantum_part_it->second;
+    if (this->use_density_fitting(quantum_part_idx)) {
+      form_fock_helper_density_fitting(this->F[quantum_part_idx][quantum_part_spin_idx], this->D_combined, this->D_last_combined, quantum_part, quantum_part_idx, quantum_part_spin_idx,
+                                       quantum_part, quantum_part_idx, team_sizes[task_idx], true);
+      continue;
+    }
+    if (this->cfmm || this->link_exchange) {
+      // coulomb from the coulomb engine, then only the exchange
+      form_fock_helper_coulomb_matrix(this->F[quantum_part_idx][quantum_part_spin_idx], this->D_combined, this->D_last_combined, quantum_part, quantum_part_idx, quantum_part_spin_idx,
+                                      quantum_part, quantum_part_idx, team_sizes[task_idx], true);
+      if (this->link_exchange) {
+        form_fock_helper_exchange_matrix(this->F[quantum_part_idx][quantum_part_spin_idx], this->D_combined, this->D_last_combined, quantum_part, quantum_part_idx, quantum_part_spin_idx,
+                                         team_sizes[task_idx], true);
+      } else {
+        form_fock_helper_single_fock_matrix(this->F[quantum_part_idx][quantum_part_spin_idx], this->D_combined, this->D_last_combined, quantum_part, quantum_part_idx, quantum_part_spin_idx,
+                                            quantum_part, quantum_part_idx, quantum_part_spin_idx, team_sizes[task_idx], false, true);
+      }
+      continue;
+    }
+    auto quantum_part_spin_lim = (quantum_part.restricted || quantum_part.num_parts == 1) ? 1 : 2;
+    for (auto quantum_part_b_spin_idx = 0; quantum_part_b_spin_idx < quantum_part_spin_lim; quantum_part_b_spin_idx++) {
+      form_fock_helper_single_fock_matrix(this->F[quantum_part_idx][quantum_part_spin_idx], this->D_combined, this->D_last_combined, quantum_part, quantum_part_idx, quantum_part_spin_idx,
+                                          quantum_part, quantum_part_idx, quantum_part_b_spin_idx, team_sizes[task_idx], true, true);
+    }
+  }
+  omp_set_max_active_levels(max_active_levels);
+  if (mpi_distribute) {
+    for (auto all_task_idx = 0; all_task_idx < all_tasks.size(); all_task_idx++) {
+      auto &F_task = this->F[all_tasks[all_task_idx].first][all_tasks[all_task_idx].second];
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> F_change = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(F_task.rows(), F_task.cols());
+      if (all_task_idx % mpi_size == mpi_rank) {
+        F_change = F_task - F_before[all_task_idx];
+      }
+      Polyquant_mpi_allreduce_sum(F_change);
+      F_task = F_before[all_task_idx] + F_change;
+    }
   }
 }
 
 void POLYQUANT_EPSCF::form_fock_helper() {
   libint2::initialize();
+  if (this->cfmm && this->cfmm_pair_moments.empty()) {
+    this->form_cfmm_shell_pairs();
+  }
+  if (!this->independent_converged && this->concurrent_independent_particles) {
+    this->form_fock_helper_independent();
+    libint2::finalize();
+    return;
+  }
+  if (this->cache_frozen_potential && this->independent_converged && this->iteration_num > 1 && !this->frozen_potential_formed &&
+      std::find(this->freeze_density.begin(), this->freeze_density.end(), true) != this->freeze_density.end()) {
+    this->form_frozen_potential();
+  }
   for (auto quantum_part_a_idx = 0; quantum_part_a_idx < this->input_molecule->quantum_particles.size(); quantum_part_a_idx++) {
-    if ((this->iteration_num > 1) && this->freeze_density[quantum_part_a_idx] == true) {
-      quantum_part_a_idx++;
+    if (this->skip_particle(quantum_part_a_idx)) {
       continue;
     }
     auto quantum_part_a_it = this->input_molecule->quantum_particles.begin();
@@ -289,9 +1201,35 @@ void POLYQUANT_EPSCF::form_fock_helper() {
       for (auto quantum_part_b_idx = 0; quantum_part_b_idx < this->input_molecule->quantum_particles.size(); quantum_part_b_idx++) {
         if (!independent_converged && quantum_part_a_idx != quantum_part_b_idx)
           continue;
+        // frozen densities are already in frozen_potential
+        if (this->frozen_potential_formed && quantum_part_a_idx != quantum_part_b_idx && this->freeze_density[quantum_part_b_idx] == true)
+          continue;
         auto quantum_part_b_it = this->input_molecule->quantum_particles.begin();
         std::advance(quantum_part_b_it, quantum_part_b_idx);
         auto quantum_part_b = quantum_part_b_it->second;
+        if (this->use_density_fitting(quantum_part_b_idx)) {
+          form_fock_helper_density_fitting(this->F[quantum_part_a_idx][quantum_part_a_spin_idx], this->D_combined, this->D_last_combined, quantum_part_a, quantum_part_a_idx,
+                                           quantum_part_a_spin_idx, quantum_part_b, quantum_part_b_idx);
+          continue;
+        }
+        if ((this->coulomb_engine || this->cfmm) && quantum_part_a_idx != quantum_part_b_idx) {
+          form_fock_helper_coulomb_matrix(this->F[quantum_part_a_idx][quantum_part_a_spin_idx], this->D_combined, this->D_last_combined, quantum_part_a, quantum_part_a_idx,
+                                          quantum_part_a_spin_idx, quantum_part_b, quantum_part_b_idx);
+          continue;
+        }
+        if (this->cfmm || this->link_exchange) {
+          // coulomb from the coulomb engine, then only the exchange
+          form_fock_helper_coulomb_matrix(this->F[quantum_part_a_idx][quantum_part_a_spin_idx], this->D_combined, this->D_last_combined, quantum_part_a, quantum_part_a_idx,
+                                          quantum_part_a_spin_idx, quantum_part_b, quantum_part_b_idx);
+          if (this->link_exchange) {
+            form_fock_helper_exchange_matrix(this->F[quantum_part_a_idx][quantum_part_a_spin_idx], this->D_combined, this->D_last_combined, quantum_part_a, quantum_part_a_idx,
+                                             quantum_part_a_spin_idx);
+          } else {
+            form_fock_helper_single_fock_matrix(this->F[quantum_part_a_idx][quantum_part_a_spin_idx], this->D_combined, this->D_last_combined, quantum_part_a, quantum_part_a_idx,
+                                                quantum_part_a_spin_idx, quantum_part_b, quantum_part_b_idx, quantum_part_a_spin_idx, 0, false);
+          }
+          continue;
+        }
         auto quantum_part_b_spin_lim = quantum_part_b.restricted ? 1 : 2;
         quantum_part_b_spin_lim = (quantum_part_b.num_parts == 1) ? 1 : quantum_part_b_spin_lim;
 
@@ -301,16 +1239,58 @@ void POLYQUANT_EPSCF::form_fock_helper() {
                                               quantum_part_a_spin_idx, quantum_part_b, quantum_part_b_idx, quantum_part_b_spin_idx);
         }
       }
+      // an incremental build already has it from the last full build
+      if (this->frozen_potential_formed && !(this->incremental_fock && this->incremental_fock_doing_incremental[quantum_part_a_idx][quantum_part_a_spin_idx])) {
+        this->F[quantum_part_a_idx][quantum_part_a_spin_idx] += this->frozen_potential[quantum_part_a_idx];
+      }
     }
   }
   libint2::finalize();
 }
 
+void POLYQUANT_EPSCF::form_frozen_potential() {
+  // coulomb potential of the frozen densities on the other particles. There is no exchange between different particles, and frozen particles don't
+  // get a fock matrix of their own, so coulomb is all that is needed.
+  Polyquant_cout("Forming the potential of the frozen densities.");
+  auto D_zero = this->D_combined;
+  for (auto &D_part : D_zero) {
+    for (auto &D_spin : D_part) {
+      D_spin.setZero();
+    }
+  }
+  this->frozen_potential.resize(this->input_molecule->quantum_particles.size());
+  auto quantum_part_a_idx = 0;
+  for (auto const &[quantum_part_a_key, quantum_part_a] : this->input_molecule->quantum_particles) {
+    auto num_basis = this->input_basis->num_basis[quantum_part_a_idx];
+    this->frozen_potential[quantum_part_a_idx].setZero(num_basis, num_basis);
+    if (this->freeze_density[quantum_part_a_idx] == true) {
+      quantum_part_a_idx++;
+      continue;
+    }
+    auto quantum_part_b_idx = 0;
+    for (auto const &[quantum_part_b_key, quantum_part_b] : this->input_molecule->quantum_particles) {
+      if (quantum_part_b_idx != quantum_part_a_idx && this->freeze_density[quantum_part_b_idx] == true && (this->coulomb_engine || this->cfmm)) {
+        form_fock_helper_coulomb_matrix(this->frozen_potential[quantum_part_a_idx], this->D_combined, D_zero, quantum_part_a, quantum_part_a_idx, 0, quantum_part_b, quantum_part_b_idx);
+      } else if (quantum_part_b_idx != quantum_part_a_idx && this->freeze_density[quantum_part_b_idx] == true) {
+        auto quantum_part_b_spin_lim = (quantum_part_b.restricted || quantum_part_b.num_parts == 1) ? 1 : 2;
+        for (auto quantum_part_b_spin_idx = 0; quantum_part_b_spin_idx < quantum_part_b_spin_lim; quantum_part_b_spin_idx++) {
+          // with a zero "last" density the full density is used even if the particle is building incrementally
+          form_fock_helper_single_fock_matrix(this->frozen_potential[quantum_part_a_idx], this->D_combined, D_zero, quantum_part_a, quantum_part_a_idx, 0, quantum_part_b,
+                                              quantum_part_b_idx, quantum_part_b_spin_idx);
+        }
+      }
+      quantum_part_b_idx++;
+    }
+    quantum_part_a_idx++;
+  }
+  this->frozen_potential_formed = true;
+}
+
 void POLYQUANT_EPSCF::form_fock() {
   // set data structures
   auto quantum_part_a_idx = 0ul;
   for (auto const &[quantum_part_a_key, quantum_part_a] : this->input_molecule->quantum_particles) {
-    if ((this->iteration_num > 1) && this->freeze_density[quantum_part_a_idx] == true) {
+    if (this->skip_particle(quantum_part_a_idx)) {
       quantum_part_a_idx++;
       continue;
     }
@@ -334,7 +1314,10 @@ void POLYQUANT_EPSCF::form_fock() {
     quantum_part_a_idx++;
   }
   // compute Fock
+  auto fock_start = std::chrono::steady_clock::now();
   this->form_fock_helper();
+  this->num_fock_builds++;
+  this->telemetry_time_fock += std::chrono::duration<double>(std::chrono::steady_clock::now() - fock_start).count();
   // compute energy with non-extrapolated Fock matrix
   this->calculate_E_elec();
   //
@@ -351,16 +1334,63 @@ void POLYQUANT_EPSCF::form_fock() {
   }
 }
 
-void POLYQUANT_EPSCF::diag_fock_helper(int quantum_part_idx, int quantum_part_irrep_idx, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &F_prime,
-                                       Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &mo_C, Eigen::Matrix<double, Eigen::Dynamic, 1> &mo_e) {
+bool POLYQUANT_EPSCF::diag_fock_helper_partial(const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &F_prime, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &C_prime,
+                                               Eigen::Matrix<double, Eigen::Dynamic, 1> &mo_e, const int num_eigenvalues) {
+  const lapack_int n = F_prime.rows();
+  const lapack_int il = 1;
+  const lapack_int iu = num_eigenvalues;
+  lapack_int m = 0;
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> A = F_prime;
+  Eigen::Matrix<double, Eigen::Dynamic, 1> w(n);
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> Z(n, num_eigenvalues);
+  std::vector<lapack_int> isuppz(2 * num_eigenvalues);
+  auto info = LAPACKE_dsyevr(LAPACK_COL_MAJOR, 'V', 'I', 'L', n, A.data(), n, 0.0, 0.0, il, iu, LAPACKE_dlamch('S'), &m, w.data(), Z.data(), n, isuppz.data());
+  if (info != 0 || m != num_eigenvalues) {
+    return false;
+  }
+  // complete the space with the orthogonal complement of the lowest eigenvectors. These orbitals are not canonical, they get the diagonal of F in the
+  // complement as energies (all above the highest eigenvalue solved for) and are sorted by them.
+  Eigen::HouseholderQR<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> qr(Z);
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> Q = qr.householderQ();
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V = Q.rightCols(n - num_eigenvalues);
+  Eigen::Matrix<double, Eigen::Dynamic, 1> e_v = (V.transpose() * F_prime * V).diagonal();
+  std::vector<int> order(e_v.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int x, int y) { return e_v(x) < e_v(y); });
+  C_prime.resize(n, n);
+  mo_e.resize(n);
+  C_prime.leftCols(num_eigenvalues) = Z;
+  mo_e.head(num_eigenvalues) = w.head(num_eigenvalues);
+  for (auto i = 0; i < order.size(); i++) {
+    C_prime.col(num_eigenvalues + i) = V.col(order[i]);
+    mo_e(num_eigenvalues + i) = e_v(order[i]);
+  }
+  return true;
+}
+
+bool POLYQUANT_EPSCF::diag_fock_helper(int quantum_part_idx, int quantum_part_irrep_idx, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &F_prime,
+                                       Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &mo_C, Eigen::Matrix<double, Eigen::Dynamic, 1> &mo_e, const int num_eigenvalues) {
+  auto partial_ok = true;
 
   if (F_prime.cols() != 0 && F_prime.rows() != 0) {
     auto num_basis = this->input_basis->num_basis[quantum_part_idx];
     auto num_mo = this->num_mo_per_irrep[quantum_part_idx][quantum_part_irrep_idx];
     Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> C_prime(num_mo, num_mo);
-    Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> eigensolver(F_prime);
-    mo_e = eigensolver.eigenvalues();
-    C_prime = eigensolver.eigenvectors();
+    auto solved = false;
+    if (num_eigenvalues > 0 && num_eigenvalues < num_mo) {
+      solved = this->diag_fock_helper_partial(F_prime, C_prime, mo_e, num_eigenvalues);
+      if (solved) {
+#pragma omp atomic write
+        this->partial_diag_used = true;
+      } else {
+        partial_ok = false;
+      }
+    }
+    if (!solved) {
+      Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> eigensolver(F_prime);
+      mo_e = eigensolver.eigenvalues();
+      C_prime = eigensolver.eigenvectors();
+    }
     mo_C = this->input_integral->orth_X[quantum_part_idx][quantum_part_irrep_idx] * C_prime;
     for (auto i = 0; i < mo_C.cols(); i++) {
       auto max_val = mo_C(Eigen::all, i).maxCoeff();
@@ -370,11 +1400,21 @@ void POLYQUANT_EPSCF::diag_fock_helper(int quantum_part_idx, int quantum_part_ir
       }
     }
   }
+  return partial_ok;
 }
 void POLYQUANT_EPSCF::diag_fock() {
+  std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> F_coupled;
+  if (this->coupled_diis) {
+    auto diis_start = std::chrono::steady_clock::now();
+    this->coupled_diis_extrapolate(F_coupled);
+    this->telemetry_time_diis += std::chrono::duration<double>(std::chrono::steady_clock::now() - diis_start).count();
+  }
+  // the blocks (particle, spin, irrep) are independent and are diagonalized together once all of them are formed
+  std::vector<std::array<int, 4>> diag_blocks; // particle, spin, irrep, lowest eigenpairs needed (0 for all)
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> diag_F;
   auto quantum_part_idx = 0ul;
   for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
-    if ((this->iteration_num > 1) && this->freeze_density[quantum_part_idx] == true) {
+    if (this->skip_particle(quantum_part_idx)) {
       quantum_part_idx++;
       continue;
     }
@@ -386,8 +1426,12 @@ void POLYQUANT_EPSCF::diag_fock() {
     FD_commutator.noalias() = (this->F[quantum_part_idx][0] * this->D_combined[quantum_part_idx][0] * this->input_integral->overlap[quantum_part_idx] -
                                this->input_integral->overlap[quantum_part_idx] * this->D_combined[quantum_part_idx][0] * this->F[quantum_part_idx][0]);
     F_diis = this->F[quantum_part_idx][0];
-    if (this->diis_extrapolation) {
-      this->diis[quantum_part_idx][0].extrapolate(F_diis, FD_commutator);
+    if (this->coupled_diis) {
+      F_diis = F_coupled[quantum_part_idx][0];
+    } else if (this->diis_extrapolation) {
+      auto diis_start = std::chrono::steady_clock::now();
+      this->diis_extrapolate(quantum_part_idx, 0, F_diis, FD_commutator);
+      this->telemetry_time_diis += std::chrono::duration<double>(std::chrono::steady_clock::now() - diis_start).count();
     }
     auto num_irrep = this->input_symmetry->irrep_names[quantum_part_idx].size();
     auto num_mo_total = this->num_mo[quantum_part_idx];
@@ -399,7 +1443,8 @@ void POLYQUANT_EPSCF::diag_fock() {
       }
       Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &X = this->input_integral->orth_X[quantum_part_idx][irrep_idx];
       F_diis_irrep.noalias() = X.transpose() * F_diis * X;
-      diag_fock_helper(quantum_part_idx, irrep_idx, F_diis_irrep, this->C[quantum_part_idx][0][irrep_idx], this->E_orbitals[quantum_part_idx][0][irrep_idx]);
+      diag_blocks.push_back({static_cast<int>(quantum_part_idx), 0, irrep_idx, this->diag_fock_num_eigenvalues(quantum_part, num_mo)});
+      diag_F.push_back(F_diis_irrep);
     }
     if (this->incremental_fock) {
       if (this->incremental_fock_doing_incremental[quantum_part_idx][0]) {
@@ -428,8 +1473,12 @@ void POLYQUANT_EPSCF::diag_fock() {
                                  this->input_integral->overlap[quantum_part_idx] * this->D_combined[quantum_part_idx][1] * this->F[quantum_part_idx][1]);
 
       F_diis = this->F[quantum_part_idx][1];
-      if (this->diis_extrapolation) {
-        this->diis[quantum_part_idx][1].extrapolate(F_diis, FD_commutator);
+      if (this->coupled_diis) {
+        F_diis = F_coupled[quantum_part_idx][1];
+      } else if (this->diis_extrapolation) {
+        auto diis_start = std::chrono::steady_clock::now();
+        this->diis_extrapolate(quantum_part_idx, 1, F_diis, FD_commutator);
+        this->telemetry_time_diis += std::chrono::duration<double>(std::chrono::steady_clock::now() - diis_start).count();
       }
       auto num_irrep = this->input_symmetry->irrep_names[quantum_part_idx].size();
       auto num_mo_total = this->num_mo[quantum_part_idx];
@@ -441,7 +1490,8 @@ void POLYQUANT_EPSCF::diag_fock() {
         }
         Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &X = this->input_integral->orth_X[quantum_part_idx][irrep_idx];
         F_diis_irrep.noalias() = X.transpose() * F_diis * X;
-        diag_fock_helper(quantum_part_idx, irrep_idx, F_diis_irrep, this->C[quantum_part_idx][1][irrep_idx], this->E_orbitals[quantum_part_idx][1][irrep_idx]);
+        diag_blocks.push_back({static_cast<int>(quantum_part_idx), 1, irrep_idx, this->diag_fock_num_eigenvalues(quantum_part, num_mo)});
+        diag_F.push_back(F_diis_irrep);
       }
       if (this->incremental_fock) {
         if (this->incremental_fock_doing_incremental[quantum_part_idx][1]) {
@@ -463,15 +1513,78 @@ void POLYQUANT_EPSCF::diag_fock() {
     }
     quantum_part_idx++;
   }
+  // largest blocks first
+  std::vector<int> diag_order(diag_blocks.size());
+  std::iota(diag_order.begin(), diag_order.end(), 0);
+  std::sort(diag_order.begin(), diag_order.end(), [&](int x, int y) { return diag_F[x].rows() > diag_F[y].rows(); });
+  auto diag_start = std::chrono::steady_clock::now();
+  // dsyevr of the partially diagonalized blocks can be threaded by the LAPACK library itself, so those blocks go one at a time and only the Eigen
+  // solves are shared out over threads
+  std::vector<int> partial_order;
+  std::vector<int> full_order;
+  for (auto block_idx : diag_order) {
+    (diag_blocks[block_idx][3] > 0 ? partial_order : full_order).push_back(block_idx);
+  }
+  auto num_partial_failed = 0;
+  for (auto block_idx : partial_order) {
+    auto [part_idx, spin_idx, irrep_idx, num_eigenvalues] = diag_blocks[block_idx];
+    if (!diag_fock_helper(part_idx, irrep_idx, diag_F[block_idx], this->C[part_idx][spin_idx][irrep_idx], this->E_orbitals[part_idx][spin_idx][irrep_idx], num_eigenvalues)) {
+      num_partial_failed++;
+    }
+  }
+#pragma omp parallel for schedule(dynamic, 1)
+  for (auto task_idx = 0; task_idx < full_order.size(); task_idx++) {
+    auto block_idx = full_order[task_idx];
+    auto [part_idx, spin_idx, irrep_idx, num_eigenvalues] = diag_blocks[block_idx];
+    diag_fock_helper(part_idx, irrep_idx, diag_F[block_idx], this->C[part_idx][spin_idx][irrep_idx], this->E_orbitals[part_idx][spin_idx][irrep_idx], num_eigenvalues);
+  }
+  this->telemetry_time_diag += std::chrono::duration<double>(std::chrono::steady_clock::now() - diag_start).count();
+  if (num_partial_failed > 0) {
+    APP_WARN("Partial diagonalization (dsyevr) failed for " + std::to_string(num_partial_failed) + " blocks. Used the full eigensolver for them.");
+  }
+  // keep the partially diagonalized blocks in case this is the last iteration
+  this->partial_diag_blocks.clear();
+  this->partial_diag_F.clear();
+  for (auto block_idx = 0; block_idx < diag_blocks.size(); block_idx++) {
+    if (diag_blocks[block_idx][3] > 0) {
+      this->partial_diag_blocks.push_back(diag_blocks[block_idx]);
+      this->partial_diag_F.push_back(std::move(diag_F[block_idx]));
+    }
+  }
   if (permute_orbitals_start) {
     permute_initial_MOs();
   }
 }
 
+void POLYQUANT_EPSCF::diag_fock_full_final() {
+  // the same matrices the last iteration's orbitals came from, so the occupied orbitals and the density don't change and the virtuals become the
+  // eigenvectors of F instead of an arbitrary basis of the complement
+#pragma omp parallel for schedule(dynamic, 1)
+  for (auto block_idx = 0; block_idx < this->partial_diag_blocks.size(); block_idx++) {
+    auto [part_idx, spin_idx, irrep_idx, num_eigenvalues] = this->partial_diag_blocks[block_idx];
+    diag_fock_helper(part_idx, irrep_idx, this->partial_diag_F[block_idx], this->C[part_idx][spin_idx][irrep_idx], this->E_orbitals[part_idx][spin_idx][irrep_idx]);
+  }
+  this->partial_diag_blocks.clear();
+  this->partial_diag_F.clear();
+}
+
+int POLYQUANT_EPSCF::diag_fock_num_eigenvalues(const QUANTUM_PARTICLE_SET &quantum_part, const int num_mo) {
+  // the first iteration sets the orbitals of frozen particles and the second order steps need every orbital
+  if (!this->partial_diag || this->iteration_num < 2 || this->second_order_active || num_mo < this->partial_diag_min_size) {
+    return 0;
+  }
+  // no irrep can hold more than num_parts particles of one spin
+  auto num_eigenvalues = quantum_part.num_parts + this->partial_diag_extra_virtuals;
+  if (2 * num_eigenvalues > num_mo) {
+    return 0;
+  }
+  return num_eigenvalues;
+}
+
 void POLYQUANT_EPSCF::form_DM() {
   auto quantum_part_idx = 0ul;
   for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
-    if ((this->iteration_num > 1) && this->freeze_density[quantum_part_idx] == true) {
+    if (this->skip_particle(quantum_part_idx)) {
       quantum_part_idx++;
       continue;
     }
@@ -520,7 +1633,7 @@ void POLYQUANT_EPSCF::calculate_E_elec() {
   auto quantum_part_idx = 0ul;
   for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
     this->E_particles_last[quantum_part_idx] = this->E_particles[quantum_part_idx];
-    if ((this->iteration_num > 1) && this->freeze_density[quantum_part_idx] == true) {
+    if (this->skip_particle(quantum_part_idx)) {
       quantum_part_idx++;
       continue;
     }
@@ -723,6 +1836,25 @@ void POLYQUANT_EPSCF::check_stop() {
   std::string curr_E = fmt::format("{:> 8.6f}", E_parts);
   line += fmt::format("{:^11}{:^10}{:^10}{:^10}{:^10}{:10}{:^10}{:^10}", "Total", curr_E, "", "", "", "", "", "");
   Polyquant_cout(line);
+  if (!this->independent_converged && this->iteration_num > 1 && this->input_molecule->quantum_particles.size() > 1) {
+    // hold particles that converged on their own while the others finish
+    quantum_part_idx = 0ul;
+    for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+      if (this->skip_particle(quantum_part_idx)) {
+        quantum_part_idx++;
+        continue;
+      }
+      auto particle_converged = this->iteration_E_diff[quantum_part_idx] < this->convergence_E;
+      for (auto &spin_error : this->iteration_rms_error[quantum_part_idx]) {
+        particle_converged = particle_converged && spin_error < this->convergence_DM;
+      }
+      if (particle_converged) {
+        this->independent_particle_converged[quantum_part_idx] = true;
+        Polyquant_cout("Independent density of " + quantum_part_key + " converged. Holding it until the other particles converge.");
+      }
+      quantum_part_idx++;
+    }
+  }
   if (!this->independent_converged && this->converged && this->stop) {
     Polyquant_cout("Independent densities converged.");
     if (this->stop_after_independent_converged) {
@@ -737,118 +1869,1116 @@ void POLYQUANT_EPSCF::check_stop() {
       Polyquant_cout("Resetting DIIS and incremental fock building.");
       this->reset_diis();
       this->reset_incfock();
+      this->reset_second_order();
+    }
+    this->independent_converged = true;
+    this->independent_converged_iteration_num = this->iteration_num;
+  } else if (this->iteration_num == this->iteration_max) {
+    this->exceeded_iterations = true;
+    this->stop = true;
+  }
+  if (this->stop && this->partial_diag_used) {
+    Polyquant_cout("Diagonalizing the final fock matrices with the full eigensolver.");
+    this->diag_fock_full_final();
+    this->partial_diag_used = false;
+  }
+  Polyquant_cout(divider);
+}
+
+void POLYQUANT_EPSCF::reset_coupled_diis() {
+  this->coupled_diis_F.clear();
+  this->coupled_diis_D.clear();
+  this->coupled_diis_error.clear();
+  this->coupled_diis_E.clear();
+  this->coupled_diis_blocks.clear();
+  this->coupled_diis_weights.clear();
+  this->coupled_diis_num_calls = 0;
+}
+
+void POLYQUANT_EPSCF::reset_diis() {
+  this->reset_coupled_diis();
+  this->diis_history.clear();
+  this->diis_num_calls.clear();
+  if (this->diis_extrapolation) {
+    this->diis.clear();
+    this->diis.resize(this->input_molecule->quantum_particles.size());
+    this->diis_history.resize(this->input_molecule->quantum_particles.size());
+    this->diis_num_calls.resize(this->input_molecule->quantum_particles.size());
+    auto quantum_part_idx = 0ul;
+    for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+      auto nspin = 1;
+      if (quantum_part.num_parts > 1 && quantum_part.restricted == false) {
+        nspin = 2;
+      }
+      // this->diis[quantum_part_idx].resize(nspin);
+      for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < nspin; quantum_part_spin_idx++) {
+        // for (auto irrep_idx = 0; irrep_idx < this->input_symmetry->irrep_names[quantum_part_idx].size(); irrep_idx++) {
+        // this->diis[quantum_part_idx][quantum_part_spin_idx].emplace_back(this->diis_start, this->diis_size, this->diis_damping, 1, 1, this->diis_mixing_fraction);
+        this->diis[quantum_part_idx].emplace_back(this->diis_start, this->diis_size, this->diis_damping, 1, 1, this->diis_mixing_fraction);
+        //}
+      }
+      this->diis_history[quantum_part_idx].resize(nspin);
+      this->diis_num_calls[quantum_part_idx].resize(nspin, 0);
+      quantum_part_idx++;
+    }
+  }
+}
+
+void POLYQUANT_EPSCF::diis_extrapolate(const int quantum_part_idx, const int quantum_part_spin_idx, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &F_diis,
+                                       Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &FD_commutator) {
+  auto &history = this->diis_history[quantum_part_idx][quantum_part_spin_idx];
+  history.emplace_back(F_diis, FD_commutator);
+  if (history.size() > this->diis_size) {
+    history.pop_front();
+  }
+  this->diis_num_calls[quantum_part_idx][quantum_part_spin_idx]++;
+  this->diis[quantum_part_idx][quantum_part_spin_idx].extrapolate(F_diis, FD_commutator);
+}
+
+void POLYQUANT_EPSCF::coupled_diis_extrapolate(std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &F_diis) {
+  F_diis = this->F;
+  std::vector<std::pair<int, int>> blocks;
+  std::vector<double> weights;
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> F_now;
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> D_now;
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> error_now;
+  auto max_error = 0.0;
+  auto quantum_part_idx = 0;
+  for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+    if (this->skip_particle(quantum_part_idx)) {
+      quantum_part_idx++;
+      continue;
+    }
+    auto num_spin = (quantum_part.num_parts > 1 && quantum_part.restricted == false) ? 2 : 1;
+    auto weight = (quantum_part.num_parts > 1 && quantum_part.restricted == true) ? 2.0 : 1.0;
+    auto &s = this->input_integral->overlap[quantum_part_idx];
+    for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < num_spin; quantum_part_spin_idx++) {
+      auto &f = this->F[quantum_part_idx][quantum_part_spin_idx];
+      auto &d = this->D_combined[quantum_part_idx][quantum_part_spin_idx];
+      blocks.emplace_back(quantum_part_idx, quantum_part_spin_idx);
+      weights.push_back(weight);
+      F_now.push_back(f);
+      D_now.push_back(d);
+      error_now.push_back(f * d * s - s * d * f);
+      max_error = std::max(max_error, error_now.back().cwiseAbs().maxCoeff());
+    }
+    quantum_part_idx++;
+  }
+  // the set of particles being optimized changed (e.g. frozen densities), old vectors don't fit anymore
+  if (blocks != this->coupled_diis_blocks) {
+    this->reset_coupled_diis();
+    this->coupled_diis_blocks = blocks;
+    this->coupled_diis_weights = weights;
+  }
+  this->coupled_diis_F.push_back(F_now);
+  this->coupled_diis_D.push_back(D_now);
+  this->coupled_diis_error.push_back(error_now);
+  this->coupled_diis_E.push_back(std::accumulate(this->E_particles.begin(), this->E_particles.end(), 0.0));
+  while (this->coupled_diis_F.size() > static_cast<std::size_t>(std::max(this->diis_size, 1))) {
+    this->coupled_diis_F.pop_front();
+    this->coupled_diis_D.pop_front();
+    this->coupled_diis_error.pop_front();
+    this->coupled_diis_E.pop_front();
+  }
+  this->coupled_diis_num_calls++;
+
+  auto num_hist = this->coupled_diis_F.size();
+  auto use_pulay = this->diis_extrapolation && this->coupled_diis_num_calls >= this->diis_start && num_hist > 1;
+  auto use_energy = this->diis_energy_mode != "none" && num_hist > 1;
+  if (!use_pulay && !use_energy) {
+    return;
+  }
+  Eigen::Matrix<double, Eigen::Dynamic, 1> coeffs;
+  if (use_energy && (max_error > this->diis_energy_blend_end || !use_pulay)) {
+    coeffs = this->coupled_diis_energy_coefficients();
+    if (use_pulay && max_error < this->diis_energy_blend_start) {
+      auto energy_fraction = (max_error - this->diis_energy_blend_end) / (this->diis_energy_blend_start - this->diis_energy_blend_end);
+      coeffs = energy_fraction * coeffs + (1.0 - energy_fraction) * this->coupled_diis_pulay_coefficients();
+    }
+  } else {
+    coeffs = this->coupled_diis_pulay_coefficients();
+  }
+  // like the per particle DIIS, keep diis_mixing_fraction of the current fock matrices
+  if (this->diis_mixing_fraction != 0.0) {
+    coeffs *= 1.0 - this->diis_mixing_fraction;
+    coeffs(num_hist - 1) += this->diis_mixing_fraction;
+  }
+  for (auto block_idx = 0; block_idx < this->coupled_diis_blocks.size(); block_idx++) {
+    auto [part_idx, spin_idx] = this->coupled_diis_blocks[block_idx];
+    F_diis[part_idx][spin_idx].setZero();
+    for (auto hist_idx = 0; hist_idx < num_hist; hist_idx++) {
+      F_diis[part_idx][spin_idx] += coeffs(hist_idx) * this->coupled_diis_F[hist_idx][block_idx];
+    }
+  }
+}
+
+Eigen::Matrix<double, Eigen::Dynamic, 1> POLYQUANT_EPSCF::coupled_diis_pulay_coefficients() {
+  auto num_hist = this->coupled_diis_error.size();
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> B(num_hist, num_hist);
+  for (auto i = 0; i < num_hist; i++) {
+    for (auto j = 0; j <= i; j++) {
+      auto b = 0.0;
+      for (auto block_idx = 0; block_idx < this->coupled_diis_blocks.size(); block_idx++) {
+        b += (this->coupled_diis_error[i][block_idx].array() * this->coupled_diis_error[j][block_idx].array()).sum();
+      }
+      B(i, j) = b;
+      B(j, i) = b;
+    }
+  }
+  // damping as in the per particle DIIS, favouring the vectors with the smallest errors
+  B.diagonal() *= 1.0 + this->diis_damping;
+  Eigen::Matrix<double, Eigen::Dynamic, 1> coeffs = Eigen::Matrix<double, Eigen::Dynamic, 1>::Zero(num_hist);
+  // drop the oldest vectors until the linear system is well conditioned
+  for (auto first = 0; first < num_hist; first++) {
+    auto n = num_hist - first;
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> A = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(n + 1, n + 1);
+    A.topLeftCorner(n, n) = B.bottomRightCorner(n, n);
+    auto scale = A.topLeftCorner(n, n).diagonal().maxCoeff();
+    if (scale > 0.0) {
+      A.topLeftCorner(n, n) /= scale;
+    }
+    A.row(n).head(n).setOnes();
+    A.col(n).head(n).setOnes();
+    Eigen::Matrix<double, Eigen::Dynamic, 1> rhs = Eigen::Matrix<double, Eigen::Dynamic, 1>::Zero(n + 1);
+    rhs(n) = 1.0;
+    Eigen::JacobiSVD<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> svd(A, Eigen::ComputeThinU | Eigen::ComputeThinV);
+    auto singular_values = svd.singularValues();
+    if (n == 1 || singular_values(singular_values.size() - 1) > 1e-12 * singular_values(0)) {
+      coeffs.tail(n) = svd.solve(rhs).head(n);
+      break;
+    }
+  }
+  return coeffs;
+}
+
+Eigen::Matrix<double, Eigen::Dynamic, 1> POLYQUANT_EPSCF::coupled_diis_energy_coefficients() {
+  // minimize g.c + 1/2 c.A.c with c_i >= 0 and sum c_i = 1
+  auto num_hist = this->coupled_diis_F.size();
+  auto last = num_hist - 1;
+  auto trace_product = [](const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &a, const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &b) { return (a.array() * b.array()).sum(); };
+  Eigen::Matrix<double, Eigen::Dynamic, 1> g = Eigen::Matrix<double, Eigen::Dynamic, 1>::Zero(num_hist);
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> A = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(num_hist, num_hist);
+  for (auto block_idx = 0; block_idx < this->coupled_diis_blocks.size(); block_idx++) {
+    auto w = this->coupled_diis_weights[block_idx];
+    auto &F_last = this->coupled_diis_F[last][block_idx];
+    auto &D_last = this->coupled_diis_D[last][block_idx];
+    for (auto i = 0; i < num_hist; i++) {
+      auto &F_i = this->coupled_diis_F[i][block_idx];
+      auto &D_i = this->coupled_diis_D[i][block_idx];
+      if (this->diis_energy_mode == "adiis") {
+        g(i) += w * trace_product(D_i - D_last, F_last);
+      }
+      for (auto j = 0; j < num_hist; j++) {
+        auto &F_j = this->coupled_diis_F[j][block_idx];
+        auto &D_j = this->coupled_diis_D[j][block_idx];
+        if (this->diis_energy_mode == "ediis") {
+          A(i, j) -= 0.5 * w * trace_product(D_i - D_j, F_i - F_j);
+        } else {
+          A(i, j) += 0.5 * w * (trace_product(D_i - D_last, F_j - F_last) + trace_product(D_j - D_last, F_i - F_last));
+        }
+      }
+    }
+  }
+  if (this->diis_energy_mode == "ediis") {
+    for (auto i = 0; i < num_hist; i++) {
+      g(i) = this->coupled_diis_E[i];
+    }
+  }
+  // euclidean projection onto the simplex
+  auto project = [](const Eigen::Matrix<double, Eigen::Dynamic, 1> &v) {
+    std::vector<double> u(v.data(), v.data() + v.size());
+    std::sort(u.begin(), u.end(), std::greater<double>());
+    auto cumulative = 0.0;
+    auto theta = 0.0;
+    for (auto i = 0; i < u.size(); i++) {
+      cumulative += u[i];
+      auto t = (cumulative - 1.0) / (i + 1);
+      if (u[i] - t > 0.0) {
+        theta = t;
+      }
+    }
+    return Eigen::Matrix<double, Eigen::Dynamic, 1>((v.array() - theta).cwiseMax(0.0));
+  };
+  // projected gradient, the step 1/L with L >= |A| can't increase the energy
+  auto lipschitz = A.norm();
+  if (lipschitz <= 0.0) {
+    lipschitz = 1.0;
+  }
+  Eigen::Matrix<double, Eigen::Dynamic, 1> coeffs = Eigen::Matrix<double, Eigen::Dynamic, 1>::Zero(num_hist);
+  coeffs(last) = 1.0;
+  for (auto step = 0; step < 1000; step++) {
+    Eigen::Matrix<double, Eigen::Dynamic, 1> coeffs_new = project(coeffs - (g + A * coeffs) / lipschitz);
+    auto change = (coeffs_new - coeffs).norm();
+    coeffs = coeffs_new;
+    if (change < 1e-12) {
+      break;
+    }
+  }
+  return coeffs;
+}
+
+void POLYQUANT_EPSCF::reset_incfock() {
+  if (this->incremental_fock) {
+    incremental_fock_reset_threshold.clear();
+    incremental_fock_reset_iteration.clear();
+    incremental_fock_doing_incremental.clear();
+    incremental_fock_reset_threshold.resize(this->input_molecule->quantum_particles.size());
+    incremental_fock_reset_iteration.resize(this->input_molecule->quantum_particles.size());
+    incremental_fock_doing_incremental.resize(this->input_molecule->quantum_particles.size());
+    auto quantum_part_idx = 0ul;
+    for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+      if (quantum_part.num_parts == 1) {
+        this->incremental_fock_reset_threshold[quantum_part_idx].resize(1);
+        this->incremental_fock_reset_threshold[quantum_part_idx][0] = this->incremental_fock_initial_onset_thresh / 10.0;
+        this->incremental_fock_reset_iteration[quantum_part_idx].resize(1);
+        this->incremental_fock_reset_iteration[quantum_part_idx][0] = this->iteration_num;
+        this->incremental_fock_doing_incremental[quantum_part_idx].resize(1);
+        this->incremental_fock_doing_incremental[quantum_part_idx][0] = false;
+      } else if (quantum_part.restricted == false) {
+        this->incremental_fock_reset_threshold[quantum_part_idx].resize(2);
+        this->incremental_fock_reset_threshold[quantum_part_idx][0] = this->incremental_fock_initial_onset_thresh / 10.0;
+        this->incremental_fock_reset_threshold[quantum_part_idx][1] = this->incremental_fock_initial_onset_thresh / 10.0;
+        this->incremental_fock_reset_iteration[quantum_part_idx].resize(2);
+        this->incremental_fock_reset_iteration[quantum_part_idx][0] = this->iteration_num;
+        this->incremental_fock_reset_iteration[quantum_part_idx][1] = this->iteration_num;
+        this->incremental_fock_doing_incremental[quantum_part_idx].resize(2);
+        this->incremental_fock_doing_incremental[quantum_part_idx][0] = false;
+        this->incremental_fock_doing_incremental[quantum_part_idx][1] = false;
+      } else {
+        this->incremental_fock_reset_threshold[quantum_part_idx].resize(1);
+        this->incremental_fock_reset_threshold[quantum_part_idx][0] = this->incremental_fock_initial_onset_thresh / 10.0;
+        this->incremental_fock_reset_iteration[quantum_part_idx].resize(1);
+        this->incremental_fock_reset_iteration[quantum_part_idx][0] = this->iteration_num;
+        this->incremental_fock_doing_incremental[quantum_part_idx].resize(1);
+        this->incremental_fock_doing_incremental[quantum_part_idx][0] = false;
+      }
+      quantum_part_idx++;
+    }
+  }
+}
+
+void POLYQUANT_EPSCF::run_iteration() {
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  if (this->second_order_active) {
+    this->run_second_order_iteration();
+    return;
+  }
+  this->iteration_num += 1;
+  this->second_order_fock_current = false;
+  this->form_fock();
+  this->diag_fock();
+  this->form_occ();
+  this->form_DM();
+  this->second_order_check_switch();
+}
+
+void POLYQUANT_EPSCF::reset_second_order() {
+  this->second_order_active = false;
+  this->second_order_fock_current = false;
+  this->second_order_error_history.clear();
+  this->second_order_trust_radius = this->second_order_trust_radius_start;
+}
+
+void POLYQUANT_EPSCF::second_order_check_switch() {
+  if (!this->second_order) {
+    return;
+  }
+  auto max_error = 0.0;
+  auto quantum_part_idx = 0ul;
+  for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+    if (!this->skip_particle(quantum_part_idx)) {
+      for (auto &spin_error : this->iteration_rms_error[quantum_part_idx]) {
+        max_error = std::max(max_error, spin_error);
+      }
+    }
+    quantum_part_idx++;
+  }
+  this->second_order_error_history.push_back(max_error);
+  auto num_hist = static_cast<int>(this->second_order_error_history.size());
+  auto num_stall = this->second_order_stall_iterations;
+  if (num_hist <= num_stall || this->iteration_num <= this->diis_start + num_stall || max_error < this->convergence_DM) {
+    return;
+  }
+  // a stall window of zero switches as soon as DIIS has started
+  auto best_recent = max_error;
+  auto stalled = true;
+  if (num_stall > 0) {
+    auto best_before = *std::min_element(this->second_order_error_history.begin(), this->second_order_error_history.end() - num_stall);
+    best_recent = *std::min_element(this->second_order_error_history.end() - num_stall, this->second_order_error_history.end());
+    stalled = best_recent > 0.9 * best_before;
+  }
+  if (stalled) {
+    std::stringstream buffer;
+    buffer << "DIIS error stalled at " << std::scientific << best_recent << " for " << num_stall << " iterations. Switching to second order SCF.";
+    Polyquant_cout(buffer.str());
+    this->second_order_active = true;
+    this->second_order_trust_radius = this->second_order_trust_radius_start;
+    // the second order steps canonicalize the orbitals themselves
+    this->partial_diag_used = false;
+    this->partial_diag_blocks.clear();
+    this->partial_diag_F.clear();
+  }
+}
+
+void POLYQUANT_EPSCF::second_order_rotation_space() {
+  // only occupied-virtual rotations inside each irrep, so the orbitals keep their symmetry
+  this->second_order_blocks.clear();
+  this->second_order_block_occ.clear();
+  this->second_order_block_virt.clear();
+  this->second_order_block_scale.clear();
+  this->second_order_num_rotations = 0;
+  auto quantum_part_idx = 0;
+  for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+    if (this->skip_particle(quantum_part_idx)) {
+      quantum_part_idx++;
+      continue;
+    }
+    // dE/dkappa_ai is 2 F_ai per occupied spin orbital, restricted orbitals hold both spins
+    auto scale = (quantum_part.num_parts > 1 && quantum_part.restricted == true) ? 4.0 : 2.0;
+    for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < this->C[quantum_part_idx].size(); quantum_part_spin_idx++) {
+      for (auto irrep_idx = 0; irrep_idx < this->input_symmetry->irrep_names[quantum_part_idx].size(); irrep_idx++) {
+        auto &part_occ = this->occ[quantum_part_idx][quantum_part_spin_idx][irrep_idx];
+        std::vector<int> occ_idxs;
+        std::vector<int> virt_idxs;
+        for (auto i = 0; i < part_occ.size(); i++) {
+          if (part_occ(i) > 0.0) {
+            occ_idxs.push_back(i);
+          } else {
+            virt_idxs.push_back(i);
+          }
+        }
+        if (occ_idxs.size() == 0 || virt_idxs.size() == 0) {
+          continue;
+        }
+        this->second_order_blocks.push_back({quantum_part_idx, quantum_part_spin_idx, irrep_idx, this->second_order_num_rotations});
+        this->second_order_block_occ.push_back(occ_idxs);
+        this->second_order_block_virt.push_back(virt_idxs);
+        this->second_order_block_scale.push_back(scale);
+        this->second_order_num_rotations += occ_idxs.size() * virt_idxs.size();
+      }
+    }
+    quantum_part_idx++;
+  }
+}
+
+void POLYQUANT_EPSCF::second_order_form_fock() {
+  // full (non incremental) fock build and energy, without the logging of form_fock
+  auto quantum_part_idx = 0ul;
+  for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+    if (!this->skip_particle(quantum_part_idx)) {
+      for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < this->F[quantum_part_idx].size(); quantum_part_spin_idx++) {
+        this->F[quantum_part_idx][quantum_part_spin_idx] = this->H_core[quantum_part_idx];
+      }
+    }
+    quantum_part_idx++;
+  }
+  auto fock_start = std::chrono::steady_clock::now();
+  this->form_fock_helper();
+  this->num_fock_builds++;
+  this->telemetry_time_fock += std::chrono::duration<double>(std::chrono::steady_clock::now() - fock_start).count();
+  this->calculate_E_elec();
+}
+
+void POLYQUANT_EPSCF::second_order_rotate_orbitals(const std::vector<std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>>> &C_ref,
+                                                   const Eigen::Matrix<double, Eigen::Dynamic, 1> &kappa) {
+  this->C = C_ref;
+  for (auto block_idx = 0; block_idx < this->second_order_blocks.size(); block_idx++) {
+    auto [quantum_part_idx, quantum_part_spin_idx, irrep_idx, offset] = this->second_order_blocks[block_idx];
+    auto &occ_idxs = this->second_order_block_occ[block_idx];
+    auto &virt_idxs = this->second_order_block_virt[block_idx];
+    auto num_mo = C_ref[quantum_part_idx][quantum_part_spin_idx][irrep_idx].cols();
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> K = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(num_mo, num_mo);
+    for (auto a = 0; a < virt_idxs.size(); a++) {
+      for (auto i = 0; i < occ_idxs.size(); i++) {
+        K(virt_idxs[a], occ_idxs[i]) = kappa(offset + a * occ_idxs.size() + i);
+        K(occ_idxs[i], virt_idxs[a]) = -kappa(offset + a * occ_idxs.size() + i);
+      }
+    }
+    // exp(K) from a truncated taylor series, made exactly orthogonal afterwards
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> U = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Identity(num_mo, num_mo);
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> term = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Identity(num_mo, num_mo);
+    for (auto order = 1; order <= 8; order++) {
+      term = (term * K) / order;
+      U += term;
+    }
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> eigensolver(U.transpose() * U);
+    U = U * eigensolver.operatorInverseSqrt();
+    this->C[quantum_part_idx][quantum_part_spin_idx][irrep_idx] = C_ref[quantum_part_idx][quantum_part_spin_idx][irrep_idx] * U;
+  }
+}
+
+void POLYQUANT_EPSCF::second_order_gradient(Eigen::Matrix<double, Eigen::Dynamic, 1> &grad, Eigen::Matrix<double, Eigen::Dynamic, 1> &hess_diag) {
+  grad.setZero(this->second_order_num_rotations);
+  hess_diag.setZero(this->second_order_num_rotations);
+  for (auto block_idx = 0; block_idx < this->second_order_blocks.size(); block_idx++) {
+    auto [quantum_part_idx, quantum_part_spin_idx, irrep_idx, offset] = this->second_order_blocks[block_idx];
+    auto &occ_idxs = this->second_order_block_occ[block_idx];
+    auto &virt_idxs = this->second_order_block_virt[block_idx];
+    auto scale = this->second_order_block_scale[block_idx];
+    auto &c = this->C[quantum_part_idx][quantum_part_spin_idx][irrep_idx];
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> F_mo = c.transpose() * this->F[quantum_part_idx][quantum_part_spin_idx] * c;
+    for (auto a = 0; a < virt_idxs.size(); a++) {
+      for (auto i = 0; i < occ_idxs.size(); i++) {
+        grad(offset + a * occ_idxs.size() + i) = scale * F_mo(virt_idxs[a], occ_idxs[i]);
+        hess_diag(offset + a * occ_idxs.size() + i) = scale * (F_mo(virt_idxs[a], virt_idxs[a]) - F_mo(occ_idxs[i], occ_idxs[i]));
+      }
+    }
+  }
+}
+
+double POLYQUANT_EPSCF::second_order_energy_gradient(const std::vector<std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>>> &C_ref,
+                                                     const Eigen::Matrix<double, Eigen::Dynamic, 1> &kappa, Eigen::Matrix<double, Eigen::Dynamic, 1> &grad,
+                                                     Eigen::Matrix<double, Eigen::Dynamic, 1> &hess_diag) {
+  this->second_order_rotate_orbitals(C_ref, kappa);
+  this->form_DM();
+  this->second_order_form_fock();
+  this->second_order_gradient(grad, hess_diag);
+  return std::accumulate(this->E_particles.begin(), this->E_particles.end(), 0.0);
+}
+
+void POLYQUANT_EPSCF::second_order_canonicalize() {
+  // diagonalize F in the occupied and virtual spaces separately, this leaves the density unchanged
+  auto quantum_part_idx = 0ul;
+  for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+    if (this->skip_particle(quantum_part_idx)) {
+      quantum_part_idx++;
+      continue;
+    }
+    for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < this->C[quantum_part_idx].size(); quantum_part_spin_idx++) {
+      for (auto irrep_idx = 0; irrep_idx < this->input_symmetry->irrep_names[quantum_part_idx].size(); irrep_idx++) {
+        auto &c = this->C[quantum_part_idx][quantum_part_spin_idx][irrep_idx];
+        auto &part_occ = this->occ[quantum_part_idx][quantum_part_spin_idx][irrep_idx];
+        auto &mo_e = this->E_orbitals[quantum_part_idx][quantum_part_spin_idx][irrep_idx];
+        if (c.cols() == 0) {
+          continue;
+        }
+        mo_e.resize(c.cols());
+        std::vector<std::vector<int>> subspaces(2);
+        for (auto i = 0; i < part_occ.size(); i++) {
+          subspaces[part_occ(i) > 0.0 ? 0 : 1].push_back(i);
+        }
+        for (auto &subspace : subspaces) {
+          if (subspace.size() == 0) {
+            continue;
+          }
+          Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> c_sub = c(Eigen::all, subspace);
+          Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> F_sub = c_sub.transpose() * this->F[quantum_part_idx][quantum_part_spin_idx] * c_sub;
+          Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> eigensolver(F_sub);
+          c(Eigen::all, subspace) = c_sub * eigensolver.eigenvectors();
+          mo_e(subspace) = eigensolver.eigenvalues();
+        }
+      }
+    }
+    quantum_part_idx++;
+  }
+}
+
+void POLYQUANT_EPSCF::second_order_rms_error() {
+  auto quantum_part_idx = 0ul;
+  for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+    if (this->skip_particle(quantum_part_idx)) {
+      quantum_part_idx++;
+      continue;
+    }
+    auto num_mo_total = this->num_mo[quantum_part_idx];
+    for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < this->F[quantum_part_idx].size(); quantum_part_spin_idx++) {
+      auto &f = this->F[quantum_part_idx][quantum_part_spin_idx];
+      auto &d = this->D_combined[quantum_part_idx][quantum_part_spin_idx];
+      auto &s = this->input_integral->overlap[quantum_part_idx];
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> FD_commutator = f * d * s - s * d * f;
+      this->iteration_rms_error[quantum_part_idx][quantum_part_spin_idx] = FD_commutator.norm() / (num_mo_total * num_mo_total);
+    }
+    quantum_part_idx++;
+  }
+}
+
+void POLYQUANT_EPSCF::run_second_order_iteration() {
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  this->iteration_num += 1;
+  auto E_particles_prev = this->E_particles;
+  // every evaluation below needs a full fock build
+  this->reset_incfock();
+  this->second_order_rotation_space();
+  auto num_rot = this->second_order_num_rotations;
+  auto C_ref = this->C;
+  Eigen::Matrix<double, Eigen::Dynamic, 1> grad0;
+  Eigen::Matrix<double, Eigen::Dynamic, 1> hess_diag;
+  Eigen::Matrix<double, Eigen::Dynamic, 1> grad;
+  Eigen::Matrix<double, Eigen::Dynamic, 1> hess_diag_unused;
+  // the previous second order step left F built from the current orbitals, canonicalizing them didn't change the density
+  auto E0 = 0.0;
+  if (this->second_order_fock_current) {
+    this->second_order_gradient(grad0, hess_diag);
+    E0 = std::accumulate(this->E_particles.begin(), this->E_particles.end(), 0.0);
+  } else {
+    E0 = this->second_order_energy_gradient(C_ref, Eigen::Matrix<double, Eigen::Dynamic, 1>::Zero(num_rot), grad0, hess_diag);
+  }
+  auto F0 = this->F;
+  auto D0 = this->D;
+  auto D_combined0 = this->D_combined;
+  auto E_particles0 = this->E_particles;
+
+  auto precondition = [&](const Eigen::Matrix<double, Eigen::Dynamic, 1> &r, const double shift) {
+    Eigen::Matrix<double, Eigen::Dynamic, 1> t = r;
+    for (auto i = 0; i < t.size(); i++) {
+      auto denom = hess_diag(i) - shift;
+      if (std::abs(denom) < 1e-4) {
+        denom = std::copysign(1e-4, denom);
+      }
+      t(i) /= denom;
+    }
+    return t;
+  };
+
+  // Davidson on the augmented Hessian [[0, g^T], [g, H]]. Hx is either the diagonal Hessian (orbital energy differences) times x, which needs no
+  // fock builds, or a finite difference of the gradient, one full fock build each but including the coupling between species.
+  auto num_species_optimized = 0;
+  for (auto quantum_part_idx = 0; quantum_part_idx < this->input_molecule->quantum_particles.size(); quantum_part_idx++) {
+    if (!this->skip_particle(quantum_part_idx)) {
+      num_species_optimized++;
+    }
+  }
+  const auto species_coupled = this->independent_converged && num_species_optimized > 1;
+  const auto finite_difference = this->second_order_hessian == "finite_difference" || (this->second_order_hessian == "auto" && species_coupled);
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, 1>> X;
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, 1>> HX;
+  Eigen::Matrix<double, Eigen::Dynamic, 1> step = Eigen::Matrix<double, Eigen::Dynamic, 1>::Zero(num_rot);
+  Eigen::Matrix<double, Eigen::Dynamic, 1> H_step = Eigen::Matrix<double, Eigen::Dynamic, 1>::Zero(num_rot);
+  auto micro_iteration = 0;
+  if (num_rot > 0 && grad0.norm() > 0.0) {
+    Eigen::Matrix<double, Eigen::Dynamic, 1> trial = -precondition(grad0, 0.0);
+    for (micro_iteration = 0; micro_iteration < this->second_order_max_micro_iterations; micro_iteration++) {
+      for (auto orth_pass = 0; orth_pass < 2; orth_pass++) {
+        for (auto &x : X) {
+          trial -= x.dot(trial) * x;
+        }
+      }
+      if (trial.norm() < 1e-12) {
+        break;
+      }
+      trial.normalize();
+      X.push_back(trial);
+      if (finite_difference) {
+        this->second_order_energy_gradient(C_ref, this->second_order_fd_step * trial, grad, hess_diag_unused);
+        HX.push_back((grad - grad0) / this->second_order_fd_step);
+      } else {
+        HX.push_back(hess_diag.cwiseProduct(trial));
+      }
+
+      auto num_sub = X.size();
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> AH = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(num_sub + 1, num_sub + 1);
+      for (auto i = 0; i < num_sub; i++) {
+        AH(0, i + 1) = X[i].dot(grad0);
+        AH(i + 1, 0) = AH(0, i + 1);
+        for (auto j = 0; j < num_sub; j++) {
+          AH(i + 1, j + 1) = 0.5 * (X[i].dot(HX[j]) + X[j].dot(HX[i]));
+        }
+      }
+      Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> eigensolver(AH);
+      Eigen::Matrix<double, Eigen::Dynamic, 1> v = eigensolver.eigenvectors().col(0);
+      auto lambda = eigensolver.eigenvalues()(0);
+      if (std::abs(v(0)) < 1e-12) {
+        break;
+      }
+      step.setZero();
+      H_step.setZero();
+      for (auto i = 0; i < num_sub; i++) {
+        step += (v(i + 1) / v(0)) * X[i];
+        H_step += (v(i + 1) / v(0)) * HX[i];
+      }
+      Eigen::Matrix<double, Eigen::Dynamic, 1> residual = H_step + grad0 - lambda * step;
+      if (residual.norm() < std::max(0.1 * grad0.norm(), std::numeric_limits<double>::epsilon())) {
+        break;
+      }
+      trial = -precondition(residual, lambda);
+    }
+  }
+
+  // restrict to the trust region and compare to the quadratic model
+  if (step.norm() > this->second_order_trust_radius) {
+    auto step_scale = this->second_order_trust_radius / step.norm();
+    step *= step_scale;
+    H_step *= step_scale;
+  }
+  auto E_predicted = grad0.dot(step) + 0.5 * step.dot(H_step);
+  auto E_new = E0;
+  if (step.norm() > 0.0) {
+    E_new = this->second_order_energy_gradient(C_ref, step, grad, hess_diag_unused);
+  }
+  auto ratio = (E_predicted != 0.0) ? (E_new - E0) / E_predicted : 1.0;
+  auto accepted = E_new <= E0;
+  if (ratio < 0.25) {
+    this->second_order_trust_radius *= 0.5;
+  } else if (ratio > 0.75 && step.norm() > 0.9 * this->second_order_trust_radius) {
+    this->second_order_trust_radius = std::min(2.0 * this->second_order_trust_radius, this->second_order_trust_radius_max);
+  }
+  // without a step the finite differences may have left the orbitals and fock matrices rotated
+  if (!accepted || step.norm() == 0.0) {
+    this->C = C_ref;
+    this->F = F0;
+    this->D = D0;
+    this->D_combined = D_combined0;
+    this->E_particles = E_particles0;
+  }
+  this->second_order_canonicalize();
+  this->second_order_rms_error();
+  this->second_order_fock_current = true;
+  this->E_particles_last = E_particles_prev;
+
+  std::string pad(7, ' ');
+  std::string line = pad;
+  line += fmt::format("Second order step: micro {:d} |g| {:.2e} |step| {:.2e} trust {:.2e} ratio {:.3f} {}", micro_iteration, grad0.norm(), step.norm(), this->second_order_trust_radius, ratio,
+                      accepted ? "accepted" : "rejected");
+  Polyquant_cout(line);
+}
+
+void POLYQUANT_EPSCF::guess_DM_hcore() {
+  // this is inefficient but diagonalizing hcore is free compared to CI so who cares.
+
+  auto quantum_part_idx = 0ul;
+  for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+    auto num_basis = this->input_basis->num_basis[quantum_part_idx];
+    for (auto irrep_idx = 0; irrep_idx < this->input_symmetry->irrep_names[quantum_part_idx].size(); irrep_idx++) {
+      auto num_mo = this->num_mo_per_irrep[quantum_part_idx][irrep_idx];
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &c = this->C[quantum_part_idx][0][irrep_idx];
+      if (num_mo == 0) {
+        continue;
+      }
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> H_prime;
+      H_prime.noalias() = this->input_integral->orth_X[quantum_part_idx][irrep_idx].transpose() * this->H_core[quantum_part_idx] * this->input_integral->orth_X[quantum_part_idx][irrep_idx];
+      diag_fock_helper(quantum_part_idx, irrep_idx, H_prime, this->C[quantum_part_idx][0][irrep_idx], this->E_orbitals[quantum_part_idx][0][irrep_idx]);
+      if (quantum_part.num_parts > 1 and quantum_part.restricted == false) {
+        diag_fock_helper(quantum_part_idx, irrep_idx, H_prime, this->C[quantum_part_idx][1][irrep_idx], this->E_orbitals[quantum_part_idx][1][irrep_idx]);
+      }
+    }
+    quantum_part_idx++;
+  }
+}
+
+void POLYQUANT_EPSCF::guess_DM_from_fock(const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &F_guess) {
+  auto quantum_part_idx = 0ul;
+  for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+    for (auto irrep_idx = 0; irrep_idx < this->input_symmetry->irrep_names[quantum_part_idx].size(); irrep_idx++) {
+      auto num_mo = this->num_mo_per_irrep[quantum_part_idx][irrep_idx];
+      if (num_mo == 0) {
+        continue;
+      }
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &X = this->input_integral->orth_X[quantum_part_idx][irrep_idx];
+      for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < F_guess[quantum_part_idx].size(); quantum_part_spin_idx++) {
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> F_prime;
+        F_prime.noalias() = X.transpose() * F_guess[quantum_part_idx][quantum_part_spin_idx] * X;
+        diag_fock_helper(quantum_part_idx, irrep_idx, F_prime, this->C[quantum_part_idx][quantum_part_spin_idx][irrep_idx],
+                         this->E_orbitals[quantum_part_idx][quantum_part_spin_idx][irrep_idx]);
+      }
+    }
+    quantum_part_idx++;
+  }
+}
+
+void POLYQUANT_EPSCF::guess_DM_coulomb_matrix(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &J, const int quantum_part_a_idx, const int quantum_part_b_idx,
+                                              const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &D_b) {
+  // plain coulomb matrix J_ij = sum_kl (ij|kl) D_kl, no charges or spin factors applied
+  auto &shells_a = this->input_basis->basis[quantum_part_a_idx];
+  auto shell2bf_a = shells_a.shell2bf();
+  auto &shells_b = this->input_basis->basis[quantum_part_b_idx];
+  auto shell2bf_b = shells_b.shell2bf();
+  auto num_basis_a = this->input_basis->num_basis[quantum_part_a_idx];
+
+  auto nthreads = omp_get_max_threads();
+  auto max_nprim = std::max(shells_a.max_nprim(), shells_b.max_nprim());
+  auto max_l = std::max(shells_a.max_l(), shells_b.max_l());
+  std::vector<libint2::Engine> engines(nthreads);
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> JA(nthreads);
+  engines[0] = libint2::Engine(libint2::Operator::coulomb, max_nprim, max_l, 0);
+  engines[0].set_precision(0.0);
+  for (int i = 0; i < nthreads; i++) {
+    engines[i] = engines[0];
+    JA[i].setZero(num_basis_a, num_basis_a);
+  }
+#pragma omp parallel
+  {
+    int shellcounter = 0;
+    auto thread_id = omp_get_thread_num();
+    const auto &buf = engines[thread_id].results();
+    for (size_t shell_i = 0; shell_i < shells_a.size(); shell_i++) {
+      for (auto &shell_j : std::get<0>(this->input_integral->unique_shell_pairs[quantum_part_a_idx])[shell_i]) {
+        shellcounter++;
+        if (shellcounter % nthreads != thread_id) {
+          continue;
+        }
+        for (size_t shell_k = 0; shell_k < shells_b.size(); shell_k++) {
+          for (auto &shell_l : std::get<0>(this->input_integral->unique_shell_pairs[quantum_part_b_idx])[shell_k]) {
+            const auto shell_kl_perdeg = (shell_k == shell_l) ? 1.0 : 2.0;
+            engines[thread_id].compute(shells_a[shell_i], shells_a[shell_j], shells_b[shell_k], shells_b[shell_l]);
+            const auto *buf_1234 = buf[0];
+            if (buf_1234 == nullptr) {
+              continue;
+            }
+            auto shell_ijkl_bf = 0;
+            for (auto shell_i_bf = shell2bf_a[shell_i]; shell_i_bf < shell2bf_a[shell_i] + shells_a[shell_i].size(); ++shell_i_bf) {
+              for (auto shell_j_bf = shell2bf_a[shell_j]; shell_j_bf < shell2bf_a[shell_j] + shells_a[shell_j].size(); ++shell_j_bf) {
+                auto J_ij = 0.0;
+                for (auto shell_k_bf = shell2bf_b[shell_k]; shell_k_bf < shell2bf_b[shell_k] + shells_b[shell_k].size(); ++shell_k_bf) {
+                  for (auto shell_l_bf = shell2bf_b[shell_l]; shell_l_bf < shell2bf_b[shell_l] + shells_b[shell_l].size(); ++shell_l_bf) {
+                    J_ij += shell_kl_perdeg * D_b(shell_k_bf, shell_l_bf) * buf_1234[shell_ijkl_bf];
+                    shell_ijkl_bf++;
+                  }
+                }
+                JA[thread_id](shell_i_bf, shell_j_bf) += J_ij;
+                if (shell_i != shell_j) {
+                  JA[thread_id](shell_j_bf, shell_i_bf) += J_ij;
+                }
+              }
+            }
+          }
+        }
+      }
     }
-    this->independent_converged = true;
-    this->independent_converged_iteration_num = this->iteration_num;
-  } else if (this->iteration_num == this->iteration_max) {
-    this->exceeded_iterations = true;
-    this->stop = true;
   }
-  Polyquant_cout(divider);
+  J.setZero(num_basis_a, num_basis_a);
+  for (auto ti = 0; ti < nthreads; ti++) {
+    J += JA[ti];
+  }
 }
 
-void POLYQUANT_EPSCF::reset_diis() {
-  if (this->diis_extrapolation) {
-    this->diis.clear();
-    this->diis.resize(this->input_molecule->quantum_particles.size());
-    auto quantum_part_idx = 0ul;
-    for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
-      auto nspin = 1;
-      if (quantum_part.num_parts > 1 && quantum_part.restricted == false) {
-        nspin = 2;
+void POLYQUANT_EPSCF::guess_DM_atomic_scf(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &D_atom, const std::vector<libint2::Shell> &atom_shells, const std::array<double, 3> &atom_pos,
+                                          const double atom_charge, const QUANTUM_PARTICLE_SET &quantum_part) {
+  // spin restricted SCF of the neutral atom in its own slice of the molecular basis.
+  // Degenerate frontier orbitals are fractionally occupied so the density stays spherical.
+  auto num_basis = libint2::BasisSet::nbf(atom_shells);
+  auto shell2bf = libint2::BasisSet::compute_shell2bf(atom_shells);
+  auto max_nprim = libint2::BasisSet::max_nprim(atom_shells);
+  auto max_l = libint2::BasisSet::max_l(atom_shells);
+  auto num_parts = atom_charge;
+
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> S = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(num_basis, num_basis);
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> H = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(num_basis, num_basis);
+  libint2::Engine overlap_engine(libint2::Operator::overlap, max_nprim, max_l, 0);
+  libint2::Engine kinetic_engine(libint2::Operator::kinetic, max_nprim, max_l, 0);
+  libint2::Engine nuclear_engine(libint2::Operator::nuclear, max_nprim, max_l, 0);
+  nuclear_engine.set_params(std::vector<std::pair<double, std::array<double, 3>>>{{atom_charge, atom_pos}});
+  for (auto s1 = 0ul; s1 < atom_shells.size(); s1++) {
+    auto n1 = atom_shells[s1].size();
+    for (auto s2 = 0ul; s2 < atom_shells.size(); s2++) {
+      auto n2 = atom_shells[s2].size();
+      overlap_engine.compute(atom_shells[s1], atom_shells[s2]);
+      kinetic_engine.compute(atom_shells[s1], atom_shells[s2]);
+      nuclear_engine.compute(atom_shells[s1], atom_shells[s2]);
+      for (size_t f1 = 0, f12 = 0; f1 != n1; ++f1) {
+        for (size_t f2 = 0; f2 != n2; ++f2, ++f12) {
+          S(shell2bf[s1] + f1, shell2bf[s2] + f2) = overlap_engine.results()[0][f12];
+          H(shell2bf[s1] + f1, shell2bf[s2] + f2) = (1.0 / quantum_part.mass) * kinetic_engine.results()[0][f12] + (-quantum_part.charge) * nuclear_engine.results()[0][f12];
+        }
       }
-      // this->diis[quantum_part_idx].resize(nspin);
-      for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < nspin; quantum_part_spin_idx++) {
-        // for (auto irrep_idx = 0; irrep_idx < this->input_symmetry->irrep_names[quantum_part_idx].size(); irrep_idx++) {
-        // this->diis[quantum_part_idx][quantum_part_spin_idx].emplace_back(this->diis_start, this->diis_size, this->diis_damping, 1, 1, this->diis_mixing_fraction);
-        this->diis[quantum_part_idx].emplace_back(this->diis_start, this->diis_size, this->diis_damping, 1, 1, this->diis_mixing_fraction);
-        //}
+    }
+  }
+
+  // canonical orthogonalization with the same linear dependency threshold as the molecule
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> S_eigensolver(S);
+  double thresh = std::pow(10.0, -(this->input_integral->eig_s2_linear_dep_threshold));
+  std::vector<int> keep_cols;
+  for (auto i = 0; i < S_eigensolver.eigenvalues().size(); i++) {
+    if (S_eigensolver.eigenvalues()(i) > thresh) {
+      keep_cols.push_back(i);
+    }
+  }
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> X =
+      S_eigensolver.eigenvectors()(Eigen::all, keep_cols) * S_eigensolver.eigenvalues()(keep_cols).array().rsqrt().matrix().asDiagonal();
+  auto num_mo = X.cols();
+
+  libint2::Engine coulomb_engine(libint2::Operator::coulomb, max_nprim, max_l, 0);
+  coulomb_engine.set_precision(0.0);
+  const auto &buf = coulomb_engine.results();
+  libint2::DIIS<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> atom_diis(2);
+
+  D_atom.setZero(num_basis, num_basis);
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> F = H;
+  auto E_atom = 0.0;
+  for (auto iteration = 0; iteration < this->iteration_max; iteration++) {
+    // D_atom is spin summed so G = J - 1/2 K
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> G = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(num_basis, num_basis);
+    if (iteration > 0) {
+      for (auto s1 = 0ul; s1 < atom_shells.size(); s1++) {
+        for (auto s2 = 0ul; s2 < atom_shells.size(); s2++) {
+          for (auto s3 = 0ul; s3 < atom_shells.size(); s3++) {
+            for (auto s4 = 0ul; s4 < atom_shells.size(); s4++) {
+              coulomb_engine.compute(atom_shells[s1], atom_shells[s2], atom_shells[s3], atom_shells[s4]);
+              const auto *buf_1234 = buf[0];
+              if (buf_1234 == nullptr) {
+                continue;
+              }
+              for (size_t f1 = 0, f1234 = 0; f1 != atom_shells[s1].size(); ++f1) {
+                auto bf1 = shell2bf[s1] + f1;
+                for (size_t f2 = 0; f2 != atom_shells[s2].size(); ++f2) {
+                  auto bf2 = shell2bf[s2] + f2;
+                  for (size_t f3 = 0; f3 != atom_shells[s3].size(); ++f3) {
+                    auto bf3 = shell2bf[s3] + f3;
+                    for (size_t f4 = 0; f4 != atom_shells[s4].size(); ++f4, ++f1234) {
+                      auto bf4 = shell2bf[s4] + f4;
+                      G(bf1, bf2) += D_atom(bf3, bf4) * buf_1234[f1234];
+                      G(bf1, bf3) -= 0.5 * D_atom(bf2, bf4) * buf_1234[f1234];
+                    }
+                  }
+                }
+              }
+            }
+          }
+        }
       }
-      quantum_part_idx++;
     }
+    F = H + G;
+    auto E_atom_last = E_atom;
+    E_atom = 0.5 * (D_atom.array() * (H + F).array()).sum();
+    if (iteration > 1) {
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> FD_commutator = F * D_atom * S - S * D_atom * F;
+      if (std::abs(E_atom - E_atom_last) < this->convergence_E && FD_commutator.norm() / (num_mo * num_mo) < this->convergence_DM) {
+        break;
+      }
+      atom_diis.extrapolate(F, FD_commutator);
+    }
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> F_prime = X.transpose() * F * X;
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> eigensolver(F_prime);
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> C_atom = X * eigensolver.eigenvectors();
+    const auto &E_orb = eigensolver.eigenvalues();
+
+    // fill shells of (near) degenerate orbitals, averaging over the partially filled one
+    Eigen::Matrix<double, Eigen::Dynamic, 1> atom_occ = Eigen::Matrix<double, Eigen::Dynamic, 1>::Zero(num_mo);
+    auto num_parts_left = num_parts;
+    auto orb_start = 0;
+    while (num_parts_left > 0.0 && orb_start < num_mo) {
+      auto orb_end = orb_start + 1;
+      while (orb_end < num_mo && std::abs(E_orb(orb_end) - E_orb(orb_start)) < 1e-4) {
+        orb_end++;
+      }
+      auto num_degenerate = orb_end - orb_start;
+      auto num_parts_shell = std::min(num_parts_left, 2.0 * num_degenerate);
+      atom_occ.segment(orb_start, num_degenerate).setConstant(num_parts_shell / num_degenerate);
+      num_parts_left -= num_parts_shell;
+      orb_start = orb_end;
+    }
+    D_atom.noalias() = C_atom * atom_occ.asDiagonal() * C_atom.transpose();
   }
+  std::stringstream buffer;
+  buffer << "    Atomic guess SCF for Z = " << atom_charge << " with " << num_basis << " basis functions : E = " << std::fixed << std::setprecision(10) << E_atom;
+  Polyquant_cout(buffer.str());
 }
 
-void POLYQUANT_EPSCF::reset_incfock() {
-  if (this->incremental_fock) {
-    incremental_fock_reset_threshold.clear();
-    incremental_fock_reset_iteration.clear();
-    incremental_fock_doing_incremental.clear();
-    incremental_fock_reset_threshold.resize(this->input_molecule->quantum_particles.size());
-    incremental_fock_reset_iteration.resize(this->input_molecule->quantum_particles.size());
-    incremental_fock_doing_incremental.resize(this->input_molecule->quantum_particles.size());
-    auto quantum_part_idx = 0ul;
-    for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
-      if (quantum_part.num_parts == 1) {
-        this->incremental_fock_reset_threshold[quantum_part_idx].resize(1);
-        this->incremental_fock_reset_threshold[quantum_part_idx][0] = this->incremental_fock_initial_onset_thresh / 10.0;
-        this->incremental_fock_reset_iteration[quantum_part_idx].resize(1);
-        this->incremental_fock_reset_iteration[quantum_part_idx][0] = this->iteration_num;
-        this->incremental_fock_doing_incremental[quantum_part_idx].resize(1);
-        this->incremental_fock_doing_incremental[quantum_part_idx][0] = false;
-      } else if (quantum_part.restricted == false) {
-        this->incremental_fock_reset_threshold[quantum_part_idx].resize(2);
-        this->incremental_fock_reset_threshold[quantum_part_idx][0] = this->incremental_fock_initial_onset_thresh / 10.0;
-        this->incremental_fock_reset_threshold[quantum_part_idx][1] = this->incremental_fock_initial_onset_thresh / 10.0;
-        this->incremental_fock_reset_iteration[quantum_part_idx].resize(2);
-        this->incremental_fock_reset_iteration[quantum_part_idx][0] = this->iteration_num;
-        this->incremental_fock_reset_iteration[quantum_part_idx][1] = this->iteration_num;
-        this->incremental_fock_doing_incremental[quantum_part_idx].resize(2);
-        this->incremental_fock_doing_incremental[quantum_part_idx][0] = false;
-        this->incremental_fock_doing_incremental[quantum_part_idx][1] = false;
-      } else {
-        this->incremental_fock_reset_threshold[quantum_part_idx].resize(1);
-        this->incremental_fock_reset_threshold[quantum_part_idx][0] = this->incremental_fock_initial_onset_thresh / 10.0;
-        this->incremental_fock_reset_iteration[quantum_part_idx].resize(1);
-        this->incremental_fock_reset_iteration[quantum_part_idx][0] = this->iteration_num;
-        this->incremental_fock_doing_incremental[quantum_part_idx].resize(1);
-        this->incremental_fock_doing_incremental[quantum_part_idx][0] = false;
+void POLYQUANT_EPSCF::guess_DM_atomic_electron_density(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &D_electron, const int quantum_part_idx) {
+  auto quantum_part_it = this->input_molecule->quantum_particles.begin();
+  std::advance(quantum_part_it, quantum_part_idx);
+  auto &quantum_part = quantum_part_it->second;
+  auto &shells = this->input_basis->basis[quantum_part_idx];
+  auto shell2bf = shells.shell2bf();
+  auto num_basis = this->input_basis->num_basis[quantum_part_idx];
+  D_electron.setZero(num_basis, num_basis);
+
+  // total nuclear charge on each center, quantum nuclei sit on their basis centers
+  auto &centers = this->input_molecule->centers;
+  std::vector<double> center_charge(centers.size(), 0.0);
+  for (auto const &[classical_part_key, classical_part] : this->input_molecule->classical_particles) {
+    for (auto center_idx : classical_part.center_idx) {
+      center_charge[center_idx] += classical_part.charge;
+    }
+  }
+  for (auto const &[other_quantum_part_key, other_quantum_part] : this->input_molecule->quantum_particles) {
+    for (auto center_idx : other_quantum_part.center_idx) {
+      center_charge[center_idx] += other_quantum_part.charge;
+    }
+  }
+
+  for (auto center_idx = 0ul; center_idx < centers.size(); center_idx++) {
+    if (center_charge[center_idx] <= 0.0) {
+      continue;
+    }
+    std::array<double, 3> center_pos = {centers[center_idx][0], centers[center_idx][1], centers[center_idx][2]};
+    std::vector<libint2::Shell> atom_shells;
+    std::vector<size_t> atom_shell_idxs;
+    for (auto shell_idx = 0ul; shell_idx < shells.size(); shell_idx++) {
+      auto dist = std::hypot(shells[shell_idx].O[0] - center_pos[0], shells[shell_idx].O[1] - center_pos[1], shells[shell_idx].O[2] - center_pos[2]);
+      if (dist < 1e-8) {
+        atom_shells.push_back(shells[shell_idx]);
+        atom_shell_idxs.push_back(shell_idx);
+      }
+    }
+    if (atom_shells.size() == 0) {
+      continue;
+    }
+    // atomic densities only depend on the charge and the basis on the atom, not where it is
+    std::stringstream cache_key;
+    cache_key << std::setprecision(17) << center_charge[center_idx];
+    for (auto &shell : atom_shells) {
+      cache_key << "|";
+      for (auto &alpha : shell.alpha) {
+        cache_key << alpha << ",";
+      }
+      for (auto &contr : shell.contr) {
+        cache_key << ";" << contr.l << contr.pure;
+        for (auto &coeff : contr.coeff) {
+          cache_key << "," << coeff;
+        }
+      }
+    }
+    auto cache_it = this->guess_atomic_density_cache.find(cache_key.str());
+    if (cache_it == this->guess_atomic_density_cache.end()) {
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> D_atom;
+      guess_DM_atomic_scf(D_atom, atom_shells, center_pos, center_charge[center_idx], quantum_part);
+      cache_it = this->guess_atomic_density_cache.emplace(cache_key.str(), D_atom).first;
+    }
+    const auto &D_atom = cache_it->second;
+    auto atom_bf_i = 0;
+    for (auto shell_i : atom_shell_idxs) {
+      for (auto shell_i_bf = shell2bf[shell_i]; shell_i_bf < shell2bf[shell_i] + shells[shell_i].size(); shell_i_bf++) {
+        auto atom_bf_j = 0;
+        for (auto shell_j : atom_shell_idxs) {
+          for (auto shell_j_bf = shell2bf[shell_j]; shell_j_bf < shell2bf[shell_j] + shells[shell_j].size(); shell_j_bf++) {
+            D_electron(shell_i_bf, shell_j_bf) = D_atom(atom_bf_i, atom_bf_j);
+            atom_bf_j++;
+          }
+        }
+        atom_bf_i++;
       }
-      quantum_part_idx++;
     }
   }
+  // neutral atoms won't have the right number of electrons for ions or positronic complexes
+  auto num_parts_guess = (D_electron.array() * this->input_integral->overlap[quantum_part_idx].array()).sum();
+  if (num_parts_guess > 0.0) {
+    D_electron *= quantum_part.num_parts / num_parts_guess;
+  }
 }
 
-void POLYQUANT_EPSCF::run_iteration() {
+void POLYQUANT_EPSCF::guess_DM_atomic() {
   auto function = __PRETTY_FUNCTION__;
   POLYQUANT_TIMER timer(function);
-  this->iteration_num += 1;
-  this->form_fock();
-  this->diag_fock();
-  this->form_occ();
-  this->form_DM();
-}
+  auto electron_it = this->input_molecule->quantum_particles.find("electron");
+  if (electron_it == this->input_molecule->quantum_particles.end() || electron_it->second.num_parts == 0) {
+    Polyquant_cout("No electrons for a " + this->guess_mode + " guess. Falling back to the core hamiltonian guess.");
+    guess_DM_hcore();
+    return;
+  }
+  const int electron_idx = std::distance(this->input_molecule->quantum_particles.begin(), electron_it);
+  const auto &electron = electron_it->second;
 
-void POLYQUANT_EPSCF::guess_DM_hcore() {
-  // this is inefficient but diagonalizing hcore is free compared to CI so who cares.
+  libint2::initialize();
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> D_electron;
+  guess_DM_atomic_electron_density(D_electron, electron_idx);
 
+  // densities laid out like D_combined so the direct fock build can be reused
+  std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> D_guess(this->input_molecule->quantum_particles.size());
+  std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> F_guess(this->input_molecule->quantum_particles.size());
   auto quantum_part_idx = 0ul;
   for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
     auto num_basis = this->input_basis->num_basis[quantum_part_idx];
-    for (auto irrep_idx = 0; irrep_idx < this->input_symmetry->irrep_names[quantum_part_idx].size(); irrep_idx++) {
-      auto num_mo = this->num_mo_per_irrep[quantum_part_idx][irrep_idx];
-      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &c = this->C[quantum_part_idx][0][irrep_idx];
-      if (num_mo == 0) {
-        continue;
+    D_guess[quantum_part_idx].resize(this->D_combined[quantum_part_idx].size());
+    F_guess[quantum_part_idx].resize(this->D_combined[quantum_part_idx].size());
+    for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < D_guess[quantum_part_idx].size(); quantum_part_spin_idx++) {
+      D_guess[quantum_part_idx][quantum_part_spin_idx].setZero(num_basis, num_basis);
+      F_guess[quantum_part_idx][quantum_part_spin_idx] = this->H_core[quantum_part_idx];
+    }
+    quantum_part_idx++;
+  }
+  if (electron.num_parts == 1) {
+    D_guess[electron_idx][0] = D_electron;
+  } else if (electron.restricted) {
+    D_guess[electron_idx][0] = 0.5 * D_electron;
+  } else {
+    D_guess[electron_idx][0] = (static_cast<double>(electron.num_parts_alpha) / electron.num_parts) * D_electron;
+    D_guess[electron_idx][1] = (static_cast<double>(electron.num_parts_beta) / electron.num_parts) * D_electron;
+  }
+
+  // the guess fock build is a full build of the atomic density. A zero last density keeps it from being incremental, and skipping the
+  // petite list and the MPI split makes it the same plain build on every rank
+  auto D_guess_zero = D_guess;
+  for (auto &D_part : D_guess_zero) {
+    for (auto &D_spin : D_part) {
+      D_spin.setZero();
+    }
+  }
+  const auto incremental_fock_saved = this->incremental_fock;
+  const auto petite_list_active_saved = this->petite_list_active;
+  this->incremental_fock = false;
+  this->petite_list_active = false;
+  quantum_part_idx = 0ul;
+  for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+    if (quantum_part_idx == electron_idx && this->guess_mode == "sad") {
+      for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < F_guess[quantum_part_idx].size(); quantum_part_spin_idx++) {
+        for (auto electron_spin_idx = 0; electron_spin_idx < D_guess[electron_idx].size(); electron_spin_idx++) {
+          form_fock_helper_single_fock_matrix(F_guess[quantum_part_idx][quantum_part_spin_idx], D_guess, D_guess_zero, quantum_part, quantum_part_idx, quantum_part_spin_idx, electron,
+                                              electron_idx, electron_spin_idx, 0, true, true);
+        }
       }
-      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> H_prime;
-      H_prime.noalias() = this->input_integral->orth_X[quantum_part_idx][irrep_idx].transpose() * this->H_core[quantum_part_idx] * this->input_integral->orth_X[quantum_part_idx][irrep_idx];
-      diag_fock_helper(quantum_part_idx, irrep_idx, H_prime, this->C[quantum_part_idx][0][irrep_idx], this->E_orbitals[quantum_part_idx][0][irrep_idx]);
-      if (quantum_part.num_parts > 1 and quantum_part.restricted == false) {
-        diag_fock_helper(quantum_part_idx, irrep_idx, H_prime, this->C[quantum_part_idx][1][irrep_idx], this->E_orbitals[quantum_part_idx][1][irrep_idx]);
+    } else {
+      // sad_coulomb electrons, and every other species, in the coulomb field of the atomic electron clouds
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> J;
+      guess_DM_coulomb_matrix(J, quantum_part_idx, electron_idx, D_electron);
+      for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < F_guess[quantum_part_idx].size(); quantum_part_spin_idx++) {
+        F_guess[quantum_part_idx][quantum_part_spin_idx] += quantum_part.charge * electron.charge * J;
       }
     }
     quantum_part_idx++;
   }
+  this->incremental_fock = incremental_fock_saved;
+  this->petite_list_active = petite_list_active_saved;
+  libint2::finalize();
+  guess_DM_from_fock(F_guess);
 }
 
 void POLYQUANT_EPSCF::guess_DM() {
-  // TODO SAD or SAP
-  guess_DM_hcore();
+  if (this->guess_mode == "hcore") {
+    guess_DM_hcore();
+  } else if (this->guess_mode == "sad" || this->guess_mode == "sad_coulomb") {
+    guess_DM_atomic();
+  } else {
+    APP_ABORT("Unknown guess_mode : " + this->guess_mode + ". Known guess modes are hcore, sad, and sad_coulomb.");
+  }
+}
+
+void POLYQUANT_EPSCF::guess_DM_from_previous(std::shared_ptr<POLYQUANT_EPSCF> previous_scf) {
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  auto num_parts = this->input_molecule->quantum_particles.size();
+  bool can_project = previous_scf->C_combined.size() == num_parts;
+  for (auto quantum_part_idx = 0; can_project && quantum_part_idx < num_parts; quantum_part_idx++) {
+    // more previous orbitals than this basis can hold can't be orthonormalized
+    can_project = previous_scf->C_combined[quantum_part_idx].size() != 0 && previous_scf->C_combined[quantum_part_idx][0].cols() <= this->num_mo[quantum_part_idx];
+  }
+  if (!can_project) {
+    APP_WARN("The previous orbitals don't fit this calculation. Falling back to guess_mode " + this->guess_mode + ".");
+    this->guess_DM();
+    return;
+  }
+  Polyquant_cout("Projecting the previous orbitals onto the current basis");
+  // The projected orbitals C and their previous energies e are turned into F = S C (e - shift) C^T S. Diagonalizing F in each irrep gives back
+  // the projected orbitals in the previous order, symmetry adapted, with the part of the basis they don't span (eigenvalue 0) above them.
+  std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> F_guess(num_parts);
+  libint2::initialize();
+  for (auto quantum_part_idx = 0; quantum_part_idx < num_parts; quantum_part_idx++) {
+    const auto &S = this->input_integral->overlap[quantum_part_idx];
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> S_mixed;
+    this->input_integral->compute_1body_ints_mixed_basis(S_mixed, this->input_basis->basis[quantum_part_idx], previous_scf->input_basis->basis[quantum_part_idx],
+                                                         libint2::Operator::overlap);
+    auto S_ldlt = S.ldlt();
+    F_guess[quantum_part_idx].resize(this->F[quantum_part_idx].size());
+    for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < this->F[quantum_part_idx].size(); quantum_part_spin_idx++) {
+      auto previous_spin_idx = std::min<int>(quantum_part_spin_idx, previous_scf->C_combined[quantum_part_idx].size() - 1);
+      const auto &C_previous = previous_scf->C_combined[quantum_part_idx][previous_spin_idx];
+      const auto &E_previous = previous_scf->E_orbitals_combined[quantum_part_idx][previous_spin_idx];
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> C_projected = S_ldlt.solve(S_mixed * C_previous);
+      reorthogonalize_MOs(C_projected, quantum_part_idx);
+      Eigen::Matrix<double, Eigen::Dynamic, 1> E_shifted = E_previous.array() - (E_previous.maxCoeff() + 1.0);
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> SC = S * C_projected;
+      F_guess[quantum_part_idx][quantum_part_spin_idx].noalias() = SC * E_shifted.asDiagonal() * SC.transpose();
+    }
+  }
+  libint2::finalize();
+  this->guess_DM_from_fock(F_guess);
 }
 
 void POLYQUANT_EPSCF::resize_objects() {
   freeze_density.resize(this->input_molecule->quantum_particles.size(), false);
+  this->independent_particle_converged.assign(this->input_molecule->quantum_particles.size(), false);
+  this->frozen_potential_formed = false;
 
   this->E_particles.resize(this->input_molecule->quantum_particles.size());
   this->E_particles_last.resize(this->input_molecule->quantum_particles.size());
@@ -1446,6 +3576,7 @@ void POLYQUANT_EPSCF::print_params() {
   std::stringstream buffer;
   buffer << "Parameters" << std::endl;
   buffer << "    Maximum iterations = " << iteration_max << std::endl;
+  buffer << "    guess_mode = " << this->guess_mode << std::endl;
   buffer << "    convergence_E = " << std::scientific << this->convergence_E << std::endl;
   buffer << "    convergence_DM = " << std::scientific << this->convergence_DM << std::endl;
   buffer << "    diis_extrapolation = " << this->diis_extrapolation << std::endl;
@@ -1453,12 +3584,38 @@ void POLYQUANT_EPSCF::print_params() {
   buffer << "    diis_damping = " << this->diis_damping << std::endl;
   buffer << "    diis_mixing_fraction = " << this->diis_mixing_fraction << std::endl;
   buffer << "    diis_size = " << this->diis_size << std::endl;
+  buffer << "    coupled_diis = " << this->coupled_diis << std::endl;
+  buffer << "    diis_energy_mode = " << this->diis_energy_mode << std::endl;
+  buffer << "    concurrent_independent_particles = " << this->concurrent_independent_particles << std::endl;
+  buffer << "    density_fitting = " << this->density_fitting << std::endl;
+  buffer << "    coulomb_engine = " << this->coulomb_engine << std::endl;
+  buffer << "    coulomb_engine_threshold = " << this->coulomb_engine_threshold << std::endl;
+  buffer << "    checkpoint_filename = " << this->checkpoint_filename << std::endl;
+  buffer << "    checkpoint_frequency = " << this->checkpoint_frequency << std::endl;
+  buffer << "    restart_from_checkpoint = " << this->restart_from_checkpoint << std::endl;
+  buffer << "    telemetry_filename = " << this->telemetry_filename << std::endl;
+  buffer << "    partial_diag = " << this->partial_diag << std::endl;
+  buffer << "    partial_diag_min_size = " << this->partial_diag_min_size << std::endl;
+  buffer << "    partial_diag_extra_virtuals = " << this->partial_diag_extra_virtuals << std::endl;
+  buffer << "    petite_list = " << this->petite_list << std::endl;
+  buffer << "    link_exchange = " << this->link_exchange << std::endl;
+  buffer << "    link_threshold = " << this->link_threshold << std::endl;
+  buffer << "    cfmm = " << this->cfmm << std::endl;
+  buffer << "    cfmm_well_separated = " << this->cfmm_well_separated << std::endl;
+  buffer << "    cfmm_box_size = " << this->cfmm_box_size << std::endl;
+  buffer << "    cfmm_extent_threshold = " << this->cfmm_extent_threshold << std::endl;
   buffer << "    incremental_fock = " << this->incremental_fock << std::endl;
   buffer << "    incremental_fock_reset_freq = " << this->incremental_fock_reset_freq << std::endl;
   buffer << "    incremental_fock_initial_onset_thresh = " << this->incremental_fock_initial_onset_thresh << std::endl;
+  buffer << "    second_order = " << this->second_order << std::endl;
+  buffer << "    second_order_stall_iterations = " << this->second_order_stall_iterations << std::endl;
+  buffer << "    second_order_trust_radius = " << this->second_order_trust_radius_start << std::endl;
+  buffer << "    second_order_max_micro_iterations = " << this->second_order_max_micro_iterations << std::endl;
+  buffer << "    second_order_hessian = " << this->second_order_hessian << std::endl;
   buffer << "    Cauchy_Schwarz_screening = " << this->Cauchy_Schwarz_screening << std::endl;
   // buffer << "    Cauchy_Schwarz_threshold = " << this->Cauchy_Schwarz_threshold << std::endl;
   buffer << "    Independent converged = " << std::boolalpha << this->independent_converged << std::endl;
+  buffer << "    cache_frozen_potential = " << std::boolalpha << this->cache_frozen_potential << std::endl;
   buffer << "    Freeze density   " << std::endl;
   auto quantum_part_idx = 0ul;
   for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
@@ -1554,9 +3711,19 @@ void POLYQUANT_EPSCF::calculate_integrals() {
   this->input_integral->calculate_nuclear();
   this->input_integral->calculate_unique_shell_pairs();
   // this->input_integral->calculate_two_electron();
-  if (this->Cauchy_Schwarz_screening) {
+  if (this->Cauchy_Schwarz_screening || this->coulomb_engine || this->cfmm || this->link_exchange) {
     this->input_integral->calculate_Schwarz();
   }
+  if (this->petite_list) {
+    this->form_petite_list();
+  }
+  if (this->density_fitting) {
+    if (this->input_basis->aux_basis.size() == 0) {
+      APP_WARN("density_fitting was requested but 'model->aux_basis' is missing. Using the exact four center fock build.");
+    } else {
+      this->input_integral->calculate_density_fitting();
+    }
+  }
 }
 void POLYQUANT_EPSCF::setup_standard() {
   this->print_start_iterations();
@@ -1582,10 +3749,27 @@ void POLYQUANT_EPSCF::run() {
   std::string divider(95, '-');
   while (!this->stop) {
     Polyquant_cout(divider);
+    this->telemetry_time_fock = 0.0;
+    this->telemetry_time_diis = 0.0;
+    this->telemetry_time_diag = 0.0;
+    this->telemetry_quartets_computed = 0;
+    this->telemetry_quartets_screened = 0;
+    this->telemetry_quartets_far_field = 0;
+    std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> D_previous;
+    if (!this->telemetry_filename.empty()) {
+      D_previous = this->D_combined;
+    }
+    auto iteration_start = std::chrono::steady_clock::now();
     this->run_iteration();
     // this->print_iteration();
     //  check stop now prints and looks better
     this->check_stop();
+    if (!this->telemetry_filename.empty()) {
+      this->write_telemetry(std::chrono::duration<double>(std::chrono::steady_clock::now() - iteration_start).count(), D_previous);
+    }
+    if (!this->checkpoint_filename.empty() && (this->stop || this->iteration_num % this->checkpoint_frequency == 0)) {
+      this->write_checkpoint();
+    }
   }
   this->calculate_E_total();
   if (this->stop && this->converged) {
@@ -1598,6 +3782,349 @@ void POLYQUANT_EPSCF::run() {
   }
 }
 
+void POLYQUANT_EPSCF::write_telemetry(const double iteration_time, const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &D_previous) {
+  if (Polyquant_mpi_rank() != 0) {
+    return;
+  }
+  json record;
+  record["iteration"] = this->iteration_num;
+  record["second_order"] = this->second_order_active;
+  record["independent_converged"] = this->independent_converged;
+  record["converged"] = this->converged;
+  record["threads"] = omp_get_max_threads();
+  record["mpi_ranks"] = Polyquant_mpi_size();
+  auto E_parts = 0.0;
+  auto quantum_part_idx = 0ul;
+  for (auto const &[quantum_part_key, quantum_part] : this->input_molecule->quantum_particles) {
+    json species;
+    species["energy"] = this->E_particles[quantum_part_idx];
+    E_parts += this->E_particles[quantum_part_idx];
+    if (quantum_part_idx < this->iteration_E_diff.size()) {
+      species["energy_change"] = this->iteration_E_diff[quantum_part_idx];
+    }
+    species["diis_error"] = json::array();
+    species["density_change"] = json::array();
+    for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < this->D_combined[quantum_part_idx].size(); quantum_part_spin_idx++) {
+      species["diis_error"].push_back(this->iteration_rms_error[quantum_part_idx][quantum_part_spin_idx]);
+      const auto &D_now = this->D_combined[quantum_part_idx][quantum_part_spin_idx];
+      auto density_change = 0.0;
+      if (quantum_part_idx < D_previous.size() && quantum_part_spin_idx < D_previous[quantum_part_idx].size() && D_previous[quantum_part_idx][quantum_part_spin_idx].size() == D_now.size() &&
+          D_now.size() != 0) {
+        // rms change of the density elements
+        density_change = (D_now - D_previous[quantum_part_idx][quantum_part_spin_idx]).norm() / std::sqrt(static_cast<double>(D_now.size()));
+      }
+      species["density_change"].push_back(density_change);
+    }
+    record["species"][quantum_part_key] = species;
+    quantum_part_idx++;
+  }
+  record["E_particles_total"] = E_parts;
+  record["time"]["iteration"] = iteration_time;
+  record["time"]["fock"] = this->telemetry_time_fock;
+  record["time"]["diis"] = this->telemetry_time_diis;
+  record["time"]["diag"] = this->telemetry_time_diag;
+  record["time"]["other"] = std::max(iteration_time - this->telemetry_time_fock - this->telemetry_time_diis - this->telemetry_time_diag, 0.0);
+  record["quartets"]["computed"] = this->telemetry_quartets_computed;
+  record["quartets"]["screened"] = this->telemetry_quartets_screened;
+  record["quartets"]["far_field"] = this->telemetry_quartets_far_field;
+  record["fock_builds"] = this->num_fock_builds;
+
+  std::ofstream telemetry_file(this->telemetry_filename, std::ios::app);
+  if (!telemetry_file) {
+    APP_WARN("Could not open telemetry file " + this->telemetry_filename);
+    return;
+  }
+  // dump() with no indent keeps each record on a single line
+  telemetry_file << record.dump() << std::endl;
+}
+
+void POLYQUANT_EPSCF::setup_from_previous(std::shared_ptr<POLYQUANT_EPSCF> previous_scf) {
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  this->print_start_iterations();
+  this->print_params();
+  this->calculate_integrals();
+  this->form_H_core();
+  this->resize_objects();
+  this->guess_DM_from_previous(previous_scf);
+  if (this->npart_per_irrep.size() == 0) {
+    this->form_occ_helper_initial_npart_per_irrep();
+  } else {
+    this->form_occ_helper_initial_npart_per_irrep_from_input();
+  }
+  this->form_occ();
+  this->form_DM();
+}
+
+void POLYQUANT_EPSCF::setup_from_checkpoint() {
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  this->print_start_iterations();
+  this->print_params();
+  this->calculate_integrals();
+  this->form_H_core();
+  this->resize_objects();
+  if (this->npart_per_irrep.size() == 0) {
+    this->form_occ_helper_initial_npart_per_irrep();
+  } else {
+    this->form_occ_helper_initial_npart_per_irrep_from_input();
+  }
+  this->read_checkpoint();
+}
+
+void POLYQUANT_EPSCF::write_checkpoint() {
+  if (Polyquant_mpi_rank() != 0) {
+    return;
+  }
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  std::string tmp_filename = this->checkpoint_filename + ".tmp";
+  std::filesystem::remove(tmp_filename);
+  {
+    POLYQUANT_HDF5 checkpoint(tmp_filename);
+    // HDF5 can't hold empty datasets, unset matrices and vectors are just left out
+    auto dump_matrix = [&](const auto &mat, const std::string &path) {
+      if (mat.size() != 0) {
+        checkpoint.dump_data(mat, path);
+      }
+    };
+    checkpoint.dump_data(this->iteration_num, "/scf/iteration_num");
+    checkpoint.dump_data(static_cast<int>(this->converged), "/scf/converged");
+    checkpoint.dump_data(static_cast<int>(this->independent_converged), "/scf/independent_converged");
+    checkpoint.dump_data(this->independent_converged_iteration_num, "/scf/independent_converged_iteration_num");
+    checkpoint.dump_data(this->E_total, "/scf/E_total");
+    dump_matrix(this->E_particles, "/scf/E_particles");
+    dump_matrix(this->E_particles_last, "/scf/E_particles_last");
+    dump_matrix(this->iteration_E_diff, "/scf/iteration_E_diff");
+    checkpoint.dump_data(static_cast<int>(this->second_order_active), "/scf/second_order_active");
+    checkpoint.dump_data(this->second_order_trust_radius, "/scf/second_order_trust_radius");
+    dump_matrix(this->second_order_error_history, "/scf/second_order_error_history");
+    checkpoint.dump_data(static_cast<int>(this->partial_diag_used), "/scf/partial_diag_used");
+
+    checkpoint.dump_data(this->coupled_diis_num_calls, "/scf/coupled_diis/num_calls");
+    checkpoint.dump_data(static_cast<int>(this->coupled_diis_F.size()), "/scf/coupled_diis/num_entries");
+    for (auto entry_idx = 0; entry_idx < this->coupled_diis_F.size(); entry_idx++) {
+      std::string entry_group = "/scf/coupled_diis/entry_" + std::to_string(entry_idx);
+      checkpoint.dump_data(this->coupled_diis_E[entry_idx], entry_group + "/E");
+      for (auto block_idx = 0; block_idx < this->coupled_diis_F[entry_idx].size(); block_idx++) {
+        std::string block_group = entry_group + "/block_" + std::to_string(block_idx);
+        dump_matrix(this->coupled_diis_F[entry_idx][block_idx], block_group + "/F");
+        dump_matrix(this->coupled_diis_D[entry_idx][block_idx], block_group + "/D");
+        dump_matrix(this->coupled_diis_error[entry_idx][block_idx], block_group + "/error");
+      }
+    }
+
+    for (auto quantum_part_idx = 0; quantum_part_idx < this->input_molecule->quantum_particles.size(); quantum_part_idx++) {
+      std::string part_group = "/scf/particle_" + std::to_string(quantum_part_idx);
+      checkpoint.dump_data(static_cast<int>(this->independent_particle_converged[quantum_part_idx]), part_group + "/independent_particle_converged");
+      dump_matrix(this->iteration_rms_error[quantum_part_idx], part_group + "/iteration_rms_error");
+      for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < this->F[quantum_part_idx].size(); quantum_part_spin_idx++) {
+        std::string spin_group = part_group + "/spin_" + std::to_string(quantum_part_spin_idx);
+        dump_matrix(this->F[quantum_part_idx][quantum_part_spin_idx], spin_group + "/F");
+        dump_matrix(this->D_combined[quantum_part_idx][quantum_part_spin_idx], spin_group + "/D_combined");
+        // the reference density of incremental fock builds
+        dump_matrix(this->D_last_combined[quantum_part_idx][quantum_part_spin_idx], spin_group + "/D_last_combined");
+        if (this->incremental_fock) {
+          checkpoint.dump_data(this->incremental_fock_doing_incremental[quantum_part_idx][quantum_part_spin_idx], spin_group + "/incremental_fock_doing_incremental");
+          checkpoint.dump_data(this->incremental_fock_reset_threshold[quantum_part_idx][quantum_part_spin_idx], spin_group + "/incremental_fock_reset_threshold");
+          checkpoint.dump_data(this->incremental_fock_reset_iteration[quantum_part_idx][quantum_part_spin_idx], spin_group + "/incremental_fock_reset_iteration");
+        }
+        if (this->diis_extrapolation) {
+          const auto &history = this->diis_history[quantum_part_idx][quantum_part_spin_idx];
+          checkpoint.dump_data(this->diis_num_calls[quantum_part_idx][quantum_part_spin_idx], spin_group + "/diis/num_calls");
+          checkpoint.dump_data(static_cast<int>(history.size()), spin_group + "/diis/num_entries");
+          for (auto entry_idx = 0; entry_idx < history.size(); entry_idx++) {
+            std::string entry_group = spin_group + "/diis/entry_" + std::to_string(entry_idx);
+            dump_matrix(history[entry_idx].first, entry_group + "/F");
+            dump_matrix(history[entry_idx].second, entry_group + "/error");
+          }
+        }
+        if (quantum_part_idx < this->npart_per_irrep.size() && quantum_part_spin_idx < this->npart_per_irrep[quantum_part_idx].size()) {
+          checkpoint.dump_data(this->npart_per_irrep[quantum_part_idx][quantum_part_spin_idx], spin_group + "/npart_per_irrep");
+        }
+        for (auto irrep_idx = 0; irrep_idx < this->C[quantum_part_idx][quantum_part_spin_idx].size(); irrep_idx++) {
+          std::string irrep_group = spin_group + "/irrep_" + std::to_string(irrep_idx);
+          dump_matrix(this->C[quantum_part_idx][quantum_part_spin_idx][irrep_idx], irrep_group + "/C");
+          dump_matrix(this->D[quantum_part_idx][quantum_part_spin_idx][irrep_idx], irrep_group + "/D");
+          dump_matrix(this->D_last[quantum_part_idx][quantum_part_spin_idx][irrep_idx], irrep_group + "/D_last");
+          dump_matrix(this->E_orbitals[quantum_part_idx][quantum_part_spin_idx][irrep_idx], irrep_group + "/E_orbitals");
+          dump_matrix(this->occ[quantum_part_idx][quantum_part_spin_idx][irrep_idx], irrep_group + "/occ");
+          if (!this->C_ref_mom.empty()) {
+            dump_matrix(this->C_ref_mom[quantum_part_idx][quantum_part_spin_idx][irrep_idx], irrep_group + "/C_ref_mom");
+          }
+        }
+      }
+    }
+  }
+  std::filesystem::rename(tmp_filename, this->checkpoint_filename);
+  Polyquant_cout("Wrote checkpoint " + this->checkpoint_filename);
+}
+
+void POLYQUANT_EPSCF::read_checkpoint() {
+  auto function = __PRETTY_FUNCTION__;
+  POLYQUANT_TIMER timer(function);
+  // only rank 0 reads the file, the others get everything from it
+  if (Polyquant_mpi_rank() == 0) {
+    if (!std::filesystem::exists(this->checkpoint_filename)) {
+      APP_ABORT("Can't restart, checkpoint " + this->checkpoint_filename + " does not exist.");
+    }
+    Polyquant_cout("Restarting from checkpoint " + this->checkpoint_filename);
+    POLYQUANT_HDF5 checkpoint(this->checkpoint_filename);
+    auto load_matrix = [&](auto &mat, const std::string &path) {
+      if (checkpoint.exist(path)) {
+        checkpoint.load_data(mat, path);
+      }
+    };
+    auto load_flag = [&](const std::string &path) {
+      int flag = 0;
+      checkpoint.load_data(flag, path);
+      return flag != 0;
+    };
+    checkpoint.load_data(this->iteration_num, "/scf/iteration_num");
+    this->converged = load_flag("/scf/converged");
+    this->independent_converged = load_flag("/scf/independent_converged");
+    checkpoint.load_data(this->independent_converged_iteration_num, "/scf/independent_converged_iteration_num");
+    checkpoint.load_data(this->E_total, "/scf/E_total");
+    load_matrix(this->E_particles, "/scf/E_particles");
+    load_matrix(this->E_particles_last, "/scf/E_particles_last");
+    load_matrix(this->iteration_E_diff, "/scf/iteration_E_diff");
+    this->second_order_active = load_flag("/scf/second_order_active");
+    checkpoint.load_data(this->second_order_trust_radius, "/scf/second_order_trust_radius");
+    load_matrix(this->second_order_error_history, "/scf/second_order_error_history");
+    this->partial_diag_used = load_flag("/scf/partial_diag_used");
+
+    checkpoint.load_data(this->coupled_diis_num_calls, "/scf/coupled_diis/num_calls");
+    int num_coupled_entries = 0;
+    checkpoint.load_data(num_coupled_entries, "/scf/coupled_diis/num_entries");
+    for (auto entry_idx = 0; entry_idx < num_coupled_entries; entry_idx++) {
+      std::string entry_group = "/scf/coupled_diis/entry_" + std::to_string(entry_idx);
+      double E_entry = 0.0;
+      checkpoint.load_data(E_entry, entry_group + "/E");
+      this->coupled_diis_E.push_back(E_entry);
+      std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> F_entry, D_entry, error_entry;
+      for (auto block_idx = 0; checkpoint.exist(entry_group + "/block_" + std::to_string(block_idx)); block_idx++) {
+        std::string block_group = entry_group + "/block_" + std::to_string(block_idx);
+        F_entry.emplace_back();
+        D_entry.emplace_back();
+        error_entry.emplace_back();
+        load_matrix(F_entry.back(), block_group + "/F");
+        load_matrix(D_entry.back(), block_group + "/D");
+        load_matrix(error_entry.back(), block_group + "/error");
+      }
+      this->coupled_diis_F.push_back(F_entry);
+      this->coupled_diis_D.push_back(D_entry);
+      this->coupled_diis_error.push_back(error_entry);
+    }
+
+    for (auto quantum_part_idx = 0; quantum_part_idx < this->input_molecule->quantum_particles.size(); quantum_part_idx++) {
+      std::string part_group = "/scf/particle_" + std::to_string(quantum_part_idx);
+      if (!checkpoint.exist(part_group)) {
+        APP_ABORT("Checkpoint " + this->checkpoint_filename + " has no " + part_group + ". Was it written for a different system?");
+      }
+      this->independent_particle_converged[quantum_part_idx] = load_flag(part_group + "/independent_particle_converged");
+      load_matrix(this->iteration_rms_error[quantum_part_idx], part_group + "/iteration_rms_error");
+      for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < this->F[quantum_part_idx].size(); quantum_part_spin_idx++) {
+        std::string spin_group = part_group + "/spin_" + std::to_string(quantum_part_spin_idx);
+        load_matrix(this->F[quantum_part_idx][quantum_part_spin_idx], spin_group + "/F");
+        load_matrix(this->D_combined[quantum_part_idx][quantum_part_spin_idx], spin_group + "/D_combined");
+        load_matrix(this->D_last_combined[quantum_part_idx][quantum_part_spin_idx], spin_group + "/D_last_combined");
+        if (this->incremental_fock && checkpoint.exist(spin_group + "/incremental_fock_doing_incremental")) {
+          checkpoint.load_data(this->incremental_fock_doing_incremental[quantum_part_idx][quantum_part_spin_idx], spin_group + "/incremental_fock_doing_incremental");
+          checkpoint.load_data(this->incremental_fock_reset_threshold[quantum_part_idx][quantum_part_spin_idx], spin_group + "/incremental_fock_reset_threshold");
+          checkpoint.load_data(this->incremental_fock_reset_iteration[quantum_part_idx][quantum_part_spin_idx], spin_group + "/incremental_fock_reset_iteration");
+        }
+        if (this->diis_extrapolation && checkpoint.exist(spin_group + "/diis")) {
+          auto &history = this->diis_history[quantum_part_idx][quantum_part_spin_idx];
+          int num_entries = 0;
+          checkpoint.load_data(this->diis_num_calls[quantum_part_idx][quantum_part_spin_idx], spin_group + "/diis/num_calls");
+          checkpoint.load_data(num_entries, spin_group + "/diis/num_entries");
+          history.resize(num_entries);
+          for (auto entry_idx = 0; entry_idx < num_entries; entry_idx++) {
+            std::string entry_group = spin_group + "/diis/entry_" + std::to_string(entry_idx);
+            checkpoint.load_data(history[entry_idx].first, entry_group + "/F");
+            checkpoint.load_data(history[entry_idx].second, entry_group + "/error");
+          }
+        }
+        if (checkpoint.exist(spin_group + "/npart_per_irrep")) {
+          checkpoint.load_data(this->npart_per_irrep[quantum_part_idx][quantum_part_spin_idx], spin_group + "/npart_per_irrep");
+        }
+        for (auto irrep_idx = 0; irrep_idx < this->C[quantum_part_idx][quantum_part_spin_idx].size(); irrep_idx++) {
+          std::string irrep_group = spin_group + "/irrep_" + std::to_string(irrep_idx);
+          load_matrix(this->C[quantum_part_idx][quantum_part_spin_idx][irrep_idx], irrep_group + "/C");
+          load_matrix(this->D[quantum_part_idx][quantum_part_spin_idx][irrep_idx], irrep_group + "/D");
+          load_matrix(this->D_last[quantum_part_idx][quantum_part_spin_idx][irrep_idx], irrep_group + "/D_last");
+          load_matrix(this->E_orbitals[quantum_part_idx][quantum_part_spin_idx][irrep_idx], irrep_group + "/E_orbitals");
+          load_matrix(this->occ[quantum_part_idx][quantum_part_spin_idx][irrep_idx], irrep_group + "/occ");
+          if (checkpoint.exist(irrep_group + "/C_ref_mom")) {
+            if (this->C_ref_mom.empty()) {
+              this->C_ref_mom = this->C;
+            }
+            load_matrix(this->C_ref_mom[quantum_part_idx][quantum_part_spin_idx][irrep_idx], irrep_group + "/C_ref_mom");
+          }
+        }
+      }
+    }
+  }
+  Polyquant_mpi_broadcast(this->iteration_num);
+  Polyquant_mpi_broadcast(this->converged);
+  Polyquant_mpi_broadcast(this->independent_converged);
+  Polyquant_mpi_broadcast(this->independent_converged_iteration_num);
+  Polyquant_mpi_broadcast(this->E_total);
+  Polyquant_mpi_broadcast(this->E_particles);
+  Polyquant_mpi_broadcast(this->E_particles_last);
+  Polyquant_mpi_broadcast(this->iteration_E_diff);
+  Polyquant_mpi_broadcast(this->second_order_active);
+  Polyquant_mpi_broadcast(this->second_order_trust_radius);
+  Polyquant_mpi_broadcast(this->second_order_error_history);
+  Polyquant_mpi_broadcast(this->partial_diag_used);
+  Polyquant_mpi_broadcast(this->coupled_diis_num_calls);
+  Polyquant_mpi_broadcast(this->coupled_diis_E);
+  Polyquant_mpi_broadcast(this->coupled_diis_F);
+  Polyquant_mpi_broadcast(this->coupled_diis_D);
+  Polyquant_mpi_broadcast(this->coupled_diis_error);
+  Polyquant_mpi_broadcast(this->independent_particle_converged);
+  Polyquant_mpi_broadcast(this->iteration_rms_error);
+  Polyquant_mpi_broadcast(this->F);
+  Polyquant_mpi_broadcast(this->D_combined);
+  Polyquant_mpi_broadcast(this->D_last_combined);
+  if (this->incremental_fock) {
+    Polyquant_mpi_broadcast(this->incremental_fock_doing_incremental);
+    Polyquant_mpi_broadcast(this->incremental_fock_reset_threshold);
+    Polyquant_mpi_broadcast(this->incremental_fock_reset_iteration);
+  }
+  Polyquant_mpi_broadcast(this->diis_history);
+  Polyquant_mpi_broadcast(this->diis_num_calls);
+  Polyquant_mpi_broadcast(this->npart_per_irrep);
+  Polyquant_mpi_broadcast(this->C);
+  Polyquant_mpi_broadcast(this->D);
+  Polyquant_mpi_broadcast(this->D_last);
+  Polyquant_mpi_broadcast(this->E_orbitals);
+  Polyquant_mpi_broadcast(this->occ);
+  Polyquant_mpi_broadcast(this->C_ref_mom);
+  this->stop = this->converged;
+
+  if (this->diis_extrapolation) {
+    // a DIIS object only depends on its last diis_size inputs and how many it has seen, so replaying the kept inputs into a fresh one with the
+    // start shifted by the inputs that were dropped rebuilds it exactly
+    for (auto quantum_part_idx = 0; quantum_part_idx < this->diis.size(); quantum_part_idx++) {
+      for (auto quantum_part_spin_idx = 0; quantum_part_spin_idx < this->diis[quantum_part_idx].size(); quantum_part_spin_idx++) {
+        auto history = this->diis_history[quantum_part_idx][quantum_part_spin_idx];
+        auto num_dropped = this->diis_num_calls[quantum_part_idx][quantum_part_spin_idx] - static_cast<int>(history.size());
+        this->diis[quantum_part_idx][quantum_part_spin_idx] =
+            libint2::DIIS<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>(std::max(this->diis_start - num_dropped, 0), this->diis_size, this->diis_damping, 1, 1, this->diis_mixing_fraction);
+        this->diis_history[quantum_part_idx][quantum_part_spin_idx].clear();
+        this->diis_num_calls[quantum_part_idx][quantum_part_spin_idx] = num_dropped;
+        for (auto &[F_entry, error_entry] : history) {
+          this->diis_extrapolate(quantum_part_idx, quantum_part_spin_idx, F_entry, error_entry);
+        }
+      }
+    }
+  }
+  std::stringstream buffer;
+  buffer << "Resuming after iteration " << this->iteration_num;
+  Polyquant_cout(buffer.str());
+}
+
 void POLYQUANT_EPSCF::setup_from_file(std::string &filename) {
   auto function = __PRETTY_FUNCTION__;
   POLYQUANT_TIMER timer(function);
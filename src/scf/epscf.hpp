@@ -45,14 +45,120 @@ public:
   void form_fock_helper_single_fock_matrix(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &fock, const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm,
                                            const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm_last, const QUANTUM_PARTICLE_SET &quantum_part_a,
                                            const int quantum_part_a_idx, const int quantum_part_a_spin_idx, const QUANTUM_PARTICLE_SET &quantum_part_b, const int quantum_part_b_idx,
-                                           const int quantum_part_b_spin_idx);
+                                           const int quantum_part_b_spin_idx, const int num_threads = 0, const bool do_coulomb = true, const bool rank_local = false);
+
+  /**
+   * @brief Coulomb only fock contribution of particle b (all spins) on particle a. The density of b is contracted into the ket shell pairs first, and
+   * the kets are screened with their density and Schwarz bound.
+   *
+   */
+  void form_fock_helper_coulomb_matrix(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &fock, const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm,
+                                       const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm_last, const QUANTUM_PARTICLE_SET &quantum_part_a,
+                                       const int quantum_part_a_idx, const int quantum_part_a_spin_idx, const QUANTUM_PARTICLE_SET &quantum_part_b, const int quantum_part_b_idx,
+                                       const int num_threads = 0, const bool rank_local = false);
+
+  /**
+   * @brief LinK exchange of a particle with itself: for every canonical bra pair the ket shells with significant (incremental or full) exchange density
+   * to it are found from density sorted lists, and their partners from Schwarz sorted lists. Only canonical quartets are computed, each once, and
+   * scattered with its 8 fold degeneracy.
+   *
+   */
+  void form_fock_helper_exchange_matrix(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &fock, const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm,
+                                        const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm_last, const QUANTUM_PARTICLE_SET &quantum_part,
+                                        const int quantum_part_idx, const int quantum_part_spin_idx, const int num_threads = 0, const bool rank_local = false);
+  /**
+   * @brief Centers, extents and multipole moments (to quadrupole) of the shell pair charge distributions for the CFMM far field
+   *
+   */
+  void form_cfmm_shell_pairs();
+  /**
+   * @brief Coefficients T such that the far field coulomb interaction of a distribution with moments m_a (about its center) with one with moments m_b
+   * (about a center R away) is m_a . T. Moments are ordered as libint's emultipole2 (1, x, y, z, xx, xy, xz, yy, yz, zz)
+   *
+   */
+  Eigen::Matrix<double, 10, 1> cfmm_interaction_tensor(const Eigen::Matrix<double, 10, 1> &moments_b, const Eigen::Vector3d &R);
+  /**
+   * @brief Moments about a center shifted by -s (i.e. the distribution is s away from the new center)
+   *
+   */
+  Eigen::Matrix<double, 10, 1> cfmm_translate_moments(const Eigen::Matrix<double, 10, 1> &moments, const Eigen::Vector3d &s);
+  /**
+   * @brief Shell and basis function images under each operation of the point group for the petite list fock build. Only groups whose operations map
+   * each basis function onto +- another (D2h and its subgroups in the aligned frame) are supported.
+   *
+   */
+  void form_petite_list();
+  /**
+   * @brief Number of distinct quartets symmetry equivalent to the (ij|kl) shell quartet, or 0 if it is not the representative of its set
+   *
+   */
+  double petite_list_quartet_degeneracy(const int quantum_part_a_idx, const size_t shell_i, const size_t shell_j, const int quantum_part_b_idx, const size_t shell_k,
+                                        const size_t shell_l) const;
+  /**
+   * @brief Average a skeleton fock matrix of a particle over the group operations
+   *
+   */
+  void petite_list_symmetrize(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &skeleton, const int quantum_part_idx) const;
+
+  /**
+   * @brief Density fitted (RI-J, and RI-K within a particle) fock contribution of particle b (all spins) on particle a, fitted in b's auxiliary basis
+   *
+   */
+  void form_fock_helper_density_fitting(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &fock, const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm,
+                                        const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &dm_last, const QUANTUM_PARTICLE_SET &quantum_part_a,
+                                        const int quantum_part_a_idx, const int quantum_part_a_spin_idx, const QUANTUM_PARTICLE_SET &quantum_part_b, const int quantum_part_b_idx,
+                                        const int num_threads = 0, const bool rank_local = false);
+  /**
+   * @brief Is the density of particle b fitted? (density_fitting is on and b has an auxiliary basis)
+   *
+   */
+  bool use_density_fitting(const int quantum_part_b_idx);
 
   void form_fock_helper();
+  /**
+   * @brief Build the fock matrices of all particles and spins as concurrent tasks, each with its own thread team. Only valid before the interactions are
+   * turned on.
+   *
+   */
+  void form_fock_helper_independent();
+  /**
+   * @brief Form frozen_potential once the frozen densities are final
+   *
+   */
+  void form_frozen_potential();
+  /**
+   * @brief Is the particle's density held fixed this iteration? (frozen, or converged on its own before interactions are turned on)
+   *
+   */
+  bool skip_particle(const int quantum_part_idx);
 
   void form_fock() override;
 
-  void diag_fock_helper(int quantum_part_idx, int quantum_part_irrep_idx, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &F_prime, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &mo_C,
-                        Eigen::Matrix<double, Eigen::Dynamic, 1> &mo_e);
+  /**
+   * @brief Orbitals of one irrep block from the orthogonalized F_prime, only the lowest num_eigenvalues exactly if it is nonzero. Doesn't warn so it can
+   * run inside parallel regions.
+   *
+   * @return false if the partial solve was asked for and failed, and the full eigensolver was used instead
+   */
+  bool diag_fock_helper(int quantum_part_idx, int quantum_part_irrep_idx, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &F_prime, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &mo_C,
+                        Eigen::Matrix<double, Eigen::Dynamic, 1> &mo_e, const int num_eigenvalues = 0);
+  /**
+   * @brief Lowest num_eigenvalues eigenpairs of F_prime from LAPACKE dsyevr, the rest of C_prime is their orthogonal complement. Returns false if
+   * dsyevr failed.
+   *
+   */
+  bool diag_fock_helper_partial(const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &F_prime, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &C_prime,
+                                Eigen::Matrix<double, Eigen::Dynamic, 1> &mo_e, const int num_eigenvalues);
+  /**
+   * @brief How many of the lowest eigenpairs of an irrep block to solve for (0 for all of them)
+   *
+   */
+  int diag_fock_num_eigenvalues(const QUANTUM_PARTICLE_SET &quantum_part, const int num_mo);
+  /**
+   * @brief Diagonalize the blocks the last diag_fock only partially diagonalized again with the full eigensolver, giving canonical virtuals.
+   *
+   */
+  void diag_fock_full_final();
 
   void diag_fock() override;
 
@@ -97,13 +203,73 @@ public:
   void check_stop() override;
 
   void reset_diis();
+  /**
+   * @brief Clear only the coupled DIIS history, leaving the per particle DIIS subspaces alone
+   *
+   */
+  void reset_coupled_diis();
 
   void reset_incfock();
 
+  /**
+   * @brief Extrapolate the Fock matrices of all particles and spins with one shared set of coefficients
+   *
+   * @param F_diis extrapolated Fock matrices, indexes: particle, spin
+   */
+  void coupled_diis_extrapolate(std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &F_diis);
+  /**
+   * @brief Pulay coefficients from the combined [F,D] error of the coupled DIIS history
+   */
+  Eigen::Matrix<double, Eigen::Dynamic, 1> coupled_diis_pulay_coefficients();
+  /**
+   * @brief EDIIS or ADIIS coefficients (non-negative, summing to one) from the coupled DIIS history
+   */
+  Eigen::Matrix<double, Eigen::Dynamic, 1> coupled_diis_energy_coefficients();
+
   void run_iteration() override;
 
+  void run_second_order_iteration();
+
+  void second_order_check_switch();
+
+  void second_order_rotation_space();
+
+  void second_order_form_fock();
+
+  void second_order_rotate_orbitals(const std::vector<std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>>> &C_ref, const Eigen::Matrix<double, Eigen::Dynamic, 1> &kappa);
+
+  void second_order_gradient(Eigen::Matrix<double, Eigen::Dynamic, 1> &grad, Eigen::Matrix<double, Eigen::Dynamic, 1> &hess_diag);
+
+  double second_order_energy_gradient(const std::vector<std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>>> &C_ref, const Eigen::Matrix<double, Eigen::Dynamic, 1> &kappa,
+                                      Eigen::Matrix<double, Eigen::Dynamic, 1> &grad, Eigen::Matrix<double, Eigen::Dynamic, 1> &hess_diag);
+
+  void second_order_canonicalize();
+
+  void second_order_rms_error();
+
+  void reset_second_order();
+
   void guess_DM_hcore();
 
+  void guess_DM_atomic();
+
+  void guess_DM_atomic_electron_density(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &D_electron, const int quantum_part_idx);
+
+  void guess_DM_atomic_scf(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &D_atom, const std::vector<libint2::Shell> &atom_shells, const std::array<double, 3> &atom_pos,
+                           const double atom_charge, const QUANTUM_PARTICLE_SET &quantum_part);
+
+  void guess_DM_coulomb_matrix(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &J, const int quantum_part_a_idx, const int quantum_part_b_idx,
+                               const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &D_b);
+
+  void guess_DM_from_fock(const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &F_guess);
+
+  /**
+   * @brief Guess from the converged orbitals of another calculation (e.g. the previous point of a scan), projected onto this basis
+   *
+   * @param previous_scf the converged calculation
+   */
+  void guess_DM_from_previous(std::shared_ptr<POLYQUANT_EPSCF> previous_scf);
+
   void guess_DM() override;
 
   void resize_objects();
@@ -125,6 +291,41 @@ public:
   void print_error();
 
   void setup_from_file(std::string &filename);
+  /**
+   * @brief Set up the SCF using the orbitals of previous_scf as the guess
+   *
+   * @param previous_scf the converged calculation
+   */
+  void setup_from_previous(std::shared_ptr<POLYQUANT_EPSCF> previous_scf);
+  /**
+   * @brief Set up the integrals and resume the SCF from checkpoint_filename
+   *
+   */
+  void setup_from_checkpoint();
+  /**
+   * @brief Write everything the next iteration depends on to checkpoint_filename. The file is written under a temporary name and renamed, so an
+   * interrupted write never replaces a good checkpoint.
+   *
+   */
+  void write_checkpoint();
+  /**
+   * @brief Restore the state written by write_checkpoint
+   *
+   */
+  void read_checkpoint();
+  /**
+   * @brief Append the record of the current iteration to telemetry_filename as one line of JSON
+   *
+   * @param iteration_time wall time of the iteration in seconds
+   * @param D_previous the combined densities the iteration started from
+   */
+  void write_telemetry(const double iteration_time, const std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &D_previous);
+  /**
+   * @brief DIIS extrapolation of a particle and spin that also keeps the inputs needed to rebuild the DIIS object on restart
+   *
+   */
+  void diis_extrapolate(const int quantum_part_idx, const int quantum_part_spin_idx, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &F_diis,
+                        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &FD_commutator);
 
   void symmetrize_orbitals(std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> &C_tosym, std::vector<std::vector<std::vector<int>>> &symm_label_idxs_to_fill,
                            std::vector<std::vector<std::vector<std::string>>> &symm_labels_to_fill);
@@ -185,6 +386,49 @@ public:
 
   std::string occupation_mode = "aufbau";
   std::deque<bool> freeze_density;
+  /**
+   * @brief Build the fock matrices of the particles concurrently before the interactions are turned on
+   *
+   */
+  bool concurrent_independent_particles = true;
+  /**
+   * @brief Particles that converged before the interactions are turned on, these are held until the others converge
+   *
+   * indexes: particle
+   *
+   */
+  std::deque<bool> independent_particle_converged;
+  /**
+   * @brief Coulomb potential of all frozen densities on each (non-frozen) particle, added to the fock matrix as a one body term
+   *
+   * indexes: particle
+   *
+   */
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> frozen_potential;
+  bool frozen_potential_formed = false;
+  /**
+   * @brief Build the coulomb potential of the frozen densities once instead of recomputing it with the other particles every iteration
+   *
+   */
+  bool cache_frozen_potential = true;
+
+  /**
+   * @brief Initial guess. hcore diagonalizes the core hamiltonian, sad builds a fock matrix from a superposition of atomic densities and
+   * sad_coulomb diagonalizes H_core + J[sad density], the coulomb potential of the neutral atoms without exchange. This is not a
+   * superposition of atomic potentials (SAP) guess, which would use fitted atomic potentials that include exchange and correlation. For sad and
+   * sad_coulomb the non-electronic species (positrons, quantum protons) are guessed in the coulomb field of the superposed electronic density.
+   *
+   */
+  std::string guess_mode = "hcore";
+  std::vector<std::string> known_guess_modes = {"hcore", "sad", "sad_coulomb"};
+
+  /**
+   * @brief Spin summed atomic densities from the atomic SCFs used by the sad/sad_coulomb guesses
+   *
+   * indexes: atomic charge and basis signature
+   *
+   */
+  std::map<std::string, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> guess_atomic_density_cache;
 
   /**
    * @brief MO per irrep
@@ -262,6 +506,14 @@ public:
    *
    */
   std::vector<std::vector<libint2::DIIS<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>>> diis;
+  /**
+   * @brief The last diis_size (F, [F,D]) pairs given to each DIIS object, and how many it has been given since it was reset
+   *
+   * indexes: particle, spin
+   *
+   */
+  std::vector<std::vector<std::deque<std::pair<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>>>> diis_history;
+  std::vector<std::vector<int>> diis_num_calls;
   /**
    * @brief Stop running iterations?
    *
@@ -278,9 +530,53 @@ public:
 
   bool diis_extrapolation = true;
   int diis_start = 5;
+  /**
+   * @brief Scales the diagonal of the DIIS error matrix by 1 + diis_damping, for the per particle and the coupled DIIS
+   *
+   */
   double diis_damping = 0.0;
+  /**
+   * @brief Fraction of the current fock matrix kept in the extrapolated one, for the per particle and the coupled DIIS
+   *
+   */
   double diis_mixing_fraction = 0.0;
   int diis_size = 5;
+  /**
+   * @brief Extrapolate all particles and spins together with one shared set of DIIS coefficients
+   *
+   */
+  bool coupled_diis = false;
+  /**
+   * @brief Energy based extrapolation blended into the coupled DIIS while the error is large (none, ediis, adiis)
+   *
+   */
+  std::string diis_energy_mode = "none";
+  std::vector<std::string> known_diis_energy_modes = {"none", "ediis", "adiis"};
+  /**
+   * @brief Max [F,D] element above which only the energy based coefficients are used, and below which only DIIS is used
+   *
+   */
+  double diis_energy_blend_start = 1e-1;
+  double diis_energy_blend_end = 1e-4;
+  /**
+   * @brief Coupled DIIS history of Fock, density, and [F,D] error matrices
+   *
+   * indexes: history, block
+   *
+   */
+  std::deque<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> coupled_diis_F;
+  std::deque<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> coupled_diis_D;
+  std::deque<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>> coupled_diis_error;
+  std::deque<double> coupled_diis_E;
+  /**
+   * @brief (particle, spin) of each coupled DIIS block, and its weight in the energy (2 for restricted)
+   *
+   * indexes: block
+   *
+   */
+  std::vector<std::pair<int, int>> coupled_diis_blocks;
+  std::vector<double> coupled_diis_weights;
+  int coupled_diis_num_calls = 0;
   bool incremental_fock = true;
 
   /**
@@ -309,11 +605,167 @@ public:
   int incremental_fock_reset_freq = 8;
   double incremental_fock_initial_onset_thresh = 1e-5;
 
+  /**
+   * @brief Allow switching from DIIS to the trust region augmented Hessian (second order) solver when the DIIS error stalls
+   *
+   */
+  bool second_order = false;
+  /**
+   * @brief Are we currently taking second order steps?
+   *
+   */
+  bool second_order_active = false;
+  /**
+   * @brief Switch once the largest rms [F,D] error hasn't improved on its earlier best for this many iterations
+   *
+   */
+  int second_order_stall_iterations = 4;
+  int second_order_max_micro_iterations = 10;
+  double second_order_trust_radius_start = 0.5;
+  double second_order_trust_radius_max = 1.0;
+  double second_order_trust_radius = 0.5;
+  /**
+   * @brief Hessian vector products of the second order steps. diagonal uses the orbital energy differences and needs no fock builds,
+   * finite_difference differences the gradient for the full Hessian including the coupling between species at one fock build each.
+   * auto uses finite_difference once more than one interacting species is optimized and diagonal otherwise, since the diagonal
+   * Hessian has no coupling between species.
+   *
+   */
+  std::string second_order_hessian = "auto";
+  /**
+   * @brief Step used for the finite difference Hessian vector products (one Fock build each)
+   *
+   */
+  double second_order_fd_step = 1e-4;
+  /**
+   * @brief Were F and E_particles built from the current orbitals by the last second order step?
+   *
+   */
+  bool second_order_fock_current = false;
+  std::vector<double> second_order_error_history;
+
+  /**
+   * @brief Occupied-virtual rotation blocks of the joint orbital rotation vector
+   *
+   * indexes: block -> (particle, spin, symmetry block, offset into the rotation vector)
+   *
+   */
+  std::vector<std::array<int, 4>> second_order_blocks;
+  std::vector<std::vector<int>> second_order_block_occ;
+  std::vector<std::vector<int>> second_order_block_virt;
+  std::vector<double> second_order_block_scale;
+  int second_order_num_rotations = 0;
+
   /**
    * @brief Are we using Cauchy-Schwarz screening to skip parts of the fock build?
    *
    */
   bool Cauchy_Schwarz_screening = false;
+  /**
+   * @brief Use the coulomb only builder for the interactions between different particles. Opt in, it screens with coulomb_engine_threshold
+   * where the default four center build is exact.
+   *
+   */
+  bool coulomb_engine = false;
+  /**
+   * @brief Fit the densities of particles with a 'model->aux_basis' (RI-J/RI-K) instead of the four center build
+   *
+   */
+  bool density_fitting = false;
+  /**
+   * @brief Skip bra-ket pairs when Q_ij Q_kl |D_kl| is below this
+   *
+   */
+  double coulomb_engine_threshold = 1e-14;
+  /**
+   * @brief Only solve for the occupied and a few virtual orbitals of large irrep blocks while iterating
+   *
+   */
+  bool partial_diag = false;
+  /**
+   * @brief Smallest irrep block that is partially diagonalized
+   *
+   */
+  int partial_diag_min_size = 100;
+  /**
+   * @brief Eigenpairs solved for beyond the number of particles
+   *
+   */
+  int partial_diag_extra_virtuals = 10;
+  /**
+   * @brief Were any orbitals formed by a partial diagonalization since the last canonicalization?
+   *
+   */
+  bool partial_diag_used = false;
+  /**
+   * @brief Blocks (particle, spin, irrep, eigenpairs solved for) the last diag_fock partially diagonalized and the fock matrices it used for them
+   *
+   */
+  std::vector<std::array<int, 4>> partial_diag_blocks;
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> partial_diag_F;
+  /**
+   * @brief Compute only symmetry unique shell quartets in the four center fock build and symmetrize the skeleton fock matrix
+   *
+   */
+  bool petite_list = false;
+  /**
+   * @brief Is the petite list usable for this molecule and basis?
+   *
+   */
+  bool petite_list_active = false;
+  /**
+   * @brief images of shells and basis functions under each group operation
+   * indexes: particle, operation, shell or basis function
+   *
+   */
+  std::vector<std::vector<std::vector<size_t>>> petite_shell_map;
+  std::vector<std::vector<std::vector<size_t>>> petite_bf_map;
+  std::vector<std::vector<std::vector<double>>> petite_bf_sign;
+  /**
+   * @brief Build the exchange within a particle with LinK (the coulomb part then comes from the coulomb engine)
+   *
+   */
+  bool link_exchange = false;
+  /**
+   * @brief Skip exchange quartets when Q_mu,lambda Q_nu,sigma |D_lambda,sigma| is below this
+   *
+   */
+  double link_threshold = 1e-13;
+  /**
+   * @brief Continuous fast multipole method: well separated shell pairs interact through their multipole moments in the coulomb engine (which also
+   * builds the coulomb part within a particle when this is on)
+   *
+   */
+  bool cfmm = false;
+  /**
+   * @brief Distributions are far field when their centers are more than this times the sum of their extents apart
+   *
+   */
+  double cfmm_well_separated = 1.0;
+  /**
+   * @brief Edge of the boxes (bohr) the ket shell pairs are grouped into
+   *
+   */
+  double cfmm_box_size = 4.0;
+  /**
+   * @brief A shell pair distribution extends until its primitive products drop below this
+   *
+   */
+  double cfmm_extent_threshold = 1e-10;
+  /**
+   * @brief Center (x, y, z) and extent of each shell pair distribution
+   *
+   * indexes: particle, unique shell pair
+   *
+   */
+  std::vector<std::vector<std::array<double, 4>>> cfmm_pair_centers;
+  /**
+   * @brief Multipole moments of each basis function product of a shell pair about the pair's center
+   *
+   * indexes: particle, unique shell pair -> (basis function pair, moment)
+   *
+   */
+  std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, 10>>> cfmm_pair_moments;
 
   /**
    * @brief Cauchy-Schwarz screening threshold
@@ -343,6 +795,49 @@ public:
    *
    */
   int iteration_max = 500;
+  /**
+   * @brief HDF5 file the SCF state is checkpointed to (no checkpoints if empty)
+   *
+   */
+  std::string checkpoint_filename = "";
+  /**
+   * @brief Checkpoint every this many iterations (and when the SCF stops)
+   *
+   */
+  int checkpoint_frequency = 1;
+  /**
+   * @brief Resume from checkpoint_filename instead of guessing
+   *
+   */
+  bool restart_from_checkpoint = false;
+  /**
+   * @brief JSON lines file each iteration appends a record of energies, errors, timings and quartet counts to (no telemetry if empty)
+   *
+   */
+  std::string telemetry_filename = "";
+  /**
+   * @brief Wall time in seconds spent in the fock build, the DIIS extrapolations and the diagonalizations during the current iteration
+   *
+   */
+  double telemetry_time_fock = 0.0;
+  double telemetry_time_diis = 0.0;
+  double telemetry_time_diag = 0.0;
+  /**
+   * @brief Shell quartets computed and skipped by screening or symmetry during the current iteration (on this rank)
+   *
+   */
+  size_t telemetry_quartets_computed = 0;
+  size_t telemetry_quartets_screened = 0;
+  /**
+   * @brief Ket shell pairs the CFMM coulomb build took from their multipoles instead of the quartets, also counted as screened
+   *
+   */
+  size_t telemetry_quartets_far_field = 0;
+  /**
+   * @brief Full fock builds done since the start of the calculation
+   *
+   */
+  size_t num_fock_builds = 0;
 };
 } // namespace polyquant
 #endif
@@ -171,6 +171,130 @@ TEST_CASE("CALCULATION: H2O/sto-3g(basis from file) SCF.") {
   REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-74.962926342808259506, 10 * POLYQUANT_TEST_EPSILON_LOOSE));
 }
 
+TEST_CASE("CALCULATION: H2O/sto-3g(library) SCF SAD and SAD coulomb guess.") {
+  POLYQUANT_CALCULATION hcore_calc("../../tests/data/h2o_sto3glibrary/h2o.json");
+  hcore_calc.run();
+  REQUIRE(hcore_calc.scf_calc->guess_mode == "hcore");
+  for (auto guess_mode : {"sad", "sad_coulomb"}) {
+    POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3glibrary/h2o_" + std::string(guess_mode) + ".json");
+    test_calc.run();
+    REQUIRE(test_calc.scf_calc->guess_mode == guess_mode);
+    REQUIRE(test_calc.scf_calc->converged);
+    REQUIRE(!test_calc.scf_calc->exceeded_iterations);
+    // same convergence settings as the hcore run, a better start has to pay off in iterations
+    REQUIRE(test_calc.scf_calc->iteration_num < hcore_calc.scf_calc->iteration_num);
+    REQUIRE_THAT(test_calc.scf_calc->E_particles[0], Catch::Matchers::WithinAbs(-84.1577900311, 10 * POLYQUANT_TEST_EPSILON_LOOSE));
+    REQUIRE_THAT(test_calc.scf_calc->E_orbitals_combined[0][0](0), Catch::Matchers::WithinAbs(-20.2417374167, POLYQUANT_TEST_EPSILON_LOOSE));
+    REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-74.962926342808259506, 10 * POLYQUANT_TEST_EPSILON_LOOSE));
+  }
+}
+
+TEST_CASE("CALCULATION: H2O/sto-3g(library) second order SCF.") {
+  for (auto hessian : {"diagonal", "finite_difference"}) {
+    std::string input = std::string(hessian) == "diagonal" ? "h2o_second_order.json" : "h2o_second_order_fd.json";
+    POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3glibrary/" + input);
+    test_calc.run();
+    REQUIRE(test_calc.scf_calc->second_order_hessian == hessian);
+    REQUIRE(test_calc.scf_calc->second_order_active);
+    REQUIRE(test_calc.scf_calc->converged);
+    REQUIRE(!test_calc.scf_calc->exceeded_iterations);
+    REQUIRE_THAT(test_calc.scf_calc->E_particles[0], Catch::Matchers::WithinAbs(-84.1577900311, 10 * POLYQUANT_TEST_EPSILON_LOOSE));
+    REQUIRE_THAT(test_calc.scf_calc->E_orbitals_combined[0][0](0), Catch::Matchers::WithinAbs(-20.2417374167, POLYQUANT_TEST_EPSILON_LOOSE));
+    REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-74.962926342808259506, 10 * POLYQUANT_TEST_EPSILON_LOOSE));
+    if (std::string(hessian) == "diagonal") {
+      // one fock build per iteration, plus the reference of the first second order step
+      REQUIRE(test_calc.scf_calc->num_fock_builds <= test_calc.scf_calc->iteration_num + 1);
+    } else {
+      // every Hessian vector product is a fock build
+      REQUIRE(test_calc.scf_calc->num_fock_builds > test_calc.scf_calc->iteration_num + 1);
+    }
+  }
+}
+
+TEST_CASE("CALCULATION: H2O/sto-3g quantum H second order SCF against DIIS.") {
+  POLYQUANT_CALCULATION diis_calc("../../tests/data/h2o_sto3g_quantumHlibrary/h2o.json");
+  diis_calc.run();
+  POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3g_quantumHlibrary/h2o_second_order.json");
+  test_calc.run();
+  REQUIRE(!diis_calc.scf_calc->second_order_active);
+  REQUIRE(diis_calc.scf_calc->converged);
+  REQUIRE(test_calc.scf_calc->second_order_hessian == "auto");
+  REQUIRE(test_calc.scf_calc->second_order_active);
+  REQUIRE(test_calc.scf_calc->independent_converged);
+  REQUIRE(test_calc.scf_calc->converged);
+  REQUIRE(!test_calc.scf_calc->exceeded_iterations);
+  // with both species interacting the Hessian vector products are coupled fock builds, not the diagonal
+  REQUIRE(test_calc.scf_calc->num_fock_builds > test_calc.scf_calc->iteration_num + 1);
+  for (auto quantum_part_idx = 0; quantum_part_idx < 2; quantum_part_idx++) {
+    for (auto &spin_error : test_calc.scf_calc->iteration_rms_error[quantum_part_idx]) {
+      REQUIRE(spin_error < test_calc.scf_calc->convergence_DM);
+    }
+    REQUIRE_THAT(test_calc.scf_calc->E_particles[quantum_part_idx], Catch::Matchers::WithinAbs(diis_calc.scf_calc->E_particles[quantum_part_idx], POLYQUANT_TEST_EPSILON_LOOSE));
+  }
+  REQUIRE_THAT(test_calc.scf_calc->E_particles[0], Catch::Matchers::WithinAbs(3.0365625787, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_particles[1], Catch::Matchers::WithinAbs(-81.1530733704, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(diis_calc.scf_calc->E_total, POLYQUANT_TEST_EPSILON_LOOSE));
+}
+
+TEST_CASE("CALCULATION: H2O/sto-3g(library) SCF petite list.") {
+  POLYQUANT_CALCULATION full_calc("../../tests/data/h2o_sto3glibrary/h2o.json");
+  full_calc.run();
+  REQUIRE(!full_calc.scf_calc->petite_list_active);
+
+  POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3glibrary/h2o_petite_list.json");
+  test_calc.run();
+  REQUIRE(test_calc.scf_calc->petite_list_active);
+  // the quartet counts are those of the last fock build, which doesn't screen by density
+  REQUIRE(full_calc.scf_calc->telemetry_quartets_computed > 0);
+  REQUIRE(test_calc.scf_calc->telemetry_quartets_computed < full_calc.scf_calc->telemetry_quartets_computed);
+  REQUIRE(test_calc.scf_calc->telemetry_quartets_screened > 0);
+  REQUIRE(test_calc.scf_calc->converged);
+  REQUIRE(!test_calc.scf_calc->exceeded_iterations);
+  REQUIRE_THAT(test_calc.scf_calc->E_particles[0], Catch::Matchers::WithinAbs(-84.1577900311, 10 * POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_orbitals_combined[0][0](0), Catch::Matchers::WithinAbs(-20.2417374167, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-74.962926342808259506, 10 * POLYQUANT_TEST_EPSILON_LOOSE));
+}
+
+TEST_CASE("CALCULATION: H2O/sto-3g(library) SCF restart from checkpoint.") {
+  POLYQUANT_CALCULATION full_calc("../../tests/data/h2o_sto3glibrary/h2o.json");
+  full_calc.run();
+  POLYQUANT_CALCULATION checkpoint_calc("../../tests/data/h2o_sto3glibrary/h2o_checkpoint.json");
+  checkpoint_calc.run();
+  REQUIRE(checkpoint_calc.scf_calc->exceeded_iterations);
+  REQUIRE(std::filesystem::exists("h2o_checkpoint.h5"));
+  POLYQUANT_CALCULATION restart_calc("../../tests/data/h2o_sto3glibrary/h2o_restart.json");
+  restart_calc.run();
+  REQUIRE(restart_calc.scf_calc->converged);
+  REQUIRE(!restart_calc.scf_calc->exceeded_iterations);
+  // the restarted run follows the uninterrupted one iteration for iteration
+  REQUIRE(restart_calc.scf_calc->iteration_num == full_calc.scf_calc->iteration_num);
+  REQUIRE_THAT(restart_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(full_calc.scf_calc->E_total, 1e-12));
+  REQUIRE_THAT(restart_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-74.962926342808259506, 10 * POLYQUANT_TEST_EPSILON_LOOSE));
+}
+
+TEST_CASE("CALCULATION: H2O/sto-3g(library) SCF telemetry.") {
+  std::filesystem::remove("h2o_telemetry.jsonl");
+  POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3glibrary/h2o_telemetry.json");
+  test_calc.run();
+  REQUIRE(test_calc.scf_calc->converged);
+  REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-74.962926342808259506, 10 * POLYQUANT_TEST_EPSILON_LOOSE));
+  std::ifstream telemetry_file("h2o_telemetry.jsonl");
+  std::string line;
+  auto num_records = 0;
+  json last_record;
+  while (std::getline(telemetry_file, line)) {
+    last_record = json::parse(line);
+    num_records++;
+    REQUIRE(last_record["iteration"] == num_records);
+    REQUIRE(last_record["quartets"]["computed"] > 0);
+    REQUIRE(last_record["time"]["fock"] <= last_record["time"]["iteration"]);
+  }
+  REQUIRE(num_records == test_calc.scf_calc->iteration_num);
+  REQUIRE(last_record["converged"] == true);
+  REQUIRE_THAT(last_record["species"]["electron"]["energy"].get<double>(), Catch::Matchers::WithinAbs(test_calc.scf_calc->E_particles[0], 1e-12));
+  REQUIRE(last_record["species"]["electron"]["diis_error"].size() == 2);
+}
+
 TEST_CASE("CALCULATION: H2O/sto-3g quantum H SCF library basis.") {
   POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3g_quantumHlibrary/h2o.json");
   test_calc.run();
@@ -192,6 +316,148 @@ TEST_CASE("CALCULATION: H2O/sto-3g quantum H SCF library basis.") {
   REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-78.1165107917, POLYQUANT_TEST_EPSILON_LOOSE));
 }
 
+TEST_CASE("CALCULATION: H2O/sto-3g quantum H SCF concurrent against sequential independent particles.") {
+  // the LinK inputs also take the coulomb engine inside the concurrent tasks
+  for (auto [concurrent_input, sequential_input] : {std::pair{"h2o.json", "h2o_sequential_independent.json"}, std::pair{"h2o_link.json", "h2o_link_sequential_independent.json"}}) {
+    POLYQUANT_CALCULATION concurrent_calc("../../tests/data/h2o_sto3g_quantumHlibrary/" + std::string(concurrent_input));
+    concurrent_calc.run();
+    POLYQUANT_CALCULATION sequential_calc("../../tests/data/h2o_sto3g_quantumHlibrary/" + std::string(sequential_input));
+    sequential_calc.run();
+    REQUIRE(concurrent_calc.scf_calc->concurrent_independent_particles);
+    REQUIRE(!sequential_calc.scf_calc->concurrent_independent_particles);
+    REQUIRE(concurrent_calc.scf_calc->converged);
+    REQUIRE(sequential_calc.scf_calc->converged);
+    for (auto quantum_part_idx = 0; quantum_part_idx < 2; quantum_part_idx++) {
+      REQUIRE_THAT(concurrent_calc.scf_calc->E_particles[quantum_part_idx],
+                   Catch::Matchers::WithinAbs(sequential_calc.scf_calc->E_particles[quantum_part_idx], POLYQUANT_TEST_EPSILON_VERYTIGHT));
+    }
+    REQUIRE_THAT(concurrent_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(sequential_calc.scf_calc->E_total, POLYQUANT_TEST_EPSILON_VERYTIGHT));
+  }
+}
+
+TEST_CASE("CALCULATION: H2O/sto-3g quantum H SCF frozen potential against recomputing the frozen density.") {
+  for (auto [cached_input, recompute_input] : {std::pair{"h2o_freeze_H.json", "h2o_freeze_H_recompute.json"}, std::pair{"h2o_freeze_H_no_incfock.json", "h2o_freeze_H_recompute_no_incfock.json"}}) {
+    POLYQUANT_CALCULATION cached_calc("../../tests/data/h2o_sto3g_quantumHlibrary/" + std::string(cached_input));
+    cached_calc.run();
+    POLYQUANT_CALCULATION recompute_calc("../../tests/data/h2o_sto3g_quantumHlibrary/" + std::string(recompute_input));
+    recompute_calc.run();
+    REQUIRE(cached_calc.scf_calc->freeze_density[0]);
+    REQUIRE(!cached_calc.scf_calc->freeze_density[1]);
+    REQUIRE(cached_calc.scf_calc->incremental_fock == recompute_calc.scf_calc->incremental_fock);
+    REQUIRE(cached_calc.scf_calc->frozen_potential_formed);
+    REQUIRE(!recompute_calc.scf_calc->frozen_potential_formed);
+    REQUIRE(cached_calc.scf_calc->converged);
+    REQUIRE(recompute_calc.scf_calc->converged);
+    for (auto quantum_part_idx = 0; quantum_part_idx < 2; quantum_part_idx++) {
+      REQUIRE_THAT(cached_calc.scf_calc->E_particles[quantum_part_idx], Catch::Matchers::WithinAbs(recompute_calc.scf_calc->E_particles[quantum_part_idx], POLYQUANT_TEST_EPSILON_VERYTIGHT));
+    }
+    REQUIRE_THAT(cached_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(recompute_calc.scf_calc->E_total, POLYQUANT_TEST_EPSILON_VERYTIGHT));
+  }
+}
+
+TEST_CASE("CALCULATION: H2O/sto-3g quantum H SCF with the coulomb engine.") {
+  POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3g_quantumHlibrary/h2o_coulomb_engine.json");
+  test_calc.run();
+  REQUIRE(test_calc.scf_calc->coulomb_engine);
+  REQUIRE(test_calc.scf_calc->converged);
+  REQUIRE(test_calc.scf_calc->independent_converged);
+  REQUIRE(!test_calc.scf_calc->exceeded_iterations);
+  REQUIRE_THAT(test_calc.scf_calc->E_particles[0], Catch::Matchers::WithinAbs(3.0365625787, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_particles[1], Catch::Matchers::WithinAbs(-81.1530733704, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-78.1165107917, POLYQUANT_TEST_EPSILON_LOOSE));
+}
+
+TEST_CASE("CALCULATION: H2O/sto-3g quantum H SCF with LinK exchange.") {
+  POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3g_quantumHlibrary/h2o_link.json");
+  test_calc.run();
+  REQUIRE(test_calc.scf_calc->link_exchange);
+  REQUIRE(test_calc.scf_calc->converged);
+  REQUIRE(test_calc.scf_calc->independent_converged);
+  REQUIRE(!test_calc.scf_calc->exceeded_iterations);
+  REQUIRE_THAT(test_calc.scf_calc->E_particles[0], Catch::Matchers::WithinAbs(3.0365625787, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_particles[1], Catch::Matchers::WithinAbs(-81.1530733704, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-78.1165107917, POLYQUANT_TEST_EPSILON_LOOSE));
+
+  // the electron exchange of the converged density from LinK and from the default four center build, which LinK must not exceed in quartets
+  auto &scf = test_calc.scf_calc;
+  scf->incremental_fock = false;
+  const auto &electrons = std::next(scf->input_molecule->quantum_particles.begin(), 1)->second;
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> K_link = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(scf->F[1][0].rows(), scf->F[1][0].cols());
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> K_default = K_link;
+  scf->telemetry_quartets_computed = 0;
+  scf->telemetry_quartets_screened = 0;
+  scf->form_fock_helper_exchange_matrix(K_link, scf->D_combined, scf->D_last_combined, electrons, 1, 0);
+  const auto link_quartets = scf->telemetry_quartets_computed;
+  // computed and screened together are exactly the canonical quartets of the significant shell pairs
+  const auto &Schwarz = scf->input_integral->Schwarz[1];
+  size_t num_pairs = 0;
+  for (auto shell_m = 0; shell_m < Schwarz.rows(); shell_m++) {
+    for (auto shell_n = 0; shell_n <= shell_m; shell_n++) {
+      num_pairs += Schwarz(shell_m, shell_n) > 0.0;
+    }
+  }
+  REQUIRE(link_quartets + scf->telemetry_quartets_screened == num_pairs * (num_pairs + 1) / 2);
+  scf->telemetry_quartets_computed = 0;
+  scf->form_fock_helper_single_fock_matrix(K_default, scf->D_combined, scf->D_last_combined, electrons, 1, 0, electrons, 1, 0, 0, false);
+  const auto default_quartets = scf->telemetry_quartets_computed;
+  REQUIRE(link_quartets > 0);
+  REQUIRE(link_quartets <= default_quartets);
+  REQUIRE((K_link - K_default).cwiseAbs().maxCoeff() < 1e-10);
+}
+
+TEST_CASE("CALCULATION: H2O dimer/sto-3g quantum H CFMM against the exact coulomb build.") {
+  POLYQUANT_CALCULATION exact_calc("../../tests/data/h2o_sto3g_quantumHlibrary/h2o_dimer.json");
+  exact_calc.run();
+  REQUIRE(exact_calc.scf_calc->converged);
+
+  POLYQUANT_CALCULATION cfmm_calc("../../tests/data/h2o_sto3g_quantumHlibrary/h2o_dimer_cfmm.json");
+  cfmm_calc.run();
+  REQUIRE(cfmm_calc.scf_calc->cfmm);
+  REQUIRE(cfmm_calc.scf_calc->converged);
+  REQUIRE(!cfmm_calc.scf_calc->exceeded_iterations);
+  // the molecules are 15 angstrom apart so their shell pairs only see each other through the multipoles
+  for (auto quantum_part_idx = 0; quantum_part_idx < 2; quantum_part_idx++) {
+    REQUIRE_THAT(cfmm_calc.scf_calc->E_particles[quantum_part_idx], Catch::Matchers::WithinAbs(exact_calc.scf_calc->E_particles[quantum_part_idx], 1e-6));
+  }
+  REQUIRE_THAT(cfmm_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(exact_calc.scf_calc->E_total, 1e-6));
+  // the last fock build took kets from the multipoles, which the exact build never does
+  REQUIRE(exact_calc.scf_calc->telemetry_quartets_far_field == 0);
+  REQUIRE(cfmm_calc.scf_calc->telemetry_quartets_far_field > 0);
+  REQUIRE(cfmm_calc.scf_calc->telemetry_quartets_screened >= cfmm_calc.scf_calc->telemetry_quartets_far_field);
+}
+
+TEST_CASE("CALCULATION: H2O/sto-3g quantum H SCF coupled DIIS with ADIIS.") {
+  POLYQUANT_CALCULATION uncoupled_calc("../../tests/data/h2o_sto3g_quantumHlibrary/h2o.json");
+  uncoupled_calc.run();
+  REQUIRE(!uncoupled_calc.scf_calc->coupled_diis);
+  REQUIRE(uncoupled_calc.scf_calc->converged);
+
+  POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3g_quantumHlibrary/h2o_coupled_diis.json");
+  test_calc.run();
+  REQUIRE(test_calc.scf_calc->iteration_num <= uncoupled_calc.scf_calc->iteration_num);
+  REQUIRE(test_calc.scf_calc->coupled_diis);
+  REQUIRE(test_calc.scf_calc->diis_energy_mode == "adiis");
+  REQUIRE(test_calc.scf_calc->converged);
+  REQUIRE(test_calc.scf_calc->independent_converged);
+  REQUIRE(!test_calc.scf_calc->exceeded_iterations);
+  REQUIRE_THAT(test_calc.scf_calc->E_particles[0], Catch::Matchers::WithinAbs(3.0365625787, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_particles[1], Catch::Matchers::WithinAbs(-81.1530733704, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-78.1165107917, POLYQUANT_TEST_EPSILON_LOOSE));
+}
+
+TEST_CASE("CALCULATION: H2O/sto-3g quantum H SCF coupled DIIS with damping and mixing.") {
+  POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3g_quantumHlibrary/h2o_coupled_diis_damped.json");
+  test_calc.run();
+  REQUIRE(test_calc.scf_calc->coupled_diis);
+  REQUIRE(test_calc.scf_calc->diis_damping == 0.1);
+  REQUIRE(test_calc.scf_calc->diis_mixing_fraction == 0.1);
+  REQUIRE(test_calc.scf_calc->converged);
+  REQUIRE(!test_calc.scf_calc->exceeded_iterations);
+  REQUIRE_THAT(test_calc.scf_calc->E_particles[0], Catch::Matchers::WithinAbs(3.0365625787, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_particles[1], Catch::Matchers::WithinAbs(-81.1530733704, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-78.1165107917, POLYQUANT_TEST_EPSILON_LOOSE));
+}
+
 TEST_CASE("CALCULATION: H2O/sto-3g quantum H SCF (basis from file).") {
   POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3g_quantumHfile/h2o.json");
   test_calc.run();
@@ -390,6 +656,28 @@ TEST_CASE("CALCULATION: H2O/sto-3g(library) explicit ham.") {
   }
 }
 
+TEST_CASE("CALCULATION: H2O/sto-3g(library) CI scan with warm starts.") {
+  POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3glibrary_cisd/h2o_scan.json");
+  test_calc.run();
+  REQUIRE(test_calc.scan_E_total.size() == 3);
+  REQUIRE(test_calc.scan_E_ci.size() == 3);
+  // the scan goes out and back, so the last point is the first point started from the stretched geometry
+  REQUIRE_THAT(test_calc.scan_E_ci[0][0], Catch::Matchers::WithinAbs(-75.01170307729812, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scan_E_ci[2][0], Catch::Matchers::WithinAbs(test_calc.scan_E_ci[0][0], POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scan_E_ci[2][1], Catch::Matchers::WithinAbs(test_calc.scan_E_ci[0][1], POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE(test_calc.scan_E_ci[1][0] > test_calc.scan_E_ci[0][0]);
+  REQUIRE(test_calc.ci_calc->reused_determinants);
+  // the reused dets map was unfolded again, so both directions agree
+  const auto &detset = test_calc.ci_calc->detset;
+  REQUIRE(detset.dets.size() == detset.N_dets);
+  REQUIRE(detset.dets_unfolded.size() == detset.N_dets * detset.det_idx_stride);
+  for (auto i_det = 0; i_det < detset.N_dets; i_det++) {
+    REQUIRE(detset.det_idx_fold(detset.det_idx_view(i_det)) == i_det);
+  }
+  REQUIRE(test_calc.ci_calc->warm_started);
+  REQUIRE(test_calc.scan_scf_iterations[2] < test_calc.scan_scf_iterations[0]);
+}
+
 TEST_CASE("CALCULATION: PsH/custom basis CI dump HDF5.") {
   POLYQUANT_CALCULATION test_calc("../../tests/data/PsH_wpos/PsH_wpos_CI_hdf5.json");
   test_calc.run();
@@ -466,6 +754,54 @@ TEST_CASE("CALCULATION: SCF restart test skipiterations.") {
   REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(test_calc2.scf_calc->E_total, POLYQUANT_TEST_EPSILON_LOOSE));
 }
 
+TEST_CASE("CALCULATION: PsH/custom basis density fitting against the exact fock build.") {
+  POLYQUANT_CALCULATION exact_calc("../../tests/data/PsH_wpos/PsH_wpos.json");
+  exact_calc.run();
+  POLYQUANT_CALCULATION df_calc("../../tests/data/PsH_wpos/PsH_wpos_density_fitting.json");
+  df_calc.run();
+  REQUIRE(df_calc.scf_calc->density_fitting);
+  REQUIRE(df_calc.scf_calc->converged);
+  REQUIRE(!df_calc.scf_calc->exceeded_iterations);
+  REQUIRE(df_calc.input_integral->ri_B.size() == 2);
+  // every orbital product of these single center s bases is in the auxiliary basis, so the fit is (nearly) exact
+  for (auto quantum_part_idx = 0; quantum_part_idx < 2; quantum_part_idx++) {
+    REQUIRE_THAT(df_calc.scf_calc->E_particles[quantum_part_idx], Catch::Matchers::WithinAbs(exact_calc.scf_calc->E_particles[quantum_part_idx], 1e-4));
+  }
+  REQUIRE_THAT(df_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(exact_calc.scf_calc->E_total, 1e-4));
+}
+
+TEST_CASE("CALCULATION: PsH/custom basis partial diagonalization against the full eigensolver.") {
+  POLYQUANT_CALCULATION exact_calc("../../tests/data/PsH_wpos/PsH_wpos.json");
+  exact_calc.run();
+  POLYQUANT_CALCULATION partial_calc("../../tests/data/PsH_wpos/PsH_wpos_partial_diag.json");
+  partial_calc.run();
+  REQUIRE(partial_calc.scf_calc->partial_diag);
+  REQUIRE(partial_calc.scf_calc->converged);
+  REQUIRE(!partial_calc.scf_calc->exceeded_iterations);
+  for (auto quantum_part_idx = 0; quantum_part_idx < 2; quantum_part_idx++) {
+    REQUIRE_THAT(partial_calc.scf_calc->E_particles[quantum_part_idx], Catch::Matchers::WithinAbs(exact_calc.scf_calc->E_particles[quantum_part_idx], POLYQUANT_TEST_EPSILON_LOOSE));
+    // the virtuals are canonicalized once converged
+    const auto &mo_e = partial_calc.scf_calc->E_orbitals[quantum_part_idx][0][0];
+    const auto &mo_e_exact = exact_calc.scf_calc->E_orbitals[quantum_part_idx][0][0];
+    REQUIRE(mo_e.size() == mo_e_exact.size());
+    for (auto i = 0; i < mo_e.size(); i++) {
+      REQUIRE_THAT(mo_e(i), Catch::Matchers::WithinAbs(mo_e_exact(i), POLYQUANT_TEST_EPSILON_LOOSE));
+    }
+    // the final orbitals are the eigenvectors of the final fock matrix, virtuals included
+    const auto &X = partial_calc.scf_calc->input_integral->orth_X[quantum_part_idx][0];
+    const auto &F = partial_calc.scf_calc->F[quantum_part_idx][0];
+    const auto &C = partial_calc.scf_calc->C[quantum_part_idx][0][0];
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> eigensolver(X.transpose() * F * X);
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> F_mo = C.transpose() * F * C;
+    for (auto i = 0; i < mo_e.size(); i++) {
+      REQUIRE_THAT(mo_e(i), Catch::Matchers::WithinAbs(eigensolver.eigenvalues()(i), POLYQUANT_TEST_EPSILON_LOOSE));
+      REQUIRE_THAT(F_mo(i, i), Catch::Matchers::WithinAbs(mo_e(i), POLYQUANT_TEST_EPSILON_LOOSE));
+    }
+    REQUIRE((F_mo - Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>(F_mo.diagonal().asDiagonal())).cwiseAbs().maxCoeff() < POLYQUANT_TEST_EPSILON_LOOSE);
+  }
+  REQUIRE_THAT(partial_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(exact_calc.scf_calc->E_total, POLYQUANT_TEST_EPSILON_LOOSE));
+}
+
 TEST_CASE("CALCULATION: PsH compare to literature CISD (10.1063/1.5094035).") {
   POLYQUANT_CALCULATION test_calc("../../tests/data/PsH_wpos/compare_CISD.json");
   test_calc.run();
@@ -0,0 +1,82 @@
+#include "calculation/calculation.hpp"
+#include "io/mpi_utilities.hpp"
+#include "io/utils.hpp"
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+using namespace polyquant;
+
+// run under mpiexec by ctest, the energies have to match the serial ones and be the same on every rank
+int main(int argc, char **argv) {
+  POLYQUANT_MPI_ENVIRONMENT mpi_environment(argc, argv);
+  return Catch::Session().run(argc, argv);
+}
+
+/**
+ * @brief Spread of a value over the ranks, max - min
+ */
+double rank_spread(double value) {
+  Eigen::VectorXd values = Eigen::VectorXd::Zero(Polyquant_mpi_size());
+  values[Polyquant_mpi_rank()] = value;
+  Polyquant_mpi_allreduce_sum(values);
+  return values.maxCoeff() - values.minCoeff();
+}
+
+TEST_CASE("MPI: H2O/sto-3g(library) SCF.") {
+  REQUIRE(Polyquant_mpi_size() > 1);
+  POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3glibrary/h2o.json");
+  test_calc.run();
+  REQUIRE(test_calc.scf_calc->converged);
+  REQUIRE_THAT(test_calc.scf_calc->E_particles[0], Catch::Matchers::WithinAbs(-84.1577900311, 10 * POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-74.962926342808259506, 10 * POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE(rank_spread(test_calc.scf_calc->E_total) < 1e-12);
+}
+
+TEST_CASE("MPI: H2O/sto-3g(library) SCF restart from checkpoint.") {
+  POLYQUANT_CALCULATION full_calc("../../tests/data/h2o_sto3glibrary/h2o.json");
+  full_calc.run();
+  POLYQUANT_CALCULATION checkpoint_calc("../../tests/data/h2o_sto3glibrary/h2o_checkpoint.json");
+  checkpoint_calc.run();
+  REQUIRE(checkpoint_calc.scf_calc->exceeded_iterations);
+  // only rank 0 writes the checkpoint and every rank resumes from what it read
+  POLYQUANT_CALCULATION restart_calc("../../tests/data/h2o_sto3glibrary/h2o_restart.json");
+  restart_calc.run();
+  REQUIRE(restart_calc.scf_calc->converged);
+  REQUIRE(restart_calc.scf_calc->iteration_num == full_calc.scf_calc->iteration_num);
+  REQUIRE_THAT(restart_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(full_calc.scf_calc->E_total, 1e-12));
+  REQUIRE(rank_spread(restart_calc.scf_calc->E_total) < 1e-12);
+}
+
+TEST_CASE("MPI: H2O/sto-3g(library) CI.") {
+  POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3glibrary_cisd/h2o.json");
+  test_calc.run();
+  REQUIRE(test_calc.scf_calc->converged);
+  REQUIRE_THAT(test_calc.ci_calc->energies[0], Catch::Matchers::WithinAbs(-75.01170307729812, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE_THAT(test_calc.ci_calc->energies[1], Catch::Matchers::WithinAbs(-74.59209776692875, POLYQUANT_TEST_EPSILON_LOOSE));
+  REQUIRE(rank_spread(test_calc.ci_calc->energies[0]) < 1e-12);
+}
+
+TEST_CASE("MPI: H2O/sto-3g quantum H SCF with the independent tasks, coulomb engine and LinK builds.") {
+  // the independent fock builds are dealt out over the ranks, the coulomb engine and LinK split their bra pairs over them
+  for (auto input : {"h2o.json", "h2o_coulomb_engine.json", "h2o_link.json"}) {
+    POLYQUANT_CALCULATION test_calc("../../tests/data/h2o_sto3g_quantumHlibrary/" + std::string(input));
+    test_calc.run();
+    REQUIRE(test_calc.scf_calc->converged);
+    REQUIRE_THAT(test_calc.scf_calc->E_particles[0], Catch::Matchers::WithinAbs(3.0365625787, POLYQUANT_TEST_EPSILON_LOOSE));
+    REQUIRE_THAT(test_calc.scf_calc->E_particles[1], Catch::Matchers::WithinAbs(-81.1530733704, POLYQUANT_TEST_EPSILON_LOOSE));
+    REQUIRE_THAT(test_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(-78.1165107917, POLYQUANT_TEST_EPSILON_LOOSE));
+    REQUIRE(rank_spread(test_calc.scf_calc->E_total) < 1e-12);
+  }
+}
+
+TEST_CASE("MPI: PsH/custom basis density fitting.") {
+  // the RI-K auxiliary functions are split over the ranks
+  POLYQUANT_CALCULATION exact_calc("../../tests/data/PsH_wpos/PsH_wpos.json");
+  exact_calc.run();
+  POLYQUANT_CALCULATION df_calc("../../tests/data/PsH_wpos/PsH_wpos_density_fitting.json");
+  df_calc.run();
+  REQUIRE(df_calc.scf_calc->converged);
+  REQUIRE_THAT(df_calc.scf_calc->E_total, Catch::Matchers::WithinAbs(exact_calc.scf_calc->E_total, 1e-4));
+  REQUIRE(rank_spread(df_calc.scf_calc->E_total) < 1e-12);
+}
@@ -0,0 +1,55 @@
+#include "calculation/calculation.hpp"
+#include "io/utils.hpp"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+
+// count heap allocations made while count_allocations is set, used to check that Slater_Condon doesn't allocate. Replacing the global
+// operator new affects the whole executable, so these tests live in their own.
+static std::atomic<bool> count_allocations = false;
+static std::atomic<std::size_t> num_allocations = 0;
+void *operator new(std::size_t size) {
+  if (count_allocations) {
+    num_allocations++;
+  }
+  if (auto ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+using namespace polyquant;
+
+TEST_CASE("CI: Slater_Condon allocation free", "[CI]") {
+  POLYQUANT_CALCULATION test_calc;
+  test_calc.setup_calculation("../../tests/data/PsH_wpos/PsH_wpos.json");
+  test_calc.run();
+  POLYQUANT_EPCI test_ci;
+  std::tuple<int, int, int> ex_lvl = {1, 1, 1};
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.setup(test_calc.scf_calc);
+  test_ci.calculate_integrals();
+  test_ci.setup_determinants();
+  test_ci.detset.precompute_diagonal_Slater_Condon();
+
+  // same and mixed particle kernels for every excitation level, all without touching the heap
+  auto N_dets = test_ci.detset.N_dets;
+  test_ci.detset.Slater_Condon_calls.reset();
+  double checksum = 0.0;
+  num_allocations = 0;
+  count_allocations = true;
+  for (auto i_det = 0; i_det < N_dets; i_det++) {
+    for (auto j_det = 0; j_det < N_dets; j_det++) {
+      checksum += test_ci.detset.Slater_Condon(i_det, j_det);
+    }
+  }
+  count_allocations = false;
+  REQUIRE(num_allocations == 0);
+  REQUIRE(test_ci.detset.Slater_Condon_calls.total() == static_cast<std::size_t>(N_dets) * N_dets);
+  REQUIRE(std::isfinite(checksum));
+}
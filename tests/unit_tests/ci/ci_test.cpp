@@ -4,8 +4,10 @@
 #include "io/utils.hpp"
 #include "molecule/molecule.hpp"
 #include <bitset>
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <omp.h>
 
 using namespace polyquant;
 
@@ -129,6 +131,27 @@ TEST_CASE("CI: setup/detset construction ", "[CI]") {
   REQUIRE(det_found);
 }
 
+TEST_CASE("CI: det_idx_unfold reverse index ", "[CI]") {
+  POLYQUANT_CALCULATION test_calc;
+  test_calc.setup_calculation("../../tests/data/h2o_sto3gfile/h2o.json");
+  test_calc.run();
+  POLYQUANT_EPCI test_ci;
+  std::tuple<int, int, int> ex_lvl = {2, 2, 2};
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.setup(test_calc.scf_calc);
+  test_ci.calculate_integrals();
+  test_ci.calculate_fc_energy();
+  test_ci.setup_determinants();
+  REQUIRE(test_ci.detset.det_idx_stride == 2);
+  REQUIRE(test_ci.detset.dets_unfolded.size() == test_ci.detset.N_dets * test_ci.detset.det_idx_stride);
+  for (auto const &[det_idx, global_idx] : test_ci.detset.dets) {
+    REQUIRE(test_ci.detset.det_idx_unfold(global_idx) == det_idx);
+  }
+  auto dets_unfolded = test_ci.detset.dets_unfolded;
+  test_ci.detset.rebuild_dets_unfolded();
+  REQUIRE(test_ci.detset.dets_unfolded == dets_unfolded);
+}
+
 TEST_CASE("CI: frozen core energy ", "[CI]") {
   POLYQUANT_CALCULATION test_calc;
   test_calc.setup_calculation("../../tests/data/h2o_sto3gfile/h2o.json");
@@ -167,10 +190,10 @@ TEST_CASE("CI: get_det ", "[CI]") {
   det = test_ci.detset.get_det(0, 1, 0);
   REQUIRE(hf_det.to_ulong() == det[0]);
 
-  det = test_ci.detset.get_det_withfcorbs(0, 0, 0);
-  REQUIRE(hf_det.to_ulong() == det[0]);
-  det = test_ci.detset.get_det_withfcorbs(0, 1, 0);
-  REQUIRE(hf_det.to_ulong() == det[0]);
+  auto fc_det = test_ci.detset.get_det_withfcorbs(0, 0, 0);
+  REQUIRE(hf_det.to_ulong() == fc_det[0]);
+  fc_det = test_ci.detset.get_det_withfcorbs(0, 1, 0);
+  REQUIRE(hf_det.to_ulong() == fc_det[0]);
 }
 
 TEST_CASE("CI: frozen core get_det ", "[CI]") {
@@ -194,20 +217,22 @@ TEST_CASE("CI: frozen core get_det ", "[CI]") {
   det = test_ci.detset.get_det(0, 1, 0);
   REQUIRE(hf_det.to_ulong() == det[0]);
 
-  det = test_ci.detset.get_det_withfcorbs(0, 0, 0);
-  REQUIRE(hf_det_withfc.to_ulong() == det[0]);
-  det = test_ci.detset.get_det_withfcorbs(0, 1, 0);
-  REQUIRE(hf_det_withfc.to_ulong() == det[0]);
+  auto fc_det = test_ci.detset.get_det_withfcorbs(0, 0, 0);
+  REQUIRE(hf_det_withfc.to_ulong() == fc_det[0]);
+  fc_det = test_ci.detset.get_det_withfcorbs(0, 1, 0);
+  REQUIRE(hf_det_withfc.to_ulong() == fc_det[0]);
 
   test_ci.detset.max_orb[0] = 75;
   std::vector<uint64_t> det2 = {0UL, 9223372036854775809UL};
-  test_ci.detset.unique_dets[0][0][0] = det2;
-  det = test_ci.detset.get_det_withfcorbs(0, 0, 0);
+  // the arena has a fixed number of words per bitstring so it is refilled with the two word bitstring
+  test_ci.detset.unique_dets[0][0].clear();
+  test_ci.detset.unique_dets[0][0].push_back(det2);
+  fc_det = test_ci.detset.get_det_withfcorbs(0, 0, 0);
 
   std::cout << "Before pad" << det2[1] << " " << det2[0] << std::endl;
-  std::cout << "after pad" << det[1] << " " << det[0] << std::endl;
-  REQUIRE(2 == det[0]);
-  REQUIRE(7 == det[1]);
+  std::cout << "after pad" << fc_det[1] << " " << fc_det[0] << std::endl;
+  REQUIRE(2 == fc_det[0]);
+  REQUIRE(7 == fc_det[1]);
 }
 
 TEST_CASE("CI: get holes ", "[CI]") {
@@ -368,6 +393,48 @@ TEST_CASE("CI: get phase ", "[CI]") {
   auto bphase = detset.get_phase(Be_bug_det_i_b, Be_bug_det_j_b, holes, parts);
   CHECK(bphase == 1.0);
 }
+
+TEST_CASE("CI: determinant arena ", "[CI]") {
+  POLYQUANT_DET_ARENA<uint64_t> arena;
+  std::vector<uint64_t> bigger_hf_det_vec = {7, 127};
+  std::vector<uint64_t> bigger_single_ext_vec = {519, 63};
+  arena.push_back(bigger_hf_det_vec);
+  arena.push_back(bigger_single_ext_vec);
+  REQUIRE(arena.size() == 2);
+  REQUIRE(arena.n_int() == 2);
+  REQUIRE(Polyquant_det_equal(arena[0], bigger_hf_det_vec));
+  REQUIRE(Polyquant_det_equal(arena[1], bigger_single_ext_vec));
+  auto count = 0;
+  for (auto det : arena) {
+    REQUIRE(det.size() == 2);
+    count++;
+  }
+  REQUIRE(count == 2);
+
+  // the fixed word count copies give the same holes, particles and phase as the span interface
+  auto det_i = arena.get_fixed<2>(0);
+  auto det_j = arena.get_fixed<2>(1);
+  POLYQUANT_ORBITAL_LIST<2> fixed_holes, fixed_parts;
+  Polyquant_det_holes_or_parts<false>(det_i, det_j, fixed_holes);
+  Polyquant_det_holes_or_parts<true>(det_i, det_j, fixed_parts);
+  POLYQUANT_DETSET<uint64_t> detset;
+  std::vector<int> holes, parts;
+  detset.get_holes(arena[0], arena[1], holes);
+  detset.get_parts(arena[0], arena[1], parts);
+  REQUIRE(fixed_holes.size() == 1);
+  REQUIRE(fixed_parts.size() == 1);
+  REQUIRE(fixed_holes[0] == holes[0]);
+  REQUIRE(fixed_parts[0] == parts[0]);
+  REQUIRE(Polyquant_det_num_excitation(det_i, det_j) == 1);
+  CHECK(Polyquant_det_phase(det_i, fixed_holes, fixed_parts) == -1.0);
+  CHECK(detset.get_phase(arena[0], arena[1], holes, parts) == -1.0);
+
+  std::vector<uint64_t> new_det = {0, 1};
+  arena.set(1, new_det);
+  REQUIRE(Polyquant_det_equal(arena[1], new_det));
+  arena.clear();
+  REQUIRE(arena.empty());
+}
 TEST_CASE("CI: get occ virt ", "[CI]") {
   POLYQUANT_DETSET<uint64_t> detset;
   detset.max_orb = {7};
@@ -552,6 +619,57 @@ TEST_CASE("CI: same part ham double ", "[CI]") {
   REQUIRE_THAT(off_diag_ham_double_elem, Catch::Matchers::WithinAbs(off_diag_ham_double_elem_thru_SC, POLYQUANT_TEST_EPSILON_LOOSE));
 }
 
+TEST_CASE("CI: Slater_Condon call counters", "[CI]") {
+  POLYQUANT_CALCULATION test_calc;
+  test_calc.setup_calculation("../../tests/data/PsH_wpos/PsH_wpos.json");
+  test_calc.run();
+  POLYQUANT_EPCI test_ci;
+  std::tuple<int, int, int> ex_lvl = {1, 1, 1};
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.setup(test_calc.scf_calc);
+  test_ci.calculate_integrals();
+  test_ci.setup_determinants();
+  test_ci.detset.precompute_diagonal_Slater_Condon();
+
+  // the per thread counters add up to the number of calls made inside a parallel region, also with more threads than counter slots
+  auto N_dets = test_ci.detset.N_dets;
+  auto max_threads = omp_get_max_threads();
+  test_ci.detset.Slater_Condon_calls.reset();
+  test_ci.detset.Slater_Condon_diagonal_calls.reset();
+#pragma omp parallel for num_threads(2 * max_threads + 1)
+  for (auto i_det = 0; i_det < N_dets; i_det++) {
+    for (auto j_det = 0; j_det < N_dets; j_det++) {
+      test_ci.detset.Slater_Condon(i_det, j_det);
+    }
+  }
+  REQUIRE(test_ci.detset.Slater_Condon_calls.total() == static_cast<std::size_t>(N_dets) * N_dets);
+  REQUIRE(test_ci.detset.Slater_Condon_diagonal_calls.total() == static_cast<std::size_t>(N_dets));
+}
+
+TEST_CASE("CI: Slater_Condon row benchmark", "[CI][!benchmark]") {
+  POLYQUANT_CALCULATION test_calc;
+  test_calc.setup_calculation("../../tests/data/PsH_wpos/PsH_wpos.json");
+  test_calc.run();
+  POLYQUANT_EPCI test_ci;
+  std::tuple<int, int, int> ex_lvl = {1, 1, 1};
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.setup(test_calc.scf_calc);
+  test_ci.calculate_integrals();
+  test_ci.setup_determinants();
+  test_ci.detset.precompute_diagonal_Slater_Condon();
+
+  auto N_dets = test_ci.detset.N_dets;
+  BENCHMARK("Slater_Condon row") {
+    auto row_sum = 0.0;
+    for (auto j_det = 0; j_det < N_dets; j_det++) {
+      row_sum += test_ci.detset.Slater_Condon(0, j_det);
+    }
+    return row_sum;
+  };
+}
+
 TEST_CASE("CI: det_idx_unfold", "[CI]") {
   POLYQUANT_CALCULATION test_calc;
   test_calc.setup_calculation("../../tests/data/h2o_sto3gfile/h2o.json");
@@ -575,6 +693,111 @@ TEST_CASE("CI: det_idx_unfold", "[CI]") {
     }
   }
 }
+
+TEST_CASE("CI: det_idx_fold", "[CI]") {
+  POLYQUANT_CALCULATION test_calc;
+  test_calc.setup_calculation("../../tests/data/h2o_sto3gfile/h2o.json");
+  test_calc.run();
+  POLYQUANT_EPCI test_ci;
+  std::tuple<int, int, int> ex_lvl = {1, 1, 1};
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.setup(test_calc.scf_calc);
+  test_ci.calculate_integrals();
+  test_ci.setup_determinants();
+
+  REQUIRE(test_ci.detset.det_address_dense);
+  for (auto i = 0; i < test_ci.detset.N_dets; i++) {
+    auto unfolded_idx = test_ci.detset.det_idx_unfold(i);
+    REQUIRE(test_ci.detset.det_idx_fold(unfolded_idx) == i);
+  }
+  // an alpha single combined with a beta single is a double excitation, which is not in the CIS space
+  std::array<int, 2> missing_idx = {1, 1};
+  REQUIRE(test_ci.detset.det_idx_fold(missing_idx) == -1);
+
+  // the hash map fallback must agree with the dense table
+  test_ci.detset.det_address_max_size = 0;
+  test_ci.detset.build_det_address();
+  REQUIRE(!test_ci.detset.det_address_dense);
+  for (auto i = 0; i < test_ci.detset.N_dets; i++) {
+    auto unfolded_idx = test_ci.detset.det_idx_unfold(i);
+    REQUIRE(test_ci.detset.det_idx_fold(unfolded_idx) == i);
+  }
+  REQUIRE(test_ci.detset.det_idx_fold(missing_idx) == -1);
+}
+
+TEST_CASE("CI: det_idx_fold sparse space", "[CI]") {
+  // 200 x 200 string pairs but only the 399 with one spin in its first string, well below det_address_min_density
+  POLYQUANT_DETSET<uint64_t> detset;
+  const auto num_strings = 200;
+  detset.unique_dets.resize(1);
+  detset.unique_dets[0].resize(2);
+  for (auto idx_spin = 0; idx_spin < 2; idx_spin++) {
+    for (uint64_t string = 0; string < num_strings; string++) {
+      std::vector<uint64_t> det = {string};
+      detset.unique_dets[0][idx_spin].push_back(det);
+    }
+  }
+  detset.det_idx_stride = 2;
+  for (auto i = 0; i < num_strings; i++) {
+    detset.add_det({i, 0});
+  }
+  for (auto j = 1; j < num_strings; j++) {
+    detset.add_det({0, j});
+  }
+  detset.build_det_address();
+  REQUIRE(detset.N_dets < detset.det_address_min_density * num_strings * num_strings);
+  REQUIRE(!detset.det_address_dense);
+  REQUIRE(detset.det_address.empty());
+  for (auto i = 0; i < detset.N_dets; i++) {
+    REQUIRE(detset.det_idx_fold(detset.det_idx_view(i)) == i);
+  }
+  std::array<int, 2> missing_idx = {1, 1};
+  REQUIRE(detset.det_idx_fold(missing_idx) == -1);
+
+  // the string driven sigma walks the product space, so it keeps the table regardless
+  detset.string_driven_sigma = true;
+  detset.build_det_address();
+  REQUIRE(detset.det_address_dense);
+  for (auto i = 0; i < detset.N_dets; i++) {
+    REQUIRE(detset.det_idx_fold(detset.det_idx_view(i)) == i);
+  }
+  REQUIRE(detset.det_idx_fold(missing_idx) == -1);
+}
+
+TEST_CASE("CI: unique excitation maps", "[CI]") {
+  POLYQUANT_CALCULATION test_calc;
+  test_calc.setup_calculation("../../tests/data/h2o_sto3gfile/h2o.json");
+  test_calc.run();
+  POLYQUANT_EPCI test_ci;
+  std::tuple<int, int, int> ex_lvl = {2, 2, 2};
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.setup(test_calc.scf_calc);
+  test_ci.calculate_integrals();
+  test_ci.setup_determinants();
+
+  // compare against every pair of unique strings
+  for (auto idx_spin = 0; idx_spin < 2; idx_spin++) {
+    const auto &strings = test_ci.detset.unique_dets[0][idx_spin];
+    const auto &singles = test_ci.detset.unique_singles[0][idx_spin];
+    const auto &doubles = test_ci.detset.unique_doubles[0][idx_spin];
+    REQUIRE(singles.size() == strings.size());
+    REQUIRE(doubles.size() == strings.size());
+    for (auto idx_idet = 0; idx_idet < strings.size(); idx_idet++) {
+      std::vector<std::size_t> ref_singles;
+      std::vector<std::size_t> ref_doubles;
+      for (auto idx_jdet = 0; idx_jdet < strings.size(); idx_jdet++) {
+        auto num_exec = test_ci.detset.single_spin_num_excitation(strings[idx_idet], strings[idx_jdet]);
+        if (num_exec == 1) {
+          ref_singles.push_back(idx_jdet);
+        } else if (num_exec == 2) {
+          ref_doubles.push_back(idx_jdet);
+        }
+      }
+      REQUIRE(std::equal(ref_singles.begin(), ref_singles.end(), singles[idx_idet].begin(), singles[idx_idet].end()));
+      REQUIRE(std::equal(ref_doubles.begin(), ref_doubles.end(), doubles[idx_idet].begin(), doubles[idx_idet].end()));
+    }
+  }
+}
 TEST_CASE("CI: mixed part ham diag ", "[CI]") {
   POLYQUANT_CALCULATION test_calc;
   test_calc.setup_calculation("../../tests/data/li-_custombasis_wpos/Li_wpos.json");
@@ -767,6 +990,224 @@ TEST_CASE("CI: single species sigma slow v fast", "[CI]") {
   }
 }
 
+TEST_CASE("CI: single species sigma string driven", "[CI]") {
+  POLYQUANT_CALCULATION test_calc;
+  test_calc.setup_calculation("../../tests/data/h2o_sto3gfile/h2o.json");
+  test_calc.run();
+  POLYQUANT_EPCI test_ci;
+  std::tuple<int, int, int> ex_lvl = {2, 2, 2};
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.setup(test_calc.scf_calc);
+  test_ci.calculate_integrals();
+  test_ci.setup_determinants();
+  test_ci.detset.precompute_diagonal_Slater_Condon();
+
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> C;
+  C.resize(test_ci.detset.N_dets, 2);
+  for (auto i = 0; i < test_ci.detset.N_dets; i++) {
+    C(i, 0) = 1.0 / test_ci.detset.N_dets;
+    C(i, 1) = std::sin(1.0 + i);
+  }
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> sigma_determinant;
+  sigma_determinant.setZero(test_ci.detset.N_dets, 2);
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> sigma_string;
+  sigma_string.setZero(test_ci.detset.N_dets, 2);
+
+  test_ci.detset.create_sigma(sigma_determinant, C);
+  test_ci.detset.string_driven_sigma = true;
+  test_ci.detset.create_sigma(sigma_string, C);
+  for (auto i = 0; i < test_ci.detset.N_dets; i++) {
+    for (auto state_idx = 0; state_idx < 2; state_idx++) {
+      REQUIRE_THAT(sigma_string(i, state_idx), Catch::Matchers::WithinAbs(sigma_determinant(i, state_idx), POLYQUANT_TEST_EPSILON_TIGHT));
+    }
+  }
+}
+
+TEST_CASE("CI: multispecies sigma row gather v scatter", "[CI]") {
+  POLYQUANT_CALCULATION test_calc;
+  test_calc.setup_calculation("../../tests/data/PsH_wpos/PsH_wpos.json");
+  test_calc.run();
+  POLYQUANT_EPCI test_ci;
+  std::tuple<int, int, int> ex_lvl = {2, 2, 2};
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.setup(test_calc.scf_calc);
+  test_ci.calculate_integrals();
+  test_ci.setup_determinants();
+  test_ci.detset.precompute_diagonal_Slater_Condon();
+
+  // the row blocks cover every determinant exactly once
+  std::vector<int> row_offsets;
+  test_ci.detset.sigma_row_partition(row_offsets);
+  REQUIRE(row_offsets.front() == 0);
+  REQUIRE(row_offsets.back() == test_ci.detset.N_dets);
+  REQUIRE(std::is_sorted(row_offsets.begin(), row_offsets.end()));
+
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> C;
+  C.resize(test_ci.detset.N_dets, 2);
+  for (auto i = 0; i < test_ci.detset.N_dets; i++) {
+    C(i, 0) = 1.0 / test_ci.detset.N_dets;
+    C(i, 1) = std::sin(1.0 + i);
+  }
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> sigma_scatter;
+  sigma_scatter.setZero(test_ci.detset.N_dets, 2);
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> sigma_gather;
+  sigma_gather.setZero(test_ci.detset.N_dets, 2);
+
+  test_ci.detset.gather_sigma = false;
+  test_ci.detset.create_sigma(sigma_scatter, C);
+  test_ci.detset.gather_sigma = true;
+  test_ci.detset.create_sigma(sigma_gather, C);
+  for (auto i = 0; i < test_ci.detset.N_dets; i++) {
+    for (auto state_idx = 0; state_idx < 2; state_idx++) {
+      REQUIRE_THAT(sigma_gather(i, state_idx), Catch::Matchers::WithinAbs(sigma_scatter(i, state_idx), POLYQUANT_TEST_EPSILON_VERYTIGHT));
+    }
+  }
+}
+
+TEST_CASE("CI: multispecies explicit hamiltonian", "[CI]") {
+  POLYQUANT_CALCULATION test_calc;
+  test_calc.setup_calculation("../../tests/data/PsH_wpos/PsH_wpos.json");
+  test_calc.run();
+  POLYQUANT_EPCI test_ci;
+  std::tuple<int, int, int> ex_lvl = {1, 1, 1};
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.setup(test_calc.scf_calc);
+  test_ci.calculate_integrals();
+  test_ci.setup_determinants();
+  test_ci.detset.precompute_diagonal_Slater_Condon();
+
+  auto check_upper_triangle = [&](double threshold) {
+    test_ci.detset.screening_threshold = threshold;
+    test_ci.detset.create_ham();
+    const auto &ham = test_ci.detset.ham;
+    REQUIRE(ham.isCompressed());
+    for (auto i = 0; i < test_ci.detset.N_dets; i++) {
+      REQUIRE(std::is_sorted(ham.innerIndexPtr() + ham.outerIndexPtr()[i], ham.innerIndexPtr() + ham.outerIndexPtr()[i + 1]));
+      for (auto j = 0; j < test_ci.detset.N_dets; j++) {
+        auto elem = j < i ? 0.0 : test_ci.detset.Slater_Condon(i, j);
+        if (threshold != 0.0 && std::abs(elem) <= threshold) {
+          elem = 0.0;
+        }
+        REQUIRE_THAT(ham.coeff(i, j), Catch::Matchers::WithinAbs(elem, POLYQUANT_TEST_EPSILON_VERYTIGHT));
+      }
+    }
+  };
+  check_upper_triangle(0.0);
+  auto num_nonzero = test_ci.detset.ham.nonZeros();
+  check_upper_triangle(1e-3);
+  REQUIRE(test_ci.detset.ham.nonZeros() <= num_nonzero);
+}
+
+TEST_CASE("CI: packed explicit hamiltonian", "[CI]") {
+  POLYQUANT_CALCULATION test_calc;
+  test_calc.setup_calculation("../../tests/data/PsH_wpos/PsH_wpos.json");
+  test_calc.run();
+  POLYQUANT_EPCI test_ci;
+  std::tuple<int, int, int> ex_lvl = {2, 2, 2};
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.setup(test_calc.scf_calc);
+  test_ci.calculate_integrals();
+  test_ci.setup_determinants();
+  test_ci.detset.precompute_diagonal_Slater_Condon();
+
+  test_ci.detset.ham_storage = "csr";
+  test_ci.detset.create_ham();
+  test_ci.detset.ham_storage = "packed";
+  test_ci.detset.create_ham();
+  test_ci.detset.ham_storage = "packed_float";
+  test_ci.detset.create_ham();
+  const auto &ham = test_ci.detset.ham;
+  const auto &packed_ham = test_ci.detset.packed_ham;
+  const auto &packed_ham_float = test_ci.detset.packed_ham_float;
+  REQUIRE(packed_ham.nonZeros() == ham.nonZeros());
+  REQUIRE(packed_ham_float.nonZeros() == ham.nonZeros());
+  REQUIRE(packed_ham.memory_bytes() < static_cast<std::size_t>(ham.nonZeros()) * (sizeof(double) + sizeof(int)));
+  REQUIRE(packed_ham_float.memory_bytes() < packed_ham.memory_bytes());
+  for (auto i = 0; i < std::min(test_ci.detset.N_dets, 50); i++) {
+    for (auto j = 0; j < test_ci.detset.N_dets; j++) {
+      auto elem = j < i ? ham.coeff(j, i) : ham.coeff(i, j);
+      REQUIRE_THAT(packed_ham(i, j), Catch::Matchers::WithinAbs(elem, POLYQUANT_TEST_EPSILON_VERYTIGHT));
+      REQUIRE_THAT(packed_ham_float(i, j), Catch::Matchers::WithinRel(elem, 1e-6) || Catch::Matchers::WithinAbs(elem, 1e-7));
+    }
+  }
+
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> C;
+  C.resize(test_ci.detset.N_dets, 2);
+  for (auto i = 0; i < test_ci.detset.N_dets; i++) {
+    C(i, 0) = 1.0 / test_ci.detset.N_dets;
+    C(i, 1) = std::sin(1.0 + i);
+  }
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> sigma_csr = ham.selfadjointView<Eigen::Upper>() * C;
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> sigma_packed = packed_ham * C;
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> sigma_packed_float = packed_ham_float * C;
+  for (auto i = 0; i < test_ci.detset.N_dets; i++) {
+    for (auto state_idx = 0; state_idx < 2; state_idx++) {
+      REQUIRE_THAT(sigma_packed(i, state_idx), Catch::Matchers::WithinAbs(sigma_csr(i, state_idx), POLYQUANT_TEST_EPSILON_VERYTIGHT));
+      REQUIRE_THAT(sigma_packed_float(i, state_idx), Catch::Matchers::WithinAbs(sigma_csr(i, state_idx), 1e-5));
+    }
+  }
+}
+
+TEST_CASE("CI: threaded symmetric sparse product", "[CI]") {
+  // uneven rows with an empty row, split into more ranges than rows with elements
+  std::vector<std::int64_t> row_offsets = {0, 10, 20, 30, 31, 31, 40};
+  auto part_rows = Polyquant_balanced_row_split(row_offsets, 8);
+  REQUIRE(part_rows.size() == 9);
+  REQUIRE(part_rows.front() == 0);
+  REQUIRE(part_rows.back() == 6);
+  REQUIRE(std::is_sorted(part_rows.begin(), part_rows.end()));
+
+  // more blocks than the one core of a CI runner so the tiles run in parallel anti-diagonals
+  auto num_threads = omp_get_max_threads();
+  omp_set_num_threads(4);
+  POLYQUANT_CALCULATION test_calc;
+  test_calc.setup_calculation("../../tests/data/PsH_wpos/PsH_wpos.json");
+  test_calc.run();
+  POLYQUANT_EPCI test_ci;
+  std::tuple<int, int, int> ex_lvl = {2, 2, 2};
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.excitation_level.push_back(ex_lvl);
+  test_ci.setup(test_calc.scf_calc);
+  test_ci.calculate_integrals();
+  test_ci.setup_determinants();
+  test_ci.detset.precompute_diagonal_Slater_Condon();
+  test_ci.detset.create_ham();
+  test_ci.detset.ham_storage = "packed";
+  test_ci.detset.create_ham();
+  const auto &ham = test_ci.detset.ham;
+
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> C;
+  C.resize(test_ci.detset.N_dets, 3);
+  for (auto i = 0; i < test_ci.detset.N_dets; i++) {
+    C(i, 0) = 1.0 / test_ci.detset.N_dets;
+    C(i, 1) = std::sin(1.0 + i);
+    C(i, 2) = std::cos(2.0 * i);
+  }
+  // serial reference
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> sigma_serial = ham.selfadjointView<Eigen::Upper>() * C;
+  POLYQUANT_SPARSE_SYM_MAT_PROD op_sparse(ham);
+  REQUIRE(op_sparse.rows() == test_ci.detset.N_dets);
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> sigma_threaded = op_sparse * C;
+  // the second product reuses the cursors and buffers of the first
+  sigma_threaded = op_sparse * C;
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> sigma_packed = test_ci.detset.packed_ham * C;
+  Eigen::Matrix<double, Eigen::Dynamic, 1> sigma_vec(test_ci.detset.N_dets);
+  Eigen::Matrix<double, Eigen::Dynamic, 1> C_vec = C.col(1);
+  op_sparse.perform_op(C_vec.data(), sigma_vec.data());
+  omp_set_num_threads(num_threads);
+  for (auto i = 0; i < test_ci.detset.N_dets; i++) {
+    REQUIRE_THAT(op_sparse(i, i), Catch::Matchers::WithinAbs(test_ci.detset.diagonal_Hii[i], POLYQUANT_TEST_EPSILON_VERYTIGHT));
+    REQUIRE_THAT(sigma_vec[i], Catch::Matchers::WithinAbs(sigma_serial(i, 1), POLYQUANT_TEST_EPSILON_VERYTIGHT));
+    for (auto state_idx = 0; state_idx < 3; state_idx++) {
+      REQUIRE_THAT(sigma_threaded(i, state_idx), Catch::Matchers::WithinAbs(sigma_serial(i, state_idx), POLYQUANT_TEST_EPSILON_VERYTIGHT));
+      REQUIRE_THAT(sigma_packed(i, state_idx), Catch::Matchers::WithinAbs(sigma_serial(i, state_idx), POLYQUANT_TEST_EPSILON_VERYTIGHT));
+    }
+  }
+}
+
 TEST_CASE("CI: multispecies sigma slow v fast", "[CI]") {
   POLYQUANT_CALCULATION test_calc;
   test_calc.setup_calculation("../../tests/data/PsH_wpos/PsH_wpos.json");